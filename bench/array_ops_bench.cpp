@@ -0,0 +1,170 @@
+#include <benchmark/benchmark.h>
+#include "array_ops.h"
+#include "calculator.h"
+#include "work_stealing_pool.h"
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+const std::size_t COUNT = 4096;
+
+struct Operands {
+    std::vector<double> a;
+    std::vector<double> b;
+    std::vector<double> out;
+    std::vector<unsigned char> errors;
+
+    Operands() : a(COUNT), b(COUNT), out(COUNT), errors(COUNT) {
+        std::mt19937_64 rng(42);
+        std::uniform_real_distribution<double> dist(0.001, 1000.0);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            a[i] = dist(rng);
+            b[i] = dist(rng);
+        }
+    }
+};
+
+Operands& operands() {
+    static Operands values;
+    return values;
+}
+
+enum Op { ADD, MULTIPLY, DIVIDE, SQRT, LN, SIN, COS, TAN };
+
+// One Calculator call per element, as callers had to do before
+void BM_ScalarLoop(benchmark::State& state) {
+    Operands& v = operands();
+    Calculator calc(0);
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            switch (state.range(0)) {
+                case ADD: v.out[i] = calc.add(v.a[i], v.b[i]); break;
+                case MULTIPLY: v.out[i] = calc.multiply(v.a[i], v.b[i]); break;
+                case DIVIDE: v.out[i] = calc.divide(v.a[i], v.b[i]); break;
+                case SQRT: v.out[i] = calc.sqrt(v.a[i]); break;
+                case LN: v.out[i] = calc.ln(v.a[i]); break;
+                case SIN: v.out[i] = calc.sin(v.a[i]); break;
+                case COS: v.out[i] = calc.cos(v.a[i]); break;
+                case TAN: v.out[i] = calc.tan(v.a[i]); break;
+            }
+        }
+        benchmark::DoNotOptimize(v.out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+
+void BM_Array(benchmark::State& state) {
+    Operands& v = operands();
+    ArrayIsa isa = static_cast<ArrayIsa>(state.range(1));
+    if (setArrayIsa(isa) != isa) {
+        state.SkipWithError("instruction set not supported");
+        return;
+    }
+    state.SetLabel(arrayIsaName(isa));
+    for (auto _ : state) {
+        switch (state.range(0)) {
+            case ADD: arrayAdd(v.a.data(), v.b.data(), v.out.data(), COUNT); break;
+            case MULTIPLY: arrayMultiply(v.a.data(), v.b.data(), v.out.data(), COUNT); break;
+            case DIVIDE: arrayDivide(v.a.data(), v.b.data(), v.out.data(), COUNT, v.errors.data()); break;
+            case SQRT: arraySqrt(v.a.data(), v.out.data(), COUNT, v.errors.data()); break;
+            case LN: arrayLn(v.a.data(), v.out.data(), COUNT, v.errors.data()); break;
+            case SIN: arraySin(v.a.data(), v.out.data(), COUNT); break;
+            case COS: arrayCos(v.a.data(), v.out.data(), COUNT); break;
+            case TAN: arrayTan(v.a.data(), v.out.data(), COUNT); break;
+        }
+        benchmark::DoNotOptimize(v.out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+    setArrayIsa(supportedArrayIsa());
+}
+
+void operationArgs(benchmark::internal::Benchmark* bench) {
+    for (int op = ADD; op <= TAN; ++op) {
+        bench->Args({op});
+    }
+}
+
+void isaArgs(benchmark::internal::Benchmark* bench) {
+    for (int op = ADD; op <= TAN; ++op) {
+        for (int isa = static_cast<int>(ArrayIsa::Scalar); isa <= static_cast<int>(ArrayIsa::Avx512); ++isa) {
+            bench->Args({op, isa});
+        }
+    }
+}
+
+BENCHMARK(BM_ScalarLoop)->Apply(operationArgs);
+BENCHMARK(BM_Array)->Apply(isaArgs);
+
+const std::size_t REDUCTION_COUNT = std::size_t(1) << 24;
+
+const std::vector<double>& reductionInput() {
+    static const std::vector<double> values = [] {
+        std::mt19937_64 rng(7);
+        std::uniform_real_distribution<double> dist(-1e3, 1e3);
+        std::vector<double> v(REDUCTION_COUNT);
+        for (double& x : v) {
+            x = dist(rng);
+        }
+        return v;
+    }();
+    return values;
+}
+
+// Summing with chained Calculator::add calls, one history record each
+void BM_SumCalculatorLoop(benchmark::State& state) {
+    const std::vector<double>& x = reductionInput();
+    Calculator calc;
+    for (auto _ : state) {
+        double total = 0;
+        for (double v : x) {
+            total = calc.add(total, v);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * REDUCTION_COUNT * sizeof(double)));
+}
+BENCHMARK(BM_SumCalculatorLoop)->Unit(benchmark::kMillisecond);
+
+// Plain uncompensated loop, the speed limit for one thread
+void BM_SumNaiveLoop(benchmark::State& state) {
+    const std::vector<double>& x = reductionInput();
+    for (auto _ : state) {
+        double total = 0;
+        for (double v : x) {
+            total += v;
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * REDUCTION_COUNT * sizeof(double)));
+}
+BENCHMARK(BM_SumNaiveLoop)->Unit(benchmark::kMillisecond);
+
+enum Reduction { SUM, VARIANCE, MIN_MAX, PREFIX_SUM };
+
+// Args: reduction, worker threads (1 = no pool)
+void BM_Reduction(benchmark::State& state) {
+    const std::vector<double>& x = reductionInput();
+    std::vector<double> out(state.range(0) == PREFIX_SUM ? REDUCTION_COUNT : 0);
+    std::unique_ptr<WorkStealingPool> pool;
+    if (state.range(1) > 1) {
+        pool.reset(new WorkStealingPool(static_cast<std::size_t>(state.range(1))));
+    }
+    for (auto _ : state) {
+        switch (state.range(0)) {
+            case SUM: benchmark::DoNotOptimize(arraySum(x.data(), REDUCTION_COUNT, pool.get())); break;
+            case VARIANCE: benchmark::DoNotOptimize(arrayVariance(x.data(), REDUCTION_COUNT, pool.get())); break;
+            case MIN_MAX: benchmark::DoNotOptimize(arrayMax(x.data(), REDUCTION_COUNT, pool.get())); break;
+            case PREFIX_SUM: arrayPrefixSum(x.data(), out.data(), REDUCTION_COUNT, pool.get()); break;
+        }
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * REDUCTION_COUNT * sizeof(double)));
+}
+BENCHMARK(BM_Reduction)
+    ->ArgsProduct({{SUM, VARIANCE, MIN_MAX, PREFIX_SUM}, {1, 4}})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
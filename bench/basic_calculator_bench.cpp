@@ -0,0 +1,55 @@
+#include <benchmark/benchmark.h>
+#include "basic_calculator.h"
+#include "calculator.h"
+#include <vector>
+
+namespace {
+
+const std::size_t COUNT = 1024;
+
+const std::vector<double>& operands() {
+    static const std::vector<double> values = [] {
+        std::vector<double> v(COUNT);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            v[i] = 1.0 + static_cast<double>(i) * 0.25;
+        }
+        return v;
+    }();
+    return values;
+}
+
+template <typename Calc>
+void sumOfProducts(benchmark::State& state, Calc& calc) {
+    const std::vector<double>& v = operands();
+    for (auto _ : state) {
+        double total = 0;
+        for (std::size_t i = 1; i < COUNT; ++i) {
+            total = calc.add(total, calc.multiply(v[i], v[i - 1]));
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * (COUNT - 1) * 2);
+}
+
+void BM_Calculator(benchmark::State& state) {
+    Calculator calc;
+    sumOfProducts(state, calc);
+}
+
+void BM_BasicRingHistory(benchmark::State& state) {
+    BasicCalculator<RingHistory> calc;
+    sumOfProducts(state, calc);
+}
+
+void BM_BasicNoHistory(benchmark::State& state) {
+    BasicCalculator<NoHistory, Radians, StatusOnError> calc;
+    sumOfProducts(state, calc);
+}
+
+BENCHMARK(BM_Calculator);
+BENCHMARK(BM_BasicRingHistory);
+BENCHMARK(BM_BasicNoHistory);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,207 @@
+#include <benchmark/benchmark.h>
+#include "calculator.h"
+#include "metrics.h"
+#include "number_format.h"
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::size_t COUNT = 1024;
+
+const std::vector<double>& operands() {
+    static const std::vector<double> values = [] {
+        std::vector<double> v(COUNT);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            v[i] = 0.5 + static_cast<double>(i) * 0.731;
+        }
+        return v;
+    }();
+    return values;
+}
+
+// Binary operations; history is recorded as in interactive use
+template <double (Calculator::*Operation)(double, double)>
+void BM_Binary(benchmark::State& state) {
+    const std::vector<double>& v = operands();
+    Calculator calc;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        double result = (calc.*Operation)(v[i % COUNT], v[(i + 1) % COUNT]);
+        benchmark::DoNotOptimize(result);
+        ++i;
+    }
+}
+BENCHMARK_TEMPLATE(BM_Binary, &Calculator::add)->Name("BM_Add");
+BENCHMARK_TEMPLATE(BM_Binary, &Calculator::subtract)->Name("BM_Subtract");
+BENCHMARK_TEMPLATE(BM_Binary, &Calculator::multiply)->Name("BM_Multiply");
+BENCHMARK_TEMPLATE(BM_Binary, &Calculator::divide)->Name("BM_Divide");
+BENCHMARK_TEMPLATE(BM_Binary, &Calculator::power)->Name("BM_Power");
+
+template <double (Calculator::*Operation)(double)>
+void BM_Unary(benchmark::State& state) {
+    const std::vector<double>& v = operands();
+    Calculator calc;
+    std::size_t i = 0;
+    for (auto _ : state) {
+        double result = (calc.*Operation)(v[i++ % COUNT]);
+        benchmark::DoNotOptimize(result);
+    }
+}
+BENCHMARK_TEMPLATE(BM_Unary, &Calculator::sqrt)->Name("BM_Sqrt");
+BENCHMARK_TEMPLATE(BM_Unary, &Calculator::ln)->Name("BM_Ln");
+BENCHMARK_TEMPLATE(BM_Unary, &Calculator::sin)->Name("BM_Sin");
+BENCHMARK_TEMPLATE(BM_Unary, &Calculator::cos)->Name("BM_Cos");
+BENCHMARK_TEMPLATE(BM_Unary, &Calculator::tan)->Name("BM_Tan");
+
+// Same as BM_Add with measurement switched on; BM_Add shows the cost
+// of the instrumentation while it is off
+void BM_AddWithMetrics(benchmark::State& state) {
+    setMetricsEnabled(true);
+    Calculator calc;
+    double x = 0;
+    for (auto _ : state) {
+        x = calc.add(x, 1);
+    }
+    benchmark::DoNotOptimize(x);
+    setMetricsEnabled(false);
+    resetMetrics();
+}
+BENCHMARK(BM_AddWithMetrics);
+
+void BM_DomainError(benchmark::State& state) {
+    Calculator calc;
+    for (auto _ : state) {
+        try {
+            calc.divide(1.0, 0.0);
+        } catch (const std::domain_error& e) {
+            benchmark::DoNotOptimize(e.what());
+        }
+    }
+}
+BENCHMARK(BM_DomainError);
+
+void BM_MemoryOperations(benchmark::State& state) {
+    Calculator calc;
+    calc.appendNumber('7');
+    for (auto _ : state) {
+        calc.memoryStore();
+        calc.memoryAdd();
+        calc.memorySubtract();
+        benchmark::DoNotOptimize(calc.memoryRecall());
+        calc.memoryClear();
+    }
+}
+BENCHMARK(BM_MemoryOperations);
+
+// Keystroke path: "1234.5 * 67 =" typed digit by digit
+void BM_KeystrokeCalculate(benchmark::State& state) {
+    Calculator calc;
+    for (auto _ : state) {
+        calc.clear();
+        for (const char* key = "1234.5"; *key; ++key) {
+            calc.appendNumber(*key);
+        }
+        calc.setOperation('*');
+        calc.appendNumber('6');
+        calc.appendNumber('7');
+        calc.calculate();
+        benchmark::DoNotOptimize(calc.getDisplayText());
+    }
+}
+BENCHMARK(BM_KeystrokeCalculate);
+
+// What Calculator::formatNumber does for every display update
+void BM_FormatNumber(benchmark::State& state) {
+    const std::vector<double>& v = operands();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        char buffer[NUMBER_BUFFER_SIZE];
+        std::string text(buffer, formatFixed(v[i++ % COUNT] * 1e3, buffer));
+        benchmark::DoNotOptimize(text);
+    }
+}
+BENCHMARK(BM_FormatNumber);
+
+// Recording into a history that is partly filled or already at its cap
+void BM_HistoryRecord(benchmark::State& state) {
+    Calculator calc;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        calc.add(1, 2);
+    }
+    double x = 0;
+    for (auto _ : state) {
+        x = calc.add(x, 1);
+    }
+    benchmark::DoNotOptimize(x);
+}
+BENCHMARK(BM_HistoryRecord)->Arg(0)->Arg(99)->Arg(100)->Arg(1000);
+
+void BM_GetHistory(benchmark::State& state) {
+    Calculator calc;
+    for (int64_t i = 0; i < state.range(0); ++i) {
+        calc.multiply(static_cast<double>(i), 1.5);
+    }
+    for (auto _ : state) {
+        std::vector<std::string> history = calc.getHistory();
+        benchmark::DoNotOptimize(history.data());
+    }
+}
+BENCHMARK(BM_GetHistory)->Arg(10)->Arg(100)->Arg(1000);
+
+// Polling for new entries after each calculation: the whole history
+// formatted again, or only what was recorded since the last poll
+void BM_PollHistory(benchmark::State& state) {
+    Calculator calc;
+    for (int i = 0; i < 100; ++i) {
+        calc.multiply(static_cast<double>(i), 1.5);
+    }
+    std::uint64_t seen = calc.historySequence();
+    double x = 0;
+    for (auto _ : state) {
+        x = calc.add(x, 1);
+        if (state.range(0) == 0) {
+            std::vector<std::string> history = calc.getHistory();
+            benchmark::DoNotOptimize(history.data());
+        } else {
+            HistoryView fresh = calc.historySince(seen);
+            for (const HistoryRecord& record : fresh) {
+                std::string text = calc.formatHistoryRecord(record);
+                benchmark::DoNotOptimize(text.data());
+            }
+            seen = fresh.lastSequence();
+        }
+    }
+}
+BENCHMARK(BM_PollHistory)->Arg(0)->Arg(1);
+
+void BM_CompiledExpr(benchmark::State& state) {
+    Calculator calc;
+    CompiledExpr expr = calc.compile("sin(x)^2 + ln(y) / 3");
+    const std::vector<double>& v = operands();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        double values[2] = {v[i % COUNT], v[(i + 7) % COUNT]};
+        benchmark::DoNotOptimize(expr.evaluate(values));
+        ++i;
+    }
+}
+BENCHMARK(BM_CompiledExpr);
+
+void BM_ArrayMultiply(benchmark::State& state) {
+    const std::vector<double>& v = operands();
+    std::vector<double> out(COUNT);
+    Calculator calc;
+    for (auto _ : state) {
+        calc.multiply(v.data(), v.data(), out.data(), COUNT);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+BENCHMARK(BM_ArrayMultiply);
+
+} // namespace
+
+BENCHMARK_MAIN();
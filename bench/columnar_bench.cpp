@@ -0,0 +1,137 @@
+#include <benchmark/benchmark.h>
+#include "calculator.h"
+#include "columnar.h"
+#include "work_stealing_pool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Dataset rows; COLUMNAR_ROWS overrides the 1e8 default for smaller machines
+std::size_t datasetRows() {
+    const char* rows = std::getenv("COLUMNAR_ROWS");
+    return rows ? static_cast<std::size_t>(std::strtoull(rows, nullptr, 10)) : 100000000;
+}
+
+// Rows of the scalar baseline, which is too slow for the full dataset
+const std::size_t SCALAR_ROWS = 1000000;
+
+const char* const FORMULA = "price * qty * (1 + tax) - sqrt(price) / 2";
+
+void fill(ColumnSet& columns, std::size_t rows) {
+    std::vector<double> price(rows);
+    std::vector<double> qty(rows);
+    std::vector<double> tax(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        price[i] = static_cast<double>(i % 10007) * 0.25 + 1;
+        qty[i] = static_cast<double>(i % 97);
+        tax[i] = static_cast<double>(i % 13) * 0.01;
+    }
+    columns.add("price", std::move(price));
+    columns.add("qty", std::move(qty));
+    columns.add("tax", std::move(tax));
+}
+
+std::unique_ptr<WorkStealingPool> makePool(const benchmark::State& state) {
+    std::unique_ptr<WorkStealingPool> pool;
+    if (state.range(0) > 1) {
+        pool.reset(new WorkStealingPool(static_cast<std::size_t>(state.range(0))));
+    }
+    return pool;
+}
+
+// Writes the dataset as CSV once; removed at exit
+const std::string& csvPath() {
+    static std::string path;
+    if (path.empty()) {
+        char name[] = "/tmp/columnar_benchXXXXXX";
+        int fd = mkstemp(name);
+        ::close(fd);
+        path = name;
+        std::FILE* file = std::fopen(name, "w");
+        std::fputs("price,qty,tax\n", file);
+        for (std::size_t i = 0, rows = datasetRows(); i < rows; ++i) {
+            std::fprintf(file, "%.17g,%d,%.2f\n", static_cast<double>(i % 10007) * 0.25 + 1,
+                         static_cast<int>(i % 97), static_cast<double>(i % 13) * 0.01);
+        }
+        std::fclose(file);
+        std::atexit([] { std::remove(path.c_str()); });
+    }
+    return path;
+}
+
+void BM_ColumnarParseCsv(benchmark::State& state) {
+    const std::string& path = csvPath();
+    std::unique_ptr<WorkStealingPool> pool = makePool(state);
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        ColumnSet columns;
+        columns.loadCsv(path, {}, pool.get());
+        bytes = columns.sourceBytes();
+        benchmark::DoNotOptimize(columns.column("price"));
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes));
+}
+BENCHMARK(BM_ColumnarParseCsv)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Bytes are the input columns plus the output column
+void BM_ColumnarEvaluate(benchmark::State& state) {
+    ColumnSet columns;
+    fill(columns, datasetRows());
+    ColumnarFormula formula(CompiledExpr::compile(FORMULA), columns);
+    std::vector<double> out(columns.rows());
+    std::unique_ptr<WorkStealingPool> pool = makePool(state);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(formula.evaluateAll(out.data(), pool.get()));
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * columns.rows() * 4 * sizeof(double)));
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * columns.rows()));
+}
+BENCHMARK(BM_ColumnarEvaluate)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_ColumnarEvaluateToFile(benchmark::State& state) {
+    ColumnSet columns;
+    fill(columns, datasetRows());
+    ColumnarFormula formula(CompiledExpr::compile(FORMULA), columns);
+    std::unique_ptr<WorkStealingPool> pool = makePool(state);
+    const std::string path = csvPath() + (state.range(1) ? ".bin" : ".txt");
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(formula.evaluateToFile(path, pool.get()));
+    }
+    std::remove(path.c_str());
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * columns.rows() * 4 * sizeof(double)));
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * columns.rows()));
+}
+BENCHMARK(BM_ColumnarEvaluateToFile)
+    ->Args({1, 1})->Args({4, 1})->Args({1, 0})->Args({4, 0})
+    ->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// The per-row loop of Calculator calls this mode replaces
+void BM_ColumnarScalarBaseline(benchmark::State& state) {
+    ColumnSet columns;
+    fill(columns, SCALAR_ROWS);
+    const double* price = columns.column("price");
+    const double* qty = columns.column("qty");
+    const double* tax = columns.column("tax");
+    std::vector<double> out(SCALAR_ROWS);
+    Calculator calc;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < SCALAR_ROWS; ++i) {
+            double total = calc.multiply(calc.multiply(price[i], qty[i]), calc.add(1, tax[i]));
+            out[i] = calc.subtract(total, calc.divide(calc.sqrt(price[i]), 2));
+        }
+        calc.clearHistory();
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * SCALAR_ROWS * 4 * sizeof(double)));
+    state.SetItemsProcessed(static_cast<std::int64_t>(state.iterations() * SCALAR_ROWS));
+}
+BENCHMARK(BM_ColumnarScalarBaseline)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,141 @@
+#include <benchmark/benchmark.h>
+#include "calculator.h"
+#include "decimal.h"
+#include "number_format.h"
+#include <vector>
+
+namespace {
+
+const std::size_t COUNT = 1024;
+
+// Prices between 1.00 and 257.00 in steps of 0.25
+const std::vector<double>& operands() {
+    static const std::vector<double> values = [] {
+        std::vector<double> v(COUNT);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            v[i] = 1.0 + static_cast<double>(i) * 0.25;
+        }
+        return v;
+    }();
+    return values;
+}
+
+std::vector<Decimal> decimalOperands(const DecimalContext& context) {
+    std::vector<Decimal> values;
+    for (double value : operands()) {
+        values.push_back(context.fromDouble(value).value);
+    }
+    return values;
+}
+
+// Arithmetic alone: total += v[i] * v[i-1] / v[i-2]
+void BM_DoubleArithmetic(benchmark::State& state) {
+    const std::vector<double>& v = operands();
+    for (auto _ : state) {
+        double total = 0;
+        for (std::size_t i = 2; i < COUNT; ++i) {
+            total += v[i] * v[i - 1] / v[i - 2];
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * (COUNT - 2) * 3);
+}
+BENCHMARK(BM_DoubleArithmetic);
+
+// The same with overflow checks and rounding; the argument is the scale
+void BM_DecimalArithmetic(benchmark::State& state) {
+    DecimalContext context(static_cast<int>(state.range(0)));
+    std::vector<Decimal> v = decimalOperands(context);
+    for (auto _ : state) {
+        Decimal total;
+        for (std::size_t i = 2; i < COUNT; ++i) {
+            Decimal product = context.multiply(v[i], v[i - 1]).value;
+            total = context.add(total, context.divide(product, v[i - 2]).value).value;
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * (COUNT - 2) * 3);
+}
+BENCHMARK(BM_DecimalArithmetic)->Arg(2)->Arg(6)->Arg(18);
+
+// Through Calculator, with metrics and history as in the keypad
+void BM_CalculatorDouble(benchmark::State& state) {
+    Calculator calc;
+    const std::vector<double>& v = operands();
+    for (auto _ : state) {
+        double total = 0;
+        for (std::size_t i = 2; i < COUNT; ++i) {
+            total = calc.add(total, calc.divide(calc.multiply(v[i], v[i - 1]), v[i - 2]));
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * (COUNT - 2) * 3);
+}
+BENCHMARK(BM_CalculatorDouble);
+
+void BM_CalculatorDecimal(benchmark::State& state) {
+    Calculator calc;
+    calc.enableDecimalMode(static_cast<int>(state.range(0)));
+    std::vector<Decimal> v = decimalOperands(calc.getDecimalContext());
+    for (auto _ : state) {
+        Decimal total;
+        for (std::size_t i = 2; i < COUNT; ++i) {
+            total = calc.add(total, calc.divide(calc.multiply(v[i], v[i - 1]), v[i - 2]));
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * (COUNT - 2) * 3);
+}
+BENCHMARK(BM_CalculatorDecimal)->Arg(2)->Arg(18);
+
+// Display formatting
+void BM_FormatDouble(benchmark::State& state) {
+    const std::vector<double>& v = operands();
+    char buffer[NUMBER_BUFFER_SIZE];
+    for (auto _ : state) {
+        for (double value : v) {
+            benchmark::DoNotOptimize(formatFixed(value * 1.01, buffer));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+BENCHMARK(BM_FormatDouble);
+
+void BM_FormatDecimal(benchmark::State& state) {
+    DecimalContext context(static_cast<int>(state.range(0)));
+    std::vector<Decimal> v = decimalOperands(context);
+    Decimal factor = context.fromDouble(1.01).value;
+    char buffer[DECIMAL_BUFFER_SIZE];
+    for (auto _ : state) {
+        for (Decimal value : v) {
+            benchmark::DoNotOptimize(context.format(context.multiply(value, factor).value, buffer));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+BENCHMARK(BM_FormatDecimal)->Arg(2)->Arg(18);
+
+// Keys "12.75", "*", "3.5", "=" per item, including the display text
+void BM_Keypad(benchmark::State& state) {
+    Calculator calc;
+    if (state.range(0)) {
+        calc.enableDecimalMode();
+    }
+    for (auto _ : state) {
+        for (char key : {'1', '2', '.', '7', '5'}) {
+            calc.appendNumber(key);
+        }
+        calc.setOperation('*');
+        for (char key : {'3', '.', '5'}) {
+            calc.appendNumber(key);
+        }
+        calc.calculate();
+        benchmark::DoNotOptimize(calc.getDisplayText());
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Keypad)->ArgName("decimal")->Arg(0)->Arg(1);
+
+} // namespace
+
+BENCHMARK_MAIN();
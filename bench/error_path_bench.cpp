@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include "calculator.h"
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+const std::size_t COUNT = 4096;
+
+// Divisors where the given percentage are zero
+const std::vector<double>& divisors(int errorPercent) {
+    static std::vector<double> values[101];
+    std::vector<double>& v = values[errorPercent];
+    if (v.empty()) {
+        std::mt19937_64 rng(42);
+        std::uniform_int_distribution<int> percent(0, 99);
+        std::uniform_real_distribution<double> dist(1.0, 1000.0);
+        v.resize(COUNT);
+        for (double& d : v) {
+            d = percent(rng) < errorPercent ? 0.0 : dist(rng);
+        }
+    }
+    return v;
+}
+
+void BM_ThrowingDivide(benchmark::State& state) {
+    const std::vector<double>& b = divisors(static_cast<int>(state.range(0)));
+    Calculator calc(0);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        double result;
+        try {
+            result = calc.divide(1.0, b[i++ % COUNT]);
+        } catch (const std::domain_error&) {
+            result = 0;
+        }
+        benchmark::DoNotOptimize(result);
+    }
+}
+
+void BM_TryDivide(benchmark::State& state) {
+    const std::vector<double>& b = divisors(static_cast<int>(state.range(0)));
+    Calculator calc(0);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        CalcResult result = calc.tryDivide(1.0, b[i++ % COUNT]);
+        benchmark::DoNotOptimize(result);
+    }
+}
+
+// Full keypad path: 1 / x =, which reports errors on the display
+void BM_Calculate(benchmark::State& state) {
+    const std::vector<double>& b = divisors(static_cast<int>(state.range(0)));
+    Calculator calc(0);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        double divisor = b[i++ % COUNT];
+        calc.clear();
+        calc.appendNumber('1');
+        calc.setOperation('/');
+        calc.appendNumber(divisor == 0 ? '0' : '7');
+        calc.calculate();
+        benchmark::DoNotOptimize(calc.getDisplayText());
+    }
+}
+
+BENCHMARK(BM_ThrowingDivide)->Arg(0)->Arg(1)->Arg(50);
+BENCHMARK(BM_TryDivide)->Arg(0)->Arg(1)->Arg(50);
+BENCHMARK(BM_Calculate)->Arg(0)->Arg(1)->Arg(50);
+
+} // namespace
+
+BENCHMARK_MAIN();
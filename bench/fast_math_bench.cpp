@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+#include "calculator.h"
+#include "fast_math.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const std::size_t COUNT = 1024;
+
+const std::vector<double>& operands() {
+    static const std::vector<double> values = [] {
+        std::vector<double> v(COUNT);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            v[i] = 0.5 + static_cast<double>(i) * 0.731;
+        }
+        return v;
+    }();
+    return values;
+}
+
+double power(double x, MathPrecision precision) {
+    return fastPower(x, 0.37, precision);
+}
+
+// Each call waits for the previous result: latency of one call. The
+// argument is the precision (0 exact, 1 high, 2 fast)
+template <double (*Function)(double, MathPrecision)>
+void BM_Latency(benchmark::State& state) {
+    const MathPrecision precision = static_cast<MathPrecision>(state.range(0));
+    state.SetLabel(mathPrecisionName(precision));
+    double x = 1.25;
+    for (auto _ : state) {
+        // Keeps x in a range where every function is defined and finite
+        x = 1.0 + 0.5 * Function(x, precision) * 1e-3;
+        benchmark::DoNotOptimize(x);
+    }
+}
+BENCHMARK_TEMPLATE(BM_Latency, fastSin)->Name("BM_SinLatency")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Latency, fastCos)->Name("BM_CosLatency")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Latency, fastTan)->Name("BM_TanLatency")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Latency, fastLn)->Name("BM_LnLatency")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Latency, fastExp)->Name("BM_ExpLatency")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Latency, power)->Name("BM_PowerLatency")->DenseRange(0, 2);
+
+// Independent calls over a table: throughput
+template <double (*Function)(double, MathPrecision)>
+void BM_Throughput(benchmark::State& state) {
+    const MathPrecision precision = static_cast<MathPrecision>(state.range(0));
+    state.SetLabel(mathPrecisionName(precision));
+    const std::vector<double>& v = operands();
+    for (auto _ : state) {
+        double sum = 0;
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            sum += Function(v[i], precision);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+BENCHMARK_TEMPLATE(BM_Throughput, fastSin)->Name("BM_SinThroughput")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Throughput, fastCos)->Name("BM_CosThroughput")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Throughput, fastTan)->Name("BM_TanThroughput")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Throughput, fastLn)->Name("BM_LnThroughput")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Throughput, fastExp)->Name("BM_ExpThroughput")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Throughput, power)->Name("BM_PowerThroughput")->DenseRange(0, 2);
+
+// Arguments beyond the Cody-Waite range: Payne-Hanek reduction against
+// libm's own
+void BM_HugeSinThroughput(benchmark::State& state) {
+    const MathPrecision precision = static_cast<MathPrecision>(state.range(0));
+    state.SetLabel(mathPrecisionName(precision));
+    std::vector<double> v = operands();
+    for (double& x : v) {
+        x *= 1e20;
+    }
+    for (auto _ : state) {
+        double sum = 0;
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            sum += fastSin(v[i], precision);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+BENCHMARK(BM_HugeSinThroughput)->DenseRange(0, 2);
+
+// Degrees: converting first, as degree mode used to, against reducing
+// modulo 90 exactly
+void BM_SinDegreesByConversion(benchmark::State& state) {
+    const std::vector<double>& v = operands();
+    for (auto _ : state) {
+        double sum = 0;
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            sum += std::sin(v[i] * 3.14159265358979323846 / 180.0);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+BENCHMARK(BM_SinDegreesByConversion);
+
+BENCHMARK_TEMPLATE(BM_Throughput, fastSinDegrees)->Name("BM_SinDegreesThroughput")->DenseRange(0, 2);
+BENCHMARK_TEMPLATE(BM_Throughput, fastTanDegrees)->Name("BM_TanDegreesThroughput")->DenseRange(0, 2);
+
+// Sine and cosine of the same angles, separately and from one reduction
+void BM_SinThenCos(benchmark::State& state) {
+    const MathPrecision precision = static_cast<MathPrecision>(state.range(0));
+    state.SetLabel(mathPrecisionName(precision));
+    const std::vector<double>& v = operands();
+    for (auto _ : state) {
+        double sum = 0;
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            sum += fastSin(v[i], precision) * fastCos(v[i], precision);
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+BENCHMARK(BM_SinThenCos)->DenseRange(0, 2);
+
+void BM_SinCos(benchmark::State& state) {
+    const MathPrecision precision = static_cast<MathPrecision>(state.range(0));
+    state.SetLabel(mathPrecisionName(precision));
+    const std::vector<double>& v = operands();
+    for (auto _ : state) {
+        double sum = 0;
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            const SineCosine both = fastSinCos(v[i], precision);
+            sum += both.sine * both.cosine;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * COUNT);
+}
+BENCHMARK(BM_SinCos)->DenseRange(0, 2);
+
+// Through Calculator, with history recorded as in interactive use
+void BM_CalculatorSin(benchmark::State& state) {
+    const MathPrecision precision = static_cast<MathPrecision>(state.range(0));
+    state.SetLabel(mathPrecisionName(precision));
+    const std::vector<double>& v = operands();
+    Calculator calc;
+    calc.setMathPrecision(precision);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(calc.sin(v[i % COUNT]));
+        ++i;
+    }
+}
+BENCHMARK(BM_CalculatorSin)->DenseRange(0, 2);
+
+} // namespace
+
+BENCHMARK_MAIN();
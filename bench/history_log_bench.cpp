@@ -0,0 +1,92 @@
+#include <benchmark/benchmark.h>
+#include "calculator.h"
+#include "history_log.h"
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// Log in a fresh temporary directory, removed again afterwards
+class TempLog {
+public:
+    TempLog() {
+        char dir[] = "/tmp/history_log_benchXXXXXX";
+        directory = mkdtemp(dir) ? dir : "/tmp";
+        base = directory + "/bench.hlog";
+    }
+
+    ~TempLog() {
+        for (int i = 0; i < 1000; ++i) {
+            char suffix[16];
+            std::snprintf(suffix, sizeof(suffix), ".%06d", i);
+            if (std::remove((base + suffix).c_str()) != 0) {
+                break;
+            }
+        }
+        rmdir(directory.c_str());
+    }
+
+    std::string directory;
+    std::string base;
+};
+
+void BM_HistoryLogAppend(benchmark::State& state) {
+    TempLog temp;
+    HistoryLog log(temp.base);
+    double x = 0;
+    for (auto _ : state) {
+        log.append(HistoryOp::Add, x, 1, x + 1);
+        x += 1;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HistoryLogAppend);
+
+// In-memory history only, for comparison
+void BM_CalculatorAdd(benchmark::State& state) {
+    Calculator calc;
+    double x = 0;
+    for (auto _ : state) {
+        x = calc.add(x, 1);
+    }
+    benchmark::DoNotOptimize(x);
+}
+BENCHMARK(BM_CalculatorAdd);
+
+void BM_CalculatorAddLogged(benchmark::State& state) {
+    TempLog temp;
+    HistoryLog log(temp.base);
+    Calculator calc;
+    calc.attachHistoryLog(&log);
+    double x = 0;
+    for (auto _ : state) {
+        x = calc.add(x, 1);
+    }
+    benchmark::DoNotOptimize(x);
+}
+BENCHMARK(BM_CalculatorAddLogged);
+
+void BM_HistoryLogRead(benchmark::State& state) {
+    TempLog temp;
+    {
+        HistoryLog log(temp.base);
+        for (int i = 0; i < 1 << 20; ++i) {
+            log.append(HistoryOp::Multiply, i, 2, i * 2.0);
+        }
+    }
+    HistoryLogReader reader(temp.base);
+    for (auto _ : state) {
+        double sum = 0;
+        for (const HistoryLogRecord& record : reader) {
+            sum += record.result;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * reader.size());
+}
+BENCHMARK(BM_HistoryLogRead);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,129 @@
+#include <benchmark/benchmark.h>
+#include "array_ops.h"
+#include "matrix.h"
+#include "work_stealing_pool.h"
+#include <random>
+
+namespace {
+
+Matrix random(std::size_t rows, std::size_t cols, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    Matrix m(rows, cols);
+    for (std::size_t i = 0; i < rows; ++i) {
+        for (std::size_t j = 0; j < cols; ++j) {
+            m(i, j) = dist(rng);
+        }
+    }
+    return m;
+}
+
+// Floating-point operations per second, as GFLOP/s in the report
+void reportFlops(benchmark::State& state, double flopsPerIteration) {
+    state.counters["GFLOP/s"] = benchmark::Counter(flopsPerIteration * static_cast<double>(state.iterations()) / 1e9,
+                                                   benchmark::Counter::kIsRate);
+}
+
+// The i-k-j triple loop callers wrote before the matrix module
+void BM_NaiveProduct(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Matrix a = random(n, n, 1);
+    Matrix b = random(n, n, 2);
+    for (auto _ : state) {
+        Matrix c(n, n);
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t k = 0; k < n; ++k) {
+                const double scale = a(i, k);
+                for (std::size_t j = 0; j < n; ++j) {
+                    c(i, j) += scale * b(k, j);
+                }
+            }
+        }
+        benchmark::DoNotOptimize(c.row(0));
+    }
+    reportFlops(state, 2.0 * n * n * n);
+}
+BENCHMARK(BM_NaiveProduct)->Arg(64)->Arg(256)->Arg(512)->Unit(benchmark::kMillisecond);
+
+// Blocked product; the second argument is the instruction set
+void BM_Product(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    const ArrayIsa isa = static_cast<ArrayIsa>(state.range(1));
+    if (setArrayIsa(isa) != isa) {
+        state.SkipWithError("instruction set not supported");
+        return;
+    }
+    state.SetLabel(arrayIsaName(isa));
+    Matrix a = random(n, n, 1);
+    Matrix b = random(n, n, 2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(matrixProduct(a, b).row(0));
+    }
+    setArrayIsa(supportedArrayIsa());
+    reportFlops(state, 2.0 * n * n * n);
+}
+BENCHMARK(BM_Product)
+    ->ArgsProduct({{64, 256, 512, 1024}, {static_cast<int>(ArrayIsa::Scalar), static_cast<int>(ArrayIsa::Avx2),
+                                           static_cast<int>(ArrayIsa::Avx512)}})
+    ->Unit(benchmark::kMillisecond);
+
+void BM_ProductParallel(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    WorkStealingPool pool;
+    Matrix a = random(n, n, 1);
+    Matrix b = random(n, n, 2);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(matrixProduct(a, b, &pool).row(0));
+    }
+    state.counters["threads"] = static_cast<double>(pool.size());
+    reportFlops(state, 2.0 * n * n * n);
+}
+BENCHMARK(BM_ProductParallel)->Arg(512)->Arg(1024)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_LuDecomposition(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Matrix a = random(n, n, 3);
+    for (auto _ : state) {
+        LuDecomposition lu(a);
+        benchmark::DoNotOptimize(lu.factors().row(0));
+    }
+    reportFlops(state, 2.0 / 3.0 * n * n * n);
+}
+BENCHMARK(BM_LuDecomposition)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMillisecond);
+
+void BM_Solve(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Matrix a = random(n, n, 3);
+    std::vector<double> b(n, 1.0);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(solve(a, b).data());
+    }
+    reportFlops(state, 2.0 / 3.0 * n * n * n + 2.0 * n * n);
+}
+BENCHMARK(BM_Solve)->Arg(256)->Unit(benchmark::kMillisecond);
+
+void BM_Transpose(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Matrix a = random(n, n, 4);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(transpose(a).row(0));
+    }
+    state.SetBytesProcessed(state.iterations() * 2 * n * n * sizeof(double));
+}
+BENCHMARK(BM_Transpose)->Arg(256)->Arg(2048);
+
+void BM_AddElements(benchmark::State& state) {
+    const std::size_t n = static_cast<std::size_t>(state.range(0));
+    Matrix a = random(n, n, 5);
+    Matrix b = random(n, n, 6);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(matrixAdd(a, b).row(0));
+    }
+    reportFlops(state, 1.0 * n * n);
+    state.SetBytesProcessed(state.iterations() * 3 * n * n * sizeof(double));
+}
+BENCHMARK(BM_AddElements)->Arg(256)->Arg(1024);
+
+} // namespace
+
+BENCHMARK_MAIN();
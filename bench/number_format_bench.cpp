@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#include "number_format.h"
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The ostringstream implementation formatFixed replaced
+std::string streamFormat(double num) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(6);
+    ss << num;
+    std::string str = ss.str();
+    if (str.find('.') != std::string::npos) {
+        str = str.substr(0, str.find_last_not_of('0') + 1);
+        if (str.back() == '.') {
+            str = str.substr(0, str.size() - 1);
+        }
+    }
+    return str;
+}
+
+const std::vector<double>& sampleValues() {
+    static const std::vector<double> values = [] {
+        std::mt19937_64 rng(42);
+        std::uniform_real_distribution<double> dist(-1e6, 1e6);
+        std::vector<double> v(1024);
+        for (std::size_t i = 0; i < v.size(); ++i) {
+            // Mix of integers, as the calculator mostly sees, and fractions
+            v[i] = (i % 2 == 0) ? static_cast<double>(static_cast<long>(dist(rng)))
+                                : dist(rng);
+        }
+        return v;
+    }();
+    return values;
+}
+
+void BM_StreamFormat(benchmark::State& state) {
+    const std::vector<double>& values = sampleValues();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        std::string text = streamFormat(values[i++ & 1023]);
+        benchmark::DoNotOptimize(text);
+    }
+}
+BENCHMARK(BM_StreamFormat);
+
+void BM_FormatFixed(benchmark::State& state) {
+    const std::vector<double>& values = sampleValues();
+    char buffer[NUMBER_BUFFER_SIZE];
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(formatFixed(values[i++ & 1023], buffer));
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_FormatFixed);
+
+void BM_FormatShortest(benchmark::State& state) {
+    const std::vector<double>& values = sampleValues();
+    char buffer[NUMBER_BUFFER_SIZE];
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(formatShortest(values[i++ & 1023], buffer));
+        benchmark::ClobberMemory();
+    }
+}
+BENCHMARK(BM_FormatShortest);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+#include "register_bank.h"
+#include <mutex>
+
+namespace {
+
+// What callers did before: one mutex around a shared double
+struct LockedValue {
+    std::mutex mutex;
+    double value = 0;
+};
+
+LockedValue locked;
+SharedRegister direct;
+SharedRegister striped(RegisterMode::Striped);
+
+void BM_MutexAdd(benchmark::State& state) {
+    for (auto _ : state) {
+        std::lock_guard<std::mutex> lock(locked.mutex);
+        locked.value += 1.5;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MutexAdd)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_DirectAdd(benchmark::State& state) {
+    for (auto _ : state) {
+        direct.add(1.5);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DirectAdd)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_StripedAdd(benchmark::State& state) {
+    for (auto _ : state) {
+        striped.add(1.5);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_StripedAdd)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_StripedLoad(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(striped.load());
+    }
+}
+BENCHMARK(BM_StripedLoad);
+
+} // namespace
+
+BENCHMARK_MAIN();
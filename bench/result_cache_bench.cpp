@@ -0,0 +1,75 @@
+#include <benchmark/benchmark.h>
+#include "calculator.h"
+#include "result_cache.h"
+#include <vector>
+
+namespace {
+
+// A workload of repeated operands: whole-degree angles and a few exponents
+std::vector<double> angles() {
+    std::vector<double> values;
+    for (int i = 0; i < 360; i += 5) {
+        values.push_back(i);
+    }
+    return values;
+}
+
+void runSin(benchmark::State& state, Calculator& calc) {
+    const std::vector<double> values = angles();
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(calc.sin(values[i]));
+        i = i + 1 == values.size() ? 0 : i + 1;
+    }
+    state.counters["hit_rate"] = benchmark::Counter(calc.getResultCacheStats().hitRate(), benchmark::Counter::kAvgThreads);
+}
+
+void runPower(benchmark::State& state, Calculator& calc) {
+    const std::vector<double> values = angles();
+    const double exponents[] = {0.5, 1.5, 2.5, 3.0};
+    std::size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(calc.power(values[i % values.size()], exponents[i & 3]));
+        ++i;
+    }
+    state.counters["hit_rate"] = benchmark::Counter(calc.getResultCacheStats().hitRate(), benchmark::Counter::kAvgThreads);
+}
+
+void BM_SinUncached(benchmark::State& state) {
+    Calculator calc(0);
+    runSin(state, calc);
+}
+BENCHMARK(BM_SinUncached);
+
+void BM_SinCached(benchmark::State& state) {
+    Calculator calc(0);
+    calc.enableResultCache();
+    runSin(state, calc);
+}
+BENCHMARK(BM_SinCached);
+
+SharedResultCache sharedCache;
+
+void BM_SinSharedCache(benchmark::State& state) {
+    Calculator calc(0);
+    calc.attachResultCache(&sharedCache);
+    runSin(state, calc);
+}
+BENCHMARK(BM_SinSharedCache)->ThreadRange(1, 8)->UseRealTime();
+
+void BM_PowerUncached(benchmark::State& state) {
+    Calculator calc(0);
+    runPower(state, calc);
+}
+BENCHMARK(BM_PowerUncached);
+
+void BM_PowerCached(benchmark::State& state) {
+    Calculator calc(0);
+    calc.enableResultCache();
+    runPower(state, calc);
+}
+BENCHMARK(BM_PowerCached);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,69 @@
+#include <benchmark/benchmark.h>
+#include "calculator.h"
+#include "spreadsheet.h"
+#include "work_stealing_pool.h"
+#include <memory>
+#include <string>
+
+namespace {
+
+const int CHAINS = 1000;
+const int CHAIN_LENGTH = 100;
+
+// 100k formulas: CHAINS independent chains that all read "rate", each
+// starting from its own input cell
+std::unique_ptr<Spreadsheet> buildModel(const Calculator& calc, WorkStealingPool* pool) {
+    std::unique_ptr<Spreadsheet> sheet(new Spreadsheet(calc, pool));
+    sheet->setValue("rate", 1.01);
+    for (int c = 0; c < CHAINS; ++c) {
+        const std::string chain = "c" + std::to_string(c) + "_";
+        sheet->setValue("in" + std::to_string(c), c);
+        sheet->setFormula(chain + "0", "in" + std::to_string(c) + " * rate");
+        for (int i = 1; i < CHAIN_LENGTH; ++i) {
+            sheet->setFormula(chain + std::to_string(i),
+                              chain + std::to_string(i - 1) + " * rate + sqrt(" + chain + std::to_string(i - 1) + ")");
+        }
+    }
+    sheet->recalculate();
+    return sheet;
+}
+
+void BM_SpreadsheetBuild(benchmark::State& state) {
+    Calculator calc;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(buildModel(calc, nullptr));
+    }
+    state.SetItemsProcessed(state.iterations() * CHAINS * CHAIN_LENGTH);
+}
+BENCHMARK(BM_SpreadsheetBuild)->Unit(benchmark::kMillisecond);
+
+// One input changes; only its chain is recomputed
+void BM_SpreadsheetChangeOneInput(benchmark::State& state) {
+    Calculator calc;
+    std::unique_ptr<Spreadsheet> sheet = buildModel(calc, nullptr);
+    double value = 0;
+    for (auto _ : state) {
+        sheet->setValue("in500", value += 1);
+        benchmark::DoNotOptimize(sheet->recalculate());
+    }
+    state.SetItemsProcessed(state.iterations() * CHAIN_LENGTH);
+}
+BENCHMARK(BM_SpreadsheetChangeOneInput)->Unit(benchmark::kMicrosecond);
+
+// The shared input changes; every formula is recomputed
+void BM_SpreadsheetChangeEverything(benchmark::State& state) {
+    Calculator calc;
+    std::unique_ptr<WorkStealingPool> pool(state.range(0) > 0 ? new WorkStealingPool(state.range(0)) : nullptr);
+    std::unique_ptr<Spreadsheet> sheet = buildModel(calc, pool.get());
+    double rate = 1.01;
+    for (auto _ : state) {
+        sheet->setValue("rate", rate += 1e-6);
+        benchmark::DoNotOptimize(sheet->recalculate());
+    }
+    state.SetItemsProcessed(state.iterations() * CHAINS * CHAIN_LENGTH);
+}
+BENCHMARK(BM_SpreadsheetChangeEverything)->Arg(0)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
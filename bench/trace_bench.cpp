@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+#include "calculator.h"
+#include "session.h"
+#include "trace.h"
+
+namespace {
+
+// A generated menu session, played over and over on one calculator
+const Session& workload() {
+    static const Session session = [] {
+        SessionProfile profile;
+        profile.steps = 1000;
+        profile.historyRate = 0;
+        return syntheticSession(profile, 1);
+    }();
+    return session;
+}
+
+// Arguments: 0 without tracing; otherwise the share of time traced,
+// in percent. Spans go to /dev/null so that only the recording counts
+void BM_MenuSteps(benchmark::State& state) {
+    const Session& session = workload();
+    if (state.range(0) > 0) {
+        TraceOptions options;
+        options.sampleFraction = static_cast<double>(state.range(0)) / 100;
+        options.samplePeriodMicroseconds = 1000;
+        startTracing("/dev/null", options);
+    }
+    Calculator calc;
+    session.settings.apply(calc);
+    std::size_t i = 0;
+    for (auto _ : state) {
+        try {
+            performSessionStep(calc, session.steps[i]);
+        } catch (const std::exception&) {
+        }
+        if (++i == session.steps.size()) {
+            i = 0;
+        }
+    }
+    TraceStats stats = stopTracing();
+    state.counters["spans"] = static_cast<double>(stats.written);
+    state.counters["dropped"] = static_cast<double>(stats.dropped);
+}
+BENCHMARK(BM_MenuSteps)->Arg(0)->Arg(1)->Arg(10)->Arg(100);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""Compare Google Benchmark JSON results against a stored baseline.
+
+Usage:
+    compare_bench.py BASELINE.json CURRENT.json [--threshold PERCENT] [--metric cpu_time|real_time]
+
+Benchmarks present in both files are matched by name. Any that got
+slower than the baseline by more than the threshold are reported as
+regressions and the script exits with status 1. When a run was repeated,
+the median aggregate is used if present.
+"""
+
+import argparse
+import json
+import sys
+
+
+def load(path, metric):
+    with open(path) as f:
+        data = json.load(f)
+    results = {}
+    medians = {}
+    for bench in data.get("benchmarks", []):
+        if bench.get("error_occurred"):
+            continue
+        if bench.get("run_type") == "aggregate":
+            if bench.get("aggregate_name") == "median":
+                medians[bench["run_name"]] = bench[metric]
+            continue
+        name = bench.get("run_name", bench["name"])
+        # Keep the first iteration of repeated runs unless a median exists
+        results.setdefault(name, bench[metric])
+    results.update(medians)
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed slowdown in percent (default 10)")
+    parser.add_argument("--metric", default="cpu_time", choices=["cpu_time", "real_time"])
+    args = parser.parse_args()
+
+    baseline = load(args.baseline, args.metric)
+    current = load(args.current, args.metric)
+
+    regressions = 0
+    width = max([len(name) for name in current] + [9])
+    print("%-*s %12s %12s %8s" % (width, "benchmark", "baseline", "current", "change"))
+    for name in sorted(current):
+        if name not in baseline:
+            print("%-*s %12s %12.1f %8s" % (width, name, "-", current[name], "new"))
+            continue
+        old = baseline[name]
+        new = current[name]
+        change = (new - old) / old * 100.0 if old > 0 else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-*s %12.1f %12.1f %+7.1f%%%s" % (width, name, old, new, change, flag))
+    for name in sorted(set(baseline) - set(current)):
+        print("%-*s %12.1f %12s %8s" % (width, name, baseline[name], "-", "missing"))
+
+    if regressions:
+        print("\n%d benchmark(s) regressed by more than %.1f%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
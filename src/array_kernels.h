@@ -0,0 +1,788 @@
+/**
+ * @file array_kernels.h
+ * @brief Vector-width independent implementations of the array operations
+ *
+ * Internal header. Each instruction set gets its own translation unit,
+ * compiled with the matching target flags, that defines a vector traits
+ * type and instantiates ArrayKernels with it. Everything here has
+ * internal linkage so the differently compiled copies never merge.
+ */
+
+#ifndef ARRAY_KERNELS_H
+#define ARRAY_KERNELS_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "fast_math.h"
+
+/**
+ * @struct CompensatedSum
+ * @brief Floating-point sum together with the rounding error it lost
+ */
+struct CompensatedSum {
+    double sum;
+    double error;
+};
+
+/// Accumulator lanes of the reductions, whatever the vector width; every
+/// instruction set adds element i into lane i % REDUCTION_LANES, so the
+/// rounding, and thus the result, is the same for all of them
+const std::size_t REDUCTION_LANES = 8;
+
+/// Columns of the output tile one matrix multiply micro-kernel call updates
+const std::size_t GEMM_COLS = 8;
+
+/**
+ * @struct ArrayKernelTable
+ * @brief Entry points of one instruction-set implementation
+ */
+struct ArrayKernelTable {
+    void (*add)(const double* a, const double* b, double* out, std::size_t n);
+    void (*subtract)(const double* a, const double* b, double* out, std::size_t n);
+    void (*multiply)(const double* a, const double* b, double* out, std::size_t n);
+    std::size_t (*divide)(const double* a, const double* b, double* out, std::size_t n,
+                          unsigned char* errors);
+    std::size_t (*sqrt)(const double* x, double* out, std::size_t n, unsigned char* errors);
+    std::size_t (*ln)(const double* x, double* out, std::size_t n, unsigned char* errors);
+    void (*sin)(const double* x, double* out, std::size_t n, bool useRadians);
+    void (*cos)(const double* x, double* out, std::size_t n, bool useRadians);
+    void (*tan)(const double* x, double* out, std::size_t n, bool useRadians);
+    void (*sinCos)(const double* x, double* sines, double* cosines, std::size_t n, bool useRadians);
+    void (*sum)(const double* x, std::size_t n, CompensatedSum lanes[REDUCTION_LANES]);
+    void (*deviations)(const double* x, std::size_t n, double center, CompensatedSum linear[REDUCTION_LANES],
+                       CompensatedSum squares[REDUCTION_LANES]);
+    void (*minMax)(const double* x, std::size_t n, double& min, double& max);
+
+    /// Rows of the output tile gemmTile updates, chosen so that the tile
+    /// fits in the vector registers
+    std::size_t gemmRows;
+
+    /**
+     * Matrix multiply micro-kernel: c[i][j] += sum over k of a[k][i] * b[k][j]
+     * for i < rows <= gemmRows and j < cols <= GEMM_COLS. a holds depth
+     * packed columns of gemmRows values, b depth packed rows of GEMM_COLS
+     * values, both zero-padded; c is row-major with ldc doubles per row.
+     */
+    void (*gemmTile)(std::size_t depth, const double* a, const double* b, double* c, std::size_t ldc,
+                     std::size_t rows, std::size_t cols);
+};
+
+/**
+ * @brief Get the kernels of the instruction set activeArrayIsa() names
+ */
+const ArrayKernelTable& activeArrayKernels();
+
+extern const ArrayKernelTable SCALAR_ARRAY_KERNELS;
+extern const ArrayKernelTable SSE2_ARRAY_KERNELS;
+extern const ArrayKernelTable AVX2_ARRAY_KERNELS;
+extern const ArrayKernelTable AVX512_ARRAY_KERNELS;
+
+namespace {
+
+/**
+ * @brief Vector traits for one double at a time
+ *
+ * Used for the remainder after the last full vector, and as the whole
+ * implementation on targets without SIMD kernels. Fused selects whether
+ * fmadd rounds once, to match the vector type it completes.
+ */
+template <bool Fused>
+struct ScalarVec {
+    typedef double Vec;
+    typedef bool Mask;
+    typedef std::uint64_t Int;
+    static const std::size_t WIDTH = 1;
+
+    static Vec load(const double* p) { return *p; }
+    static void store(double* p, Vec v) { *p = v; }
+    static Vec set1(double value) { return value; }
+    static Int set1i(std::uint64_t value) { return value; }
+
+    static Vec add(Vec a, Vec b) { return a + b; }
+    static Vec sub(Vec a, Vec b) { return a - b; }
+    static Vec mul(Vec a, Vec b) { return a * b; }
+    static Vec div(Vec a, Vec b) { return a / b; }
+    static Vec sqrt(Vec a) { return std::sqrt(a); }
+    static Vec fmadd(Vec a, Vec b, Vec c) { return Fused ? std::fma(a, b, c) : a * b + c; }
+    static Vec abs(Vec a) { return std::fabs(a); }
+
+    static Mask lt(Vec a, Vec b) { return a < b; }
+    static Mask le(Vec a, Vec b) { return a <= b; }
+    static Mask eq(Vec a, Vec b) { return a == b; }
+    static Mask notLe(Vec a, Vec b) { return !(a <= b); }
+    static Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return m ? ifTrue : ifFalse; }
+    static unsigned bits(Mask m) { return m ? 1u : 0u; }
+
+    static Int asInt(Vec a) {
+        Int i;
+        std::memcpy(&i, &a, sizeof(i));
+        return i;
+    }
+    static Vec asVec(Int i) {
+        Vec a;
+        std::memcpy(&a, &i, sizeof(a));
+        return a;
+    }
+    static Int intAnd(Int a, Int b) { return a & b; }
+    static Int intOr(Int a, Int b) { return a | b; }
+    static Int intXor(Int a, Int b) { return a ^ b; }
+    static Int intAdd(Int a, Int b) { return a + b; }
+    template <int N> static Int shiftLeft(Int a) { return a << N; }
+    template <int N> static Int shiftRight(Int a) { return a >> N; }
+};
+
+/// Adding and subtracting this rounds a double below 2^51 to an integer
+const double ROUND_MAGIC = 6755399441055744.0;               // 1.5 * 2^52
+const std::uint64_t DOUBLE_2_52_BITS = 0x4330000000000000ULL; // 2^52
+const double TWO_52 = 4503599627370496.0;
+
+// fdlibm log coefficients
+const double LG1 = 6.666666666666735130e-01;
+const double LG2 = 3.999999999940941908e-01;
+const double LG3 = 2.857142874366239149e-01;
+const double LG4 = 2.222219843214978396e-01;
+const double LG5 = 1.818357216161805012e-01;
+const double LG6 = 1.531383769920937332e-01;
+const double LG7 = 1.479819860511658591e-01;
+const double LN2_HI = 6.93147180369123816490e-01;
+const double LN2_LO = 1.90821492927058770002e-10;
+
+// fdlibm sin/cos kernel coefficients on [-pi/4, pi/4]
+const double S1 = -1.66666666666666324348e-01;
+const double S2 = 8.33333333332248946124e-03;
+const double S3 = -1.98412698298579493134e-04;
+const double S4 = 2.75573137070700676789e-06;
+const double S5 = -2.50507602534068634195e-08;
+const double S6 = 1.58969099521155010221e-10;
+const double C1 = 4.16666666666666019037e-02;
+const double C2 = -1.38888888888741095749e-03;
+const double C3 = 2.48015872894767294178e-05;
+const double C4 = -2.75573143513906633035e-07;
+const double C5 = 2.08757232129817482790e-09;
+const double C6 = -1.13596475577881948265e-11;
+
+// pi/2 split into 33-bit pieces so n * piece is exact for n < 2^20
+const double TWO_OVER_PI = 6.36619772367581382433e-01;
+const double PIO2_1 = 1.57079632673412561417e+00;
+const double PIO2_2 = 6.07710050630396597660e-11;
+const double PIO2_3 = 2.02226624871116645580e-21;
+const double PIO2_3T = 8.47842766036889956997e-32;
+
+/// Largest |x| reduced in vector registers; beyond it lanes use libm
+const double TRIG_VECTOR_LIMIT = 1.0e6;
+
+/// Largest |x| in degrees reduced in vector registers, where x - 90 n is
+/// still exact; beyond it lanes use fastSinDegrees() and friends
+const double TRIG_DEGREES_VECTOR_LIMIT = 4503599627370496.0; // 2^52
+
+/// pi/180 to double precision
+const double DEGREE = 0.017453292519943295;
+
+/// sqrt(1/2), sin and cos of 45 degrees rounded to nearest
+const double SQRT_HALF = 0.70710678118654757;
+
+inline double libmSin(double x) { return std::sin(x); }
+inline double libmCos(double x) { return std::cos(x); }
+inline double libmTan(double x) { return std::tan(x); }
+inline double exactSinDegrees(double x) { return fastSinDegrees(x, MathPrecision::Exact); }
+inline double exactCosDegrees(double x) { return fastCosDegrees(x, MathPrecision::Exact); }
+inline double exactTanDegrees(double x) { return fastTanDegrees(x, MathPrecision::Exact); }
+
+/**
+ * @brief Replace the lanes selected by a mask with a scalar function of the input
+ */
+template <typename V>
+typename V::Vec fixLanes(typename V::Vec x, typename V::Vec result, unsigned laneBits,
+                         double (*function)(double)) {
+    double in[V::WIDTH];
+    double out[V::WIDTH];
+    V::store(in, x);
+    V::store(out, result);
+    for (std::size_t k = 0; k < V::WIDTH; ++k) {
+        if (laneBits & (1u << k)) {
+            out[k] = function(in[k]);
+        }
+    }
+    return V::load(out);
+}
+
+/**
+ * @brief Natural logarithm; sets error for x <= 0 (the result is then NaN)
+ */
+template <typename V>
+typename V::Vec lnKernel(typename V::Vec x, typename V::Mask& error) {
+    typedef typename V::Vec Vec;
+    typedef typename V::Int Int;
+    error = V::le(x, V::set1(0.0));
+
+    // Scale subnormals into the normal range first
+    typename V::Mask tiny = V::lt(x, V::set1(2.2250738585072014e-308));
+    Vec scaled = V::select(tiny, V::mul(x, V::set1(18014398509481984.0)), x); // 2^54
+    Vec bias = V::select(tiny, V::set1(1023.0 + 54.0), V::set1(1023.0));
+
+    Int bits = V::asInt(scaled);
+    Vec exponent = V::sub(V::asVec(V::intOr(V::template shiftRight<52>(bits), V::set1i(DOUBLE_2_52_BITS))),
+                          V::set1(TWO_52));
+    Vec m = V::asVec(V::intOr(V::intAnd(bits, V::set1i(0x000FFFFFFFFFFFFFULL)),
+                              V::set1i(0x3FF0000000000000ULL)));
+
+    // Keep m in [sqrt(2)/2, sqrt(2)] so log1p(f) stays accurate
+    typename V::Mask high = V::lt(V::set1(1.4142135623730951), m);
+    m = V::select(high, V::mul(m, V::set1(0.5)), m);
+    Vec k = V::sub(V::select(high, V::add(exponent, V::set1(1.0)), exponent), bias);
+
+    Vec f = V::sub(m, V::set1(1.0));
+    Vec s = V::div(f, V::add(f, V::set1(2.0)));
+    Vec z = V::mul(s, s);
+    Vec w = V::mul(z, z);
+    Vec t1 = V::mul(w, V::fmadd(w, V::fmadd(w, V::set1(LG6), V::set1(LG4)), V::set1(LG2)));
+    Vec t2 = V::mul(z, V::fmadd(w, V::fmadd(w, V::fmadd(w, V::set1(LG7), V::set1(LG5)),
+                                                    V::set1(LG3)),
+                                V::set1(LG1)));
+    Vec r = V::add(t2, t1);
+    Vec hfsq = V::mul(V::set1(0.5), V::mul(f, f));
+    Vec result = V::sub(V::mul(k, V::set1(LN2_HI)),
+                        V::sub(V::sub(hfsq, V::fmadd(s, V::add(hfsq, r), V::mul(k, V::set1(LN2_LO)))), f));
+
+    // +inf and NaN map to themselves, invalid lanes to NaN
+    typename V::Mask passThrough = V::notLe(x, V::set1(1.7976931348623157e308));
+    result = V::select(passThrough, x, result);
+    return V::select(error, V::set1(NAN), result);
+}
+
+/**
+ * @brief Evaluate the sin and cos kernels on a reduced angle
+ * @param r Angle in radians, |r| <= pi/4
+ * @param quadrant n mod 4 in the low bits, for x = n pi/2 + r
+ * @param sinPart Receives sin(r) or cos(r), whichever sin(x) needs
+ * @param cosPart Receives the other one
+ */
+template <typename V>
+void sinCosPolynomials(typename V::Vec r, typename V::Int quadrant, typename V::Vec& sinPart,
+                       typename V::Vec& cosPart) {
+    typedef typename V::Vec Vec;
+    Vec z = V::mul(r, r);
+    Vec sinPoly = V::fmadd(z, V::fmadd(z, V::fmadd(z, V::fmadd(z, V::set1(S6), V::set1(S5)),
+                                                   V::set1(S4)),
+                                       V::set1(S3)),
+                           V::set1(S2));
+    Vec s = V::fmadd(V::mul(z, r), V::fmadd(z, sinPoly, V::set1(S1)), r);
+
+    Vec cosPoly = V::mul(z, V::fmadd(z, V::fmadd(z, V::fmadd(z, V::fmadd(z, V::fmadd(z, V::set1(C6),
+                                                                                  V::set1(C5)),
+                                                                     V::set1(C4)),
+                                                         V::set1(C3)),
+                                             V::set1(C2)),
+                                 V::set1(C1)));
+    Vec hz = V::mul(V::set1(0.5), z);
+    Vec w = V::sub(V::set1(1.0), hz);
+    Vec c = V::add(w, V::fmadd(z, cosPoly, V::sub(V::sub(V::set1(1.0), w), hz)));
+
+    // Odd quadrants swap the roles of sin and cos
+    Vec odd = V::sub(V::asVec(V::intOr(V::intAnd(quadrant, V::set1i(1)), V::set1i(DOUBLE_2_52_BITS))),
+                     V::set1(TWO_52));
+    typename V::Mask swap = V::eq(odd, V::set1(1.0));
+    sinPart = V::select(swap, c, s);
+    cosPart = V::select(swap, s, c);
+}
+
+/**
+ * @brief Reduce x by multiples of pi/2 and evaluate the sin and cos kernels
+ * @param x Angle in radians, |x| <= TRIG_VECTOR_LIMIT
+ * @param sinPart Receives sin(r) or cos(r), whichever sin(x) needs
+ * @param cosPart Receives the other one
+ * @param quadrant Receives n mod 4 in the low bits
+ */
+template <typename V>
+void sinCosKernel(typename V::Vec x, typename V::Vec& sinPart, typename V::Vec& cosPart,
+                  typename V::Int& quadrant) {
+    typedef typename V::Vec Vec;
+    Vec shifted = V::add(V::mul(x, V::set1(TWO_OVER_PI)), V::set1(ROUND_MAGIC));
+    quadrant = V::asInt(shifted);
+    Vec n = V::sub(shifted, V::set1(ROUND_MAGIC));
+
+    Vec r = V::sub(x, V::mul(n, V::set1(PIO2_1)));
+    r = V::sub(r, V::mul(n, V::set1(PIO2_2)));
+    r = V::sub(r, V::mul(n, V::set1(PIO2_3)));
+    r = V::sub(r, V::mul(n, V::set1(PIO2_3T)));
+    sinCosPolynomials<V>(r, quadrant, sinPart, cosPart);
+}
+
+/**
+ * @brief Reduce x by multiples of 90 degrees and evaluate the sin and cos kernels
+ *
+ * x - 90 n is exact, so multiples of 90 reduce to exactly 0; 30 and 45
+ * degrees get the correctly rounded sine and cosine, as in
+ * fastSinDegrees().
+ *
+ * @param x Angle in degrees, |x| <= TRIG_DEGREES_VECTOR_LIMIT
+ */
+template <typename V>
+void sinCosDegreesKernel(typename V::Vec x, typename V::Vec& sinPart, typename V::Vec& cosPart,
+                         typename V::Int& quadrant) {
+    typedef typename V::Vec Vec;
+    Vec shifted = V::add(V::mul(x, V::set1(1.0 / 90)), V::set1(ROUND_MAGIC));
+    quadrant = V::asInt(shifted);
+    Vec d = V::sub(x, V::mul(V::sub(shifted, V::set1(ROUND_MAGIC)), V::set1(90.0)));
+    Vec s;
+    Vec c;
+    sinCosPolynomials<V>(V::mul(d, V::set1(DEGREE)), V::set1i(0), s, c);
+
+    Vec size = V::abs(d);
+    typename V::Mask thirty = V::eq(size, V::set1(30.0));
+    typename V::Mask fortyFive = V::eq(size, V::set1(45.0));
+    s = V::select(thirty, V::mul(d, V::set1(1.0 / 60)), s);
+    s = V::select(fortyFive, V::asVec(V::intOr(V::asInt(V::set1(SQRT_HALF)),
+                                               V::intAnd(V::asInt(d), V::set1i(0x8000000000000000ULL)))),
+                  s);
+    c = V::select(fortyFive, V::set1(SQRT_HALF), c);
+
+    Vec odd = V::sub(V::asVec(V::intOr(V::intAnd(quadrant, V::set1i(1)), V::set1i(DOUBLE_2_52_BITS))),
+                     V::set1(TWO_52));
+    typename V::Mask swap = V::eq(odd, V::set1(1.0));
+    sinPart = V::select(swap, c, s);
+    cosPart = V::select(swap, s, c);
+}
+
+/**
+ * @brief Flip the sign of lanes whose quadrant has bit 1 set
+ */
+template <typename V>
+typename V::Vec signByQuadrant(typename V::Vec value, typename V::Int quadrant) {
+    typename V::Int sign = V::template shiftLeft<62>(V::intAnd(quadrant, V::set1i(2)));
+    return V::asVec(V::intXor(V::asInt(value), sign));
+}
+
+/// Trigonometric function selector for trigKernel
+enum class Trig { Sin, Cos, Tan };
+
+/**
+ * @brief Reduce x in radians or degrees
+ * @return Lanes that could not be reduced in registers: huge, infinite or NaN
+ */
+template <typename V>
+unsigned reduceAngle(typename V::Vec x, bool useRadians, typename V::Vec& sinPart, typename V::Vec& cosPart,
+                     typename V::Int& quadrant) {
+    if (useRadians) {
+        sinCosKernel<V>(x, sinPart, cosPart, quadrant);
+        return V::bits(V::notLe(V::abs(x), V::set1(TRIG_VECTOR_LIMIT)));
+    }
+    sinCosDegreesKernel<V>(x, sinPart, cosPart, quadrant);
+    return V::bits(V::notLe(V::abs(x), V::set1(TRIG_DEGREES_VECTOR_LIMIT)));
+}
+
+/**
+ * @brief Flip the sign of the lanes of quadrants 2 and 3, keeping zeros positive
+ *
+ * Exact zeros only come out of the degree reduction, where sin(180)
+ * should be 0 rather than -0; adding 0 turns -0 into +0 and leaves every
+ * other value alone.
+ */
+template <typename V>
+typename V::Vec signByQuadrantPositiveZero(typename V::Vec value, typename V::Int quadrant) {
+    return V::add(signByQuadrant<V>(value, quadrant), V::set1(0.0));
+}
+
+template <typename V, Trig function>
+typename V::Vec trigKernel(typename V::Vec x, bool useRadians) {
+    typedef typename V::Vec Vec;
+    Vec sinPart;
+    Vec cosPart;
+    typename V::Int quadrant;
+    unsigned slow = reduceAngle<V>(x, useRadians, sinPart, cosPart, quadrant);
+
+    Vec result;
+    double (*fallback)(double);
+    switch (function) {
+        case Trig::Sin:
+            result = signByQuadrantPositiveZero<V>(sinPart, quadrant);
+            fallback = useRadians ? libmSin : exactSinDegrees;
+            break;
+        case Trig::Cos:
+            result = signByQuadrantPositiveZero<V>(cosPart, V::intAdd(quadrant, V::set1i(1)));
+            fallback = useRadians ? libmCos : exactCosDegrees;
+            break;
+        default: {
+            // The quadrant signs cancel in sin / cos except for the swap;
+            // negating the divisor as 0 - cos makes an exact zero in an
+            // odd quadrant (tan 90 degrees) +infinity
+            Vec odd = V::sub(V::asVec(V::intOr(V::intAnd(quadrant, V::set1i(1)),
+                                               V::set1i(DOUBLE_2_52_BITS))),
+                             V::set1(TWO_52));
+            result = V::div(sinPart, V::select(V::eq(odd, V::set1(1.0)), V::sub(V::set1(0.0), cosPart), cosPart));
+            fallback = useRadians ? libmTan : exactTanDegrees;
+            break;
+        }
+    }
+
+    if (function != Trig::Cos) {
+        // Odd functions keep the sign of zero
+        result = V::select(V::eq(x, V::set1(0.0)), x, result);
+    }
+
+    // Huge arguments, infinities and NaN go through the scalar functions
+    // lane by lane
+    if (slow != 0) {
+        result = fixLanes<V>(x, result, slow, fallback);
+    }
+    return result;
+}
+
+/**
+ * @brief Sine and cosine from one reduction
+ */
+template <typename V>
+void sinCosKernelPair(typename V::Vec x, bool useRadians, typename V::Vec& sine, typename V::Vec& cosine) {
+    typename V::Vec sinPart;
+    typename V::Vec cosPart;
+    typename V::Int quadrant;
+    unsigned slow = reduceAngle<V>(x, useRadians, sinPart, cosPart, quadrant);
+    sine = V::select(V::eq(x, V::set1(0.0)), x, signByQuadrantPositiveZero<V>(sinPart, quadrant));
+    cosine = signByQuadrantPositiveZero<V>(cosPart, V::intAdd(quadrant, V::set1i(1)));
+    if (slow != 0) {
+        sine = fixLanes<V>(x, sine, slow, useRadians ? libmSin : exactSinDegrees);
+        cosine = fixLanes<V>(x, cosine, slow, useRadians ? libmCos : exactCosDegrees);
+    }
+}
+
+/**
+ * @brief Record the error lanes of one vector and count them
+ */
+inline std::size_t storeErrors(unsigned laneBits, std::size_t width, unsigned char* errors) {
+    std::size_t count = 0;
+    for (std::size_t k = 0; k < width; ++k) {
+        unsigned char failed = static_cast<unsigned char>((laneBits >> k) & 1u);
+        if (errors != nullptr) {
+            errors[k] = failed;
+        }
+        count += failed;
+    }
+    return count;
+}
+
+/**
+ * @brief Add x to a compensated sum with Knuth's TwoSum, keeping the
+ *        rounding error of the addition exactly
+ */
+template <typename V>
+void twoSum(typename V::Vec& sum, typename V::Vec& error, typename V::Vec x) {
+    typedef typename V::Vec Vec;
+    Vec t = V::add(sum, x);
+    Vec b = V::sub(t, sum);
+    error = V::add(error, V::add(V::sub(sum, V::sub(t, b)), V::sub(x, b)));
+    sum = t;
+}
+
+/**
+ * @struct CompensatedLanes
+ * @brief REDUCTION_LANES compensated sums held in vectors of V
+ */
+template <typename V>
+struct CompensatedLanes {
+    static const std::size_t GROUPS = REDUCTION_LANES / V::WIDTH;
+    typename V::Vec sum[GROUPS];
+    typename V::Vec error[GROUPS];
+
+    CompensatedLanes() {
+        for (std::size_t g = 0; g < GROUPS; ++g) {
+            sum[g] = V::set1(0.0);
+            error[g] = V::set1(0.0);
+        }
+    }
+
+    void add(std::size_t group, typename V::Vec x) { twoSum<V>(sum[group], error[group], x); }
+
+    void store(CompensatedSum lanes[REDUCTION_LANES]) const {
+        double sums[REDUCTION_LANES];
+        double errors[REDUCTION_LANES];
+        for (std::size_t g = 0; g < GROUPS; ++g) {
+            V::store(sums + g * V::WIDTH, sum[g]);
+            V::store(errors + g * V::WIDTH, error[g]);
+        }
+        for (std::size_t k = 0; k < REDUCTION_LANES; ++k) {
+            lanes[k].sum = sums[k];
+            lanes[k].error = errors[k];
+        }
+    }
+};
+
+inline void addToLane(CompensatedSum& lane, double x) {
+    twoSum<ScalarVec<false> >(lane.sum, lane.error, x);
+}
+
+/**
+ * @struct ArrayKernels
+ * @brief Array loops over a vector traits type V, finishing with scalar type S
+ */
+template <typename V, typename S>
+struct ArrayKernels {
+    typedef typename V::Vec Vec;
+
+    static void add(const double* a, const double* b, double* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + V::WIDTH <= n; i += V::WIDTH) {
+            V::store(out + i, V::add(V::load(a + i), V::load(b + i)));
+        }
+        for (; i < n; ++i) {
+            out[i] = a[i] + b[i];
+        }
+    }
+
+    static void subtract(const double* a, const double* b, double* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + V::WIDTH <= n; i += V::WIDTH) {
+            V::store(out + i, V::sub(V::load(a + i), V::load(b + i)));
+        }
+        for (; i < n; ++i) {
+            out[i] = a[i] - b[i];
+        }
+    }
+
+    static void multiply(const double* a, const double* b, double* out, std::size_t n) {
+        std::size_t i = 0;
+        for (; i + V::WIDTH <= n; i += V::WIDTH) {
+            V::store(out + i, V::mul(V::load(a + i), V::load(b + i)));
+        }
+        for (; i < n; ++i) {
+            out[i] = a[i] * b[i];
+        }
+    }
+
+    static std::size_t divide(const double* a, const double* b, double* out, std::size_t n,
+                              unsigned char* errors) {
+        std::size_t failed = 0;
+        std::size_t i = 0;
+        for (; i + V::WIDTH <= n; i += V::WIDTH) {
+            Vec divisor = V::load(b + i);
+            typename V::Mask zero = V::eq(divisor, V::set1(0.0));
+            V::store(out + i, V::select(zero, V::set1(NAN), V::div(V::load(a + i), divisor)));
+            failed += storeErrors(V::bits(zero), V::WIDTH, errors ? errors + i : nullptr);
+        }
+        for (; i < n; ++i) {
+            bool zero = b[i] == 0;
+            out[i] = zero ? NAN : a[i] / b[i];
+            failed += storeErrors(zero, 1, errors ? errors + i : nullptr);
+        }
+        return failed;
+    }
+
+    static std::size_t sqrt(const double* x, double* out, std::size_t n, unsigned char* errors) {
+        std::size_t failed = 0;
+        std::size_t i = 0;
+        for (; i + V::WIDTH <= n; i += V::WIDTH) {
+            Vec value = V::load(x + i);
+            typename V::Mask negative = V::lt(value, V::set1(0.0));
+            V::store(out + i, V::select(negative, V::set1(NAN), V::sqrt(value)));
+            failed += storeErrors(V::bits(negative), V::WIDTH, errors ? errors + i : nullptr);
+        }
+        for (; i < n; ++i) {
+            bool negative = x[i] < 0;
+            out[i] = negative ? NAN : std::sqrt(x[i]);
+            failed += storeErrors(negative, 1, errors ? errors + i : nullptr);
+        }
+        return failed;
+    }
+
+    static std::size_t ln(const double* x, double* out, std::size_t n, unsigned char* errors) {
+        std::size_t failed = 0;
+        std::size_t i = 0;
+        for (; i + V::WIDTH <= n; i += V::WIDTH) {
+            typename V::Mask error;
+            V::store(out + i, lnKernel<V>(V::load(x + i), error));
+            failed += storeErrors(V::bits(error), V::WIDTH, errors ? errors + i : nullptr);
+        }
+        for (; i < n; ++i) {
+            typename S::Mask error;
+            out[i] = lnKernel<S>(x[i], error);
+            failed += storeErrors(S::bits(error), 1, errors ? errors + i : nullptr);
+        }
+        return failed;
+    }
+
+    template <Trig function>
+    static void trig(const double* x, double* out, std::size_t n, bool useRadians) {
+        std::size_t i = 0;
+        for (; i + V::WIDTH <= n; i += V::WIDTH) {
+            V::store(out + i, trigKernel<V, function>(V::load(x + i), useRadians));
+        }
+        for (; i < n; ++i) {
+            out[i] = trigKernel<S, function>(x[i], useRadians);
+        }
+    }
+
+    static void sin(const double* x, double* out, std::size_t n, bool useRadians) {
+        trig<Trig::Sin>(x, out, n, useRadians);
+    }
+
+    static void cos(const double* x, double* out, std::size_t n, bool useRadians) {
+        trig<Trig::Cos>(x, out, n, useRadians);
+    }
+
+    static void tan(const double* x, double* out, std::size_t n, bool useRadians) {
+        trig<Trig::Tan>(x, out, n, useRadians);
+    }
+
+    static void sinCos(const double* x, double* sines, double* cosines, std::size_t n, bool useRadians) {
+        std::size_t i = 0;
+        for (; i + V::WIDTH <= n; i += V::WIDTH) {
+            Vec sine;
+            Vec cosine;
+            sinCosKernelPair<V>(V::load(x + i), useRadians, sine, cosine);
+            V::store(sines + i, sine);
+            V::store(cosines + i, cosine);
+        }
+        for (; i < n; ++i) {
+            double sine;
+            double cosine;
+            sinCosKernelPair<S>(x[i], useRadians, sine, cosine);
+            sines[i] = sine;
+            cosines[i] = cosine;
+        }
+    }
+
+    static void sum(const double* x, std::size_t n, CompensatedSum lanes[REDUCTION_LANES]) {
+        CompensatedLanes<V> acc;
+        std::size_t i = 0;
+        for (; i + REDUCTION_LANES <= n; i += REDUCTION_LANES) {
+            for (std::size_t g = 0; g < acc.GROUPS; ++g) {
+                acc.add(g, V::load(x + i + g * V::WIDTH));
+            }
+        }
+        acc.store(lanes);
+        for (std::size_t k = 0; i < n; ++i, ++k) {
+            addToLane(lanes[k], x[i]);
+        }
+    }
+
+    // Sums of x - center and (x - center)^2, for the two-pass variance
+    static void deviations(const double* x, std::size_t n, double center, CompensatedSum linear[REDUCTION_LANES],
+                           CompensatedSum squares[REDUCTION_LANES]) {
+        CompensatedLanes<V> linearAcc;
+        CompensatedLanes<V> squaresAcc;
+        const Vec c = V::set1(center);
+        std::size_t i = 0;
+        for (; i + REDUCTION_LANES <= n; i += REDUCTION_LANES) {
+            for (std::size_t g = 0; g < linearAcc.GROUPS; ++g) {
+                Vec d = V::sub(V::load(x + i + g * V::WIDTH), c);
+                linearAcc.add(g, d);
+                squaresAcc.add(g, V::mul(d, d));
+            }
+        }
+        linearAcc.store(linear);
+        squaresAcc.store(squares);
+        for (std::size_t k = 0; i < n; ++i, ++k) {
+            double d = x[i] - center;
+            addToLane(linear[k], d);
+            addToLane(squares[k], d * d);
+        }
+    }
+
+    // NaN if any element is NaN; of equal elements (0 and -0) the one in
+    // the lower lane wins, so the result does not depend on the vector width
+    static void minMax(const double* x, std::size_t n, double& min, double& max) {
+        const std::size_t groups = REDUCTION_LANES / V::WIDTH;
+        Vec low[groups];
+        Vec high[groups];
+        Vec nan = V::set1(0.0);
+        for (std::size_t g = 0; g < groups; ++g) {
+            low[g] = V::set1(INFINITY);
+            high[g] = V::set1(-INFINITY);
+        }
+        std::size_t i = 0;
+        for (; i + REDUCTION_LANES <= n; i += REDUCTION_LANES) {
+            for (std::size_t g = 0; g < groups; ++g) {
+                Vec value = V::load(x + i + g * V::WIDTH);
+                low[g] = V::select(V::lt(value, low[g]), value, low[g]);
+                high[g] = V::select(V::lt(high[g], value), value, high[g]);
+                nan = V::select(V::notLe(value, value), value, nan);
+            }
+        }
+        double lows[REDUCTION_LANES];
+        double highs[REDUCTION_LANES];
+        double nans[V::WIDTH];
+        for (std::size_t g = 0; g < groups; ++g) {
+            V::store(lows + g * V::WIDTH, low[g]);
+            V::store(highs + g * V::WIDTH, high[g]);
+        }
+        V::store(nans, nan);
+        for (std::size_t k = 0; i < n; ++i, ++k) {
+            lows[k] = x[i] < lows[k] ? x[i] : lows[k];
+            highs[k] = highs[k] < x[i] ? x[i] : highs[k];
+            nans[0] = x[i] != x[i] ? x[i] : nans[0];
+        }
+        min = lows[0];
+        max = highs[0];
+        for (std::size_t k = 1; k < REDUCTION_LANES; ++k) {
+            min = lows[k] < min ? lows[k] : min;
+            max = max < highs[k] ? highs[k] : max;
+        }
+        for (std::size_t k = 0; k < V::WIDTH; ++k) {
+            if (nans[k] != nans[k]) {
+                min = max = nans[k];
+            }
+        }
+    }
+
+    // Rows and vectors per row of the register tile: AVX-512 keeps 8 x 1
+    // accumulators, AVX2 6 x 2, SSE2 3 x 4 and scalar code 2 x 8
+    static const std::size_t GEMM_ROWS = V::WIDTH >= 8 ? 8 : V::WIDTH >= 4 ? 6 : V::WIDTH >= 2 ? 3 : 2;
+    static const std::size_t GEMM_VECTORS = GEMM_COLS / V::WIDTH;
+
+    static void gemmTile(std::size_t depth, const double* a, const double* b, double* c, std::size_t ldc,
+                         std::size_t rows, std::size_t cols) {
+        Vec acc[GEMM_ROWS][GEMM_VECTORS];
+        for (std::size_t i = 0; i < GEMM_ROWS; ++i) {
+            for (std::size_t v = 0; v < GEMM_VECTORS; ++v) {
+                acc[i][v] = V::set1(0.0);
+            }
+        }
+        for (std::size_t k = 0; k < depth; ++k, a += GEMM_ROWS, b += GEMM_COLS) {
+            Vec row[GEMM_VECTORS];
+            for (std::size_t v = 0; v < GEMM_VECTORS; ++v) {
+                row[v] = V::load(b + v * V::WIDTH);
+            }
+            for (std::size_t i = 0; i < GEMM_ROWS; ++i) {
+                Vec scale = V::set1(a[i]);
+                for (std::size_t v = 0; v < GEMM_VECTORS; ++v) {
+                    acc[i][v] = V::fmadd(scale, row[v], acc[i][v]);
+                }
+            }
+        }
+        if (rows == GEMM_ROWS && cols == GEMM_COLS) {
+            for (std::size_t i = 0; i < GEMM_ROWS; ++i) {
+                for (std::size_t v = 0; v < GEMM_VECTORS; ++v) {
+                    double* out = c + i * ldc + v * V::WIDTH;
+                    V::store(out, V::add(V::load(out), acc[i][v]));
+                }
+            }
+            return;
+        }
+        // Edge tile: only part of the register tile lies inside c
+        double tile[GEMM_ROWS * GEMM_COLS];
+        for (std::size_t i = 0; i < GEMM_ROWS; ++i) {
+            for (std::size_t v = 0; v < GEMM_VECTORS; ++v) {
+                V::store(tile + i * GEMM_COLS + v * V::WIDTH, acc[i][v]);
+            }
+        }
+        for (std::size_t i = 0; i < rows; ++i) {
+            for (std::size_t j = 0; j < cols; ++j) {
+                c[i * ldc + j] += tile[i * GEMM_COLS + j];
+            }
+        }
+    }
+
+    static ArrayKernelTable table() {
+        ArrayKernelTable kernels = {
+            add, subtract, multiply, divide, sqrt, ln, sin, cos, tan, sinCos, sum, deviations, minMax,
+            GEMM_ROWS, gemmTile
+        };
+        return kernels;
+    }
+};
+
+} // namespace
+
+#endif // ARRAY_KERNELS_H
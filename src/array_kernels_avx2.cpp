@@ -0,0 +1,45 @@
+#include "array_kernels.h"
+#include <immintrin.h>
+
+namespace {
+
+/// Four doubles per AVX register, with FMA
+struct Avx2Vec {
+    typedef __m256d Vec;
+    typedef __m256d Mask;
+    typedef __m256i Int;
+    static const std::size_t WIDTH = 4;
+
+    static Vec load(const double* p) { return _mm256_loadu_pd(p); }
+    static void store(double* p, Vec v) { _mm256_storeu_pd(p, v); }
+    static Vec set1(double value) { return _mm256_set1_pd(value); }
+    static Int set1i(std::uint64_t value) { return _mm256_set1_epi64x(static_cast<long long>(value)); }
+
+    static Vec add(Vec a, Vec b) { return _mm256_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm256_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm256_mul_pd(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm256_div_pd(a, b); }
+    static Vec sqrt(Vec a) { return _mm256_sqrt_pd(a); }
+    static Vec fmadd(Vec a, Vec b, Vec c) { return _mm256_fmadd_pd(a, b, c); }
+    static Vec abs(Vec a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+
+    static Mask lt(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static Mask le(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+    static Mask eq(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+    static Mask notLe(Vec a, Vec b) { return _mm256_cmp_pd(a, b, _CMP_NLE_UQ); }
+    static Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm256_blendv_pd(ifFalse, ifTrue, m); }
+    static unsigned bits(Mask m) { return static_cast<unsigned>(_mm256_movemask_pd(m)); }
+
+    static Int asInt(Vec a) { return _mm256_castpd_si256(a); }
+    static Vec asVec(Int i) { return _mm256_castsi256_pd(i); }
+    static Int intAnd(Int a, Int b) { return _mm256_and_si256(a, b); }
+    static Int intOr(Int a, Int b) { return _mm256_or_si256(a, b); }
+    static Int intXor(Int a, Int b) { return _mm256_xor_si256(a, b); }
+    static Int intAdd(Int a, Int b) { return _mm256_add_epi64(a, b); }
+    template <int N> static Int shiftLeft(Int a) { return _mm256_slli_epi64(a, N); }
+    template <int N> static Int shiftRight(Int a) { return _mm256_srli_epi64(a, N); }
+};
+
+} // namespace
+
+const ArrayKernelTable AVX2_ARRAY_KERNELS = ArrayKernels<Avx2Vec, ScalarVec<true> >::table();
@@ -0,0 +1,51 @@
+#include "array_kernels.h"
+#include <immintrin.h>
+
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC's AVX-512 intrinsics seed results with a self-initialized placeholder
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+namespace {
+
+/// Eight doubles per AVX-512 register, with mask registers for comparisons
+struct Avx512Vec {
+    typedef __m512d Vec;
+    typedef __mmask8 Mask;
+    typedef __m512i Int;
+    static const std::size_t WIDTH = 8;
+
+    static Vec load(const double* p) { return _mm512_loadu_pd(p); }
+    static void store(double* p, Vec v) { _mm512_storeu_pd(p, v); }
+    static Vec set1(double value) { return _mm512_set1_pd(value); }
+    static Int set1i(std::uint64_t value) { return _mm512_set1_epi64(static_cast<long long>(value)); }
+
+    static Vec add(Vec a, Vec b) { return _mm512_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm512_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm512_mul_pd(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm512_div_pd(a, b); }
+    static Vec sqrt(Vec a) { return _mm512_sqrt_pd(a); }
+    static Vec fmadd(Vec a, Vec b, Vec c) { return _mm512_fmadd_pd(a, b, c); }
+    static Vec abs(Vec a) { return asVec(_mm512_andnot_si512(asInt(_mm512_set1_pd(-0.0)), asInt(a))); }
+
+    static Mask lt(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+    static Mask le(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+    static Mask eq(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+    static Mask notLe(Vec a, Vec b) { return _mm512_cmp_pd_mask(a, b, _CMP_NLE_UQ); }
+    static Vec select(Mask m, Vec ifTrue, Vec ifFalse) { return _mm512_mask_blend_pd(m, ifFalse, ifTrue); }
+    static unsigned bits(Mask m) { return m; }
+
+    static Int asInt(Vec a) { return _mm512_castpd_si512(a); }
+    static Vec asVec(Int i) { return _mm512_castsi512_pd(i); }
+    static Int intAnd(Int a, Int b) { return _mm512_and_si512(a, b); }
+    static Int intOr(Int a, Int b) { return _mm512_or_si512(a, b); }
+    static Int intXor(Int a, Int b) { return _mm512_xor_si512(a, b); }
+    static Int intAdd(Int a, Int b) { return _mm512_add_epi64(a, b); }
+    template <int N> static Int shiftLeft(Int a) { return _mm512_slli_epi64(a, N); }
+    template <int N> static Int shiftRight(Int a) { return _mm512_srli_epi64(a, N); }
+};
+
+} // namespace
+
+const ArrayKernelTable AVX512_ARRAY_KERNELS = ArrayKernels<Avx512Vec, ScalarVec<true> >::table();
@@ -0,0 +1,47 @@
+#include "array_kernels.h"
+#include <emmintrin.h>
+
+namespace {
+
+/// Two doubles per SSE2 register; no fused multiply-add
+struct Sse2Vec {
+    typedef __m128d Vec;
+    typedef __m128d Mask;
+    typedef __m128i Int;
+    static const std::size_t WIDTH = 2;
+
+    static Vec load(const double* p) { return _mm_loadu_pd(p); }
+    static void store(double* p, Vec v) { _mm_storeu_pd(p, v); }
+    static Vec set1(double value) { return _mm_set1_pd(value); }
+    static Int set1i(std::uint64_t value) { return _mm_set1_epi64x(static_cast<long long>(value)); }
+
+    static Vec add(Vec a, Vec b) { return _mm_add_pd(a, b); }
+    static Vec sub(Vec a, Vec b) { return _mm_sub_pd(a, b); }
+    static Vec mul(Vec a, Vec b) { return _mm_mul_pd(a, b); }
+    static Vec div(Vec a, Vec b) { return _mm_div_pd(a, b); }
+    static Vec sqrt(Vec a) { return _mm_sqrt_pd(a); }
+    static Vec fmadd(Vec a, Vec b, Vec c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    static Vec abs(Vec a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+
+    static Mask lt(Vec a, Vec b) { return _mm_cmplt_pd(a, b); }
+    static Mask le(Vec a, Vec b) { return _mm_cmple_pd(a, b); }
+    static Mask eq(Vec a, Vec b) { return _mm_cmpeq_pd(a, b); }
+    static Mask notLe(Vec a, Vec b) { return _mm_cmpnle_pd(a, b); }
+    static Vec select(Mask m, Vec ifTrue, Vec ifFalse) {
+        return _mm_or_pd(_mm_and_pd(m, ifTrue), _mm_andnot_pd(m, ifFalse));
+    }
+    static unsigned bits(Mask m) { return static_cast<unsigned>(_mm_movemask_pd(m)); }
+
+    static Int asInt(Vec a) { return _mm_castpd_si128(a); }
+    static Vec asVec(Int i) { return _mm_castsi128_pd(i); }
+    static Int intAnd(Int a, Int b) { return _mm_and_si128(a, b); }
+    static Int intOr(Int a, Int b) { return _mm_or_si128(a, b); }
+    static Int intXor(Int a, Int b) { return _mm_xor_si128(a, b); }
+    static Int intAdd(Int a, Int b) { return _mm_add_epi64(a, b); }
+    template <int N> static Int shiftLeft(Int a) { return _mm_slli_epi64(a, N); }
+    template <int N> static Int shiftRight(Int a) { return _mm_srli_epi64(a, N); }
+};
+
+} // namespace
+
+const ArrayKernelTable SSE2_ARRAY_KERNELS = ArrayKernels<Sse2Vec, ScalarVec<false> >::table();
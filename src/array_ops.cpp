@@ -0,0 +1,299 @@
+#include "array_ops.h"
+#include "array_kernels.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+const ArrayKernelTable SCALAR_ARRAY_KERNELS = ArrayKernels<ScalarVec<false>, ScalarVec<false> >::table();
+
+namespace {
+
+const ArrayKernelTable* kernelsFor(ArrayIsa isa) {
+    switch (isa) {
+#ifdef CALCULATOR_X86_KERNELS
+        case ArrayIsa::Avx512: return &AVX512_ARRAY_KERNELS;
+        case ArrayIsa::Avx2: return &AVX2_ARRAY_KERNELS;
+        case ArrayIsa::Sse2: return &SSE2_ARRAY_KERNELS;
+#endif
+        default: return &SCALAR_ARRAY_KERNELS;
+    }
+}
+
+ArrayIsa detectIsa() {
+#if defined(CALCULATOR_X86_KERNELS) && defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return ArrayIsa::Avx512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return ArrayIsa::Avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return ArrayIsa::Sse2;
+    }
+#elif defined(CALCULATOR_X86_KERNELS) && (defined(_M_X64) || defined(__x86_64__))
+    // SSE2 is part of x86-64
+    return ArrayIsa::Sse2;
+#endif
+    return ArrayIsa::Scalar;
+}
+
+std::atomic<int> activeIsa(-1);
+
+const ArrayKernelTable& kernels() {
+    return activeArrayKernels();
+}
+
+// Blocks below which the reductions stay on the calling thread
+const std::size_t PARALLEL_REDUCTION_BLOCKS = 16;
+
+// Calls fn(block) for every block; with a pool, contiguous runs of
+// blocks go to the workers. fn must write only its own block's results.
+template <typename Fn>
+void forEachBlock(std::size_t blocks, WorkStealingPool* pool, const Fn& fn) {
+    if (!pool || blocks < PARALLEL_REDUCTION_BLOCKS) {
+        for (std::size_t b = 0; b < blocks; ++b) {
+            fn(b);
+        }
+        return;
+    }
+    const std::size_t tasks = std::min(blocks, 4 * pool->size());
+    parallelFor(pool, tasks, [&fn, tasks, blocks](std::size_t t) {
+        for (std::size_t b = blocks * t / tasks; b < blocks * (t + 1) / tasks; ++b) {
+            fn(b);
+        }
+    });
+}
+
+std::size_t blockCount(std::size_t n) {
+    return (n + REDUCTION_BLOCK - 1) / REDUCTION_BLOCK;
+}
+
+std::size_t blockSize(std::size_t block, std::size_t n) {
+    return std::min(REDUCTION_BLOCK, n - block * REDUCTION_BLOCK);
+}
+
+CompensatedSum combine(const CompensatedSum& a, const CompensatedSum& b) {
+    CompensatedSum result = a;
+    addToLane(result, b.sum);
+    result.error += b.error;
+    return result;
+}
+
+// Pairwise tree over partials[begin, end); the shape depends only on the count
+CompensatedSum combineRange(const CompensatedSum* partials, std::size_t begin, std::size_t end) {
+    if (end - begin == 1) {
+        return partials[begin];
+    }
+    std::size_t middle = begin + (end - begin) / 2;
+    return combine(combineRange(partials, begin, middle), combineRange(partials, middle, end));
+}
+
+CompensatedSum combineLanes(const CompensatedSum lanes[REDUCTION_LANES]) {
+    return combineRange(lanes, 0, REDUCTION_LANES);
+}
+
+// Infinite sums make the TwoSum error NaN; the plain sum is right then
+double value(const CompensatedSum& total) {
+    return std::isfinite(total.sum) ? total.sum + total.error : total.sum;
+}
+
+std::vector<CompensatedSum> blockSums(const double* x, std::size_t n, WorkStealingPool* pool) {
+    std::vector<CompensatedSum> partials(blockCount(n));
+    const ArrayKernelTable& table = kernels();
+    forEachBlock(partials.size(), pool, [&](std::size_t b) {
+        CompensatedSum lanes[REDUCTION_LANES];
+        table.sum(x + b * REDUCTION_BLOCK, blockSize(b, n), lanes);
+        partials[b] = combineLanes(lanes);
+    });
+    return partials;
+}
+
+} // namespace
+
+ArrayIsa supportedArrayIsa() {
+    static const ArrayIsa supported = detectIsa();
+    return supported;
+}
+
+ArrayIsa activeArrayIsa() {
+    int isa = activeIsa.load(std::memory_order_relaxed);
+    if (isa < 0) {
+        return supportedArrayIsa();
+    }
+    return static_cast<ArrayIsa>(isa);
+}
+
+ArrayIsa setArrayIsa(ArrayIsa isa) {
+    if (static_cast<int>(isa) > static_cast<int>(supportedArrayIsa())) {
+        isa = supportedArrayIsa();
+    }
+    activeIsa.store(static_cast<int>(isa), std::memory_order_relaxed);
+    return isa;
+}
+
+const ArrayKernelTable& activeArrayKernels() {
+    return *kernelsFor(activeArrayIsa());
+}
+
+const char* arrayIsaName(ArrayIsa isa) {
+    switch (isa) {
+        case ArrayIsa::Scalar: return "scalar";
+        case ArrayIsa::Sse2: return "sse2";
+        case ArrayIsa::Avx2: return "avx2";
+        case ArrayIsa::Avx512: return "avx512";
+    }
+    return "unknown";
+}
+
+void arrayAdd(const double* a, const double* b, double* out, std::size_t n) {
+    kernels().add(a, b, out, n);
+}
+
+void arraySubtract(const double* a, const double* b, double* out, std::size_t n) {
+    kernels().subtract(a, b, out, n);
+}
+
+void arrayMultiply(const double* a, const double* b, double* out, std::size_t n) {
+    kernels().multiply(a, b, out, n);
+}
+
+std::size_t arrayDivide(const double* a, const double* b, double* out, std::size_t n,
+                        unsigned char* errors) {
+    return kernels().divide(a, b, out, n, errors);
+}
+
+std::size_t arraySqrt(const double* x, double* out, std::size_t n, unsigned char* errors) {
+    return kernels().sqrt(x, out, n, errors);
+}
+
+std::size_t arrayLn(const double* x, double* out, std::size_t n, unsigned char* errors) {
+    return kernels().ln(x, out, n, errors);
+}
+
+void arrayPower(const double* base, const double* exponent, double* out, std::size_t n) {
+    // A vector pow within an ulp needs an extended-precision log and exp;
+    // until then every element goes through libm
+    for (std::size_t i = 0; i < n; ++i) {
+        out[i] = std::pow(base[i], exponent[i]);
+    }
+}
+
+void arraySin(const double* x, double* out, std::size_t n, bool useRadians) {
+    kernels().sin(x, out, n, useRadians);
+}
+
+void arrayCos(const double* x, double* out, std::size_t n, bool useRadians) {
+    kernels().cos(x, out, n, useRadians);
+}
+
+void arrayTan(const double* x, double* out, std::size_t n, bool useRadians) {
+    kernels().tan(x, out, n, useRadians);
+}
+
+void arraySinCos(const double* x, double* sines, double* cosines, std::size_t n, bool useRadians) {
+    kernels().sinCos(x, sines, cosines, n, useRadians);
+}
+
+double arraySum(const double* x, std::size_t n, WorkStealingPool* pool) {
+    if (n == 0) {
+        return 0.0;
+    }
+    std::vector<CompensatedSum> partials = blockSums(x, n, pool);
+    return value(combineRange(partials.data(), 0, partials.size()));
+}
+
+double arrayMean(const double* x, std::size_t n, WorkStealingPool* pool) {
+    if (n == 0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return arraySum(x, n, pool) / static_cast<double>(n);
+}
+
+double arrayVariance(const double* x, std::size_t n, WorkStealingPool* pool) {
+    if (n < 2) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    const double mean = arrayMean(x, n, pool);
+    std::vector<CompensatedSum> linear(blockCount(n));
+    std::vector<CompensatedSum> squares(linear.size());
+    const ArrayKernelTable& table = kernels();
+    forEachBlock(linear.size(), pool, [&](std::size_t b) {
+        CompensatedSum linearLanes[REDUCTION_LANES];
+        CompensatedSum squareLanes[REDUCTION_LANES];
+        table.deviations(x + b * REDUCTION_BLOCK, blockSize(b, n), mean, linearLanes, squareLanes);
+        linear[b] = combineLanes(linearLanes);
+        squares[b] = combineLanes(squareLanes);
+    });
+    const double count = static_cast<double>(n);
+    const double offset = value(combineRange(linear.data(), 0, linear.size()));
+    const double deviation = value(combineRange(squares.data(), 0, squares.size()));
+    return std::max(deviation - offset * offset / count, 0.0) / (count - 1);
+}
+
+namespace {
+
+void minMax(const double* x, std::size_t n, WorkStealingPool* pool, double& min, double& max) {
+    if (n == 0) {
+        min = max = std::numeric_limits<double>::quiet_NaN();
+        return;
+    }
+    std::vector<double> mins(blockCount(n));
+    std::vector<double> maxes(mins.size());
+    const ArrayKernelTable& table = kernels();
+    forEachBlock(mins.size(), pool, [&](std::size_t b) {
+        table.minMax(x + b * REDUCTION_BLOCK, blockSize(b, n), mins[b], maxes[b]);
+    });
+    min = mins[0];
+    max = maxes[0];
+    for (std::size_t b = 1; b < mins.size() && !std::isnan(min); ++b) {
+        if (std::isnan(mins[b])) {
+            min = max = mins[b];
+            break;
+        }
+        min = mins[b] < min ? mins[b] : min;
+        max = max < maxes[b] ? maxes[b] : max;
+    }
+}
+
+} // namespace
+
+double arrayMin(const double* x, std::size_t n, WorkStealingPool* pool) {
+    double min;
+    double max;
+    minMax(x, n, pool, min, max);
+    return min;
+}
+
+double arrayMax(const double* x, std::size_t n, WorkStealingPool* pool) {
+    double min;
+    double max;
+    minMax(x, n, pool, min, max);
+    return max;
+}
+
+void arrayPrefixSum(const double* x, double* out, std::size_t n, WorkStealingPool* pool) {
+    if (n == 0) {
+        return;
+    }
+    // Exact starting offset of every block, then independent block scans
+    std::vector<CompensatedSum> offsets = blockSums(x, n, pool);
+    CompensatedSum running = {0.0, 0.0};
+    for (CompensatedSum& offset : offsets) {
+        CompensatedSum total = offset;
+        offset = running;
+        running = combine(running, total);
+    }
+    forEachBlock(offsets.size(), pool, [&](std::size_t b) {
+        CompensatedSum total = offsets[b];
+        const double* in = x + b * REDUCTION_BLOCK;
+        double* result = out + b * REDUCTION_BLOCK;
+        for (std::size_t i = 0, size = blockSize(b, n); i < size; ++i) {
+            addToLane(total, in[i]);
+            result[i] = value(total);
+        }
+    });
+}
@@ -0,0 +1,173 @@
+/**
+ * @file array_ops.h
+ * @brief Element-wise calculator operations on arrays of doubles
+ */
+
+#ifndef ARRAY_OPS_H
+#define ARRAY_OPS_H
+
+#include <cstddef>
+
+class WorkStealingPool;
+
+/**
+ * @enum ArrayIsa
+ * @brief Instruction sets the array kernels are built for
+ */
+enum class ArrayIsa {
+    Scalar,  ///< Plain C++ loop, available everywhere
+    Sse2,    ///< 2 doubles per instruction
+    Avx2,    ///< 4 doubles per instruction, with FMA
+    Avx512   ///< 8 doubles per instruction
+};
+
+/**
+ * @brief Get the best instruction set supported by this CPU
+ * @return Detected instruction set
+ */
+ArrayIsa supportedArrayIsa();
+
+/**
+ * @brief Get the instruction set the array operations currently use
+ * @return Active instruction set, the supported one unless overridden
+ */
+ArrayIsa activeArrayIsa();
+
+/**
+ * @brief Force the array operations onto an instruction set
+ *
+ * Meant for tests and benchmarks. Requests beyond what the CPU supports
+ * fall back to supportedArrayIsa().
+ *
+ * @param isa Instruction set to use
+ * @return Instruction set actually selected
+ */
+ArrayIsa setArrayIsa(ArrayIsa isa);
+
+/**
+ * @brief Get a printable name of an instruction set
+ * @param isa Instruction set
+ * @return "scalar", "sse2", "avx2" or "avx512"
+ */
+const char* arrayIsaName(ArrayIsa isa);
+
+/**
+ * @brief Element-wise a + b
+ *
+ * The binary operations read a[i] and b[i] and write out[i] for i < n.
+ * out may alias either input.
+ */
+void arrayAdd(const double* a, const double* b, double* out, std::size_t n);
+
+/** @brief Element-wise a - b */
+void arraySubtract(const double* a, const double* b, double* out, std::size_t n);
+
+/** @brief Element-wise a * b */
+void arrayMultiply(const double* a, const double* b, double* out, std::size_t n);
+
+/**
+ * @brief Element-wise a / b
+ *
+ * Domain errors are reported per element instead of thrown: the failing
+ * element's result is NaN and, when errors is not null, errors[i] is set
+ * to 1 (0 for elements that succeeded).
+ *
+ * @param errors Optional mask of n bytes
+ * @return Number of elements with b[i] == 0
+ */
+std::size_t arrayDivide(const double* a, const double* b, double* out, std::size_t n,
+                        unsigned char* errors = nullptr);
+
+/**
+ * @brief Element-wise square root, exact like std::sqrt
+ * @param errors Optional mask of n bytes, see arrayDivide()
+ * @return Number of elements with x[i] < 0
+ */
+std::size_t arraySqrt(const double* x, double* out, std::size_t n, unsigned char* errors = nullptr);
+
+/**
+ * @brief Element-wise natural logarithm, within 1 ulp of std::log
+ * @param errors Optional mask of n bytes, see arrayDivide()
+ * @return Number of elements with x[i] <= 0
+ */
+std::size_t arrayLn(const double* x, double* out, std::size_t n, unsigned char* errors = nullptr);
+
+/**
+ * @brief Element-wise base ^ exponent, identical to std::pow
+ */
+void arrayPower(const double* base, const double* exponent, double* out, std::size_t n);
+
+/**
+ * @brief Element-wise sine, within 2 ulp of std::sin
+ *
+ * Degrees are reduced modulo 90 exactly before conversion, as in
+ * fastSinDegrees(): within 2 ulp of fastSinDegrees() and exact at
+ * multiples of 90, 30 and 45 degrees.
+ *
+ * @param useRadians false to treat the inputs as degrees
+ */
+void arraySin(const double* x, double* out, std::size_t n, bool useRadians = true);
+
+/** @brief Element-wise cosine, see arraySin() */
+void arrayCos(const double* x, double* out, std::size_t n, bool useRadians = true);
+
+/** @brief Element-wise tangent, within 4 ulp of std::tan; see arraySin() */
+void arrayTan(const double* x, double* out, std::size_t n, bool useRadians = true);
+
+/**
+ * @brief Element-wise sine and cosine from one argument reduction
+ *
+ * Same results as arraySin() and arrayCos() at about the cost of one.
+ */
+void arraySinCos(const double* x, double* sines, double* cosines, std::size_t n, bool useRadians = true);
+
+/// Elements per reduction block
+const std::size_t REDUCTION_BLOCK = 16384;
+
+/**
+ * @brief Sum of x[0] .. x[n - 1]
+ *
+ * The reductions split the array into blocks of REDUCTION_BLOCK
+ * elements. Each block is added up in eight SIMD lanes with TwoSum
+ * compensation, and the block results are combined in a fixed pairwise
+ * tree, so the error stays near one rounding of the exact sum. With a
+ * pool, blocks are spread over its workers. Because the blocks, lanes
+ * and tree do not depend on the thread count or instruction set, the
+ * result is bit-identical with and without a pool. A NaN element makes
+ * the result NaN.
+ *
+ * @param pool Workers for large arrays, or nullptr for the calling thread
+ * @return Sum, 0 for n == 0
+ */
+double arraySum(const double* x, std::size_t n, WorkStealingPool* pool = nullptr);
+
+/** @brief Arithmetic mean, see arraySum(); NaN for n == 0 */
+double arrayMean(const double* x, std::size_t n, WorkStealingPool* pool = nullptr);
+
+/**
+ * @brief Sample variance (divided by n - 1), see arraySum()
+ *
+ * Uses the corrected two-pass algorithm: the compensated sums of
+ * x[i] - mean and of its square, so large offsets do not cancel.
+ *
+ * @return Variance, NaN for n < 2
+ */
+double arrayVariance(const double* x, std::size_t n, WorkStealingPool* pool = nullptr);
+
+/** @brief Smallest element; NaN for n == 0 or if any element is NaN */
+double arrayMin(const double* x, std::size_t n, WorkStealingPool* pool = nullptr);
+
+/** @brief Largest element; NaN for n == 0 or if any element is NaN */
+double arrayMax(const double* x, std::size_t n, WorkStealingPool* pool = nullptr);
+
+/**
+ * @brief Inclusive prefix sum: out[i] = x[0] + ... + x[i]
+ *
+ * Every output is a compensated running sum. The block totals are
+ * computed first (on the pool, if given), then every block is scanned
+ * from its exact starting offset, so the result is the same for any
+ * thread count. out may alias x.
+ */
+void arrayPrefixSum(const double* x, double* out, std::size_t n, WorkStealingPool* pool = nullptr);
+
+#endif // ARRAY_OPS_H
@@ -0,0 +1,221 @@
+/**
+ * @file basic_calculator.h
+ * @brief Calculator operations configured at compile time through policies
+ */
+
+#ifndef BASIC_CALCULATOR_H
+#define BASIC_CALCULATOR_H
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+#include "calc_result.h"
+#include "fast_math.h"
+#include "history.h"
+
+// History policies
+
+/**
+ * @struct NoHistory
+ * @brief Records nothing; recording compiles away
+ */
+struct NoHistory {
+    constexpr void record(HistoryOp, double, double, double) {
+    }
+};
+
+/**
+ * @struct RingHistory
+ * @brief Keeps the most recent records in a HistoryBuffer, like Calculator
+ */
+struct RingHistory {
+    HistoryBuffer records;
+
+    explicit RingHistory(std::size_t capacity = HistoryBuffer::DEFAULT_CAPACITY)
+        : records(capacity) {
+    }
+
+    void record(HistoryOp op, double lhs, double rhs, double result) {
+        records.push(op, lhs, rhs, result);
+    }
+};
+
+/**
+ * @struct FullHistory
+ * @brief Keeps every record
+ */
+struct FullHistory {
+    std::vector<HistoryRecord> records;
+
+    void record(HistoryOp op, double lhs, double rhs, double result) {
+        HistoryRecord entry = {op, lhs, rhs, result};
+        records.push_back(entry);
+    }
+};
+
+// Angle policies
+
+/**
+ * @struct Radians
+ * @brief Trigonometric arguments are radians
+ */
+struct Radians {
+    static const HistoryOp SIN = HistoryOp::Sin;
+    static const HistoryOp COS = HistoryOp::Cos;
+    static const HistoryOp TAN = HistoryOp::Tan;
+
+    static double sin(double x) { return std::sin(x); }
+    static double cos(double x) { return std::cos(x); }
+    static double tan(double x) { return std::tan(x); }
+};
+
+/**
+ * @struct Degrees
+ * @brief Trigonometric arguments are degrees, reduced exactly like Calculator's degree mode
+ */
+struct Degrees {
+    static const HistoryOp SIN = HistoryOp::SinDegrees;
+    static const HistoryOp COS = HistoryOp::CosDegrees;
+    static const HistoryOp TAN = HistoryOp::TanDegrees;
+
+    static double sin(double x) { return fastSinDegrees(x, MathPrecision::Exact); }
+    static double cos(double x) { return fastCosDegrees(x, MathPrecision::Exact); }
+    static double tan(double x) { return fastTanDegrees(x, MathPrecision::Exact); }
+};
+
+// Error policies
+
+/**
+ * @struct ThrowOnError
+ * @brief Operations return double and throw std::domain_error on failure
+ */
+struct ThrowOnError {
+    typedef double Result;
+
+    static constexpr Result success(double value) { return value; }
+
+    static Result failure(CalcStatus status) {
+        throw std::domain_error(calcStatusMessage(status));
+    }
+};
+
+/**
+ * @struct StatusOnError
+ * @brief Operations return a CalcResult and never throw
+ */
+struct StatusOnError {
+    typedef CalcResult Result;
+
+    static constexpr Result success(double value) { return CalcResult::success(value); }
+    static constexpr Result failure(CalcStatus status) { return CalcResult::failure(status); }
+};
+
+/**
+ * @class BasicCalculator
+ * @brief The arithmetic and scientific operations of Calculator, without display state
+ *
+ * Each policy is chosen at compile time, so an instantiation such as
+ * BasicCalculator<NoHistory, Radians, StatusOnError> reduces every
+ * operation to the floating-point instruction plus its domain check.
+ * With NoHistory the arithmetic operations are usable in constant
+ * expressions.
+ *
+ * Calculator remains the interactive class with display, memory, input
+ * and a runtime angle unit; its operations behave like
+ * BasicCalculator<RingHistory, Radians, ThrowOnError>.
+ *
+ * @tparam HistoryPolicy NoHistory, RingHistory or FullHistory
+ * @tparam AnglePolicy Radians or Degrees
+ * @tparam ErrorPolicy ThrowOnError or StatusOnError
+ */
+template <typename HistoryPolicy = RingHistory, typename AnglePolicy = Radians,
+          typename ErrorPolicy = ThrowOnError>
+class BasicCalculator {
+public:
+    typedef typename ErrorPolicy::Result Result;
+
+    constexpr BasicCalculator() : history() {
+    }
+
+    explicit BasicCalculator(const HistoryPolicy& history) : history(history) {
+    }
+
+    constexpr double add(double a, double b) {
+        return record(HistoryOp::Add, a, b, a + b);
+    }
+
+    constexpr double subtract(double a, double b) {
+        return record(HistoryOp::Subtract, a, b, a - b);
+    }
+
+    constexpr double multiply(double a, double b) {
+        return record(HistoryOp::Multiply, a, b, a * b);
+    }
+
+    /**
+     * @brief Divide
+     * @return a / b, or the error policy's failure for b == 0
+     */
+    constexpr Result divide(double a, double b) {
+        if (b == 0) {
+            return ErrorPolicy::failure(CalcStatus::DivisionByZero);
+        }
+        return ErrorPolicy::success(record(HistoryOp::Divide, a, b, a / b));
+    }
+
+    /**
+     * @brief Square root
+     * @return Square root of x, or the error policy's failure for x < 0
+     */
+    Result sqrt(double x) {
+        if (x < 0) {
+            return ErrorPolicy::failure(CalcStatus::NegativeSqrt);
+        }
+        return ErrorPolicy::success(record(HistoryOp::Sqrt, x, 0, std::sqrt(x)));
+    }
+
+    double power(double base, double exp) {
+        return record(HistoryOp::Power, base, exp, std::pow(base, exp));
+    }
+
+    /**
+     * @brief Natural logarithm
+     * @return Logarithm of x, or the error policy's failure for x <= 0
+     */
+    Result ln(double x) {
+        if (x <= 0) {
+            return ErrorPolicy::failure(CalcStatus::NonPositiveLog);
+        }
+        return ErrorPolicy::success(record(HistoryOp::Ln, x, 0, std::log(x)));
+    }
+
+    double sin(double x) {
+        return record(AnglePolicy::SIN, x, 0, AnglePolicy::sin(x));
+    }
+
+    double cos(double x) {
+        return record(AnglePolicy::COS, x, 0, AnglePolicy::cos(x));
+    }
+
+    double tan(double x) {
+        return record(AnglePolicy::TAN, x, 0, AnglePolicy::tan(x));
+    }
+
+    /**
+     * @brief Access the history policy, e.g. getHistory().records
+     */
+    const HistoryPolicy& getHistory() const { return history; }
+    HistoryPolicy& getHistory() { return history; }
+
+private:
+    HistoryPolicy history;
+
+    constexpr double record(HistoryOp op, double lhs, double rhs, double result) {
+        history.record(op, lhs, rhs, result);
+        return result;
+    }
+};
+
+#endif // BASIC_CALCULATOR_H
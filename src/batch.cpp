@@ -0,0 +1,285 @@
+#include "batch.h"
+#include "expression_parser.h"
+#include "number_format.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::size_t READ_CHUNK_SIZE = 1 << 20;
+
+/**
+ * @brief ExpressionParser builder that evaluates through Calculator operations
+ *
+ * Domain errors use the non-throwing operations: the first failure is
+ * kept in status and the remaining operations of the line are skipped.
+ */
+class CalculatorBuilder {
+public:
+    typedef double Value;
+
+    explicit CalculatorBuilder(Calculator& calc) : calc(calc), status(CalcStatus::Ok) {
+    }
+
+    CalcStatus failure() const {
+        return status;
+    }
+
+    double constant(double value) {
+        return value;
+    }
+
+    double variable(const char* name, std::size_t length) {
+        throw std::invalid_argument("Unknown variable '" + std::string(name, length) + "'");
+    }
+
+    double emit(CompiledExpr::Opcode op, double x) {
+        typedef CompiledExpr::Opcode Opcode;
+        if (status != CalcStatus::Ok) {
+            return 0.0;
+        }
+        switch (op) {
+            case Opcode::Negate: return -x;
+            case Opcode::Sqrt: return check(calc.trySqrt(x));
+            case Opcode::Ln: return check(calc.tryLn(x));
+            // The calculator applies its own angle unit
+            case Opcode::Sin: case Opcode::SinDegrees: return calc.sin(x);
+            case Opcode::Cos: case Opcode::CosDegrees: return calc.cos(x);
+            case Opcode::Tan: case Opcode::TanDegrees: return calc.tan(x);
+            default: break;
+        }
+        return emit(op, x, 0.0);
+    }
+
+    double emit(CompiledExpr::Opcode op, double a, double b) {
+        typedef CompiledExpr::Opcode Opcode;
+        if (status != CalcStatus::Ok) {
+            return 0.0;
+        }
+        switch (op) {
+            case Opcode::Add: return calc.add(a, b);
+            case Opcode::Subtract: return calc.subtract(a, b);
+            case Opcode::Multiply: return calc.multiply(a, b);
+            case Opcode::Divide: return check(calc.tryDivide(a, b));
+            case Opcode::Power: return calc.power(a, b);
+            default: break;
+        }
+        return emit(op, a);
+    }
+
+private:
+    Calculator& calc;
+    CalcStatus status;
+
+    double check(CalcResult result) {
+        status = result.status;
+        return result.value;
+    }
+};
+
+} // namespace
+
+BatchLineStatus evaluateBatchLine(Calculator& calc, const char* text, std::size_t length,
+                                  double& result, std::string& error) {
+    if (length > 0 && text[length - 1] == '\r') {
+        --length;
+    }
+    std::size_t start = 0;
+    while (start < length && (text[start] == ' ' || text[start] == '\t')) {
+        ++start;
+    }
+    if (start == length) {
+        return BatchLineStatus::Blank;
+    }
+    try {
+        CalculatorBuilder builder(calc);
+        ExpressionParser<CalculatorBuilder> parser(text, length, builder, true);
+        result = parser.parse();
+        if (builder.failure() != CalcStatus::Ok) {
+            error = calcStatusMessage(builder.failure());
+            return BatchLineStatus::Error;
+        }
+        return BatchLineStatus::Value;
+    } catch (const std::exception& e) {
+        error = e.what();
+        return BatchLineStatus::Error;
+    }
+}
+
+BatchOptions::BatchOptions()
+    : recordHistory(true)
+    , shortestOutput(false)
+    , outputBufferSize(1 << 20) {
+}
+
+BatchEvaluator::BatchEvaluator(Calculator& calc, int outputFd, const BatchOptions& options)
+    : calc(calc)
+    , outputFd(outputFd)
+    , shortestOutput(options.shortestOutput)
+    , output(options.outputBufferSize < NUMBER_BUFFER_SIZE ? NUMBER_BUFFER_SIZE
+                                                           : options.outputBufferSize)
+    , outputSize(0) {
+    counters.lines = 0;
+    counters.errors = 0;
+    if (!options.recordHistory) {
+        calc.setHistoryCapacity(0);
+    }
+}
+
+BatchEvaluator::~BatchEvaluator() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Nowhere to report a failed write from a destructor
+    }
+}
+
+void BatchEvaluator::evaluateLine(const char* text, std::size_t length) {
+    ++counters.lines;
+    double result;
+    switch (evaluateBatchLine(calc, text, length, result, error)) {
+        case BatchLineStatus::Value: {
+            if (output.size() - outputSize < NUMBER_BUFFER_SIZE + 1) {
+                flush();
+            }
+            char* out = output.data() + outputSize;
+            std::size_t written = shortestOutput ? formatShortest(result, out)
+                                                 : formatFixed(result, out);
+            out[written] = '\n';
+            outputSize += written + 1;
+            break;
+        }
+        case BatchLineStatus::Blank:
+            append("\n", 1);
+            break;
+        case BatchLineStatus::Error:
+            ++counters.errors;
+            append("Error: ", 7);
+            append(error.data(), error.size());
+            append("\n", 1);
+            break;
+    }
+}
+
+void BatchEvaluator::feed(const char* data, std::size_t size) {
+    const char* end = data + size;
+    if (!pending.empty()) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', size));
+        if (newline == nullptr) {
+            pending.append(data, size);
+            return;
+        }
+        pending.append(data, newline - data);
+        evaluateLine(pending.data(), pending.size());
+        pending.clear();
+        data = newline + 1;
+    }
+    while (data < end) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        if (newline == nullptr) {
+            pending.assign(data, end - data);
+            return;
+        }
+        evaluateLine(data, newline - data);
+        data = newline + 1;
+    }
+}
+
+void BatchEvaluator::finish() {
+    if (!pending.empty()) {
+        evaluateLine(pending.data(), pending.size());
+        pending.clear();
+    }
+    flush();
+}
+
+void BatchEvaluator::flush() {
+    std::size_t done = 0;
+    while (done < outputSize) {
+        ssize_t written = ::write(outputFd, output.data() + done, outputSize - done);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            outputSize = 0;
+            throw std::runtime_error(std::string("Write failed: ") + std::strerror(errno));
+        }
+        done += static_cast<std::size_t>(written);
+    }
+    outputSize = 0;
+}
+
+void BatchEvaluator::append(const char* text, std::size_t length) {
+    while (length > 0) {
+        if (outputSize == output.size()) {
+            flush();
+        }
+        std::size_t chunk = std::min(length, output.size() - outputSize);
+        std::memcpy(output.data() + outputSize, text, chunk);
+        outputSize += chunk;
+        text += chunk;
+        length -= chunk;
+    }
+}
+
+void BatchEvaluator::run(const std::string& path) {
+    if (path == "-") {
+        readStream(0);
+        finish();
+        return;
+    }
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        std::size_t size = static_cast<std::size_t>(info.st_size);
+        void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            ::madvise(mapped, size, MADV_SEQUENTIAL);
+            try {
+                feed(static_cast<const char*>(mapped), size);
+            } catch (...) {
+                ::munmap(mapped, size);
+                ::close(fd);
+                throw;
+            }
+            ::munmap(mapped, size);
+            ::close(fd);
+            finish();
+            return;
+        }
+    }
+    try {
+        readStream(fd);
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+    finish();
+}
+
+void BatchEvaluator::readStream(int fd) {
+    std::vector<char> chunk(READ_CHUNK_SIZE);
+    for (;;) {
+        ssize_t count = ::read(fd, chunk.data(), chunk.size());
+        if (count == 0) {
+            return;
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Read failed: ") + std::strerror(errno));
+        }
+        feed(chunk.data(), static_cast<std::size_t>(count));
+    }
+}
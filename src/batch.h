@@ -0,0 +1,136 @@
+/**
+ * @file batch.h
+ * @brief Non-interactive evaluation of newline-delimited expressions
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "calculator.h"
+
+/**
+ * @struct BatchOptions
+ * @brief Settings for a BatchEvaluator
+ */
+struct BatchOptions {
+    bool recordHistory;            ///< Record each operation in the calculator history
+    bool shortestOutput;           ///< Print full-precision results instead of the display format
+    std::size_t outputBufferSize;  ///< Bytes collected before each write to the output
+
+    BatchOptions();
+};
+
+/**
+ * @struct BatchStats
+ * @brief Counters for the lines processed so far
+ */
+struct BatchStats {
+    std::size_t lines;   ///< Lines evaluated, including blank and failed ones
+    std::size_t errors;  ///< Lines that produced an error
+};
+
+/**
+ * @enum BatchLineStatus
+ * @brief Outcome of evaluating one line of batch input
+ */
+enum class BatchLineStatus {
+    Value,  ///< The line produced a result
+    Blank,  ///< The line was empty or only whitespace
+    Error   ///< The line could not be parsed or evaluated
+};
+
+/**
+ * @brief Evaluate one line of batch input through Calculator operations
+ * @param calc Calculator that performs the operations
+ * @param text Line contents without the newline (a trailing '\r' is ignored)
+ * @param length Number of characters
+ * @param result Receives the value when the status is Value
+ * @param error Receives the message when the status is Error
+ * @return Outcome of the line
+ */
+BatchLineStatus evaluateBatchLine(Calculator& calc, const char* text, std::size_t length,
+                                  double& result, std::string& error);
+
+/**
+ * @class BatchEvaluator
+ * @brief Streams expressions through a Calculator and writes one result per line
+ *
+ * Each input line is parsed with the CompiledExpr grammar and evaluated
+ * directly through the Calculator operations (no bytecode is built).
+ * The output line is the result in display format, an empty line for
+ * blank input, or "Error: ..." like the calculator display. Output is
+ * collected in a large buffer and written to a file descriptor in big
+ * chunks.
+ */
+class BatchEvaluator {
+public:
+    /**
+     * @brief Create an evaluator writing to a file descriptor
+     * @param calc Calculator that performs the operations; history
+     *        recording is disabled on it unless options.recordHistory is set
+     * @param outputFd Destination, e.g. 1 for stdout
+     * @param options Evaluation settings
+     */
+    BatchEvaluator(Calculator& calc, int outputFd, const BatchOptions& options = BatchOptions());
+
+    /**
+     * @brief Flushes any buffered output
+     */
+    ~BatchEvaluator();
+
+    /**
+     * @brief Evaluate one line and buffer its output
+     * @param text Line contents without the newline
+     * @param length Number of characters
+     */
+    void evaluateLine(const char* text, std::size_t length);
+
+    /**
+     * @brief Evaluate every complete line in a chunk of input
+     *
+     * A line split across chunks is kept until the rest arrives.
+     *
+     * @param data Input bytes
+     * @param size Number of bytes
+     */
+    void feed(const char* data, std::size_t size);
+
+    /**
+     * @brief Evaluate a trailing line without newline and flush the output
+     */
+    void finish();
+
+    /**
+     * @brief Write buffered output to the file descriptor
+     * @throw std::runtime_error if the write fails
+     */
+    void flush();
+
+    /**
+     * @brief Evaluate a whole file, memory-mapping it when possible
+     * @param path File to read, or "-" for standard input
+     * @throw std::runtime_error if the file cannot be read
+     */
+    void run(const std::string& path);
+
+    const BatchStats& stats() const { return counters; }
+
+private:
+    Calculator& calc;
+    int outputFd;
+    bool shortestOutput;
+    std::vector<char> output;   ///< Pending output bytes
+    std::size_t outputSize;     ///< Bytes used in output
+    std::string pending;        ///< Incomplete line carried between feed() calls
+    std::string error;          ///< Message of the last failed line
+    BatchStats counters;
+
+    void append(const char* text, std::size_t length);
+    void readStream(int fd);
+};
+
+#endif // BATCH_H
@@ -0,0 +1,165 @@
+/**
+ * @file big_uint.h
+ * @brief Fixed-size big integer shared by the number conversion routines
+ *
+ * Internal header; not installed.
+ */
+
+#ifndef BIG_UINT_H
+#define BIG_UINT_H
+
+#include <cstdint>
+#include <cstring>
+
+/// Implicit leading bit of a normal double mantissa
+const std::uint64_t HIDDEN_BIT = std::uint64_t(1) << 52;
+
+/// Binary exponent of the smallest subnormal double
+const int MIN_EXPONENT = -1074;
+
+/**
+ * @brief Fixed-size unsigned big integer used for exact conversions
+ *
+ * 40 limbs of 32 bits hold every intermediate value needed to convert
+ * between doubles and decimal text exactly (the widest is about 1200
+ * bits, when parsing input near the subnormal range).
+ */
+struct BigUint {
+    static const int LIMBS = 40;
+    std::uint32_t limb[LIMBS];
+    int size; ///< Number of significant limbs, 0 for zero
+
+    explicit BigUint(std::uint64_t value = 0) : size(0) {
+        while (value != 0) {
+            limb[size++] = static_cast<std::uint32_t>(value);
+            value >>= 32;
+        }
+    }
+
+    bool isZero() const { return size == 0; }
+
+    void multiplySmall(std::uint32_t factor) {
+        std::uint64_t carry = 0;
+        for (int i = 0; i < size; ++i) {
+            std::uint64_t product = std::uint64_t(limb[i]) * factor + carry;
+            limb[i] = static_cast<std::uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry != 0) {
+            limb[size++] = static_cast<std::uint32_t>(carry);
+        }
+    }
+
+    void multiplyPow10(int exponent) {
+        static const std::uint32_t POW10[] = {
+            1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+        };
+        for (; exponent >= 9; exponent -= 9) {
+            multiplySmall(1000000000);
+        }
+        if (exponent > 0) {
+            multiplySmall(POW10[exponent]);
+        }
+    }
+
+    void shiftLeft(int bits) {
+        if (size == 0 || bits == 0) {
+            return;
+        }
+        int words = bits / 32;
+        int rest = bits % 32;
+        int top = size + words;
+        limb[top] = 0;
+        for (int i = size - 1; i >= 0; --i) {
+            std::uint64_t wide = std::uint64_t(limb[i]) << rest;
+            limb[i + words + 1] |= static_cast<std::uint32_t>(wide >> 32);
+            limb[i + words] = static_cast<std::uint32_t>(wide);
+        }
+        for (int i = 0; i < words; ++i) {
+            limb[i] = 0;
+        }
+        size = top + 1;
+        trim();
+    }
+
+    /// Divide in place and return the remainder
+    std::uint32_t divideSmall(std::uint32_t divisor) {
+        std::uint64_t remainder = 0;
+        for (int i = size - 1; i >= 0; --i) {
+            std::uint64_t current = (remainder << 32) | limb[i];
+            limb[i] = static_cast<std::uint32_t>(current / divisor);
+            remainder = current % divisor;
+        }
+        trim();
+        return static_cast<std::uint32_t>(remainder);
+    }
+
+    void add(const BigUint& other) {
+        int count = size > other.size ? size : other.size;
+        std::uint64_t carry = 0;
+        for (int i = 0; i < count; ++i) {
+            std::uint64_t sum = carry;
+            sum += i < size ? limb[i] : 0;
+            sum += i < other.size ? other.limb[i] : 0;
+            limb[i] = static_cast<std::uint32_t>(sum);
+            carry = sum >> 32;
+        }
+        size = count;
+        if (carry != 0) {
+            limb[size++] = static_cast<std::uint32_t>(carry);
+        }
+    }
+
+    /// Subtract a value that is not larger than this one
+    void subtract(const BigUint& other) {
+        std::int64_t borrow = 0;
+        for (int i = 0; i < size; ++i) {
+            std::int64_t diff = std::int64_t(limb[i]) - borrow
+                - (i < other.size ? std::int64_t(other.limb[i]) : 0);
+            borrow = diff < 0 ? 1 : 0;
+            limb[i] = static_cast<std::uint32_t>(diff + (borrow << 32));
+        }
+        trim();
+    }
+
+    void trim() {
+        while (size > 0 && limb[size - 1] == 0) {
+            --size;
+        }
+    }
+
+    static int compare(const BigUint& a, const BigUint& b) {
+        if (a.size != b.size) {
+            return a.size < b.size ? -1 : 1;
+        }
+        for (int i = a.size - 1; i >= 0; --i) {
+            if (a.limb[i] != b.limb[i]) {
+                return a.limb[i] < b.limb[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+};
+
+/**
+ * @brief Split a finite double into value = mantissa * 2^exponent
+ * @param value Number to split
+ * @param mantissa Receives the integer significand (hidden bit included)
+ * @param exponent Receives the binary exponent
+ * @return true if the sign bit is set
+ */
+inline bool decomposeDouble(double value, std::uint64_t& mantissa, int& exponent) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    int biased = static_cast<int>((bits >> 52) & 0x7ff);
+    mantissa = bits & (HIDDEN_BIT - 1);
+    if (biased == 0) {
+        exponent = MIN_EXPONENT;
+    } else {
+        mantissa |= HIDDEN_BIT;
+        exponent = biased - 1075;
+    }
+    return (bits >> 63) != 0;
+}
+
+#endif // BIG_UINT_H
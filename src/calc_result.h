@@ -0,0 +1,65 @@
+/**
+ * @file calc_result.h
+ * @brief Status and value returned by the non-throwing calculator operations
+ */
+
+#ifndef CALC_RESULT_H
+#define CALC_RESULT_H
+
+/**
+ * @enum CalcStatus
+ * @brief Outcome of a calculator operation
+ */
+enum class CalcStatus : unsigned char {
+    Ok,              ///< The value is valid
+    DivisionByZero,  ///< Divisor was zero
+    NegativeSqrt,    ///< Square root of a negative number
+    NonPositiveLog,  ///< Logarithm of zero or a negative number
+    Overflow,        ///< Result outside the range of a decimal
+    SingularMatrix,  ///< Matrix has no inverse
+    TooManyDigits    ///< Keyed-in decimal with more digits than are kept
+};
+
+/**
+ * @brief Get the message the throwing operations use for a status
+ * @param status Operation outcome
+ * @return Message such as "Division by zero", empty for Ok
+ */
+inline const char* calcStatusMessage(CalcStatus status) {
+    switch (status) {
+        case CalcStatus::Ok: return "";
+        case CalcStatus::DivisionByZero: return "Division by zero";
+        case CalcStatus::NegativeSqrt: return "Square root of negative number";
+        case CalcStatus::NonPositiveLog: return "Logarithm of non-positive number";
+        case CalcStatus::Overflow: return "Decimal overflow";
+        case CalcStatus::SingularMatrix: return "Singular matrix";
+        case CalcStatus::TooManyDigits: return "Too many digits";
+    }
+    return "Unknown error";
+}
+
+/**
+ * @struct CalcResult
+ * @brief Value of an operation together with its status
+ *
+ * Small enough to be returned in registers, so checking it costs a
+ * compare and branch instead of exception unwinding.
+ */
+struct CalcResult {
+    CalcStatus status;  ///< Ok unless the operation failed
+    double value;       ///< Result, 0 when the operation failed
+
+    constexpr bool ok() const { return status == CalcStatus::Ok; }
+
+    static constexpr CalcResult success(double value) {
+        CalcResult result = {CalcStatus::Ok, value};
+        return result;
+    }
+
+    static constexpr CalcResult failure(CalcStatus status) {
+        CalcResult result = {status, 0.0};
+        return result;
+    }
+};
+
+#endif // CALC_RESULT_H
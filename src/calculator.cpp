@@ -1,168 +1,675 @@
 #include "calculator.h"
-#include <iostream>
-#include <sstream>
-#include <iomanip>
+#include "array_ops.h"
+#include "number_format.h"
+#include "register_bank.h"
 #include <cmath>
 #include <stdexcept>
 #include <vector>
 
-Calculator::Calculator()
+namespace {
+
+[[noreturn]] void throwDomainError(CalcStatus status) {
+    throw std::domain_error(calcStatusMessage(status));
+}
+
+Decimal decimalValue(DecimalResult result) {
+    if (result.status == CalcStatus::Overflow) {
+        throw std::overflow_error(calcStatusMessage(result.status));
+    }
+    if (!result.ok()) {
+        throwDomainError(result.status);
+    }
+    return result.value;
+}
+
+void requireElements(std::size_t n, std::size_t minimum, const char* operation) {
+    if (n < minimum) {
+        throw std::invalid_argument(std::string(operation) + " needs at least " + std::to_string(minimum) +
+                                    (minimum == 1 ? " element" : " elements"));
+    }
+}
+
+} // namespace
+
+Calculator::Calculator(std::size_t historyCapacity)
     : currentNumber(0)
     , storedNumber(0)
     , memoryValue(0)
+    , sharedMemory(nullptr)
     , currentOperation(' ')
     , newNumber(true)
-    , useRadians(true) {
+    , useRadians(true)
+    , mathPrecision(MathPrecision::Exact)
+    , history(historyCapacity)
+    , historyLog(nullptr)
+    , nextSubscription(1)
+    , sharedCache(nullptr)
+    , cacheStats()
+    , workerPool(nullptr)
+    , decimal()
+    , decimalCurrent()
+    , decimalStored()
+    , decimalMemory()
+    , decimalMode(false) {
     displayText = "0";
 }
 
 // Basic Operations
 double Calculator::add(double a, double b) {
+    MetricTimer timer(MetricOp::Add);
     double result = a + b;
-    addToHistory(formatNumber(a) + " + " + formatNumber(b) + " = " + formatNumber(result));
+    addToHistory(HistoryOp::Add, a, b, result);
     return result;
 }
 
 double Calculator::subtract(double a, double b) {
+    MetricTimer timer(MetricOp::Subtract);
     double result = a - b;
-    addToHistory(formatNumber(a) + " - " + formatNumber(b) + " = " + formatNumber(result));
+    addToHistory(HistoryOp::Subtract, a, b, result);
     return result;
 }
 
 double Calculator::multiply(double a, double b) {
+    MetricTimer timer(MetricOp::Multiply);
     double result = a * b;
-    addToHistory(formatNumber(a) + " × " + formatNumber(b) + " = " + formatNumber(result));
+    addToHistory(HistoryOp::Multiply, a, b, result);
     return result;
 }
 
 double Calculator::divide(double a, double b) {
-    if (b == 0) {
-        throw std::domain_error("Division by zero");
+    CalcResult result = tryDivide(a, b);
+    if (!result.ok()) {
+        throwDomainError(result.status);
     }
-    double result = a / b;
-    addToHistory(formatNumber(a) + " ÷ " + formatNumber(b) + " = " + formatNumber(result));
-    return result;
+    return result.value;
 }
 
 // Scientific Operations
 double Calculator::sqrt(double x) {
-    if (x < 0) {
-        throw std::domain_error("Square root of negative number");
+    CalcResult result = trySqrt(x);
+    if (!result.ok()) {
+        throwDomainError(result.status);
     }
-    double result = std::sqrt(x);
-    addToHistory("√(" + formatNumber(x) + ") = " + formatNumber(result));
-    return result;
+    return result.value;
 }
 
 double Calculator::power(double base, double exp) {
-    double result = std::pow(base, exp);
-    addToHistory(formatNumber(base) + "^" + formatNumber(exp) + " = " + formatNumber(result));
+    MetricTimer timer(MetricOp::Power);
+    double result;
+    if (mathPrecision != MathPrecision::Exact) {
+        result = fastPower(base, exp, mathPrecision);
+    } else if (!findCachedResult(CachedFunction::Power, base, exp, result)) {
+        result = std::pow(base, exp);
+        cacheResult(CachedFunction::Power, base, exp, result);
+    }
+    addToHistory(HistoryOp::Power, base, exp, result);
     return result;
 }
 
 double Calculator::ln(double x) {
-    if (x <= 0) {
-        throw std::domain_error("Logarithm of non-positive number");
+    CalcResult result = tryLn(x);
+    if (!result.ok()) {
+        throwDomainError(result.status);
     }
-    double result = std::log(x);
-    addToHistory("ln(" + formatNumber(x) + ") = " + formatNumber(result));
-    return result;
+    return result.value;
 }
 
 double Calculator::sin(double x) {
-    double result = useRadians ? std::sin(x) : std::sin(degreesToRadians(x));
-    addToHistory("sin(" + formatNumber(x) + ") = " + formatNumber(result));
+    MetricTimer timer(MetricOp::Sin);
+    const CachedFunction function = useRadians ? CachedFunction::SinRadians : CachedFunction::SinDegrees;
+    double result;
+    if (mathPrecision != MathPrecision::Exact) {
+        result = useRadians ? fastSin(x, mathPrecision) : fastSinDegrees(x, mathPrecision);
+    } else if (!findCachedResult(function, x, 0, result)) {
+        result = useRadians ? std::sin(x) : fastSinDegrees(x, MathPrecision::Exact);
+        cacheResult(function, x, 0, result);
+    }
+    addToHistory(useRadians ? HistoryOp::Sin : HistoryOp::SinDegrees, x, 0, result);
     return result;
 }
 
 double Calculator::cos(double x) {
-    double result = useRadians ? std::cos(x) : std::cos(degreesToRadians(x));
-    addToHistory("cos(" + formatNumber(x) + ") = " + formatNumber(result));
+    MetricTimer timer(MetricOp::Cos);
+    const CachedFunction function = useRadians ? CachedFunction::CosRadians : CachedFunction::CosDegrees;
+    double result;
+    if (mathPrecision != MathPrecision::Exact) {
+        result = useRadians ? fastCos(x, mathPrecision) : fastCosDegrees(x, mathPrecision);
+    } else if (!findCachedResult(function, x, 0, result)) {
+        result = useRadians ? std::cos(x) : fastCosDegrees(x, MathPrecision::Exact);
+        cacheResult(function, x, 0, result);
+    }
+    addToHistory(useRadians ? HistoryOp::Cos : HistoryOp::CosDegrees, x, 0, result);
     return result;
 }
 
 double Calculator::tan(double x) {
-    double result = useRadians ? std::tan(x) : std::tan(degreesToRadians(x));
-    addToHistory("tan(" + formatNumber(x) + ") = " + formatNumber(result));
+    MetricTimer timer(MetricOp::Tan);
+    const CachedFunction function = useRadians ? CachedFunction::TanRadians : CachedFunction::TanDegrees;
+    double result;
+    if (mathPrecision != MathPrecision::Exact) {
+        result = useRadians ? fastTan(x, mathPrecision) : fastTanDegrees(x, mathPrecision);
+    } else if (!findCachedResult(function, x, 0, result)) {
+        result = useRadians ? std::tan(x) : fastTanDegrees(x, MathPrecision::Exact);
+        cacheResult(function, x, 0, result);
+    }
+    addToHistory(useRadians ? HistoryOp::Tan : HistoryOp::TanDegrees, x, 0, result);
     return result;
 }
 
+SineCosine Calculator::sincos(double x) {
+    MetricTimer timer(MetricOp::SinCos);
+    const CachedFunction sinFunction = useRadians ? CachedFunction::SinRadians : CachedFunction::SinDegrees;
+    const CachedFunction cosFunction = useRadians ? CachedFunction::CosRadians : CachedFunction::CosDegrees;
+    SineCosine result;
+    if (mathPrecision != MathPrecision::Exact) {
+        result = useRadians ? fastSinCos(x, mathPrecision) : fastSinCosDegrees(x, mathPrecision);
+    } else if (!findCachedResult(sinFunction, x, 0, result.sine) ||
+               !findCachedResult(cosFunction, x, 0, result.cosine)) {
+        result = useRadians ? fastSinCos(x, MathPrecision::Exact) : fastSinCosDegrees(x, MathPrecision::Exact);
+        cacheResult(sinFunction, x, 0, result.sine);
+        cacheResult(cosFunction, x, 0, result.cosine);
+    }
+    addToHistory(useRadians ? HistoryOp::Sin : HistoryOp::SinDegrees, x, 0, result.sine);
+    addToHistory(useRadians ? HistoryOp::Cos : HistoryOp::CosDegrees, x, 0, result.cosine);
+    return result;
+}
+
+// Non-throwing Operations
+CalcResult Calculator::tryDivide(double a, double b) {
+    MetricTimer timer(MetricOp::Divide);
+    if (b == 0) {
+        timer.fail();
+        return CalcResult::failure(CalcStatus::DivisionByZero);
+    }
+    double result = a / b;
+    addToHistory(HistoryOp::Divide, a, b, result);
+    return CalcResult::success(result);
+}
+
+CalcResult Calculator::trySqrt(double x) {
+    MetricTimer timer(MetricOp::Sqrt);
+    if (x < 0) {
+        timer.fail();
+        return CalcResult::failure(CalcStatus::NegativeSqrt);
+    }
+    double result = std::sqrt(x);
+    addToHistory(HistoryOp::Sqrt, x, 0, result);
+    return CalcResult::success(result);
+}
+
+CalcResult Calculator::tryLn(double x) {
+    MetricTimer timer(MetricOp::Ln);
+    if (x <= 0) {
+        timer.fail();
+        return CalcResult::failure(CalcStatus::NonPositiveLog);
+    }
+    double result;
+    if (mathPrecision != MathPrecision::Exact) {
+        result = fastLn(x, mathPrecision);
+    } else if (!findCachedResult(CachedFunction::Ln, x, 0, result)) {
+        result = std::log(x);
+        cacheResult(CachedFunction::Ln, x, 0, result);
+    }
+    addToHistory(HistoryOp::Ln, x, 0, result);
+    return CalcResult::success(result);
+}
+
+// Array Operations
+void Calculator::add(const double* a, const double* b, double* out, std::size_t n) const {
+    arrayAdd(a, b, out, n);
+}
+
+void Calculator::subtract(const double* a, const double* b, double* out, std::size_t n) const {
+    arraySubtract(a, b, out, n);
+}
+
+void Calculator::multiply(const double* a, const double* b, double* out, std::size_t n) const {
+    arrayMultiply(a, b, out, n);
+}
+
+std::size_t Calculator::divide(const double* a, const double* b, double* out, std::size_t n,
+                               unsigned char* errors) const {
+    return arrayDivide(a, b, out, n, errors);
+}
+
+std::size_t Calculator::sqrt(const double* x, double* out, std::size_t n, unsigned char* errors) const {
+    return arraySqrt(x, out, n, errors);
+}
+
+void Calculator::power(const double* base, const double* exp, double* out, std::size_t n) const {
+    arrayPower(base, exp, out, n);
+}
+
+std::size_t Calculator::ln(const double* x, double* out, std::size_t n, unsigned char* errors) const {
+    return arrayLn(x, out, n, errors);
+}
+
+void Calculator::sin(const double* x, double* out, std::size_t n) const {
+    arraySin(x, out, n, useRadians);
+}
+
+void Calculator::cos(const double* x, double* out, std::size_t n) const {
+    arrayCos(x, out, n, useRadians);
+}
+
+void Calculator::tan(const double* x, double* out, std::size_t n) const {
+    arrayTan(x, out, n, useRadians);
+}
+
+void Calculator::sincos(const double* x, double* sines, double* cosines, std::size_t n) const {
+    arraySinCos(x, sines, cosines, n, useRadians);
+}
+
+// Reductions
+double Calculator::sum(const double* x, std::size_t n) {
+    MetricTimer timer(MetricOp::Reduce);
+    requireElements(n, 1, "sum");
+    double result = arraySum(x, n, workerPool);
+    addToHistory(HistoryOp::Sum, static_cast<double>(n), 0, result);
+    return result;
+}
+
+double Calculator::mean(const double* x, std::size_t n) {
+    MetricTimer timer(MetricOp::Reduce);
+    requireElements(n, 1, "mean");
+    double result = arrayMean(x, n, workerPool);
+    addToHistory(HistoryOp::Mean, static_cast<double>(n), 0, result);
+    return result;
+}
+
+double Calculator::variance(const double* x, std::size_t n) {
+    MetricTimer timer(MetricOp::Reduce);
+    requireElements(n, 2, "variance");
+    double result = arrayVariance(x, n, workerPool);
+    addToHistory(HistoryOp::Variance, static_cast<double>(n), 0, result);
+    return result;
+}
+
+double Calculator::stddev(const double* x, std::size_t n) {
+    MetricTimer timer(MetricOp::Reduce);
+    requireElements(n, 2, "stddev");
+    double result = std::sqrt(arrayVariance(x, n, workerPool));
+    addToHistory(HistoryOp::StdDev, static_cast<double>(n), 0, result);
+    return result;
+}
+
+double Calculator::min(const double* x, std::size_t n) {
+    MetricTimer timer(MetricOp::Reduce);
+    requireElements(n, 1, "min");
+    double result = arrayMin(x, n, workerPool);
+    addToHistory(HistoryOp::Min, static_cast<double>(n), 0, result);
+    return result;
+}
+
+double Calculator::max(const double* x, std::size_t n) {
+    MetricTimer timer(MetricOp::Reduce);
+    requireElements(n, 1, "max");
+    double result = arrayMax(x, n, workerPool);
+    addToHistory(HistoryOp::Max, static_cast<double>(n), 0, result);
+    return result;
+}
+
+void Calculator::prefixSum(const double* x, double* out, std::size_t n) {
+    MetricTimer timer(MetricOp::Reduce);
+    requireElements(n, 1, "prefix sum");
+    arrayPrefixSum(x, out, n, workerPool);
+    addToHistory(HistoryOp::PrefixSum, static_cast<double>(n), 0, out[n - 1]);
+}
+
+void Calculator::attachWorkerPool(WorkStealingPool* pool) {
+    workerPool = pool;
+}
+
+// Decimal Operations
+Decimal Calculator::add(Decimal a, Decimal b) {
+    return decimalValue(tryAdd(a, b));
+}
+
+Decimal Calculator::subtract(Decimal a, Decimal b) {
+    return decimalValue(trySubtract(a, b));
+}
+
+Decimal Calculator::multiply(Decimal a, Decimal b) {
+    return decimalValue(tryMultiply(a, b));
+}
+
+Decimal Calculator::divide(Decimal a, Decimal b) {
+    return decimalValue(tryDivide(a, b));
+}
+
+DecimalResult Calculator::tryAdd(Decimal a, Decimal b) {
+    MetricTimer timer(MetricOp::Add);
+    DecimalResult result = decimal.add(a, b);
+    recordDecimal(timer, HistoryOp::DecimalAdd, a, b, result);
+    return result;
+}
+
+DecimalResult Calculator::trySubtract(Decimal a, Decimal b) {
+    MetricTimer timer(MetricOp::Subtract);
+    DecimalResult result = decimal.subtract(a, b);
+    recordDecimal(timer, HistoryOp::DecimalSubtract, a, b, result);
+    return result;
+}
+
+DecimalResult Calculator::tryMultiply(Decimal a, Decimal b) {
+    MetricTimer timer(MetricOp::Multiply);
+    DecimalResult result = decimal.multiply(a, b);
+    recordDecimal(timer, HistoryOp::DecimalMultiply, a, b, result);
+    return result;
+}
+
+DecimalResult Calculator::tryDivide(Decimal a, Decimal b) {
+    MetricTimer timer(MetricOp::Divide);
+    DecimalResult result = decimal.divide(a, b);
+    recordDecimal(timer, HistoryOp::DecimalDivide, a, b, result);
+    return result;
+}
+
+void Calculator::enableDecimalMode(int scale, RoundingMode rounding) {
+    decimal = DecimalContext(scale, rounding);
+    DecimalResult memory = decimal.fromDouble(memoryValue);
+    setDecimalMemory(memory.ok() ? memory.value : Decimal());
+    decimalMode = true;
+    clear();
+}
+
+void Calculator::disableDecimalMode() {
+    decimalMode = false;
+    clear();
+}
+
 // Memory Operations
 void Calculator::memoryStore() {
-    memoryValue = currentNumber;
-    addToHistory("M← " + formatNumber(currentNumber));
+    MetricTimer timer(MetricOp::MemoryStore);
+    if (sharedMemory) {
+        sharedMemory->store(currentNumber);
+    } else if (decimalMode) {
+        setDecimalMemory(decimalCurrent);
+    } else {
+        memoryValue = currentNumber;
+    }
+    addToHistory(HistoryOp::MemoryStore, currentNumber);
 }
 
 double Calculator::memoryRecall() {
-    currentNumber = memoryValue;
-    displayText = formatNumber(memoryValue);
-    addToHistory("MR " + formatNumber(memoryValue));
-    return memoryValue;
+    MetricTimer timer(MetricOp::MemoryRecall);
+    double value = sharedMemory ? sharedMemory->load() : memoryValue;
+    if (decimalMode && !sharedMemory) {
+        showDecimal(DecimalResult::success(decimalMemory));
+    } else if (decimalMode) {
+        showDecimal(decimal.fromDouble(value));
+    } else {
+        currentNumber = value;
+        displayText = formatNumber(value);
+    }
+    newNumber = true;
+    addToHistory(HistoryOp::MemoryRecall, value);
+    return value;
 }
 
 void Calculator::memoryClear() {
-    memoryValue = 0;
-    addToHistory("MC");
+    MetricTimer timer(MetricOp::MemoryClear);
+    if (sharedMemory) {
+        sharedMemory->clear();
+    } else {
+        decimalMemory = Decimal();
+        memoryValue = 0;
+    }
+    addToHistory(HistoryOp::MemoryClear, 0);
 }
 
 void Calculator::memoryAdd() {
-    memoryValue += currentNumber;
-    addToHistory("M+ " + formatNumber(currentNumber));
+    MetricTimer timer(MetricOp::MemoryAdd);
+    if (sharedMemory) {
+        sharedMemory->add(currentNumber);
+    } else if (decimalMode) {
+        if (!addToDecimalMemory(timer, decimal.add(decimalMemory, decimalCurrent))) {
+            return;
+        }
+    } else {
+        memoryValue += currentNumber;
+    }
+    addToHistory(HistoryOp::MemoryAdd, currentNumber);
 }
 
 void Calculator::memorySubtract() {
-    memoryValue -= currentNumber;
-    addToHistory("M- " + formatNumber(currentNumber));
+    MetricTimer timer(MetricOp::MemorySubtract);
+    if (sharedMemory) {
+        sharedMemory->subtract(currentNumber);
+    } else if (decimalMode) {
+        if (!addToDecimalMemory(timer, decimal.subtract(decimalMemory, decimalCurrent))) {
+            return;
+        }
+    } else {
+        memoryValue -= currentNumber;
+    }
+    addToHistory(HistoryOp::MemorySubtract, currentNumber);
+}
+
+bool Calculator::addToDecimalMemory(MetricTimer& timer, DecimalResult result) {
+    if (!result.ok()) {
+        // Memory keeps its value; the display shows why nothing happened
+        timer.fail();
+        showDecimal(result);
+        newNumber = true;
+        return false;
+    }
+    setDecimalMemory(result.value);
+    return true;
+}
+
+void Calculator::attachMemory(SharedRegister* memory) {
+    sharedMemory = memory;
 }
 
 // History Operations
 std::vector<std::string> Calculator::getHistory() const {
-    return history;
+    MetricTimer timer(MetricOp::GetHistory);
+    std::vector<std::string> entries;
+    entries.reserve(history.size());
+    for (std::size_t i = 0; i < history.size(); ++i) {
+        entries.push_back(formatHistoryRecord(history[i]));
+    }
+    return entries;
 }
 
 void Calculator::clearHistory() {
+    MetricTimer timer(MetricOp::ClearHistory);
     history.clear();
 }
 
-void Calculator::addToHistory(const std::string& entry) {
-    history.push_back(entry);
-    if (history.size() > 100) { // Keep only last 100 entries
-        history.erase(history.begin());
+void Calculator::setHistoryCapacity(std::size_t capacity) {
+    history.setCapacity(capacity);
+}
+
+std::size_t Calculator::getHistoryCapacity() const {
+    return history.capacity();
+}
+
+void Calculator::attachHistoryLog(HistoryLog* log) {
+    historyLog = log;
+}
+
+std::size_t Calculator::subscribeHistory(HistoryCallback callback) {
+    historySubscribers.push_back(std::make_pair(nextSubscription, std::move(callback)));
+    return nextSubscription++;
+}
+
+void Calculator::unsubscribeHistory(std::size_t id) {
+    for (std::size_t i = 0; i < historySubscribers.size(); ++i) {
+        if (historySubscribers[i].first == id) {
+            historySubscribers.erase(historySubscribers.begin() + static_cast<std::ptrdiff_t>(i));
+            return;
+        }
+    }
+}
+
+void Calculator::notifyHistory(const HistoryRecord& record) {
+    std::uint64_t sequence = history.lastSequence();
+    for (const auto& subscriber : historySubscribers) {
+        subscriber.second(sequence, record);
+    }
+}
+
+// Result Cache
+void Calculator::enableResultCache(std::size_t entries) {
+    resultCache.reset(entries == 0 ? nullptr : new ResultCache(entries));
+}
+
+void Calculator::attachResultCache(SharedResultCache* cache) {
+    sharedCache = cache;
+}
+
+void Calculator::resetResultCacheStats() {
+    cacheStats = CacheStats();
+}
+
+bool Calculator::findCachedResult(CachedFunction function, double a, double b, double& result) {
+    bool hit;
+    if (sharedCache) {
+        hit = sharedCache->lookup(function, a, b, result);
+    } else if (resultCache) {
+        hit = resultCache->lookup(function, a, b, result);
+    } else {
+        return false;
+    }
+    ++(hit ? cacheStats.hits : cacheStats.misses);
+    return hit;
+}
+
+void Calculator::cacheResult(CachedFunction function, double a, double b, double result) {
+    if (sharedCache) {
+        sharedCache->insert(function, a, b, result);
+    } else if (resultCache) {
+        resultCache->insert(function, a, b, result);
+    }
+}
+
+std::string Calculator::formatHistoryRecord(const HistoryRecord& record) const {
+    const std::string lhs = formatNumber(record.lhs);
+    switch (record.op) {
+        case HistoryOp::Add:
+        case HistoryOp::DecimalAdd:
+            return lhs + " + " + formatNumber(record.rhs) + " = " + formatNumber(record.result);
+        case HistoryOp::Subtract:
+        case HistoryOp::DecimalSubtract:
+            return lhs + " - " + formatNumber(record.rhs) + " = " + formatNumber(record.result);
+        case HistoryOp::Multiply:
+        case HistoryOp::DecimalMultiply:
+            return lhs + " × " + formatNumber(record.rhs) + " = " + formatNumber(record.result);
+        case HistoryOp::Divide:
+        case HistoryOp::DecimalDivide:
+            return lhs + " ÷ " + formatNumber(record.rhs) + " = " + formatNumber(record.result);
+        case HistoryOp::Power:
+            return lhs + "^" + formatNumber(record.rhs) + " = " + formatNumber(record.result);
+        case HistoryOp::Sqrt:
+            return "√(" + lhs + ") = " + formatNumber(record.result);
+        case HistoryOp::Ln:
+            return "ln(" + lhs + ") = " + formatNumber(record.result);
+        case HistoryOp::Sin:
+            return "sin(" + lhs + ") = " + formatNumber(record.result);
+        case HistoryOp::Cos:
+            return "cos(" + lhs + ") = " + formatNumber(record.result);
+        case HistoryOp::Tan:
+            return "tan(" + lhs + ") = " + formatNumber(record.result);
+        case HistoryOp::SinDegrees:
+            return "sin(" + lhs + "°) = " + formatNumber(record.result);
+        case HistoryOp::CosDegrees:
+            return "cos(" + lhs + "°) = " + formatNumber(record.result);
+        case HistoryOp::TanDegrees:
+            return "tan(" + lhs + "°) = " + formatNumber(record.result);
+        case HistoryOp::MemoryStore:
+            return "M← " + lhs;
+        case HistoryOp::MemoryRecall:
+            return "MR " + lhs;
+        case HistoryOp::MemoryClear:
+            return "MC";
+        case HistoryOp::MemoryAdd:
+            return "M+ " + lhs;
+        case HistoryOp::MemorySubtract:
+            return "M- " + lhs;
+        case HistoryOp::Sum:
+            return "sum(" + lhs + " values) = " + formatNumber(record.result);
+        case HistoryOp::Mean:
+            return "mean(" + lhs + " values) = " + formatNumber(record.result);
+        case HistoryOp::Variance:
+            return "variance(" + lhs + " values) = " + formatNumber(record.result);
+        case HistoryOp::StdDev:
+            return "stddev(" + lhs + " values) = " + formatNumber(record.result);
+        case HistoryOp::Min:
+            return "min(" + lhs + " values) = " + formatNumber(record.result);
+        case HistoryOp::Max:
+            return "max(" + lhs + " values) = " + formatNumber(record.result);
+        case HistoryOp::PrefixSum:
+            return "prefix sum(" + lhs + " values) = [..., " + formatNumber(record.result) + "]";
     }
+    return lhs;
 }
 
 // Display and Input Operations
 void Calculator::appendNumber(char digit) {
+    MetricTimer timer(MetricOp::AppendNumber);
     if (newNumber) {
-        displayText = digit;
+        input.reset();
         newNumber = false;
+    }
+    if (!input.append(digit)) {
+        return;
+    }
+    if (decimalMode) {
+        showDecimal(decimal.fromDecimal(input.isNegative(), input.significand(), input.decimalExponent(),
+                                        input.isTruncated()));
     } else {
-        displayText += digit;
+        currentNumber = input.value();
+        displayText = formatNumber(currentNumber);
     }
-    currentNumber = std::stod(displayText);
 }
 
 void Calculator::setOperation(char op) {
+    MetricTimer timer(MetricOp::SetOperation);
     calculate();
     currentOperation = op;
     storedNumber = currentNumber;
+    decimalStored = decimalCurrent;
     newNumber = true;
 }
 
 void Calculator::calculate() {
+    MetricTimer timer(MetricOp::Calculate);
     if (currentOperation == ' ') return;
 
-    try {
+    if (decimalMode) {
+        DecimalResult result = DecimalResult::success(decimalCurrent);
         switch (currentOperation) {
-            case '+': currentNumber = add(storedNumber, currentNumber); break;
-            case '-': currentNumber = subtract(storedNumber, currentNumber); break;
-            case '*': currentNumber = multiply(storedNumber, currentNumber); break;
-            case '/': currentNumber = divide(storedNumber, currentNumber); break;
-            case '^': currentNumber = power(storedNumber, currentNumber); break;
+            case '+': result = tryAdd(decimalStored, decimalCurrent); break;
+            case '-': result = trySubtract(decimalStored, decimalCurrent); break;
+            case '*': result = tryMultiply(decimalStored, decimalCurrent); break;
+            case '/': result = tryDivide(decimalStored, decimalCurrent); break;
+            case '^': result = decimal.fromDouble(power(storedNumber, currentNumber)); break;
+        }
+        if (!result.ok()) {
+            timer.fail();
         }
+        showDecimal(result);
+        currentOperation = ' ';
+        newNumber = true;
+        return;
+    }
+
+    CalcResult result = CalcResult::success(currentNumber);
+    switch (currentOperation) {
+        case '+': result = CalcResult::success(add(storedNumber, currentNumber)); break;
+        case '-': result = CalcResult::success(subtract(storedNumber, currentNumber)); break;
+        case '*': result = CalcResult::success(multiply(storedNumber, currentNumber)); break;
+        case '/': result = tryDivide(storedNumber, currentNumber); break;
+        case '^': result = CalcResult::success(power(storedNumber, currentNumber)); break;
+    }
+    if (result.ok()) {
+        currentNumber = result.value;
         displayText = formatNumber(currentNumber);
-    } catch (const std::exception& e) {
-        displayText = "Error: " + std::string(e.what());
+    } else {
+        timer.fail();
+        displayText = std::string("Error: ") + calcStatusMessage(result.status);
         currentNumber = 0;
     }
 
@@ -171,17 +678,42 @@ void Calculator::calculate() {
 }
 
 void Calculator::clear() {
+    MetricTimer timer(MetricOp::Clear);
     currentNumber = 0;
     storedNumber = 0;
     currentOperation = ' ';
-    displayText = "0";
+    decimalStored = Decimal();
+    if (decimalMode) {
+        showDecimal(DecimalResult::success(Decimal()));
+    } else {
+        decimalCurrent = Decimal();
+        displayText = "0";
+    }
     newNumber = true;
 }
 
+void Calculator::showDecimal(DecimalResult result) {
+    if (result.ok()) {
+        char buffer[DECIMAL_BUFFER_SIZE];
+        decimalCurrent = result.value;
+        currentNumber = decimal.toDouble(result.value);
+        displayText.assign(buffer, decimal.format(result.value, buffer));
+    } else {
+        decimalCurrent = Decimal();
+        currentNumber = 0;
+        displayText = std::string("Error: ") + calcStatusMessage(result.status);
+    }
+}
+
 std::string Calculator::getDisplayText() const {
     return displayText;
 }
 
+CompiledExpr Calculator::compile(const std::string& source) const {
+    MetricTimer timer(MetricOp::Compile);
+    return CompiledExpr::compile(source, useRadians);
+}
+
 // Utility Functions
 double Calculator::degreesToRadians(double degrees) {
     return degrees * M_PI / 180.0;
@@ -192,17 +724,8 @@ double Calculator::radiansToDegrees(double radians) {
 }
 
 std::string Calculator::formatNumber(double num) const {
-    std::ostringstream ss;
-    ss << std::fixed << std::setprecision(6);
-    ss << num;
-    std::string str = ss.str();
-    
-    // Remove trailing zeros after decimal point
-    if (str.find('.') != std::string::npos) {
-        str = str.substr(0, str.find_last_not_of('0') + 1);
-        if (str.back() == '.') {
-            str = str.substr(0, str.size() - 1);
-        }
-    }
-    return str;
+    MetricTimer timer(MetricOp::FormatNumber);
+    char buffer[NUMBER_BUFFER_SIZE];
+    std::size_t length = formatFixed(num, buffer);
+    return std::string(buffer, length);
 }
@@ -8,11 +8,29 @@
 #ifndef CALCULATOR_H
 #define CALCULATOR_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <cmath>
 #include <memory>
 #include <functional>
+#include <utility>
+
+#include "calc_result.h"
+#include "decimal.h"
+#include "expression.h"
+#include "fast_math.h"
+#include "history.h"
+#include "history_log.h"
+#include "metrics.h"
+#include "number_input.h"
+#include "result_cache.h"
+
+class SharedRegister;
+class WorkStealingPool;
+
+/// Observer of new history records: sequence number and record
+typedef std::function<void(std::uint64_t, const HistoryRecord&)> HistoryCallback;
 
 /**
  * @class Calculator
@@ -27,8 +45,9 @@ public:
     /**
      * @brief Default constructor
      * Initializes the calculator with default values
+     * @param historyCapacity Maximum number of history entries kept
      */
-    Calculator();
+    explicit Calculator(std::size_t historyCapacity = HistoryBuffer::DEFAULT_CAPACITY);
 
     // Basic Operations
     double add(double a, double b);
@@ -62,26 +81,218 @@ public:
     double ln(double x);
 
     /**
-     * @brief Calculate sine in radians
-     * @param x Angle in radians
+     * @brief Calculate sine in the current angle unit
+     *
+     * Degrees are reduced modulo 90 exactly before they are converted
+     * (see fastSinDegrees()), so sin(180) is 0 and sin(30) is 0.5.
+     *
+     * @param x Angle in radians, or degrees after setRadians(false)
      * @return Sine of x
      */
     double sin(double x);
 
     /**
-     * @brief Calculate cosine in radians
-     * @param x Angle in radians
+     * @brief Calculate cosine in the current angle unit, see sin()
+     * @param x Angle
      * @return Cosine of x
      */
     double cos(double x);
 
     /**
-     * @brief Calculate tangent in radians
-     * @param x Angle in radians
-     * @return Tangent of x
+     * @brief Calculate tangent in the current angle unit, see sin()
+     * @param x Angle
+     * @return Tangent of x; +infinity at odd multiples of 90 degrees
      */
     double tan(double x);
 
+    /**
+     * @brief Calculate sine and cosine of one angle, reducing it once
+     *
+     * Same results as sin() and cos(), which are also what the history
+     * records, at close to the cost of one of them.
+     *
+     * @param x Angle in the current unit
+     * @return Sine and cosine of x
+     */
+    SineCosine sincos(double x);
+
+    /**
+     * @brief Choose the angle unit of the trigonometric functions
+     * @param radians true for radians (the default), false for degrees
+     */
+    void setRadians(bool radians) { useRadians = radians; }
+
+    /**
+     * @brief Check the angle unit of the trigonometric functions
+     * @return true for radians, false for degrees
+     */
+    bool isRadians() const { return useRadians; }
+
+    /**
+     * @brief Trade accuracy of the scientific functions for speed
+     *
+     * Below Exact, sin, cos, tan, power and ln use the approximations of
+     * fast_math.h within the bound of the precision, and skip the result
+     * cache so that cached exact results and approximations never mix.
+     * sqrt stays exact: the hardware instruction is already faster than
+     * any approximation. The array operations are not affected.
+     *
+     * @param precision Exact (the default), High or Fast
+     */
+    void setMathPrecision(MathPrecision precision) { mathPrecision = precision; }
+
+    /**
+     * @brief Get the accuracy of the scientific functions
+     * @return Precision set by setMathPrecision()
+     */
+    MathPrecision getMathPrecision() const { return mathPrecision; }
+
+    // Non-throwing Operations
+    /**
+     * @brief Divide without throwing
+     * @param a Dividend
+     * @param b Divisor
+     * @return a / b, or DivisionByZero if b == 0
+     */
+    CalcResult tryDivide(double a, double b);
+
+    /**
+     * @brief Square root without throwing
+     * @param x Input number
+     * @return Square root of x, or NegativeSqrt if x < 0
+     */
+    CalcResult trySqrt(double x);
+
+    /**
+     * @brief Natural logarithm without throwing
+     * @param x Input number
+     * @return Natural logarithm of x, or NonPositiveLog if x <= 0
+     */
+    CalcResult tryLn(double x);
+
+    // Decimal Operations
+    /**
+     * @brief Fixed-point arithmetic in this calculator's decimal context
+     *
+     * Usable in either mode; see DecimalContext for rounding and range.
+     * History records the operands and result converted to double.
+     *
+     * @throw std::overflow_error if the result is out of range
+     * @throw std::domain_error if dividing by zero
+     */
+    Decimal add(Decimal a, Decimal b);
+    Decimal subtract(Decimal a, Decimal b);
+    Decimal multiply(Decimal a, Decimal b);
+    Decimal divide(Decimal a, Decimal b);
+
+    /**
+     * @brief Decimal arithmetic without throwing
+     * @return Result, or Overflow / DivisionByZero
+     */
+    DecimalResult tryAdd(Decimal a, Decimal b);
+    DecimalResult trySubtract(Decimal a, Decimal b);
+    DecimalResult tryMultiply(Decimal a, Decimal b);
+    DecimalResult tryDivide(Decimal a, Decimal b);
+
+    /**
+     * @brief Make the keypad and display use fixed-point decimals
+     *
+     * Keyed-in numbers are taken digit for digit and rounded to the
+     * scale; '+', '-', '*' and '/' use the decimal operations above, and
+     * the display shows exactly scale digits after the point. '^' is
+     * computed in double and rounded back. Memory holds a decimal too,
+     * so M+ and M- are exact; it starts from the double memory rounded
+     * to the scale. A shared register (attachMemory()) still holds a
+     * double, rounded to the scale when recalled. Like clear(),
+     * switching modes discards the entry and any pending operation.
+     *
+     * @param scale Digits after the decimal point, 0 to DecimalContext::MAX_SCALE
+     * @param rounding Rounding applied to inexact results
+     * @throw std::invalid_argument if scale is out of range
+     */
+    void enableDecimalMode(int scale = DecimalContext::DEFAULT_SCALE,
+                           RoundingMode rounding = RoundingMode::HalfEven);
+
+    /**
+     * @brief Go back to double arithmetic, discarding the entry like clear()
+     */
+    void disableDecimalMode();
+
+    /**
+     * @brief Check whether the keypad uses decimals
+     * @return true between enableDecimalMode() and disableDecimalMode()
+     */
+    bool isDecimalMode() const { return decimalMode; }
+
+    /**
+     * @brief Get the scale and rounding of the decimal operations
+     * @return Context set by enableDecimalMode(), scale 2 by default
+     */
+    const DecimalContext& getDecimalContext() const { return decimal; }
+
+    // Array Operations
+    /**
+     * @brief Element-wise operations on arrays of n operands
+     *
+     * These write out[i] for every i < n using the SIMD kernels in
+     * array_ops.h and record no history. Instead of throwing, domain
+     * errors yield NaN and are flagged in the optional errors mask
+     * (one byte per element); the return value is the error count.
+     * The trigonometric functions use this calculator's angle unit.
+     */
+    void add(const double* a, const double* b, double* out, std::size_t n) const;
+    void subtract(const double* a, const double* b, double* out, std::size_t n) const;
+    void multiply(const double* a, const double* b, double* out, std::size_t n) const;
+    std::size_t divide(const double* a, const double* b, double* out, std::size_t n,
+                       unsigned char* errors = nullptr) const;
+    std::size_t sqrt(const double* x, double* out, std::size_t n, unsigned char* errors = nullptr) const;
+    void power(const double* base, const double* exp, double* out, std::size_t n) const;
+    std::size_t ln(const double* x, double* out, std::size_t n, unsigned char* errors = nullptr) const;
+    void sin(const double* x, double* out, std::size_t n) const;
+    void cos(const double* x, double* out, std::size_t n) const;
+    void tan(const double* x, double* out, std::size_t n) const;
+    void sincos(const double* x, double* sines, double* cosines, std::size_t n) const;
+
+    // Reductions
+    /**
+     * @brief Reductions over arrays of n numbers
+     *
+     * One call replaces n chained operations: the array is reduced with
+     * the compensated, deterministic SIMD reductions in array_ops.h (on
+     * the attached worker pool, if any) and a single history entry
+     * records the element count and the result. variance() is the sample
+     * variance and stddev() its square root; prefixSum() writes the
+     * inclusive running sums to out (which may alias x) and records the
+     * last one.
+     *
+     * @throw std::invalid_argument if n is 0 (or 1 for variance and stddev)
+     */
+    double sum(const double* x, std::size_t n);
+    double mean(const double* x, std::size_t n);
+    double variance(const double* x, std::size_t n);
+    double stddev(const double* x, std::size_t n);
+    double min(const double* x, std::size_t n);
+    double max(const double* x, std::size_t n);
+    void prefixSum(const double* x, double* out, std::size_t n);
+
+    /**
+     * @brief Spread large reductions over a worker pool
+     *
+     * Results do not depend on whether a pool is attached. The pool must
+     * outlive the attachment. Each reduction waits only for its own
+     * tasks, so calculators may share a pool and may reduce from inside
+     * the pool's tasks.
+     *
+     * @param pool Workers to use, or nullptr to reduce on the calling thread
+     */
+    void attachWorkerPool(WorkStealingPool* pool);
+
+    /**
+     * @brief Get the attached worker pool
+     * @return Pool set by attachWorkerPool(), or nullptr
+     */
+    WorkStealingPool* getWorkerPool() const { return workerPool; }
+
     // Memory Operations
     /**
      * @brief Store current value in memory
@@ -109,25 +320,186 @@ public:
      */
     void memorySubtract();
 
+    /**
+     * @brief Use a shared register as this calculator's memory
+     *
+     * While attached, MS/MR/MC/M+/M- operate on the register instead of
+     * the calculator's own memory value, so calculators on different
+     * threads can accumulate into one register without locking. The
+     * register must outlive the attachment.
+     *
+     * @param memory Register to use, or nullptr to go back to private memory
+     */
+    void attachMemory(SharedRegister* memory);
+
+    /**
+     * @brief Get the attached shared register
+     * @return Register set by attachMemory(), or nullptr
+     */
+    SharedRegister* getAttachedMemory() const { return sharedMemory; }
+
+    // Result Cache
+    /**
+     * @brief Memoize power, ln, sin, cos and tan in a private cache
+     *
+     * Repeated operands (in the same angle unit) are then answered from
+     * the cache with bit-identical results. History and metrics are
+     * recorded as for uncached calls.
+     *
+     * @param entries Results kept, rounded up to a power of two; 0 removes the cache
+     */
+    void enableResultCache(std::size_t entries = ResultCache::DEFAULT_ENTRIES);
+
+    /**
+     * @brief Use a cache shared with other calculators
+     *
+     * While attached, the shared cache is used instead of the private one.
+     * The cache must outlive the attachment.
+     *
+     * @param cache Cache to use, or nullptr to detach
+     */
+    void attachResultCache(SharedResultCache* cache);
+
+    /**
+     * @brief Get the attached shared cache
+     * @return Cache set by attachResultCache(), or nullptr
+     */
+    SharedResultCache* getAttachedResultCache() const { return sharedCache; }
+
+    /**
+     * @brief Get this calculator's cache lookups
+     * @return Hits and misses since the last reset, for either cache
+     */
+    CacheStats getResultCacheStats() const { return cacheStats; }
+
+    /**
+     * @brief Zero the lookup counts
+     */
+    void resetResultCacheStats();
+
     // History Operations
     /**
      * @brief Get calculation history
+     *
+     * Formats every entry into a new string; to poll, prefer
+     * historySince(), which neither copies nor formats.
+     *
      * @return Vector of previous calculations
      */
     std::vector<std::string> getHistory() const;
 
+    /**
+     * @brief View the history in place, oldest entry first
+     *
+     * Pass the records to formatHistoryRecord() for their text. The view
+     * is valid until the next operation that changes the history.
+     *
+     * @return Every entry kept, with its sequence number
+     */
+    HistoryView historyView() const { return history.view(); }
+
+    /**
+     * @brief View only the entries recorded after a given one
+     *
+     * A poller keeps the lastSequence() of the view it got and passes it
+     * next time, so each poll touches just the new entries. Entries that
+     * were recorded and already dropped by the capacity limit are missing;
+     * the view's firstSequence() then skips ahead.
+     *
+     * @param sequence Last sequence number seen, 0 for the whole history
+     * @return Newer entries still kept, valid until the history changes
+     */
+    HistoryView historySince(std::uint64_t sequence) const { return history.since(sequence); }
+
+    /**
+     * @brief Get the sequence number of the newest history entry
+     * @return Entries ever recorded, including ones no longer kept; 0 if none
+     */
+    std::uint64_t historySequence() const { return history.lastSequence(); }
+
+    /**
+     * @brief Call a function for every new history entry
+     *
+     * The callback runs synchronously right after the entry is recorded,
+     * also when the capacity is 0, and receives its sequence number. It
+     * must not subscribe or unsubscribe; exceptions it throws leave the
+     * operation that recorded the entry.
+     *
+     * @param callback Function to call
+     * @return Subscription id for unsubscribeHistory()
+     */
+    std::size_t subscribeHistory(HistoryCallback callback);
+
+    /**
+     * @brief Stop calling a subscribed function
+     * @param id Value returned by subscribeHistory(); unknown ids are ignored
+     */
+    void unsubscribeHistory(std::size_t id);
+
+    /**
+     * @brief Format a history record for display
+     * @param record Record to format
+     * @return Text such as "2 + 3 = 5"
+     */
+    std::string formatHistoryRecord(const HistoryRecord& record) const;
+
     /**
      * @brief Clear calculation history
      */
     void clearHistory();
 
+    /**
+     * @brief Change how many history entries are kept
+     * @param capacity Maximum number of entries (0 disables history)
+     */
+    void setHistoryCapacity(std::size_t capacity);
+
+    /**
+     * @brief Get the maximum number of history entries kept
+     * @return History capacity
+     */
+    std::size_t getHistoryCapacity() const;
+
+    /**
+     * @brief Also append every history record to a persistent log
+     *
+     * The log receives each record in addition to the in-memory history,
+     * regardless of its capacity. The log must outlive the attachment.
+     *
+     * @param log Log to append to, or nullptr to stop logging
+     */
+    void attachHistoryLog(HistoryLog* log);
+
+    /**
+     * @brief Get the attached history log
+     * @return Log set by attachHistoryLog(), or nullptr
+     */
+    HistoryLog* getHistoryLog() const { return historyLog; }
+
     // Display and Input Operations
     std::string getDisplayText() const;
+
+    /**
+     * @brief Feed one key of the number being entered
+     * @param digit '0'-'9', '.', '-' or 'e'; see NumberInput for details
+     */
     void appendNumber(char digit);
     void setOperation(char op);
     void calculate();
     void clear();
 
+    /**
+     * @brief Compile an expression for repeated evaluation
+     *
+     * The result uses this calculator's angle unit but records no
+     * history; see CompiledExpr for the supported syntax.
+     *
+     * @param source Expression text, e.g. "sin(x)^2 + ln(y)/3"
+     * @return Compiled expression
+     * @throw std::invalid_argument if the text is not a valid expression
+     */
+    CompiledExpr compile(const std::string& source) const;
+
     /**
      * @brief Convert between degrees and radians
      * @param degrees Angle in degrees
@@ -146,17 +518,91 @@ private:
     double currentNumber;    ///< Current input number
     double storedNumber;     ///< Previously stored number
     double memoryValue;      ///< Value stored in memory
+    SharedRegister* sharedMemory; ///< Memory shared with other calculators, if attached
     char currentOperation;   ///< Current operation to perform
     bool newNumber;          ///< Flag indicating start of new number input
     std::string displayText; ///< Current display text
     bool useRadians;         ///< Flag for angle unit (true for radians, false for degrees)
-    std::vector<std::string> history; ///< Calculation history
+    MathPrecision mathPrecision; ///< Accuracy of the scalar scientific functions
+    HistoryBuffer history;   ///< Calculation history
+    HistoryLog* historyLog;  ///< Persistent copy of the history, if attached
+    std::vector<std::pair<std::size_t, HistoryCallback>> historySubscribers; ///< Observers by id
+    std::size_t nextSubscription; ///< Id of the next subscription
+    NumberInput input;       ///< Number currently being entered
+    std::unique_ptr<ResultCache> resultCache; ///< Private memoization table, if enabled
+    SharedResultCache* sharedCache; ///< Memoization table shared with other calculators, if attached
+    CacheStats cacheStats;   ///< Lookups in either cache
+    WorkStealingPool* workerPool; ///< Workers for the reductions, if attached
+    DecimalContext decimal;  ///< Scale and rounding of the decimal operations
+    Decimal decimalCurrent;  ///< Current input number in decimal mode
+    Decimal decimalStored;   ///< Previously stored number in decimal mode
+    Decimal decimalMemory;   ///< Private memory in decimal mode; memoryValue mirrors it
+    bool decimalMode;        ///< Flag for fixed-point keypad and display
+
+    /**
+     * @brief Look a result up in the cache in use
+     * @return true on a hit; false on a miss or without a cache
+     */
+    bool findCachedResult(CachedFunction function, double a, double b, double& result);
+
+    /**
+     * @brief Store a computed result in the cache in use, if any
+     */
+    void cacheResult(CachedFunction function, double a, double b, double result);
 
     /**
      * @brief Add entry to calculation history
-     * @param entry Calculation to add to history
+     * @param op Operation performed
+     * @param lhs First operand (or value for memory operations)
+     * @param rhs Second operand, 0 for unary operations
+     * @param result Result of the operation
+     */
+    void addToHistory(HistoryOp op, double lhs, double rhs = 0, double result = 0) {
+        MetricTimer timer(MetricOp::RecordHistory);
+        history.push(op, lhs, rhs, result);
+        if (historyLog) {
+            historyLog->append(op, lhs, rhs, result);
+        }
+        if (!historySubscribers.empty()) {
+            notifyHistory(HistoryRecord{op, lhs, rhs, result});
+        }
+    }
+
+    /**
+     * @brief Pass the newest history entry to every subscriber
+     */
+    void notifyHistory(const HistoryRecord& record);
+
+    /**
+     * @brief Record a decimal operation that succeeded, or count its failure
+     */
+    void recordDecimal(MetricTimer& timer, HistoryOp op, Decimal a, Decimal b, DecimalResult result) {
+        if (result.ok()) {
+            addToHistory(op, decimal.toDouble(a), decimal.toDouble(b), decimal.toDouble(result.value));
+        } else {
+            timer.fail();
+        }
+    }
+
+    /**
+     * @brief Store the result of M+ or M- in decimal mode
+     * @return false, after showing the error, if the result overflowed
+     */
+    bool addToDecimalMemory(MetricTimer& timer, DecimalResult result);
+
+    /**
+     * @brief Set the decimal memory and its double mirror
+     */
+    void setDecimalMemory(Decimal value) {
+        decimalMemory = value;
+        memoryValue = decimal.toDouble(value);
+    }
+
+    /**
+     * @brief Make a decimal result the current number and display it
+     * @param result Value to show, or the error to display
      */
-    void addToHistory(const std::string& entry);
+    void showDecimal(DecimalResult result);
 
     /**
      * @brief Format number for display
@@ -0,0 +1,378 @@
+#include "calculator_server.h"
+#include "batch.h"
+#include "number_format.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const std::size_t READ_SIZE = 64 * 1024;
+const int MAX_EVENTS = 256;
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+bool matches(const char* word, std::size_t length, const char* command) {
+    return std::strlen(command) == length && std::memcmp(word, command, length) == 0;
+}
+
+void appendNumber(std::string& response, double value) {
+    char buffer[NUMBER_BUFFER_SIZE];
+    response.append(buffer, formatFixed(value, buffer));
+}
+
+// Returns a session's calculator to its freshly constructed state
+void resetCalculator(Calculator& calc) {
+    calc.clear();
+    calc.memoryClear();
+    calc.clearHistory();
+}
+
+} // namespace
+
+ServerOptions::ServerOptions()
+    : maxSessions(4096)
+    , historyCapacity(HistoryBuffer::DEFAULT_CAPACITY)
+    , maxRequestSize(64 * 1024)
+    , maxPendingOutput(1 << 20) {
+}
+
+CalculatorServer::CalculatorServer(const std::string& socketPath, const ServerOptions& options)
+    : path(socketPath)
+    , options(options)
+    , listenFd(-1)
+    , epollFd(-1)
+    , stopFd(-1)
+    , openSessions(0) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Invalid socket path: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    struct stat info;
+    if (::stat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        ::unlink(path.c_str());
+    }
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        throw systemError("Cannot create socket");
+    }
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listenFd, SOMAXCONN) != 0) {
+        std::runtime_error error = systemError("Cannot listen on " + path);
+        ::close(listenFd);
+        throw error;
+    }
+
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    stopFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    epoll_event listenEvent;
+    listenEvent.events = EPOLLIN;
+    listenEvent.data.ptr = nullptr;
+    epoll_event stopEvent;
+    stopEvent.events = EPOLLIN;
+    stopEvent.data.ptr = &stopFd;
+    if (epollFd < 0 || stopFd < 0 ||
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &listenEvent) != 0 ||
+        ::epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &stopEvent) != 0) {
+        std::runtime_error error = systemError("Cannot set up epoll");
+        if (epollFd >= 0) ::close(epollFd);
+        if (stopFd >= 0) ::close(stopFd);
+        ::close(listenFd);
+        ::unlink(path.c_str());
+        throw error;
+    }
+}
+
+CalculatorServer::~CalculatorServer() {
+    for (auto& entry : sessions) {
+        ::close(entry.first);
+    }
+    ::close(stopFd);
+    ::close(epollFd);
+    ::close(listenFd);
+    ::unlink(path.c_str());
+}
+
+void CalculatorServer::run() {
+    epoll_event events[MAX_EVENTS];
+    for (;;) {
+        int count = ::epoll_wait(epollFd, events, MAX_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw systemError("epoll_wait failed");
+        }
+        for (int i = 0; i < count; ++i) {
+            void* target = events[i].data.ptr;
+            if (target == nullptr) {
+                acceptClients();
+            } else if (target == &stopFd) {
+                std::uint64_t value;
+                while (::read(stopFd, &value, sizeof(value)) > 0) {
+                }
+                return;
+            } else {
+                Session& session = *static_cast<Session*>(target);
+                if (session.fd < 0) {
+                    continue;
+                }
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    readSession(session);
+                }
+                if (session.fd >= 0 && (events[i].events & EPOLLOUT)) {
+                    serviceSession(session);
+                }
+            }
+        }
+        closed.clear();
+    }
+}
+
+void CalculatorServer::stop() {
+    std::uint64_t one = 1;
+    ssize_t written = ::write(stopFd, &one, sizeof(one));
+    (void)written;
+}
+
+void CalculatorServer::acceptClients() {
+    for (;;) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        if (sessions.size() >= options.maxSessions) {
+            static const char FULL[] = "ERR Server full\n";
+            ssize_t written = ::send(fd, FULL, sizeof(FULL) - 1, MSG_NOSIGNAL);
+            (void)written;
+            ::close(fd);
+            continue;
+        }
+
+        std::unique_ptr<Session> session(new Session);
+        session->fd = fd;
+        if (pool.empty()) {
+            session->calc.reset(new Calculator(options.historyCapacity));
+        } else {
+            session->calc = std::move(pool.back());
+            pool.pop_back();
+        }
+        session->outputSent = 0;
+        session->events = EPOLLIN;
+
+        epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = session.get();
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            pool.push_back(std::move(session->calc));
+            ::close(fd);
+            continue;
+        }
+        sessions[fd] = std::move(session);
+        openSessions.store(sessions.size(), std::memory_order_relaxed);
+    }
+}
+
+void CalculatorServer::readSession(Session& session) {
+    char buffer[READ_SIZE];
+    ssize_t count = ::read(session.fd, buffer, sizeof(buffer));
+    if (count == 0 || (count < 0 && errno != EAGAIN && errno != EINTR)) {
+        closeSession(session);
+        return;
+    }
+    if (count > 0) {
+        session.input.append(buffer, static_cast<std::size_t>(count));
+    }
+    serviceSession(session);
+}
+
+void CalculatorServer::serviceSession(Session& session) {
+    for (;;) {
+        // Execute complete requests while the client keeps up with the responses
+        std::size_t start = 0;
+        while (session.output.size() - session.outputSent < options.maxPendingOutput) {
+            const char* begin = session.input.data() + start;
+            const char* newline = static_cast<const char*>(
+                std::memchr(begin, '\n', session.input.size() - start));
+            if (newline == nullptr) {
+                break;
+            }
+            execute(*session.calc, begin, static_cast<std::size_t>(newline - begin), response);
+            session.output += response;
+            session.output += '\n';
+            start = static_cast<std::size_t>(newline - session.input.data()) + 1;
+        }
+        session.input.erase(0, start);
+        if (session.input.size() > options.maxRequestSize &&
+            session.input.find('\n') == std::string::npos) {
+            closeSession(session);
+            return;
+        }
+
+        while (session.outputSent < session.output.size()) {
+            ssize_t written = ::send(session.fd, session.output.data() + session.outputSent,
+                                     session.output.size() - session.outputSent, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                closeSession(session);
+                return;
+            }
+            session.outputSent += static_cast<std::size_t>(written);
+        }
+        if (session.outputSent < session.output.size()) {
+            // The socket is full; EPOLLOUT brings us back to the rest
+            break;
+        }
+        session.output.clear();
+        session.outputSent = 0;
+        // Requests held back for the responses just sent, also when this
+        // call only flushed them; a pipelining client may send nothing
+        // more until it has their answers
+        if (session.input.find('\n') == std::string::npos) {
+            break;
+        }
+    }
+
+    // Stop reading from clients that do not read their responses
+    std::size_t pending = session.output.size() - session.outputSent;
+    unsigned wanted = (pending < options.maxPendingOutput ? EPOLLIN : 0u) | (pending > 0 ? EPOLLOUT : 0u);
+    if (wanted != session.events) {
+        epoll_event event;
+        event.events = wanted;
+        event.data.ptr = &session;
+        ::epoll_ctl(epollFd, EPOLL_CTL_MOD, session.fd, &event);
+        session.events = wanted;
+    }
+}
+
+void CalculatorServer::closeSession(Session& session) {
+    auto it = sessions.find(session.fd);
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, session.fd, nullptr);
+    ::close(session.fd);
+    session.fd = -1;
+    resetCalculator(*session.calc);
+    pool.push_back(std::move(session.calc));
+    // Other events of this epoll batch may still point at the session
+    closed.push_back(std::move(it->second));
+    sessions.erase(it);
+    openSessions.store(sessions.size(), std::memory_order_relaxed);
+}
+
+void CalculatorServer::execute(Calculator& calc, const char* request, std::size_t length, std::string& response) {
+    if (length > 0 && request[length - 1] == '\r') {
+        --length;
+    }
+    std::size_t wordLength = 0;
+    while (wordLength < length && request[wordLength] != ' ') {
+        ++wordLength;
+    }
+    const char* argument = request + wordLength;
+    std::size_t argumentLength = length - wordLength;
+    while (argumentLength > 0 && *argument == ' ') {
+        ++argument;
+        --argumentLength;
+    }
+
+    response.assign("OK ");
+    try {
+        if (matches(request, wordLength, "eval")) {
+            double result;
+            std::string error;
+            switch (evaluateBatchLine(calc, argument, argumentLength, result, error)) {
+                case BatchLineStatus::Value:
+                    appendNumber(response, result);
+                    return;
+                case BatchLineStatus::Blank:
+                    response.assign("ERR Empty expression");
+                    return;
+                case BatchLineStatus::Error:
+                    response.assign("ERR ").append(error);
+                    return;
+            }
+        } else if (matches(request, wordLength, "num")) {
+            for (std::size_t i = 0; i < argumentLength; ++i) {
+                calc.appendNumber(argument[i]);
+            }
+        } else if (matches(request, wordLength, "op")) {
+            if (argumentLength != 1 || std::strchr("+-*/^", argument[0]) == nullptr) {
+                response.assign("ERR Unknown operation");
+                return;
+            }
+            calc.setOperation(argument[0]);
+        } else if (matches(request, wordLength, "=")) {
+            calc.calculate();
+        } else if (matches(request, wordLength, "C")) {
+            calc.clear();
+        } else if (matches(request, wordLength, "MS")) {
+            calc.memoryStore();
+        } else if (matches(request, wordLength, "MR")) {
+            calc.memoryRecall();
+        } else if (matches(request, wordLength, "MC")) {
+            calc.memoryClear();
+        } else if (matches(request, wordLength, "M+")) {
+            calc.memoryAdd();
+        } else if (matches(request, wordLength, "M-")) {
+            calc.memorySubtract();
+        } else if (matches(request, wordLength, "display")) {
+            // Answered below
+        } else if (matches(request, wordLength, "history")) {
+            HistoryView entries = calc.historyView();
+            for (HistoryView::Iterator it = entries.begin(); it != entries.end(); ++it) {
+                if (it != entries.begin()) {
+                    response += " | ";
+                }
+                response += calc.formatHistoryRecord(*it);
+            }
+            return;
+        } else {
+            double (Calculator::*unary)(double) = nullptr;
+            if (matches(request, wordLength, "sqrt")) unary = &Calculator::sqrt;
+            else if (matches(request, wordLength, "ln")) unary = &Calculator::ln;
+            else if (matches(request, wordLength, "sin")) unary = &Calculator::sin;
+            else if (matches(request, wordLength, "cos")) unary = &Calculator::cos;
+            else if (matches(request, wordLength, "tan")) unary = &Calculator::tan;
+            if (unary == nullptr) {
+                response.assign("ERR Unknown command");
+                return;
+            }
+            // Like the interactive menu, applied to the displayed number
+            std::string display = calc.getDisplayText();
+            char* end;
+            double current = std::strtod(display.c_str(), &end);
+            if (end == display.c_str() || *end != '\0') {
+                response.assign("ERR Display does not hold a number");
+                return;
+            }
+            appendNumber(response, (calc.*unary)(current));
+            return;
+        }
+    } catch (const std::exception& e) {
+        response.assign("ERR ").append(e.what());
+        return;
+    }
+    response += calc.getDisplayText();
+}
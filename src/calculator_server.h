@@ -0,0 +1,134 @@
+/**
+ * @file calculator_server.h
+ * @brief Unix domain socket server with one calculator session per client
+ */
+
+#ifndef CALCULATOR_SERVER_H
+#define CALCULATOR_SERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "calculator.h"
+
+/**
+ * @struct ServerOptions
+ * @brief Settings for a CalculatorServer
+ */
+struct ServerOptions {
+    std::size_t maxSessions;      ///< Connections served at once; more are refused
+    std::size_t historyCapacity;  ///< History entries kept per session
+    std::size_t maxRequestSize;   ///< Longest request line accepted
+    std::size_t maxPendingOutput; ///< Unsent response bytes before a client stops being read
+
+    ServerOptions();
+};
+
+/**
+ * @class CalculatorServer
+ * @brief Serves many calculator sessions from one thread with epoll
+ *
+ * Every connection is a session with its own Calculator, so display,
+ * stored number, memory and history behave as in the interactive
+ * program. Calculators come from a pool: a closed session's calculator
+ * is reset and handed to the next client instead of being freed.
+ *
+ * The protocol is line based. Each request is one line and gets exactly
+ * one response line, "OK <text>" or "ERR <message>", in request order,
+ * so clients may pipeline any number of requests. See execute() for the
+ * commands.
+ *
+ * The server is Linux-only (epoll, eventfd).
+ */
+class CalculatorServer {
+public:
+    /**
+     * @brief Bind and listen on a socket path
+     *
+     * A stale socket file left at the path is replaced.
+     *
+     * @param socketPath Filesystem path of the Unix domain socket
+     * @param options Session limits
+     * @throw std::runtime_error if the socket cannot be created
+     */
+    explicit CalculatorServer(const std::string& socketPath, const ServerOptions& options = ServerOptions());
+
+    /**
+     * @brief Close every session and remove the socket file
+     */
+    ~CalculatorServer();
+
+    CalculatorServer(const CalculatorServer&) = delete;
+    CalculatorServer& operator=(const CalculatorServer&) = delete;
+
+    /**
+     * @brief Serve clients until stop() is called
+     * @throw std::runtime_error if epoll fails
+     */
+    void run();
+
+    /**
+     * @brief Make run() return; safe from other threads and signal handlers
+     */
+    void stop();
+
+    /**
+     * @brief Get the number of connected clients
+     * @return Open sessions
+     */
+    std::size_t sessionCount() const { return openSessions.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Run one request against a calculator
+     *
+     * Commands:
+     * - "eval <expression>": evaluate like a line of batch input
+     * - "num <keys>": type digits, '.', '-' or 'e' into the display
+     * - "op <+|-|*|/|^>": set the pending operation
+     * - "=": calculate; "C": clear
+     * - "sqrt", "ln", "sin", "cos", "tan": apply to the displayed number
+     * - "MS", "MR", "MC", "M+", "M-": memory operations
+     * - "history": history entries separated by " | "
+     * - "display": the display text
+     *
+     * Commands that change the display answer with the new display text.
+     *
+     * @param calc Session calculator
+     * @param request Request line without the newline
+     * @param length Number of characters
+     * @param response Receives "OK ..." or "ERR ..." without a newline
+     */
+    static void execute(Calculator& calc, const char* request, std::size_t length, std::string& response);
+
+private:
+    struct Session {
+        int fd;
+        std::unique_ptr<Calculator> calc;
+        std::string input;        ///< Received bytes not yet executed
+        std::string output;       ///< Responses not yet sent
+        std::size_t outputSent;   ///< Bytes of output already written
+        unsigned events;          ///< Events registered with epoll
+    };
+
+    std::string path;
+    ServerOptions options;
+    int listenFd;
+    int epollFd;
+    int stopFd;
+    std::atomic<std::size_t> openSessions;
+    std::unordered_map<int, std::unique_ptr<Session>> sessions;
+    std::vector<std::unique_ptr<Calculator>> pool;  ///< Calculators of closed sessions
+    std::vector<std::unique_ptr<Session>> closed;  ///< Sessions closed during the current epoll batch
+    std::string response;                          ///< Scratch space for execute()
+
+    void acceptClients();
+    void readSession(Session& session);
+    void serviceSession(Session& session);
+    void closeSession(Session& session);
+};
+
+#endif // CALCULATOR_SERVER_H
@@ -0,0 +1,614 @@
+#include "columnar.h"
+#include "array_ops.h"
+#include "number_format.h"
+#include "number_input.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// CSV bytes per parsing task; chunk boundaries move to the next line break
+const std::size_t PARSE_CHUNK_BYTES = std::size_t(1) << 22;
+
+// Larger exponents are infinity or zero anyway; keeps the sum in int range
+const int MAX_EXPONENT = 100000;
+
+std::runtime_error systemError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+// Read-only mapping of a whole file, unmapped on destruction
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) : data(nullptr), size(0) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw systemError("Cannot open", path);
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            std::runtime_error error = systemError("Cannot stat", path);
+            ::close(fd);
+            throw error;
+        }
+        size = static_cast<std::size_t>(info.st_size);
+        if (size > 0) {
+            void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                std::runtime_error error = systemError("Cannot map", path);
+                ::close(fd);
+                throw error;
+            }
+            data = static_cast<const char*>(mapped);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile() {
+        if (data) {
+            ::munmap(const_cast<char*>(data), size);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// Hands the mapping over to the caller, who must munmap it
+    void* release() {
+        void* mapped = const_cast<char*>(data);
+        data = nullptr;
+        return mapped;
+    }
+
+    const char* data;
+    std::size_t size;
+};
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+void trim(const char*& begin, const char*& end) {
+    while (begin < end && isBlank(*begin)) {
+        ++begin;
+    }
+    while (end > begin && isBlank(end[-1])) {
+        --end;
+    }
+}
+
+// Consumes word (lower case) at p, ignoring case
+bool matchWord(const char*& p, const char* end, const char* word) {
+    const char* q = p;
+    for (; *word != '\0'; ++word, ++q) {
+        if (q == end || (*q | 0x20) != *word) {
+            return false;
+        }
+    }
+    p = q;
+    return true;
+}
+
+const char* findChar(const char* p, const char* end, char c) {
+    const void* found = std::memchr(p, c, static_cast<std::size_t>(end - p));
+    return found ? static_cast<const char*>(found) : end;
+}
+
+// Parses the field starting at p in one pass, with the same digit
+// handling as NumberInput so the result is correctly rounded. Returns
+// the delimiter or line end that closes the field, or null if the field
+// is not a number.
+const char* parseField(const char* p, const char* end, char delimiter, double& value) {
+    while (p < end && isBlank(*p)) {
+        ++p;
+    }
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    if (p < end && ((*p | 0x20) == 'n' || (*p | 0x20) == 'i')) {
+        if (matchWord(p, end, "nan")) {
+            value = std::numeric_limits<double>::quiet_NaN();
+        } else if (matchWord(p, end, "inf")) {
+            matchWord(p, end, "inity");
+            value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+        } else {
+            return nullptr;
+        }
+    } else {
+        std::uint64_t mantissa = 0;
+        int digitCount = 0;
+        int decimalShift = 0;
+        bool truncated = false;
+        bool anyDigit = false;
+        bool seenPoint = false;
+        for (; p < end; ++p) {
+            unsigned digit = static_cast<unsigned>(*p - '0');
+            if (digit > 9) {
+                if (*p == '.' && !seenPoint) {
+                    seenPoint = true;
+                    continue;
+                }
+                break;
+            }
+            anyDigit = true;
+            if (digitCount == 0 && digit == 0) {
+                decimalShift -= seenPoint ? 1 : 0;
+            } else if (digitCount < NumberInput::MAX_DIGITS) {
+                mantissa = mantissa * 10 + digit;
+                ++digitCount;
+                decimalShift -= seenPoint ? 1 : 0;
+            } else {
+                truncated = truncated || digit != 0;
+                decimalShift += seenPoint ? 0 : 1;
+            }
+        }
+        if (!anyDigit) {
+            return nullptr;
+        }
+
+        int exponent = 0;
+        if (p < end && (*p == 'e' || *p == 'E')) {
+            ++p;
+            bool exponentNegative = false;
+            if (p < end && (*p == '-' || *p == '+')) {
+                exponentNegative = *p == '-';
+                ++p;
+            }
+            if (p == end || static_cast<unsigned>(*p - '0') > 9) {
+                return nullptr;
+            }
+            for (; p < end && static_cast<unsigned>(*p - '0') <= 9; ++p) {
+                exponent = std::min(exponent * 10 + (*p - '0'), MAX_EXPONENT);
+            }
+            if (exponentNegative) {
+                exponent = -exponent;
+            }
+        }
+        double magnitude = decimalToDouble(mantissa, decimalShift + exponent, truncated);
+        value = negative ? -magnitude : magnitude;
+    }
+
+    while (p < end && isBlank(*p)) {
+        ++p;
+    }
+    return p == end || *p == delimiter ? p : nullptr;
+}
+
+const char* lineEnd(const char* p, const char* end) {
+    return findChar(p, end, '\n');
+}
+
+bool blankLine(const char* begin, const char* end) {
+    return begin == end || (end - begin == 1 && *begin == '\r');
+}
+
+struct CsvChunk {
+    const char* begin;
+    const char* end;
+    std::size_t rows;       ///< Non-blank lines
+    std::size_t lines;      ///< All lines
+    std::size_t firstRow;
+    std::size_t firstLine;  ///< 1-based line number in the file
+    std::string error;
+};
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+} // namespace
+
+ColumnarOptions::ColumnarOptions()
+    : blockRows(1024)
+    , chunkRows(std::size_t(1) << 16)
+    , delimiter(',') {
+}
+
+ColumnSet::ColumnSet() : rowCount(0), bytesRead(0) {
+}
+
+ColumnSet::~ColumnSet() {
+    for (const Column& column : columns) {
+        if (column.mapping) {
+            ::munmap(column.mapping, column.mappingSize);
+        }
+    }
+}
+
+void ColumnSet::checkRows(std::size_t rows, const std::string& name) const {
+    if (contains(name)) {
+        throw std::invalid_argument("Duplicate column " + name);
+    }
+    if (!columns.empty() && rows != rowCount) {
+        throw std::invalid_argument("Column " + name + " has " + std::to_string(rows) +
+                                    " rows, expected " + std::to_string(rowCount));
+    }
+}
+
+void ColumnSet::loadCsv(const std::string& path, const std::vector<std::string>& names,
+                        WorkStealingPool* pool, const ColumnarOptions& options) {
+    MappedFile file(path);
+    if (file.size == 0) {
+        throw std::invalid_argument(path + ": missing header line");
+    }
+    const char* const end = file.data + file.size;
+    ::madvise(const_cast<char*>(file.data), file.size, MADV_SEQUENTIAL);
+
+    // Header: column names
+    const char* headerEnd = lineEnd(file.data, end);
+    std::vector<std::string> header;
+    for (const char* p = file.data; p <= headerEnd;) {
+        const char* fieldEnd = findChar(p, headerEnd, options.delimiter);
+        const char* nameBegin = p;
+        const char* nameEnd = fieldEnd;
+        trim(nameBegin, nameEnd);
+        header.emplace_back(nameBegin, nameEnd);
+        p = fieldEnd + 1;
+    }
+    if (header.size() == 1 && header[0].empty()) {
+        throw std::invalid_argument(path + ": missing header line");
+    }
+
+    const std::vector<std::string>& selected = names.empty() ? header : names;
+    std::vector<int> slotOfField(header.size(), -1);
+    std::size_t fieldsNeeded = 0;
+    for (std::size_t slot = 0; slot < selected.size(); ++slot) {
+        std::size_t field = static_cast<std::size_t>(
+            std::find(header.begin(), header.end(), selected[slot]) - header.begin());
+        if (field == header.size()) {
+            throw std::invalid_argument("Column " + selected[slot] + " not found in " + path);
+        }
+        if (slotOfField[field] >= 0 || contains(selected[slot])) {
+            throw std::invalid_argument("Duplicate column " + selected[slot]);
+        }
+        slotOfField[field] = static_cast<int>(slot);
+        fieldsNeeded = std::max(fieldsNeeded, field + 1);
+    }
+
+    // Split the body at line breaks and count each chunk's rows
+    std::vector<CsvChunk> chunks;
+    for (const char* p = std::min(headerEnd + 1, end); p < end;) {
+        const char* chunkEnd = p + std::min(PARSE_CHUNK_BYTES, static_cast<std::size_t>(end - p));
+        chunkEnd = chunkEnd == end ? end : std::min(lineEnd(chunkEnd, end) + 1, end);
+        CsvChunk chunk;
+        chunk.begin = p;
+        chunk.end = chunkEnd;
+        chunk.rows = 0;
+        chunk.lines = 0;
+        chunks.push_back(chunk);
+        p = chunkEnd;
+    }
+    parallelFor(pool, chunks.size(), [&](std::size_t i) {
+        CsvChunk& chunk = chunks[i];
+        for (const char* p = chunk.begin; p < chunk.end;) {
+            const char* eol = lineEnd(p, chunk.end);
+            ++chunk.lines;
+            chunk.rows += blankLine(p, eol) ? 0 : 1;
+            p = eol + 1;
+        }
+    });
+    std::size_t rows = 0;
+    std::size_t line = 2;
+    for (CsvChunk& chunk : chunks) {
+        chunk.firstRow = rows;
+        chunk.firstLine = line;
+        rows += chunk.rows;
+        line += chunk.lines;
+    }
+    for (const std::string& name : selected) {
+        checkRows(rows, name);
+    }
+
+    // Parse every chunk straight into its rows of the output columns
+    std::vector<std::vector<double>> values(selected.size(), std::vector<double>(rows));
+    std::vector<double*> targets;
+    for (std::vector<double>& column : values) {
+        targets.push_back(column.data());
+    }
+    parallelFor(pool, chunks.size(), [&](std::size_t i) {
+        CsvChunk& chunk = chunks[i];
+        std::size_t row = chunk.firstRow;
+        std::size_t lineNumber = chunk.firstLine;
+        for (const char* p = chunk.begin; p < chunk.end; ++lineNumber) {
+            const char* eol = lineEnd(p, chunk.end);
+            if (blankLine(p, eol)) {
+                p = eol + 1;
+                continue;
+            }
+            std::size_t field = 0;
+            for (const char* q = p; field < fieldsNeeded; ++field) {
+                int slot = slotOfField[field];
+                const char* fieldEnd = slot < 0 ? findChar(q, eol, options.delimiter)
+                    : parseField(q, eol, options.delimiter, targets[static_cast<std::size_t>(slot)][row]);
+                if (!fieldEnd) {
+                    chunk.error = "Line " + std::to_string(lineNumber) + ": " + header[field] + " is not a number";
+                    return;
+                }
+                if (fieldEnd == eol) {
+                    ++field;
+                    break;
+                }
+                q = fieldEnd + 1;
+            }
+            if (field < fieldsNeeded) {
+                chunk.error = "Line " + std::to_string(lineNumber) + ": expected " +
+                              std::to_string(fieldsNeeded) + " fields";
+                return;
+            }
+            ++row;
+            p = eol + 1;
+        }
+    });
+    for (const CsvChunk& chunk : chunks) {
+        if (!chunk.error.empty()) {
+            throw std::invalid_argument(path + ": " + chunk.error);
+        }
+    }
+
+    for (std::size_t slot = 0; slot < selected.size(); ++slot) {
+        Column column;
+        column.name = selected[slot];
+        column.values = std::move(values[slot]);
+        column.mapping = nullptr;
+        column.mappingSize = 0;
+        columns.push_back(std::move(column));
+    }
+    rowCount = rows;
+    bytesRead += file.size;
+}
+
+void ColumnSet::mapBinary(const std::string& name, const std::string& path) {
+    MappedFile file(path);
+    if (file.size % sizeof(double) != 0) {
+        throw std::invalid_argument(path + ": size is not a multiple of " + std::to_string(sizeof(double)));
+    }
+    std::size_t rows = file.size / sizeof(double);
+    checkRows(rows, name);
+
+    Column column;
+    column.name = name;
+    column.mappingSize = file.size;
+    column.mapping = nullptr;
+    columns.push_back(std::move(column));
+    if (file.size > 0) {
+        ::madvise(const_cast<char*>(file.data), file.size, MADV_SEQUENTIAL);
+        columns.back().mapping = file.release();
+    }
+    rowCount = rows;
+    bytesRead += file.size;
+}
+
+void ColumnSet::add(const std::string& name, std::vector<double> values) {
+    checkRows(values.size(), name);
+    std::size_t rows = values.size();
+    Column column;
+    column.name = name;
+    column.values = std::move(values);
+    column.mapping = nullptr;
+    column.mappingSize = 0;
+    columns.push_back(std::move(column));
+    rowCount = rows;
+    bytesRead += rows * sizeof(double);
+}
+
+const double* ColumnSet::column(const std::string& name) const {
+    for (const Column& column : columns) {
+        if (column.name == name) {
+            return column.data();
+        }
+    }
+    throw std::invalid_argument("No column named " + name);
+}
+
+bool ColumnSet::contains(const std::string& name) const {
+    for (const Column& column : columns) {
+        if (column.name == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ColumnarFormula::ColumnarFormula(const CompiledExpr& expr, const ColumnSet& columns,
+                                 const ColumnarOptions& options)
+    : expr(expr)
+    , rowCount(columns.rows())
+    , options(options) {
+    for (const std::string& name : expr.variables()) {
+        inputs.push_back(columns.column(name));
+    }
+    this->options.blockRows = std::max<std::size_t>(this->options.blockRows, 1);
+    this->options.chunkRows = std::max(this->options.chunkRows, this->options.blockRows);
+}
+
+void ColumnarFormula::evaluateBlock(std::size_t row, std::size_t n, double* out, double* temporaries,
+                                    const double* constantBlocks, unsigned char* errors,
+                                    unsigned char* scratch) const {
+    typedef CompiledExpr::Opcode Opcode;
+    const std::size_t block = options.blockRows;
+    const std::size_t variableCount = inputs.size();
+    const std::size_t firstTemporary = variableCount + expr.constantValues().size();
+
+    auto source = [&](std::size_t reg) -> const double* {
+        if (reg < variableCount) {
+            return inputs[reg] + row;
+        }
+        if (reg < firstTemporary) {
+            return constantBlocks + (reg - variableCount) * block;
+        }
+        return temporaries + (reg - firstTemporary) * block;
+    };
+
+    const std::vector<CompiledExpr::Instruction>& code = expr.instructions();
+    for (std::size_t i = 0; i < code.size(); ++i) {
+        const CompiledExpr::Instruction& in = code[i];
+        // The last instruction computes the result; write it in place
+        double* dst = (i + 1 == code.size() && in.dst == expr.resultIndex())
+            ? out : temporaries + (in.dst - firstTemporary) * block;
+        const double* lhs = source(in.lhs);
+        const double* rhs = source(in.rhs);
+        std::size_t failed = 0;
+        switch (in.op) {
+            case Opcode::Add: arrayAdd(lhs, rhs, dst, n); break;
+            case Opcode::Subtract: arraySubtract(lhs, rhs, dst, n); break;
+            case Opcode::Multiply: arrayMultiply(lhs, rhs, dst, n); break;
+            case Opcode::Divide: failed = arrayDivide(lhs, rhs, dst, n, scratch); break;
+            case Opcode::Power: arrayPower(lhs, rhs, dst, n); break;
+            case Opcode::Negate:
+                for (std::size_t k = 0; k < n; ++k) {
+                    dst[k] = -lhs[k];
+                }
+                break;
+            case Opcode::Sqrt: failed = arraySqrt(lhs, dst, n, scratch); break;
+            case Opcode::Ln: failed = arrayLn(lhs, dst, n, scratch); break;
+            case Opcode::Sin: arraySin(lhs, dst, n); break;
+            case Opcode::Cos: arrayCos(lhs, dst, n); break;
+            case Opcode::Tan: arrayTan(lhs, dst, n); break;
+            case Opcode::SinDegrees: arraySin(lhs, dst, n, false); break;
+            case Opcode::CosDegrees: arrayCos(lhs, dst, n, false); break;
+            case Opcode::TanDegrees: arrayTan(lhs, dst, n, false); break;
+        }
+        if (failed > 0) {
+            for (std::size_t k = 0; k < n; ++k) {
+                errors[k] |= scratch[k];
+            }
+        }
+    }
+
+    if (code.empty() || code.back().dst != expr.resultIndex()) {
+        std::memcpy(out, source(expr.resultIndex()), n * sizeof(double));
+    }
+}
+
+std::size_t ColumnarFormula::evaluate(std::size_t begin, std::size_t end, double* out) const {
+    const std::size_t block = options.blockRows;
+    const std::vector<double>& constants = expr.constantValues();
+    const std::size_t temporaryCount = expr.registerCount() - inputs.size() - constants.size();
+
+    // Constants are broadcast once so every operand is a plain array
+    std::vector<double> constantBlocks(constants.size() * block);
+    for (std::size_t c = 0; c < constants.size(); ++c) {
+        std::fill_n(constantBlocks.begin() + static_cast<std::ptrdiff_t>(c * block), block, constants[c]);
+    }
+    std::vector<double> temporaries(temporaryCount * block);
+    std::vector<unsigned char> errors(block);
+    std::vector<unsigned char> scratch(block);
+
+    std::size_t failedRows = 0;
+    for (std::size_t row = begin; row < end; row += block) {
+        std::size_t n = std::min(block, end - row);
+        double* blockOut = out + (row - begin);
+        std::fill_n(errors.begin(), n, 0);
+        evaluateBlock(row, n, blockOut, temporaries.data(), constantBlocks.data(), errors.data(), scratch.data());
+        for (std::size_t k = 0; k < n; ++k) {
+            if (errors[k]) {
+                blockOut[k] = std::numeric_limits<double>::quiet_NaN();
+                ++failedRows;
+            }
+        }
+    }
+    return failedRows;
+}
+
+std::size_t ColumnarFormula::evaluateAll(double* out, WorkStealingPool* pool) const {
+    const std::size_t chunk = options.chunkRows;
+    const std::size_t chunkCount = (rowCount + chunk - 1) / chunk;
+    std::vector<std::size_t> failed(chunkCount);
+    parallelFor(pool, chunkCount, [&](std::size_t i) {
+        std::size_t begin = i * chunk;
+        failed[i] = evaluate(begin, std::min(begin + chunk, rowCount), out + begin);
+    });
+    std::size_t failedRows = 0;
+    for (std::size_t count : failed) {
+        failedRows += count;
+    }
+    return failedRows;
+}
+
+std::size_t ColumnarFormula::evaluateToFile(const std::string& path, WorkStealingPool* pool) const {
+    const bool binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+    int fd = STDOUT_FILENO;
+    if (path != "-") {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw systemError("Cannot create", path);
+        }
+    }
+
+    // A window holds a couple of chunks per worker; chunks are evaluated
+    // and formatted in parallel, then written in row order
+    const std::size_t chunk = options.chunkRows;
+    const std::size_t windowChunks = pool ? 2 * pool->size() : 1;
+    std::vector<double> results(std::min(rowCount, windowChunks * chunk));
+    std::vector<std::string> texts(binary ? 0 : windowChunks);
+    std::vector<std::size_t> failed(windowChunks);
+    std::size_t failedRows = 0;
+    bool ok = true;
+
+    for (std::size_t windowBegin = 0; windowBegin < rowCount && ok; windowBegin += windowChunks * chunk) {
+        std::size_t windowEnd = std::min(windowBegin + windowChunks * chunk, rowCount);
+        std::size_t chunkCount = (windowEnd - windowBegin + chunk - 1) / chunk;
+        parallelFor(pool, chunkCount, [&](std::size_t i) {
+            std::size_t begin = windowBegin + i * chunk;
+            std::size_t end = std::min(begin + chunk, windowEnd);
+            double* values = results.data() + (begin - windowBegin);
+            failed[i] = evaluate(begin, end, values);
+            if (!binary) {
+                std::string& text = texts[i];
+                text.clear();
+                char buffer[NUMBER_BUFFER_SIZE];
+                for (std::size_t k = 0; k < end - begin; ++k) {
+                    std::size_t length = formatShortest(values[k], buffer);
+                    buffer[length] = '\n';
+                    text.append(buffer, length + 1);
+                }
+            }
+        });
+        for (std::size_t i = 0; i < chunkCount; ++i) {
+            failedRows += failed[i];
+        }
+        if (binary) {
+            ok = writeAll(fd, reinterpret_cast<const char*>(results.data()),
+                          (windowEnd - windowBegin) * sizeof(double));
+        } else {
+            for (std::size_t i = 0; i < chunkCount && ok; ++i) {
+                ok = writeAll(fd, texts[i].data(), texts[i].size());
+            }
+        }
+    }
+
+    if (!ok) {
+        std::runtime_error error = systemError("Cannot write", path);
+        if (fd != STDOUT_FILENO) {
+            ::close(fd);
+        }
+        throw error;
+    }
+    if (fd != STDOUT_FILENO && ::close(fd) != 0) {
+        throw systemError("Cannot write", path);
+    }
+    return failedRows;
+}
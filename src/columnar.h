@@ -0,0 +1,188 @@
+/**
+ * @file columnar.h
+ * @brief Column-at-a-time evaluation of formulas over tabular data
+ */
+
+#ifndef COLUMNAR_H
+#define COLUMNAR_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "expression.h"
+
+class WorkStealingPool;
+
+/**
+ * @struct ColumnarOptions
+ * @brief Block sizes and CSV settings for columnar evaluation
+ */
+struct ColumnarOptions {
+    std::size_t blockRows;  ///< Rows per instruction pass; each register is blockRows doubles
+    std::size_t chunkRows;  ///< Rows per pool task
+    char delimiter;         ///< CSV field separator
+
+    ColumnarOptions();
+};
+
+/**
+ * @class ColumnSet
+ * @brief Named numeric columns of equal length, stored as separate arrays
+ *
+ * Columns come from a CSV file, which is memory-mapped and parsed into
+ * one array per column (structure of arrays), or from raw binary files
+ * of native doubles, which are mapped and used in place.
+ */
+class ColumnSet {
+public:
+    ColumnSet();
+    ~ColumnSet();
+
+    ColumnSet(const ColumnSet&) = delete;
+    ColumnSet& operator=(const ColumnSet&) = delete;
+
+    /**
+     * @brief Parse numeric columns of a CSV file
+     *
+     * The first line names the columns. Fields may be surrounded by
+     * spaces; numbers use the batch syntax plus "nan" and "inf". Blank
+     * lines are skipped. The file is split into chunks at line breaks;
+     * with a pool, the chunks are counted and parsed in parallel.
+     *
+     * @param path CSV file
+     * @param names Columns to load; empty loads every column
+     * @param pool Workers for parsing, or nullptr for the calling thread
+     * @param options Delimiter and chunk size
+     * @throw std::runtime_error if the file cannot be read
+     * @throw std::invalid_argument for a missing column, a short line or
+     *        a field that is not a number (with its line number), or a
+     *        row count that differs from columns already in the set
+     */
+    void loadCsv(const std::string& path, const std::vector<std::string>& names = std::vector<std::string>(),
+                 WorkStealingPool* pool = nullptr, const ColumnarOptions& options = ColumnarOptions());
+
+    /**
+     * @brief Map a raw file of native-endian doubles as a column
+     * @param name Column name
+     * @param path Binary file whose size is a multiple of 8
+     * @throw std::runtime_error if the file cannot be mapped
+     * @throw std::invalid_argument if its row count differs from the set's
+     */
+    void mapBinary(const std::string& name, const std::string& path);
+
+    /**
+     * @brief Add a column held in memory
+     * @param name Column name
+     * @param values Column values; moved into the set
+     * @throw std::invalid_argument if the row count differs from the set's
+     */
+    void add(const std::string& name, std::vector<double> values);
+
+    /**
+     * @brief Get a column
+     * @param name Column name
+     * @return rows() values
+     * @throw std::invalid_argument if there is no such column
+     */
+    const double* column(const std::string& name) const;
+
+    bool contains(const std::string& name) const;
+
+    /**
+     * @brief Get the number of rows
+     * @return Rows in every column, 0 for an empty set
+     */
+    std::size_t rows() const { return rowCount; }
+
+    /**
+     * @brief Get the size of the data the columns were read from
+     * @return CSV file bytes plus 8 bytes per row of binary and added columns
+     */
+    std::size_t sourceBytes() const { return bytesRead; }
+
+private:
+    struct Column {
+        std::string name;
+        std::vector<double> values;  ///< Parsed or added data
+        void* mapping;               ///< Mapped binary file, or null
+        std::size_t mappingSize;
+        const double* data() const { return mapping ? static_cast<const double*>(mapping) : values.data(); }
+    };
+
+    std::vector<Column> columns;
+    std::size_t rowCount;
+    std::size_t bytesRead;
+
+    void checkRows(std::size_t rows, const std::string& name) const;
+};
+
+/**
+ * @class ColumnarFormula
+ * @brief Compiled expression bound to the columns of a ColumnSet
+ *
+ * Evaluation walks the rows in blocks of blockRows and runs each
+ * instruction over a whole block with the SIMD array kernels, so the
+ * registers of a block (blockRows doubles each) stay in cache. Variable
+ * registers point straight into the input columns. Results are
+ * identical to Calculator's array operations. A row whose evaluation
+ * hits a domain error yields NaN and is counted.
+ */
+class ColumnarFormula {
+public:
+    /**
+     * @brief Bind the expression's variables to columns of the same name
+     * @param expr Compiled expression; copied
+     * @param columns Input columns; must outlive the formula
+     * @param options Block and chunk sizes
+     * @throw std::invalid_argument if a variable has no column
+     */
+    ColumnarFormula(const CompiledExpr& expr, const ColumnSet& columns,
+                    const ColumnarOptions& options = ColumnarOptions());
+
+    /**
+     * @brief Evaluate a range of rows; may be called from several threads
+     * @param begin First row
+     * @param end One past the last row
+     * @param out Receives end - begin results
+     * @return Rows with domain errors
+     */
+    std::size_t evaluate(std::size_t begin, std::size_t end, double* out) const;
+
+    /**
+     * @brief Evaluate every row, in chunks on a pool
+     * @param out Receives rows() results
+     * @param pool Workers, or nullptr for the calling thread
+     * @return Rows with domain errors
+     */
+    std::size_t evaluateAll(double* out, WorkStealingPool* pool = nullptr) const;
+
+    /**
+     * @brief Evaluate every row and stream the results to a file
+     *
+     * Rows are evaluated (and, for text, formatted) a window of chunks at
+     * a time and written in order, so the output column is never held in
+     * memory in full.
+     *
+     * @param path Output file, or "-" for standard output; a name ending
+     *             in ".bin" gets raw doubles, anything else one
+     *             shortest round-trip number per line
+     * @param pool Workers, or nullptr for the calling thread
+     * @return Rows with domain errors
+     * @throw std::runtime_error if the file cannot be written
+     */
+    std::size_t evaluateToFile(const std::string& path, WorkStealingPool* pool = nullptr) const;
+
+    std::size_t rows() const { return rowCount; }
+
+private:
+    CompiledExpr expr;
+    std::vector<const double*> inputs;  ///< Column of each variable
+    std::size_t rowCount;
+    ColumnarOptions options;
+
+    void evaluateBlock(std::size_t row, std::size_t n, double* out, double* temporaries,
+                       const double* constantBlocks, unsigned char* errors, unsigned char* scratch) const;
+};
+
+#endif // COLUMNAR_H
@@ -0,0 +1,121 @@
+#include "columnar.h"
+#include "work_stealing_pool.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+namespace {
+
+void displayUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] <formula> [csv]\n"
+              << "  Evaluates a formula for every row of a dataset and writes one\n"
+              << "  result per row. Variables name CSV columns or binary columns.\n"
+              << "  --output FILE       Results file (default -, standard output);\n"
+              << "                      a name ending in .bin gets raw doubles\n"
+              << "  --binary NAME=FILE  Map a file of native doubles as column NAME\n"
+              << "  --threads N         Worker threads (0 = all cores, default 1)\n"
+              << "  --degrees           Trigonometric arguments are in degrees\n"
+              << "  --time              Report rows and bytes per second on stderr\n";
+}
+
+bool parseCount(const char* text, std::size_t& value) {
+    char* end;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (*text == '\0' || *text == '-' || *end != '\0') {
+        return false;
+    }
+    value = static_cast<std::size_t>(parsed);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string output = "-";
+    std::vector<std::pair<std::string, std::string>> binaries;
+    std::vector<const char*> positional;
+    std::size_t threads = 1;
+    bool useRadians = true;
+    bool timed = false;
+    for (int i = 1; i < argc; ++i) {
+        bool ok = true;
+        bool hasValue = i + 1 < argc;
+        if (hasValue && std::strcmp(argv[i], "--output") == 0) {
+            output = argv[++i];
+        } else if (hasValue && std::strcmp(argv[i], "--binary") == 0) {
+            const char* spec = argv[++i];
+            const char* equals = std::strchr(spec, '=');
+            ok = equals != nullptr && equals != spec && equals[1] != '\0';
+            if (ok) {
+                binaries.emplace_back(std::string(spec, equals), std::string(equals + 1));
+            }
+        } else if (hasValue && std::strcmp(argv[i], "--threads") == 0) {
+            ok = parseCount(argv[++i], threads);
+        } else if (std::strcmp(argv[i], "--degrees") == 0) {
+            useRadians = false;
+        } else if (std::strcmp(argv[i], "--time") == 0) {
+            timed = true;
+        } else if (argv[i][0] != '-' || argv[i][1] == '\0') {
+            positional.push_back(argv[i]);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            displayUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (positional.empty() || positional.size() > 2 || (positional.size() == 1 && binaries.empty())) {
+        displayUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<WorkStealingPool> pool;
+        if (threads != 1) {
+            pool.reset(new WorkStealingPool(threads));
+        }
+
+        CompiledExpr expr = CompiledExpr::compile(positional[0], useRadians);
+        ColumnSet columns;
+        for (const auto& binary : binaries) {
+            columns.mapBinary(binary.first, binary.second);
+        }
+        if (positional.size() == 2) {
+            // Parse only the columns the formula reads
+            std::vector<std::string> names;
+            for (const std::string& name : expr.variables()) {
+                if (!columns.contains(name)) {
+                    names.push_back(name);
+                }
+            }
+            if (!names.empty()) {
+                columns.loadCsv(positional[1], names, pool.get());
+            }
+        }
+
+        ColumnarFormula formula(expr, columns);
+        std::size_t failed = formula.evaluateToFile(output, pool.get());
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (timed) {
+            std::cerr << std::fixed << std::setprecision(3)
+                      << "rows:       " << formula.rows() << "\n"
+                      << "seconds:    " << seconds << "\n"
+                      << std::setprecision(0)
+                      << "throughput: " << formula.rows() / seconds << " rows/s, "
+                      << columns.sourceBytes() / seconds / 1e6 << " MB/s\n";
+        }
+        if (failed > 0) {
+            std::cerr << "Warning: " << failed << " rows had domain errors and are nan\n";
+            return 1;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 2;
+    }
+}
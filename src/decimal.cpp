@@ -0,0 +1,359 @@
+#include "decimal.h"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+const DecimalMagnitude MAX_MAGNITUDE = ~DecimalMagnitude(0) >> 1;
+
+/// Powers of ten that fit in 64 bits
+const std::uint64_t POW10[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+const int MAX_POW10 = 19;
+
+const char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+/// 256-bit unsigned integer
+struct Wide {
+    DecimalMagnitude high;
+    DecimalMagnitude low;
+};
+
+DecimalMagnitude magnitude(Decimal value) {
+    return value.units() < 0 ? -static_cast<DecimalMagnitude>(value.units())
+                             : static_cast<DecimalMagnitude>(value.units());
+}
+
+Wide multiplyWide(DecimalMagnitude a, DecimalMagnitude b) {
+    const DecimalMagnitude mask = ~std::uint64_t(0);
+    DecimalMagnitude lowLow = (a & mask) * (b & mask);
+    DecimalMagnitude lowHigh = (a & mask) * (b >> 64);
+    DecimalMagnitude highLow = (a >> 64) * (b & mask);
+    DecimalMagnitude highHigh = (a >> 64) * (b >> 64);
+    DecimalMagnitude middle = (lowLow >> 64) + (lowHigh & mask) + (highLow & mask);
+    Wide product;
+    product.low = (middle << 64) | (lowLow & mask);
+    product.high = highHigh + (lowHigh >> 64) + (highLow >> 64) + (middle >> 64);
+    return product;
+}
+
+int leadingZeros(DecimalMagnitude value) {
+    std::uint64_t high = static_cast<std::uint64_t>(value >> 64);
+    return high != 0 ? __builtin_clzll(high) : 64 + __builtin_clzll(static_cast<std::uint64_t>(value));
+}
+
+/**
+ * @brief Divide a 256-bit number by a divisor of at most 2^127 - 1
+ *
+ * Long division in the largest digits that keep the running remainder
+ * shifted by one digit within 128 bits: two 128-bit divisions for a
+ * 64-bit divisor, more as the divisor grows.
+ *
+ * @return false if the quotient exceeds 2^127 - 1
+ */
+bool divideWide(Wide n, DecimalMagnitude divisor, DecimalMagnitude& quotient, DecimalMagnitude& remainder) {
+    if (n.high >= divisor) {
+        return false;
+    }
+    const int room = leadingZeros(divisor);
+    DecimalMagnitude rest = n.high;
+    quotient = 0;
+    for (int bits = 128; bits > 0;) {
+        int step = room < bits ? room : bits;
+        bits -= step;
+        DecimalMagnitude mask = (DecimalMagnitude(1) << step) - 1;
+        rest = (rest << step) | ((n.low >> bits) & mask);
+        DecimalMagnitude digit = rest / divisor;
+        rest -= digit * divisor;
+        quotient = (quotient << step) | digit;
+    }
+    remainder = rest;
+    return quotient <= MAX_MAGNITUDE;
+}
+
+/**
+ * @brief Divide a two-limb number by a normalized divisor
+ *
+ * Möller and Granlund, "Improved division by invariant integers",
+ * algorithm 4: two multiplications and a rarely taken correction instead
+ * of a hardware division.
+ *
+ * @param high Upper limb, less than divisor
+ * @param low Lower limb
+ * @param divisor Divisor with its top bit set
+ * @param inverse floor((2^128 - 1) / divisor) - 2^64
+ * @param[out] remainder Remainder
+ * @return Quotient
+ */
+std::uint64_t divide2By1(std::uint64_t high, std::uint64_t low, std::uint64_t divisor, std::uint64_t inverse,
+                         std::uint64_t& remainder) {
+    DecimalMagnitude estimate = DecimalMagnitude(inverse) * high + ((DecimalMagnitude(high) << 64) | low);
+    std::uint64_t quotient = static_cast<std::uint64_t>(estimate >> 64) + 1;
+    std::uint64_t rest = low - quotient * divisor;
+    if (rest > static_cast<std::uint64_t>(estimate)) {
+        --quotient;
+        rest += divisor;
+    }
+    if (rest >= divisor) {
+        ++quotient;
+        rest -= divisor;
+    }
+    remainder = rest;
+    return quotient;
+}
+
+/// Sign of remainder - divisor / 2
+int compareToHalf(DecimalMagnitude remainder, DecimalMagnitude divisor) {
+    DecimalMagnitude rest = divisor - remainder;
+    return remainder < rest ? -1 : (remainder > rest ? 1 : 0);
+}
+
+/**
+ * @brief Write the decimal digits of value right to left
+ * @param value Number to write
+ * @param end One past the last digit
+ * @param width Minimum number of digits, padded with zeros
+ * @return Pointer to the first digit
+ */
+char* writeDigits(std::uint64_t value, char* end, int width) {
+    char* first = end;
+    while (value >= 100) {
+        std::uint64_t pair = value % 100;
+        value /= 100;
+        first -= 2;
+        std::memcpy(first, DIGIT_PAIRS + 2 * pair, 2);
+    }
+    if (value >= 10) {
+        first -= 2;
+        std::memcpy(first, DIGIT_PAIRS + 2 * value, 2);
+    } else {
+        *--first = static_cast<char>('0' + value);
+    }
+    while (end - first < width) {
+        *--first = '0';
+    }
+    return first;
+}
+
+} // namespace
+
+const int DecimalContext::MAX_SCALE;
+const int DecimalContext::DEFAULT_SCALE;
+constexpr DecimalUnits DecimalContext::MIN_UNITS;
+
+DecimalContext::DecimalContext(int scale, RoundingMode rounding)
+    : digits(scale)
+    , mode(rounding)
+    , unit(1)
+    , unitNormalized(0)
+    , unitInverse(0)
+    , unitShift(0)
+    , unitValue(1) {
+    if (scale < 0 || scale > MAX_SCALE) {
+        throw std::invalid_argument("Decimal scale must be between 0 and " + std::to_string(MAX_SCALE));
+    }
+    unit = POW10[scale];
+    unitValue = static_cast<double>(unit);
+    unitShift = __builtin_clzll(unit);
+    unitNormalized = unit << unitShift;
+    unitInverse = static_cast<std::uint64_t>(~DecimalMagnitude(0) / unitNormalized);
+}
+
+std::uint64_t DecimalContext::divideByUnit(std::uint64_t* limbs, int count) const {
+    // Divide limbs * 2^unitShift by unitNormalized; the quotient is the
+    // same and the remainder is scaled by 2^unitShift. unit < 2^60, so
+    // the shift is never 0.
+    const int shift = unitShift;
+    std::uint64_t remainder = limbs[0] >> (64 - shift);
+    for (int i = 0; i < count; ++i) {
+        std::uint64_t next = i + 1 < count ? limbs[i + 1] >> (64 - shift) : 0;
+        limbs[i] = divide2By1(remainder, (limbs[i] << shift) | next, unitNormalized, unitInverse, remainder);
+    }
+    return remainder >> shift;
+}
+
+inline DecimalResult DecimalContext::roundToUnits(bool negative, DecimalMagnitude quotient, int half, bool inexact) const {
+    bool away = false;
+    switch (mode) {
+        case RoundingMode::HalfEven: away = half > 0 || (half == 0 && (quotient & 1) != 0); break;
+        case RoundingMode::HalfUp: away = half >= 0; break;
+        case RoundingMode::TowardZero: away = false; break;
+        case RoundingMode::Floor: away = negative && inexact; break;
+        case RoundingMode::Ceiling: away = !negative && inexact; break;
+    }
+    if (away) {
+        ++quotient;
+    }
+    if (quotient > MAX_MAGNITUDE) {
+        return DecimalResult::failure(CalcStatus::Overflow);
+    }
+    DecimalUnits units = static_cast<DecimalUnits>(quotient);
+    return DecimalResult::success(Decimal::fromUnits(negative ? -units : units));
+}
+
+DecimalResult DecimalContext::multiply(Decimal a, Decimal b) const {
+    bool negative = (a.units() < 0) != (b.units() < 0);
+    DecimalMagnitude product;
+    std::uint64_t limbs[4];
+    int count;
+    if (!__builtin_mul_overflow(magnitude(a), magnitude(b), &product)) {
+        if (unit == 1) {
+            return roundToUnits(negative, product, -1, false);
+        }
+        if ((product >> 64) == 0) {
+            // For a single limb, one hardware division is the faster option
+            std::uint64_t low = static_cast<std::uint64_t>(product);
+            std::uint64_t quotient = low / unit;
+            std::uint64_t remainder = low - quotient * unit;
+            return roundToUnits(negative, quotient, compareToHalf(remainder, unit), remainder != 0);
+        }
+        limbs[0] = static_cast<std::uint64_t>(product >> 64);
+        limbs[1] = static_cast<std::uint64_t>(product);
+        count = 2;
+    } else {
+        Wide wide = multiplyWide(magnitude(a), magnitude(b));
+        limbs[0] = static_cast<std::uint64_t>(wide.high >> 64);
+        limbs[1] = static_cast<std::uint64_t>(wide.high);
+        limbs[2] = static_cast<std::uint64_t>(wide.low >> 64);
+        limbs[3] = static_cast<std::uint64_t>(wide.low);
+        count = 4;
+    }
+    std::uint64_t remainder = divideByUnit(limbs, count);
+    for (int i = 0; i + 2 < count; ++i) {
+        if (limbs[i] != 0) {
+            return DecimalResult::failure(CalcStatus::Overflow);
+        }
+    }
+    DecimalMagnitude quotient = (DecimalMagnitude(limbs[count - 2]) << 64) | limbs[count - 1];
+    return roundToUnits(negative, quotient, compareToHalf(remainder, unit), remainder != 0);
+}
+
+DecimalResult DecimalContext::divide(Decimal a, Decimal b) const {
+    if (b.units() == 0) {
+        return DecimalResult::failure(CalcStatus::DivisionByZero);
+    }
+    bool negative = (a.units() < 0) != (b.units() < 0);
+    DecimalMagnitude divisor = magnitude(b);
+    DecimalMagnitude dividend;
+    DecimalMagnitude quotient;
+    DecimalMagnitude remainder;
+    if (!__builtin_mul_overflow(magnitude(a), DecimalMagnitude(unit), &dividend)) {
+        if ((dividend >> 64) == 0 && (divisor >> 64) == 0) {
+            quotient = static_cast<std::uint64_t>(dividend) / static_cast<std::uint64_t>(divisor);
+        } else {
+            quotient = dividend / divisor;
+        }
+        remainder = dividend - quotient * divisor;
+    } else if (!divideWide(multiplyWide(magnitude(a), unit), divisor, quotient, remainder)) {
+        return DecimalResult::failure(CalcStatus::Overflow);
+    }
+    return roundToUnits(negative, quotient, compareToHalf(remainder, divisor), remainder != 0);
+}
+
+DecimalResult DecimalContext::fromDouble(double value) const {
+    if (!std::isfinite(value)) {
+        return DecimalResult::failure(CalcStatus::Overflow);
+    }
+    if (value == 0) {
+        return DecimalResult::success(Decimal());
+    }
+    // value = significand * 2^exponent exactly, with a 53-bit significand
+    int exponent;
+    double fraction = std::frexp(std::fabs(value), &exponent);
+    std::uint64_t significand = static_cast<std::uint64_t>(std::ldexp(fraction, 53));
+    exponent -= 53;
+
+    bool negative = std::signbit(value);
+    DecimalMagnitude scaled = static_cast<DecimalMagnitude>(significand) * unit;  // below 2^113
+    if (exponent >= 0) {
+        if (exponent > 127 || (scaled >> (127 - exponent)) != 0) {
+            return DecimalResult::failure(CalcStatus::Overflow);
+        }
+        return roundToUnits(negative, scaled << exponent, -1, false);
+    }
+    int shift = -exponent;
+    if (shift > 127) {
+        return roundToUnits(negative, 0, -1, true);
+    }
+    DecimalMagnitude remainder = scaled & ((DecimalMagnitude(1) << shift) - 1);
+    return roundToUnits(negative, scaled >> shift,
+                        compareToHalf(remainder, DecimalMagnitude(1) << shift), remainder != 0);
+}
+
+DecimalResult DecimalContext::fromDecimal(bool negative, std::uint64_t significand, int exponent,
+                                          bool truncated) const {
+    if (significand == 0) {
+        return DecimalResult::success(Decimal());
+    }
+    long shift = static_cast<long>(exponent) + digits;
+    if (shift >= 0) {
+        // Digits NumberInput dropped past its MAX_DIGITS would belong to
+        // the units kept, or decide their rounding
+        if (truncated) {
+            return DecimalResult::failure(CalcStatus::TooManyDigits);
+        }
+        DecimalMagnitude units = significand;
+        while (shift > 0) {
+            int step = shift < MAX_POW10 ? static_cast<int>(shift) : MAX_POW10;
+            if (__builtin_mul_overflow(units, DecimalMagnitude(POW10[step]), &units)) {
+                return DecimalResult::failure(CalcStatus::Overflow);
+            }
+            shift -= step;
+        }
+        return roundToUnits(negative, units, -1, false);
+    }
+    if (-shift > MAX_POW10) {
+        // significand < 10^19, less than half of the divisor
+        return roundToUnits(negative, 0, -1, true);
+    }
+    std::uint64_t divisor = POW10[-shift];
+    std::uint64_t remainder = significand % divisor;
+    int half = compareToHalf(remainder, divisor);
+    if (half == 0 && truncated) {
+        half = 1;
+    }
+    return roundToUnits(negative, significand / divisor, half, remainder != 0 || truncated);
+}
+
+double DecimalContext::wideToDouble(Decimal value) const {
+    long double result = static_cast<long double>(magnitude(value)) / static_cast<long double>(unit);
+    return static_cast<double>(value.units() < 0 ? -result : result);
+}
+
+std::size_t DecimalContext::format(Decimal value, char* buffer) const {
+    // At most 39 digits, produced right to left
+    char digitBuffer[40];
+    char* end = digitBuffer + sizeof(digitBuffer);
+    char* first = end;
+    DecimalMagnitude units = magnitude(value);
+    if ((units >> 64) != 0) {
+        DecimalMagnitude upper = units / POW10[MAX_POW10];
+        first = writeDigits(static_cast<std::uint64_t>(units - upper * POW10[MAX_POW10]), first, MAX_POW10);
+        units = upper;
+    }
+    first = writeDigits(static_cast<std::uint64_t>(units), first, digits + 1 - static_cast<int>(end - first));
+
+    char* out = buffer;
+    if (value.units() < 0) {
+        *out++ = '-';
+    }
+    std::size_t integerDigits = static_cast<std::size_t>(end - first) - static_cast<std::size_t>(digits);
+    std::memcpy(out, first, integerDigits);
+    out += integerDigits;
+    if (digits > 0) {
+        *out++ = '.';
+        std::memcpy(out, first + integerDigits, static_cast<std::size_t>(digits));
+        out += digits;
+    }
+    *out = '\0';
+    return static_cast<std::size_t>(out - buffer);
+}
@@ -0,0 +1,242 @@
+/**
+ * @file decimal.h
+ * @brief Fixed-point decimal numbers held as scaled 128-bit integers
+ */
+
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include "calc_result.h"
+#include <cstddef>
+#include <cstdint>
+
+__extension__ typedef __int128 DecimalUnits;           ///< Signed 128-bit integer
+__extension__ typedef unsigned __int128 DecimalMagnitude; ///< Unsigned 128-bit integer
+
+/// Size of a buffer large enough for any formatted Decimal
+const std::size_t DECIMAL_BUFFER_SIZE = 48;
+
+/**
+ * @enum RoundingMode
+ * @brief How results with more fractional digits than the scale are rounded
+ */
+enum class RoundingMode : unsigned char {
+    HalfEven,    ///< To nearest, ties to the even last digit (banker's rounding)
+    HalfUp,      ///< To nearest, ties away from zero
+    TowardZero,  ///< Truncate
+    Floor,       ///< Toward negative infinity
+    Ceiling      ///< Toward positive infinity
+};
+
+/**
+ * @class Decimal
+ * @brief Fixed-point number: an integer count of units of 10^-scale
+ *
+ * A Decimal carries no scale of its own; the DecimalContext that made it
+ * gives its meaning, so 150 units are 1.50 at scale 2. Magnitudes are
+ * limited to 2^127 - 1 units, which keeps negation exact.
+ */
+class Decimal {
+public:
+    constexpr Decimal() : value(0) {}
+
+    /**
+     * @brief Wrap a raw unit count
+     * @param units Value in units of 10^-scale
+     */
+    static constexpr Decimal fromUnits(DecimalUnits units) { return Decimal(units); }
+
+    /** @brief Get the raw unit count */
+    constexpr DecimalUnits units() const { return value; }
+
+    constexpr bool operator==(Decimal other) const { return value == other.value; }
+    constexpr bool operator!=(Decimal other) const { return value != other.value; }
+    constexpr bool operator<(Decimal other) const { return value < other.value; }
+
+private:
+    explicit constexpr Decimal(DecimalUnits units) : value(units) {}
+
+    DecimalUnits value;  ///< Units of 10^-scale
+};
+
+/**
+ * @struct DecimalResult
+ * @brief Decimal value of an operation together with its status
+ */
+struct DecimalResult {
+    CalcStatus status;  ///< Ok unless the operation failed
+    Decimal value;      ///< Result, 0 when the operation failed
+
+    constexpr bool ok() const { return status == CalcStatus::Ok; }
+
+    static constexpr DecimalResult success(Decimal value) {
+        return DecimalResult{CalcStatus::Ok, value};
+    }
+
+    static constexpr DecimalResult failure(CalcStatus status) {
+        return DecimalResult{status, Decimal()};
+    }
+};
+
+/**
+ * @class DecimalContext
+ * @brief Scale, rounding mode and overflow-checked arithmetic for Decimals
+ *
+ * Addition and subtraction are exact. Multiplication, division and the
+ * conversions compute the exact result and round it once to the scale,
+ * so results are identical on every platform. Results beyond 2^127 - 1
+ * units fail with CalcStatus::Overflow instead of wrapping.
+ *
+ * Addition and subtraction compile to a few inline instructions.
+ * Products are divided by 10^scale with a precomputed inverse rather than
+ * hardware division where that is faster; a product or dividend beyond
+ * 128 bits takes a slower 256-bit path.
+ */
+class DecimalContext {
+public:
+    /// Largest supported scale; 10^MAX_SCALE units still fit in 64 bits
+    static const int MAX_SCALE = 18;
+
+    /// Scale used when none is given
+    static const int DEFAULT_SCALE = 2;
+
+    /**
+     * @brief Construct a context
+     * @param scale Digits after the decimal point, 0 to MAX_SCALE
+     * @param rounding Rounding applied to inexact results
+     * @throw std::invalid_argument if scale is out of range
+     */
+    explicit DecimalContext(int scale = DEFAULT_SCALE, RoundingMode rounding = RoundingMode::HalfEven);
+
+    /** @brief Get the number of digits after the decimal point */
+    int scale() const { return digits; }
+
+    /** @brief Get the rounding mode */
+    RoundingMode rounding() const { return mode; }
+
+    /** @brief Get the number of units in 1 (10^scale) */
+    std::uint64_t one() const { return unit; }
+
+    // Arithmetic
+    DecimalResult add(Decimal a, Decimal b) const {
+        DecimalUnits sum;
+        if (__builtin_add_overflow(a.units(), b.units(), &sum) || sum == MIN_UNITS) {
+            return DecimalResult::failure(CalcStatus::Overflow);
+        }
+        return DecimalResult::success(Decimal::fromUnits(sum));
+    }
+
+    DecimalResult subtract(Decimal a, Decimal b) const {
+        DecimalUnits difference;
+        if (__builtin_sub_overflow(a.units(), b.units(), &difference) || difference == MIN_UNITS) {
+            return DecimalResult::failure(CalcStatus::Overflow);
+        }
+        return DecimalResult::success(Decimal::fromUnits(difference));
+    }
+
+    /**
+     * @brief Multiply, rounding the product to the scale
+     * @return a * b, or Overflow
+     */
+    DecimalResult multiply(Decimal a, Decimal b) const;
+
+    /**
+     * @brief Divide, rounding the quotient to the scale
+     * @return a / b, DivisionByZero if b is 0, or Overflow
+     */
+    DecimalResult divide(Decimal a, Decimal b) const;
+
+    // Conversions
+    /**
+     * @brief Round a double to the scale
+     * @param value Number to convert
+     * @return Exactly rounded value, or Overflow for NaN, infinities and
+     *         values out of range
+     */
+    DecimalResult fromDouble(double value) const;
+
+    /**
+     * @brief Round a decimal significand and exponent to the scale
+     *
+     * Takes the parts NumberInput accumulates, so keyed-in numbers reach
+     * the decimal mode without passing through binary floating point.
+     *
+     * @param negative Sign of the number
+     * @param significand Decimal digits
+     * @param exponent Power of ten applied to significand
+     * @param truncated true if non-zero digits followed the significand
+     * @return Rounded value, Overflow if out of range, or TooManyDigits
+     *         if truncated digits were not all below the scale
+     */
+    DecimalResult fromDecimal(bool negative, std::uint64_t significand, int exponent, bool truncated) const;
+
+    /**
+     * @brief Convert to the nearest double
+     *
+     * Correctly rounded up to 2^53 units; larger values go through long
+     * double and can be one ulp off when within 2^-64 relative of a
+     * halfway point.
+     *
+     * @param value Number to convert
+     * @return Nearest double
+     */
+    double toDouble(Decimal value) const {
+        const DecimalUnits exact = DecimalUnits(1) << 53;
+        if (value.units() > -exact && value.units() < exact) {
+            // Both operands are exact, so one IEEE division rounds correctly
+            return static_cast<double>(static_cast<std::int64_t>(value.units())) / unitValue;
+        }
+        return wideToDouble(value);
+    }
+
+    /**
+     * @brief Format with exactly scale() digits after the decimal point
+     *
+     * Writes text such as "-1234.50" without allocating.
+     *
+     * @param value Number to format
+     * @param buffer Output buffer of at least DECIMAL_BUFFER_SIZE bytes
+     * @return Number of characters written (the text is also NUL-terminated)
+     */
+    std::size_t format(Decimal value, char* buffer) const;
+
+private:
+    /// Excluded so that every magnitude is a valid DecimalUnits
+    static constexpr DecimalUnits MIN_UNITS = -static_cast<DecimalUnits>(~DecimalMagnitude(0) >> 1) - 1;
+
+    /**
+     * @brief Round a truncated magnitude and apply the sign
+     * @param negative Sign of the result
+     * @param quotient Magnitude with the fraction discarded
+     * @param half Sign of (discarded fraction - 1/2)
+     * @param inexact true if the discarded fraction is non-zero
+     * @return Rounded value, or Overflow if it exceeds 2^127 - 1 units
+     */
+    DecimalResult roundToUnits(bool negative, DecimalMagnitude quotient, int half, bool inexact) const;
+
+    /**
+     * @brief toDouble() for magnitudes of 2^53 units and more
+     */
+    double wideToDouble(Decimal value) const;
+
+    /**
+     * @brief Divide a multi-limb number by 10^scale in place
+     *
+     * Uses a precomputed inverse instead of hardware division.
+     *
+     * @param limbs 64-bit limbs, most significant first; receives the quotient
+     * @param count Number of limbs
+     * @return Remainder
+     */
+    std::uint64_t divideByUnit(std::uint64_t* limbs, int count) const;
+
+    int digits;                   ///< Digits after the decimal point
+    RoundingMode mode;            ///< Rounding applied to inexact results
+    std::uint64_t unit;           ///< 10^digits
+    std::uint64_t unitNormalized; ///< unit shifted left until its top bit is set
+    std::uint64_t unitInverse;    ///< floor((2^128 - 1) / unitNormalized) - 2^64
+    int unitShift;                ///< Shift applied to unitNormalized
+    double unitValue;             ///< 10^digits as an exact double
+};
+
+#endif // DECIMAL_H
@@ -0,0 +1,271 @@
+#include "expression.h"
+#include "calculator.h"
+#include "expression_parser.h"
+#include "fast_math.h"
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <tuple>
+
+const std::size_t CompiledExpr::MAX_REGISTERS;
+
+/**
+ * @class ExpressionCompiler
+ * @brief ExpressionParser builder that emits deduplicated, folded bytecode
+ *
+ * Values are tracked as tagged operands (variable, constant or the
+ * result of an earlier node). Nodes are hash-consed on (op, operands),
+ * which gives common-subexpression elimination for free; registers are
+ * assigned afterwards so that temporaries are reused once dead.
+ */
+class ExpressionCompiler {
+public:
+    typedef CompiledExpr::Opcode Opcode;
+
+    enum class Kind : std::uint8_t { None, Variable, Constant, Node };
+
+    struct Value {
+        Kind kind;
+        std::uint32_t index;
+    };
+
+    Value constant(double value) {
+        std::uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        auto found = constantIndex.find(bits);
+        if (found != constantIndex.end()) {
+            return makeValue(Kind::Constant, found->second);
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(constants.size());
+        constants.push_back(value);
+        constantIndex[bits] = index;
+        return makeValue(Kind::Constant, index);
+    }
+
+    Value variable(const char* name, std::size_t length) {
+        for (std::size_t i = 0; i < variableNames.size(); ++i) {
+            if (variableNames[i].compare(0, std::string::npos, name, length) == 0) {
+                return makeValue(Kind::Variable, static_cast<std::uint32_t>(i));
+            }
+        }
+        variableNames.push_back(std::string(name, length));
+        return makeValue(Kind::Variable, static_cast<std::uint32_t>(variableNames.size() - 1));
+    }
+
+    Value emit(Opcode op, Value lhs) {
+        return emit(op, lhs, makeValue(Kind::None, 0));
+    }
+
+    Value emit(Opcode op, Value lhs, Value rhs) {
+        bool unary = rhs.kind == Kind::None;
+        if (lhs.kind == Kind::Constant && (unary || rhs.kind == Kind::Constant)) {
+            CalcResult folded = CompiledExpr::tryApply(op, constants[lhs.index],
+                                                       unary ? 0.0 : constants[rhs.index]);
+            // Errors are left to evaluate() so they surface at run time
+            if (folded.ok()) {
+                return constant(folded.value);
+            }
+        }
+        if ((op == Opcode::Add || op == Opcode::Multiply)
+            && std::make_tuple(rhs.kind, rhs.index) < std::make_tuple(lhs.kind, lhs.index)) {
+            std::swap(lhs, rhs);
+        }
+        NodeKey key(op, lhs.kind, lhs.index, rhs.kind, rhs.index);
+        auto found = nodeIndex.find(key);
+        if (found != nodeIndex.end()) {
+            return makeValue(Kind::Node, found->second);
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(nodes.size());
+        Node node = {op, lhs, rhs};
+        nodes.push_back(node);
+        nodeIndex[key] = index;
+        return makeValue(Kind::Node, index);
+    }
+
+    /**
+     * @brief Assign registers and produce the finished program
+     * @param result Value of the whole expression
+     * @return Compiled expression
+     */
+    CompiledExpr finish(Value result) {
+        CompiledExpr expr;
+        expr.variableNames = variableNames;
+        expr.constants = constants;
+
+        const std::size_t fixed = variableNames.size() + constants.size();
+        const std::uint32_t live = static_cast<std::uint32_t>(nodes.size());
+
+        // Last instruction reading each node; the result stays live to the end
+        std::vector<std::uint32_t> lastUse(nodes.size(), 0);
+        for (std::uint32_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].lhs.kind == Kind::Node) lastUse[nodes[i].lhs.index] = i;
+            if (nodes[i].rhs.kind == Kind::Node) lastUse[nodes[i].rhs.index] = i;
+        }
+        if (result.kind == Kind::Node) {
+            lastUse[result.index] = live;
+        }
+
+        std::vector<std::uint32_t> nodeRegister(nodes.size(), 0);
+        std::vector<std::uint32_t> freeRegisters;
+        std::size_t registerCount = fixed;
+        auto slot = [&](Value operand) -> std::uint32_t {
+            switch (operand.kind) {
+                case Kind::Variable: return operand.index;
+                case Kind::Constant: return static_cast<std::uint32_t>(variableNames.size()) + operand.index;
+                case Kind::Node: return nodeRegister[operand.index];
+                case Kind::None: break;
+            }
+            return 0;
+        };
+
+        for (std::uint32_t i = 0; i < nodes.size(); ++i) {
+            const Node& node = nodes[i];
+            std::uint32_t lhs = slot(node.lhs);
+            std::uint32_t rhs = node.rhs.kind == Kind::None ? lhs : slot(node.rhs);
+            if (node.lhs.kind == Kind::Node && lastUse[node.lhs.index] == i) {
+                freeRegisters.push_back(lhs);
+            }
+            if (node.rhs.kind == Kind::Node && lastUse[node.rhs.index] == i && rhs != lhs) {
+                freeRegisters.push_back(rhs);
+            }
+            std::uint32_t dst;
+            if (!freeRegisters.empty()) {
+                dst = freeRegisters.back();
+                freeRegisters.pop_back();
+            } else {
+                dst = static_cast<std::uint32_t>(registerCount++);
+            }
+            nodeRegister[i] = dst;
+            CompiledExpr::Instruction instruction = {
+                node.op, static_cast<std::uint16_t>(dst),
+                static_cast<std::uint16_t>(lhs), static_cast<std::uint16_t>(rhs)
+            };
+            expr.code.push_back(instruction);
+            if (registerCount > CompiledExpr::MAX_REGISTERS) {
+                throw std::length_error("Expression needs too many registers");
+            }
+        }
+        if (fixed > CompiledExpr::MAX_REGISTERS) {
+            throw std::length_error("Expression needs too many registers");
+        }
+        expr.registers = registerCount;
+        expr.resultRegister = static_cast<std::uint16_t>(slot(result));
+        return expr;
+    }
+
+private:
+    struct Node {
+        Opcode op;
+        Value lhs;
+        Value rhs;
+    };
+
+    typedef std::tuple<Opcode, Kind, std::uint32_t, Kind, std::uint32_t> NodeKey;
+
+    std::vector<std::string> variableNames;
+    std::vector<double> constants;
+    std::map<std::uint64_t, std::uint32_t> constantIndex;
+    std::vector<Node> nodes;
+    std::map<NodeKey, std::uint32_t> nodeIndex;
+
+    static Value makeValue(Kind kind, std::uint32_t index) {
+        Value value = {kind, index};
+        return value;
+    }
+};
+
+CompiledExpr::CompiledExpr()
+    : registers(0)
+    , resultRegister(0) {
+}
+
+CompiledExpr CompiledExpr::compile(const std::string& source, bool useRadians) {
+    ExpressionCompiler compiler;
+    ExpressionParser<ExpressionCompiler> parser(source.data(), source.size(), compiler, useRadians);
+    return compiler.finish(parser.parse());
+}
+
+CalcResult CompiledExpr::tryApply(Opcode op, double lhs, double rhs) {
+    switch (op) {
+        case Opcode::Add: return CalcResult::success(lhs + rhs);
+        case Opcode::Subtract: return CalcResult::success(lhs - rhs);
+        case Opcode::Multiply: return CalcResult::success(lhs * rhs);
+        case Opcode::Divide:
+            if (rhs == 0) {
+                return CalcResult::failure(CalcStatus::DivisionByZero);
+            }
+            return CalcResult::success(lhs / rhs);
+        case Opcode::Power: return CalcResult::success(std::pow(lhs, rhs));
+        case Opcode::Negate: return CalcResult::success(-lhs);
+        case Opcode::Sqrt:
+            if (lhs < 0) {
+                return CalcResult::failure(CalcStatus::NegativeSqrt);
+            }
+            return CalcResult::success(std::sqrt(lhs));
+        case Opcode::Ln:
+            if (lhs <= 0) {
+                return CalcResult::failure(CalcStatus::NonPositiveLog);
+            }
+            return CalcResult::success(std::log(lhs));
+        case Opcode::Sin: return CalcResult::success(std::sin(lhs));
+        case Opcode::Cos: return CalcResult::success(std::cos(lhs));
+        case Opcode::Tan: return CalcResult::success(std::tan(lhs));
+        case Opcode::SinDegrees: return CalcResult::success(fastSinDegrees(lhs, MathPrecision::Exact));
+        case Opcode::CosDegrees: return CalcResult::success(fastCosDegrees(lhs, MathPrecision::Exact));
+        case Opcode::TanDegrees: return CalcResult::success(fastTanDegrees(lhs, MathPrecision::Exact));
+    }
+    return CalcResult::success(0);
+}
+
+double CompiledExpr::apply(Opcode op, double lhs, double rhs) {
+    CalcResult result = tryApply(op, lhs, rhs);
+    if (!result.ok()) {
+        throw std::domain_error(calcStatusMessage(result.status));
+    }
+    return result.value;
+}
+
+CalcResult CompiledExpr::tryEvaluate(const double* values) const {
+    double reg[MAX_REGISTERS];
+    const std::size_t variableCount = variableNames.size();
+    for (std::size_t i = 0; i < variableCount; ++i) {
+        reg[i] = values[i];
+    }
+    for (std::size_t i = 0; i < constants.size(); ++i) {
+        reg[variableCount + i] = constants[i];
+    }
+    for (const Instruction& instruction : code) {
+        CalcResult result = tryApply(instruction.op, reg[instruction.lhs], reg[instruction.rhs]);
+        if (!result.ok()) {
+            return result;
+        }
+        reg[instruction.dst] = result.value;
+    }
+    return CalcResult::success(reg[resultRegister]);
+}
+
+double CompiledExpr::evaluate(const double* values) const {
+    CalcResult result = tryEvaluate(values);
+    if (!result.ok()) {
+        throw std::domain_error(calcStatusMessage(result.status));
+    }
+    return result.value;
+}
+
+double CompiledExpr::evaluate(std::initializer_list<double> values) const {
+    if (values.size() != variableNames.size()) {
+        throw std::invalid_argument("Expected " + std::to_string(variableNames.size())
+                                    + " variable values");
+    }
+    return evaluate(values.begin());
+}
+
+int CompiledExpr::variableIndex(const std::string& name) const {
+    for (std::size_t i = 0; i < variableNames.size(); ++i) {
+        if (variableNames[i] == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
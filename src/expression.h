@@ -0,0 +1,177 @@
+/**
+ * @file expression.h
+ * @brief Expressions compiled once into register bytecode
+ */
+
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "calc_result.h"
+
+/**
+ * @class CompiledExpr
+ * @brief Reusable compiled form of an expression such as "sin(x)^2 + ln(y)/3"
+ *
+ * The source is parsed once into straight-line bytecode over a small
+ * register file. Constant subexpressions are folded and repeated
+ * subexpressions are computed once. Evaluation runs a single loop over
+ * the instructions with registers on the stack, so it never allocates
+ * and may be called concurrently from several threads.
+ *
+ * Supported syntax: numbers (with optional exponent), variables,
+ * the constant pi, + - * / ^ (right-associative), unary minus,
+ * parentheses, and the functions sqrt, ln, sin, cos and tan. Operations
+ * follow Calculator semantics, including domain errors and the angle
+ * unit in effect when the expression was compiled.
+ */
+class CompiledExpr {
+public:
+    /// Maximum number of registers an expression may need
+    static const std::size_t MAX_REGISTERS = 1024;
+
+    /**
+     * @brief Compile an expression
+     * @param source Expression text
+     * @param useRadians true if trigonometric arguments are in radians
+     * @return Compiled expression
+     * @throw std::invalid_argument if the text is not a valid expression
+     * @throw std::length_error if the expression needs more than MAX_REGISTERS
+     */
+    static CompiledExpr compile(const std::string& source, bool useRadians = true);
+
+    /**
+     * @brief Evaluate with variable values given in variables() order
+     * @param values Array of variableCount() values (may be null if none)
+     * @return Value of the expression
+     * @throw std::domain_error for division by zero, sqrt of a negative
+     *        number or ln of a non-positive number
+     */
+    double evaluate(const double* values = nullptr) const;
+
+    /**
+     * @brief Evaluate without throwing
+     * @param values Array of variableCount() values (may be null if none)
+     * @return Value of the expression, or the status of the first
+     *         operation that failed
+     */
+    CalcResult tryEvaluate(const double* values = nullptr) const;
+
+    /**
+     * @brief Evaluate with variable values given in variables() order
+     * @param values Variable values
+     * @return Value of the expression
+     * @throw std::invalid_argument if the number of values is wrong
+     * @throw std::domain_error as for evaluate(const double*)
+     */
+    double evaluate(std::initializer_list<double> values) const;
+
+    /**
+     * @brief Get the variable names in order of first appearance
+     * @return Variable names
+     */
+    const std::vector<std::string>& variables() const { return variableNames; }
+
+    std::size_t variableCount() const { return variableNames.size(); }
+
+    /**
+     * @brief Find the position of a variable
+     * @param name Variable name
+     * @return Index into the evaluate() arguments, or -1 if not used
+     */
+    int variableIndex(const std::string& name) const;
+
+    /**
+     * @brief Get the number of bytecode instructions
+     * @return Instruction count after folding and deduplication
+     */
+    std::size_t instructionCount() const { return code.size(); }
+
+    /**
+     * @brief Get the number of registers used during evaluation
+     * @return Register count
+     */
+    std::size_t registerCount() const { return registers; }
+
+    /**
+     * @enum Opcode
+     * @brief Bytecode operations
+     */
+    enum class Opcode : std::uint8_t {
+        Add, Subtract, Multiply, Divide, Power, Negate,
+        Sqrt, Ln, Sin, Cos, Tan, SinDegrees, CosDegrees, TanDegrees
+    };
+
+    /**
+     * @struct Instruction
+     * @brief One three-address instruction: dst = lhs op rhs
+     */
+    struct Instruction {
+        Opcode op;
+        std::uint16_t dst;
+        std::uint16_t lhs;
+        std::uint16_t rhs;
+    };
+
+    /**
+     * @brief Get the bytecode, for evaluators other than evaluate()
+     *
+     * Registers are numbered [variables][constants][temporaries]: the
+     * first variableCount() hold the variables, the next
+     * constantValues().size() the constants, and instructions only
+     * write temporaries.
+     *
+     * @return Instructions in execution order
+     */
+    const std::vector<Instruction>& instructions() const { return code; }
+
+    /**
+     * @brief Get the values of the constant registers
+     * @return Constants in register order
+     */
+    const std::vector<double>& constantValues() const { return constants; }
+
+    /**
+     * @brief Get the register holding the result after the last instruction
+     * @return Register index
+     */
+    std::size_t resultIndex() const { return resultRegister; }
+
+    /**
+     * @brief Apply one operation with Calculator semantics
+     * @param op Operation
+     * @param lhs First operand
+     * @param rhs Second operand (ignored by unary operations)
+     * @return Result
+     * @throw std::domain_error for invalid operands
+     */
+    static double apply(Opcode op, double lhs, double rhs);
+
+    /**
+     * @brief Apply one operation without throwing
+     * @param op Operation
+     * @param lhs First operand
+     * @param rhs Second operand (ignored by unary operations)
+     * @return Result, or the failure status for invalid operands
+     */
+    static CalcResult tryApply(Opcode op, double lhs, double rhs);
+
+private:
+    friend class ExpressionCompiler;
+
+    CompiledExpr();
+
+    // Register file layout: [variables][constants][temporaries]
+    std::vector<std::string> variableNames; ///< Variables, in register order
+    std::vector<double> constants;          ///< Values of the constant registers
+    std::vector<Instruction> code;          ///< Straight-line program
+    std::size_t registers;                  ///< Total registers needed
+    std::uint16_t resultRegister;           ///< Register holding the result
+};
+
+#endif // EXPRESSION_H
@@ -0,0 +1,283 @@
+/**
+ * @file expression_parser.h
+ * @brief Recursive-descent expression parser shared by the evaluators
+ *
+ * Internal header; not installed.
+ */
+
+#ifndef EXPRESSION_PARSER_H
+#define EXPRESSION_PARSER_H
+
+#include <cctype>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+#include "expression.h"
+#include "number_input.h"
+
+/**
+ * @class ExpressionParser
+ * @brief Parses the CompiledExpr grammar and reports it to a builder
+ *
+ * The builder decides what a value is: the compiler builds bytecode
+ * nodes, the batch evaluator computes numbers immediately. Builder
+ * must provide:
+ *
+ *     typedef ... Value;
+ *     Value constant(double value);
+ *     Value variable(const char* name, std::size_t length);
+ *     Value emit(CompiledExpr::Opcode op, Value lhs);             // unary
+ *     Value emit(CompiledExpr::Opcode op, Value lhs, Value rhs);  // binary
+ *
+ * The parser itself never allocates except to build an error message.
+ * Nesting (parentheses, function calls, unary signs and exponents) is
+ * limited to MAX_DEPTH levels so that hostile input is rejected instead
+ * of overflowing the stack.
+ *
+ * @tparam Builder Receiver of parsed values and operations
+ */
+template <typename Builder>
+class ExpressionParser {
+public:
+    typedef typename Builder::Value Value;
+    typedef CompiledExpr::Opcode Opcode;
+
+    /// Deepest nesting accepted
+    static const std::size_t MAX_DEPTH = 256;
+
+    /**
+     * @brief Prepare to parse a piece of text
+     * @param text Start of the expression (need not be null-terminated)
+     * @param length Number of characters
+     * @param builder Receiver of the parsed operations
+     * @param useRadians true if trigonometric arguments are in radians
+     */
+    ExpressionParser(const char* text, std::size_t length, Builder& builder, bool useRadians)
+        : text(text)
+        , length(length)
+        , pos(0)
+        , depth(0)
+        , builder(builder)
+        , useRadians(useRadians) {
+    }
+
+    /**
+     * @brief Parse the whole text
+     * @return Value of the expression as produced by the builder
+     * @throw std::invalid_argument if the text is not a valid expression
+     */
+    Value parse() {
+        Value result = parseExpression();
+        skipSpaces();
+        if (pos != length) {
+            fail("Unexpected character");
+        }
+        return result;
+    }
+
+private:
+    const char* text;
+    std::size_t length;
+    std::size_t pos;
+    std::size_t depth;  ///< Nesting levels currently open
+    Builder& builder;
+    bool useRadians;
+
+    [[noreturn]] void fail(const char* message) const {
+        throw std::invalid_argument(std::string(message) + " at position "
+                                    + std::to_string(pos) + " in \""
+                                    + std::string(text, length) + "\"");
+    }
+
+    // Counts one nesting level for the lifetime of a recursive call
+    class DepthGuard {
+    public:
+        explicit DepthGuard(ExpressionParser& parser) : parser(parser) {
+            if (parser.depth == MAX_DEPTH) {
+                parser.fail("Expression nested too deeply");
+            }
+            ++parser.depth;
+        }
+
+        ~DepthGuard() { --parser.depth; }
+
+        DepthGuard(const DepthGuard&) = delete;
+        DepthGuard& operator=(const DepthGuard&) = delete;
+
+    private:
+        ExpressionParser& parser;
+    };
+
+    bool isDigit(std::size_t at) const {
+        return at < length && std::isdigit(static_cast<unsigned char>(text[at]));
+    }
+
+    bool isNameChar(std::size_t at) const {
+        return at < length && (std::isalnum(static_cast<unsigned char>(text[at])) || text[at] == '_');
+    }
+
+    void skipSpaces() {
+        while (pos < length && std::isspace(static_cast<unsigned char>(text[pos]))) {
+            ++pos;
+        }
+    }
+
+    bool accept(char c) {
+        skipSpaces();
+        if (pos < length && text[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    bool nameIs(std::size_t start, std::size_t end, const char* name) const {
+        std::size_t size = std::char_traits<char>::length(name);
+        return end - start == size && std::char_traits<char>::compare(text + start, name, size) == 0;
+    }
+
+    // expression := term (('+' | '-') term)*
+    Value parseExpression() {
+        Value lhs = parseTerm();
+        for (;;) {
+            if (accept('+')) {
+                lhs = builder.emit(Opcode::Add, lhs, parseTerm());
+            } else if (accept('-')) {
+                lhs = builder.emit(Opcode::Subtract, lhs, parseTerm());
+            } else {
+                return lhs;
+            }
+        }
+    }
+
+    // term := unary (('*' | '/') unary)*
+    Value parseTerm() {
+        Value lhs = parseUnary();
+        for (;;) {
+            if (accept('*')) {
+                lhs = builder.emit(Opcode::Multiply, lhs, parseUnary());
+            } else if (accept('/')) {
+                lhs = builder.emit(Opcode::Divide, lhs, parseUnary());
+            } else {
+                return lhs;
+            }
+        }
+    }
+
+    // unary := ('-' | '+') unary | power
+    // Every nested parse passes through here, so the depth is counted once
+    Value parseUnary() {
+        DepthGuard guard(*this);
+        if (accept('-')) {
+            return builder.emit(Opcode::Negate, parseUnary());
+        }
+        if (accept('+')) {
+            return parseUnary();
+        }
+        return parsePower();
+    }
+
+    // power := primary ('^' unary)?
+    Value parsePower() {
+        Value base = parsePrimary();
+        if (accept('^')) {
+            return builder.emit(Opcode::Power, base, parseUnary());
+        }
+        return base;
+    }
+
+    // primary := number | name | name '(' expression ')' | '(' expression ')'
+    Value parsePrimary() {
+        skipSpaces();
+        if (pos >= length) {
+            fail("Unexpected end of expression");
+        }
+        char c = text[pos];
+        if (accept('(')) {
+            Value inner = parseExpression();
+            if (!accept(')')) {
+                fail("Expected ')'");
+            }
+            return inner;
+        }
+        if (isDigit(pos) || c == '.') {
+            return builder.constant(parseNumber());
+        }
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            std::size_t start = pos;
+            while (isNameChar(pos)) {
+                ++pos;
+            }
+            std::size_t end = pos;
+            if (accept('(')) {
+                Opcode op = functionOpcode(start, end);
+                Value argument = parseExpression();
+                if (!accept(')')) {
+                    fail("Expected ')'");
+                }
+                return builder.emit(op, argument);
+            }
+            if (nameIs(start, end, "pi")) {
+                return builder.constant(3.14159265358979323846);
+            }
+            return builder.variable(text + start, end - start);
+        }
+        fail("Unexpected character");
+    }
+
+    double parseNumber() {
+        NumberInput input;
+        bool seenDigit = false;
+        while (pos < length) {
+            char c = text[pos];
+            if (isDigit(pos) || c == '.') {
+                seenDigit = seenDigit || c != '.';
+                if (!input.append(c)) {
+                    fail("Malformed number");
+                }
+                ++pos;
+            } else if ((c == 'e' || c == 'E') && seenDigit && exponentFollows(pos + 1)) {
+                // A second exponent is refused rather than merged into the first
+                if (!input.append(c)) {
+                    fail("Malformed number");
+                }
+                ++pos;
+                if (text[pos] == '+') {
+                    ++pos;
+                } else if (text[pos] == '-') {
+                    input.append('-');
+                    ++pos;
+                }
+            } else {
+                break;
+            }
+        }
+        if (!seenDigit) {
+            fail("Malformed number");
+        }
+        return input.value();
+    }
+
+    bool exponentFollows(std::size_t at) const {
+        if (at < length && (text[at] == '+' || text[at] == '-')) {
+            ++at;
+        }
+        return isDigit(at);
+    }
+
+    Opcode functionOpcode(std::size_t start, std::size_t end) {
+        if (nameIs(start, end, "sqrt")) return Opcode::Sqrt;
+        if (nameIs(start, end, "ln")) return Opcode::Ln;
+        if (nameIs(start, end, "sin")) return useRadians ? Opcode::Sin : Opcode::SinDegrees;
+        if (nameIs(start, end, "cos")) return useRadians ? Opcode::Cos : Opcode::CosDegrees;
+        if (nameIs(start, end, "tan")) return useRadians ? Opcode::Tan : Opcode::TanDegrees;
+        pos = start;
+        fail("Unknown function");
+    }
+};
+
+template <typename Builder>
+const std::size_t ExpressionParser<Builder>::MAX_DEPTH;
+
+#endif // EXPRESSION_PARSER_H
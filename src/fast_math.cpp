@@ -0,0 +1,536 @@
+#include "fast_math.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// pi/64 in four parts (fdlibm's split of pi/2, scaled by 1/32). The first
+// three have 33 significant bits, so n * part is exact for |n| < 2^20.
+const double PIO64_1 = 1.57079632673412561417e+00 / 32;
+const double PIO64_2 = 6.07710050630396597660e-11 / 32;
+const double PIO64_3 = 2.02226624871116645580e-21 / 32;
+const double PIO64_3T = 8.47842766036889956997e-32 / 32;
+const double INV_PIO64 = 20.371832715762604;  // 64/pi
+
+/// Largest |x| reduced by subtracting the parts of pi/64; keeps
+/// |n| = |x| * 64/pi below 2^20. Larger arguments use reduceLarge().
+const double TRIG_LIMIT = 32768.0;
+
+/// pi/64 to double precision, for the remainder of reduceLarge()
+const double PIO64 = 0.049087385212340517;
+
+/// pi/180 to double precision
+const double DEGREE = 0.017453292519943295;
+
+/// sqrt(1/2), sin and cos of 45 degrees rounded to nearest
+const double SQRT_HALF = 0.70710678118654757;
+
+/// Below 2^52 degrees, x - 90 round(x / 90) is exact; larger arguments
+/// are first reduced modulo 360 by fmod(), which is exact too
+const double DEGREES_LIMIT = 4503599627370496.0;
+
+// ln 2 in two parts; the first has 32 significant bits
+const double LN2_HI = 6.93147180369123816490e-01;
+const double LN2_LO = 1.90821492927058770002e-10;
+const double INV_LN2_64 = 92.33248261689366;  // 64 / ln 2
+
+/// Largest |x| fastExp() handles; e^x stays a normal double
+const double EXP_LIMIT = 708.0;
+
+/// Adding 1.5 * 2^52 rounds to an integer, which then sits in the low
+/// bits of the sum; subtracting it again gives the integer as a double
+const double ROUNDER = 6755399441055744.0;
+
+const std::uint64_t SMALLEST_NORMAL = 0x0010000000000000ULL;
+const std::uint64_t INFINITY_BITS = 0x7ff0000000000000ULL;
+const std::uint64_t EXPONENT_MASK = 0xfff0000000000000ULL;
+
+/// fastLn() splits x into 2^k z with z in [LN_OFFSET, 2 LN_OFFSET) and
+/// rounds z to one of 128 bucket centers; 0.748046875 puts 1 at the
+/// center of bucket 64
+const std::uint64_t LN_OFFSET = 0x3fe7f00000000000ULL;
+
+// The tables were computed to 50 digits and rounded to nearest.
+
+/// sin(j pi/64); entries at multiples of pi/2 are exact
+const double SIN_TABLE[128] = {
+    0.0, 0.049067674327418015, 0.0980171403295606, 0.14673047445536175,
+    0.19509032201612828, 0.2429801799032639, 0.2902846772544624, 0.33688985339222005,
+    0.3826834323650898, 0.4275550934302821, 0.47139673682599764, 0.5141027441932218,
+    0.5555702330196022, 0.5956993044924334, 0.6343932841636455, 0.6715589548470184,
+    0.7071067811865476, 0.7409511253549591, 0.773010453362737, 0.8032075314806449,
+    0.8314696123025452, 0.8577286100002721, 0.881921264348355, 0.9039892931234433,
+    0.9238795325112867, 0.9415440651830208, 0.9569403357322088, 0.970031253194544,
+    0.9807852804032304, 0.989176509964781, 0.9951847266721969, 0.9987954562051724,
+    1.0, 0.9987954562051724, 0.9951847266721969, 0.989176509964781,
+    0.9807852804032304, 0.970031253194544, 0.9569403357322088, 0.9415440651830208,
+    0.9238795325112867, 0.9039892931234433, 0.881921264348355, 0.8577286100002721,
+    0.8314696123025452, 0.8032075314806449, 0.773010453362737, 0.7409511253549591,
+    0.7071067811865476, 0.6715589548470184, 0.6343932841636455, 0.5956993044924334,
+    0.5555702330196022, 0.5141027441932218, 0.47139673682599764, 0.4275550934302821,
+    0.3826834323650898, 0.33688985339222005, 0.2902846772544624, 0.2429801799032639,
+    0.19509032201612828, 0.14673047445536175, 0.0980171403295606, 0.049067674327418015,
+    0.0, -0.049067674327418015, -0.0980171403295606, -0.14673047445536175,
+    -0.19509032201612828, -0.2429801799032639, -0.2902846772544624, -0.33688985339222005,
+    -0.3826834323650898, -0.4275550934302821, -0.47139673682599764, -0.5141027441932218,
+    -0.5555702330196022, -0.5956993044924334, -0.6343932841636455, -0.6715589548470184,
+    -0.7071067811865476, -0.7409511253549591, -0.773010453362737, -0.8032075314806449,
+    -0.8314696123025452, -0.8577286100002721, -0.881921264348355, -0.9039892931234433,
+    -0.9238795325112867, -0.9415440651830208, -0.9569403357322088, -0.970031253194544,
+    -0.9807852804032304, -0.989176509964781, -0.9951847266721969, -0.9987954562051724,
+    -1.0, -0.9987954562051724, -0.9951847266721969, -0.989176509964781,
+    -0.9807852804032304, -0.970031253194544, -0.9569403357322088, -0.9415440651830208,
+    -0.9238795325112867, -0.9039892931234433, -0.881921264348355, -0.8577286100002721,
+    -0.8314696123025452, -0.8032075314806449, -0.773010453362737, -0.7409511253549591,
+    -0.7071067811865476, -0.6715589548470184, -0.6343932841636455, -0.5956993044924334,
+    -0.5555702330196022, -0.5141027441932218, -0.47139673682599764, -0.4275550934302821,
+    -0.3826834323650898, -0.33688985339222005, -0.2902846772544624, -0.2429801799032639,
+    -0.19509032201612828, -0.14673047445536175, -0.0980171403295606, -0.049067674327418015
+};
+
+/// 2^(j/64)
+const double EXP2_TABLE[64] = {
+    1.0, 1.0108892860517005, 1.0218971486541166, 1.0330248790212284,
+    1.0442737824274138, 1.0556451783605572, 1.0671404006768237, 1.0787607977571199,
+    1.0905077326652577, 1.102382583307841, 1.1143867425958924, 1.1265216186082418,
+    1.1387886347566916, 1.1511892299529827, 1.1637248587775775, 1.1763969916502812,
+    1.189207115002721, 1.202156731452703, 1.215247359980469, 1.22848053610687,
+    1.241857812073484, 1.255380757024691, 1.2690509571917332, 1.2828700160787783,
+    1.2968395546510096, 1.3109612115247644, 1.3252366431597413, 1.339667524053303,
+    1.3542555469368927, 1.3690024229745905, 1.383909881963832, 1.3989796725383112,
+    1.4142135623730951, 1.42961333839197, 1.4451808069770467, 1.460917794180647,
+    1.4768261459394993, 1.4929077282912648, 1.5091644275934228, 1.5255981507445384,
+    1.5422108254079407, 1.559004400237837, 1.5759808451078865, 1.593142151342267,
+    1.6104903319492543, 1.6280274218573478, 1.645755478153965, 1.6636765803267364,
+    1.681792830507429, 1.7001063537185235, 1.718619298122478, 1.7373338352737062,
+    1.7562521603732995, 1.7753764925265212, 1.7947090750031072, 1.8142521755003989,
+    1.8340080864093424, 1.8539791250833855, 1.8741676341103, 1.8945759815869656,
+    1.9152065613971474, 1.9360617934922943, 1.9571441241754002, 1.978456026387951
+};
+
+/// 1/c for the center c of each ln bucket, rounded; exactly 1 in bucket 64
+const double LN_INVERSE[128] = {
+    1.3333333333333333, 1.3264248704663213, 1.3195876288659794, 1.3128205128205128,
+    1.3061224489795917, 1.299492385786802, 1.292929292929293, 1.2864321608040201,
+    1.28, 1.2736318407960199, 1.2673267326732673, 1.2610837438423645,
+    1.2549019607843137, 1.248780487804878, 1.2427184466019416, 1.2367149758454106,
+    1.2307692307692308, 1.2248803827751196, 1.2190476190476192, 1.2132701421800949,
+    1.2075471698113207, 1.2018779342723005, 1.1962616822429906, 1.1906976744186046,
+    1.1851851851851851, 1.1797235023041475, 1.1743119266055047, 1.1689497716894977,
+    1.1636363636363636, 1.158371040723982, 1.1531531531531531, 1.147982062780269,
+    1.1428571428571428, 1.1377777777777778, 1.1327433628318584, 1.1277533039647578,
+    1.1228070175438596, 1.1179039301310043, 1.1130434782608696, 1.1082251082251082,
+    1.103448275862069, 1.0987124463519313, 1.0940170940170941, 1.0893617021276596,
+    1.0847457627118644, 1.080168776371308, 1.0756302521008403, 1.0711297071129706,
+    1.0666666666666667, 1.062240663900415, 1.0578512396694215, 1.0534979423868314,
+    1.0491803278688525, 1.0448979591836736, 1.0406504065040652, 1.0364372469635628,
+    1.032258064516129, 1.0281124497991967, 1.024, 1.0199203187250996,
+    1.0158730158730158, 1.0118577075098814, 1.0078740157480315, 1.003921568627451,
+    1.0, 0.9922480620155039, 0.9846153846153847, 0.9770992366412213,
+    0.9696969696969697, 0.9624060150375939, 0.9552238805970149, 0.9481481481481482,
+    0.9411764705882353, 0.9343065693430657, 0.927536231884058, 0.920863309352518,
+    0.9142857142857143, 0.9078014184397163, 0.9014084507042254, 0.8951048951048951,
+    0.8888888888888888, 0.8827586206896552, 0.8767123287671232, 0.8707482993197279,
+    0.8648648648648649, 0.8590604026845637, 0.8533333333333334, 0.847682119205298,
+    0.8421052631578947, 0.8366013071895425, 0.8311688311688312, 0.8258064516129032,
+    0.8205128205128205, 0.8152866242038217, 0.810126582278481, 0.8050314465408805,
+    0.8, 0.7950310559006211, 0.7901234567901234, 0.7852760736196319,
+    0.7804878048780488, 0.7757575757575758, 0.7710843373493976, 0.7664670658682635,
+    0.7619047619047619, 0.757396449704142, 0.7529411764705882, 0.7485380116959064,
+    0.7441860465116279, 0.7398843930635838, 0.735632183908046, 0.7314285714285714,
+    0.7272727272727273, 0.7231638418079096, 0.7191011235955056, 0.7150837988826816,
+    0.7111111111111111, 0.7071823204419889, 0.7032967032967034, 0.6994535519125683,
+    0.6956521739130435, 0.6918918918918919, 0.6881720430107527, 0.6844919786096256,
+    0.6808510638297872, 0.6772486772486772, 0.6736842105263158, 0.6701570680628273
+};
+
+/// -ln(LN_INVERSE[j]); exactly 0 in bucket 64
+const double LN_CENTER[128] = {
+    -0.28768207245178085, -0.28248725557467697, -0.27731928541623435, -0.27217788591581565,
+    -0.26706278524904514, -0.2619737157415739, -0.2569104137850273, -0.2518726197550701,
+    -0.2468600779315258, -0.2418725364204867, -0.23690974707835774, -0.23197146543777517,
+    -0.22705745063534608, -0.2221674653411543, -0.2173012756899813, -0.21245865121419336,
+    -0.20763936477824455, -0.20284319251475144, -0.19806991376209387, -0.19331931100349606,
+    -0.18859116980754997, -0.18388527877013738, -0.17920142945771092, -0.17453941635189965,
+    -0.16989903679539742, -0.16528009093910292, -0.16068238169047352, -0.1561057146630616,
+    -0.15154989812720088, -0.14701474296180975, -0.142500062607283, -0.1380056730194437,
+    -0.13353139262452257, -0.12907704227514236, -0.12464244520727659, -0.12022742699815989,
+    -0.11583181552512165, -0.11145544092532278, -0.10709813555636712, -0.10275973395776894,
+    -0.09844007281325251, -0.09413899091386191, -0.08985632912186114, -0.08559193033540353,
+    -0.0813456394539524, -0.0771173033444312, -0.07290677080808773, -0.06871389254805173,
+    -0.06453852113757116, -0.06038051098890748, -0.05623971832287611, -0.0521160011390141,
+    -0.04800921918636066, -0.04391923393483558, -0.03984590854719978, -0.03578910785158529,
+    -0.03174869831458027, -0.02772454801485477, -0.023716526617316065, -0.019724505347778573,
+    -0.015748356968139112, -0.011787955752042173, -0.007843177461025879, -0.003913899321136315,
+    0.0, 0.007782140442054963, 0.015504186535965199, 0.023167059281534418,
+    0.03077165866675366, 0.03831886430213666, 0.04580953603129422, 0.05324451451881224,
+    0.060624621816434854, 0.06795066190850778, 0.07522342123758752, 0.08244366921107454,
+    0.08961215868968717, 0.09672962645855114, 0.10379679368164355, 0.11081436634029011,
+    0.11778303565638351, 0.12470347850095725, 0.13157635778871932, 0.1384023228591192,
+    0.14518200984449783, 0.151916042025842, 0.15860503017663852, 0.16524957289530717,
+    0.17185025692665928, 0.17840765747281825, 0.18492233849401193, 0.19139485299962947,
+    0.19782574332991992, 0.20421554142869083, 0.21056476910734964, 0.2168739383006143,
+    0.2231435513142097, 0.2293741010648459, 0.23556607131276697, 0.24171993688714513,
+    0.2478361639045812, 0.25391520998096345, 0.259957524436926, 0.2659635484971379,
+    0.2719337154836418, 0.2778684510034563, 0.2837681731306446, 0.2896332925830427,
+    0.2954642128938359, 0.30126133057816185, 0.3070250352949119, 0.3127557100038969,
+    0.3184537311185346, 0.324119468654212, 0.32975328637246804, 0.3353555419211378,
+    0.3409265869705932, 0.3464667673462086, 0.3519764231571781, 0.3574558889218038,
+    0.3629054936893685, 0.36832556115870757, 0.373716409793584, 0.3790783529349695,
+    0.38441169891033206, 0.38971675114002524, 0.394993808240869, 0.40024316412701266
+};
+
+/// 2/pi to 1408 bits, most significant first; enough for the largest
+/// double plus the 192 bits reduceLarge() multiplies with
+const std::uint64_t TWO_OVER_PI[22] = {
+    0xa2f9836e4e441529ULL, 0xfc2757d1f534ddc0ULL, 0xdb6295993c439041ULL,
+    0xfe5163abdebbc561ULL, 0xb7246e3a424dd2e0ULL, 0x06492eea09d1921cULL,
+    0xfe1deb1cb129a73eULL, 0xe88235f52ebb4484ULL, 0xe99c7026b45f7e41ULL,
+    0x3991d639835339f4ULL, 0x9c845f8bbdf9283bULL, 0x1ff897ffde05980fULL,
+    0xef2f118b5a0a6d1fULL, 0x6d367ecf27cb09b7ULL, 0x4f463f669e5fea2dULL,
+    0x7527bac7ebe5f17bULL, 0x3d0739f78a5292eaULL, 0x6bfb5fb11f8d5d08ULL,
+    0x56033046fc7b6babULL, 0xf0cfbc209af4361dULL, 0xa9e391615ee61b08ULL,
+    0x6599855f14a06840ULL,
+};
+
+__extension__ typedef unsigned __int128 Uint128;
+__extension__ typedef __int128 Int128;
+
+std::uint64_t bitsOf(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double fromBits(std::uint64_t bits) {
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// 64 bits of 2/pi starting at bit (0 is the first after the point);
+// bits before the point are zero
+std::uint64_t twoOverPiBits(int bit) {
+    if (bit < 0) {
+        return bit <= -64 ? 0 : TWO_OVER_PI[0] >> -bit;
+    }
+    const int word = bit >> 6;
+    const int shift = bit & 63;
+    if (shift == 0) {
+        return TWO_OVER_PI[word];
+    }
+    return (TWO_OVER_PI[word] << shift) | (TWO_OVER_PI[word + 1] >> (64 - shift));
+}
+
+// Payne-Hanek reduction of a finite |x| > TRIG_LIMIT: x = n pi/64 + r
+// with |r| <= pi/128. Returns n mod 128.
+//
+// With |x| = m 2^e, x 64/pi = m 2^(e+5) (2/pi). Bits of 2/pi before bit
+// e - 2 only add multiples of 128 and are skipped; the next 192 bits,
+// multiplied by m in integer arithmetic, give the fraction of x 64/pi /
+// 128 to 128 bits, enough for r even when x is the double closest to a
+// multiple of pi/64.
+unsigned reduceLarge(double x, double& r) {
+    const std::uint64_t bits = bitsOf(x);
+    const std::uint64_t mantissa = (bits & 0x000fffffffffffffULL) | 0x0010000000000000ULL;
+    const int exponent = static_cast<int>((bits >> 52) & 0x7ff) - 1075;
+    const int first = exponent - 2;
+
+    const Uint128 low = static_cast<Uint128>(mantissa) * twoOverPiBits(first);
+    const Uint128 middle = static_cast<Uint128>(mantissa) * twoOverPiBits(first + 64);
+    const Uint128 high = static_cast<Uint128>(mantissa) * twoOverPiBits(first + 128);
+    const Uint128 fraction = (low << 64) + middle + (high >> 64);
+
+    // n is the top 7 bits rounded; the rest, centred on 0, is r / (pi/64)
+    const Uint128 half = static_cast<Uint128>(1) << 120;
+    const Uint128 rounded = fraction + half;
+    unsigned index = static_cast<unsigned>(rounded >> 121) & 127;
+    const Int128 remainder = static_cast<Int128>(rounded & ((half << 1) - 1)) - static_cast<Int128>(half);
+    r = std::ldexp(static_cast<double>(remainder), -121) * PIO64;
+    if (x < 0) {
+        index = (128 - index) & 127;
+        r = -r;
+    }
+    return index;
+}
+
+// sin x and cos x for finite x. With x = n pi/64 + r, |r| <= pi/128, and
+// s, c the sine and cosine of n pi/64 from the table:
+//   sin x = (s + c r) + (s (cos r - 1) + c (sin r - r))
+//   cos x = (c - s r) + (c (cos r - 1) - s (sin r - r))
+// The leading terms are exact products of table entries, so the short
+// polynomials only have to be accurate relative to the correction terms.
+void sinCos(double x, MathPrecision precision, double& sine, double& cosine) {
+    unsigned index;
+    double r;
+    if (std::fabs(x) <= TRIG_LIMIT) {
+        const double shifted = x * INV_PIO64 + ROUNDER;
+        const double n = shifted - ROUNDER;
+        index = static_cast<unsigned>(bitsOf(shifted)) & 127;
+
+        // x - n*PIO64_1 and the products are exact; near a multiple of
+        // pi, where r is tiny, the later subtractions are exact too
+        r = ((x - n * PIO64_1) - n * PIO64_2) - (n * PIO64_3 + n * PIO64_3T);
+    } else {
+        index = reduceLarge(x, r);
+    }
+    const double r2 = r * r;
+
+    // Taylor polynomials: truncation error below r^5/120 and r^4/24 in
+    // Fast, r^9/9! and r^8/8! in High
+    double sinMinusR;
+    double cosMinusOne;
+    if (precision == MathPrecision::Fast) {
+        sinMinusR = r * r2 * (-1.0 / 6);
+        cosMinusOne = r2 * -0.5;
+    } else {
+        sinMinusR = r * (r2 * (-1.0 / 6 + r2 * (1.0 / 120 + r2 * (-1.0 / 5040))));
+        cosMinusOne = r2 * (-0.5 + r2 * (1.0 / 24 + r2 * (-1.0 / 720)));
+    }
+    const double s = SIN_TABLE[index];
+    const double c = SIN_TABLE[(index + 32) & 127];
+    sine = (s + c * r) + (s * cosMinusOne + c * sinMinusR);
+    cosine = (c - s * r) + (c * cosMinusOne - s * sinMinusR);
+}
+
+// x = 90 n + d exactly, with |d| <= 45 (slightly more where x / 90 rounds
+// across a half); returns n mod 4. NaN and infinities give a NaN d.
+unsigned reduceDegrees(double x, double& d) {
+    if (!(std::fabs(x) < DEGREES_LIMIT)) {
+        x = std::fmod(x, 360.0);
+    }
+    const double shifted = x * (1.0 / 90) + ROUNDER;
+    const double n = shifted - ROUNDER;
+    d = x - n * 90.0;
+    return static_cast<unsigned>(bitsOf(shifted)) & 3;
+}
+
+// sin and cos of d degrees, |d| about 45 at most. 30 and 45 degrees, whose
+// sines a calculator is expected to show exactly, are special-cased.
+SineCosine sinCosOfDegrees(double d, MathPrecision precision) {
+    SineCosine result = fastSinCos(d * DEGREE, precision);
+    const double size = std::fabs(d);
+    if (size == 30.0) {
+        result.sine = d * (1.0 / 60);
+    } else if (size == 45.0) {
+        result.sine = std::copysign(SQRT_HALF, d);
+        result.cosine = SQRT_HALF;
+    }
+    return result;
+}
+
+double sinOfDegrees(double d, MathPrecision precision) {
+    const double size = std::fabs(d);
+    if (size == 30.0) {
+        return d * (1.0 / 60);
+    }
+    if (size == 45.0) {
+        return std::copysign(SQRT_HALF, d);
+    }
+    return fastSin(d * DEGREE, precision);
+}
+
+double cosOfDegrees(double d, MathPrecision precision) {
+    return std::fabs(d) == 45.0 ? SQRT_HALF : fastCos(d * DEGREE, precision);
+}
+
+// Negation that turns 0 into +0, so that sin(180) is 0 rather than -0
+double negate(double value) {
+    return 0.0 - value;
+}
+
+} // namespace
+
+const char* mathPrecisionName(MathPrecision precision) {
+    switch (precision) {
+        case MathPrecision::Exact: return "exact";
+        case MathPrecision::High: return "high";
+        case MathPrecision::Fast: return "fast";
+    }
+    return "unknown";
+}
+
+double mathPrecisionBound(MathPrecision precision) {
+    switch (precision) {
+        case MathPrecision::Exact: return 0.0;
+        case MathPrecision::High: return 1e-12;
+        case MathPrecision::Fast: return 1e-7;
+    }
+    return 0.0;
+}
+
+double fastSin(double x, MathPrecision precision) {
+    if (precision == MathPrecision::Exact || !(std::fabs(x) < INFINITY)) {
+        return std::sin(x);
+    }
+    double sine;
+    double cosine;
+    sinCos(x, precision, sine, cosine);
+    return sine;
+}
+
+double fastCos(double x, MathPrecision precision) {
+    if (precision == MathPrecision::Exact || !(std::fabs(x) < INFINITY)) {
+        return std::cos(x);
+    }
+    double sine;
+    double cosine;
+    sinCos(x, precision, sine, cosine);
+    return cosine;
+}
+
+double fastTan(double x, MathPrecision precision) {
+    if (precision == MathPrecision::Exact || !(std::fabs(x) < INFINITY)) {
+        return std::tan(x);
+    }
+    double sine;
+    double cosine;
+    sinCos(x, precision, sine, cosine);
+    return sine / cosine;
+}
+
+SineCosine fastSinCos(double x, MathPrecision precision) {
+    SineCosine result;
+    if (precision == MathPrecision::Exact || !(std::fabs(x) < INFINITY)) {
+#ifdef __GLIBC__
+        ::sincos(x, &result.sine, &result.cosine);
+#else
+        result.sine = std::sin(x);
+        result.cosine = std::cos(x);
+#endif
+        return result;
+    }
+    sinCos(x, precision, result.sine, result.cosine);
+    return result;
+}
+
+double fastSinDegrees(double x, MathPrecision precision) {
+    double d;
+    const unsigned quadrant = reduceDegrees(x, d);
+    const double value = (quadrant & 1) ? cosOfDegrees(d, precision) : sinOfDegrees(d, precision);
+    return (quadrant & 2) ? negate(value) : value;
+}
+
+double fastCosDegrees(double x, MathPrecision precision) {
+    double d;
+    const unsigned quadrant = reduceDegrees(x, d) + 1;
+    const double value = (quadrant & 1) ? cosOfDegrees(d, precision) : sinOfDegrees(d, precision);
+    return (quadrant & 2) ? negate(value) : value;
+}
+
+double fastTanDegrees(double x, MathPrecision precision) {
+    double d;
+    const unsigned quadrant = reduceDegrees(x, d);
+    const double value = std::fabs(d) == 45.0 ? std::copysign(1.0, d) : fastTan(d * DEGREE, precision);
+    // tan(x) = -1 / tan(d) in odd quadrants; d = +0 there gives +infinity
+    return (quadrant & 1) ? 1.0 / negate(value) : value;
+}
+
+SineCosine fastSinCosDegrees(double x, MathPrecision precision) {
+    double d;
+    const unsigned quadrant = reduceDegrees(x, d);
+    const SineCosine reduced = sinCosOfDegrees(d, precision);
+    SineCosine result;
+    switch (quadrant) {
+        case 0: result.sine = reduced.sine; result.cosine = reduced.cosine; break;
+        case 1: result.sine = reduced.cosine; result.cosine = negate(reduced.sine); break;
+        case 2: result.sine = negate(reduced.sine); result.cosine = negate(reduced.cosine); break;
+        default: result.sine = negate(reduced.cosine); result.cosine = reduced.sine; break;
+    }
+    return result;
+}
+
+double fastLn(double x, MathPrecision precision) {
+    std::uint64_t bits = bitsOf(x);
+    int scale = 0;
+    if (precision == MathPrecision::Exact || bits - SMALLEST_NORMAL >= INFINITY_BITS - SMALLEST_NORMAL) {
+        // Zero, negative, subnormal, infinite or NaN
+        if (precision == MathPrecision::Exact || !(x > 0) || x == INFINITY) {
+            return std::log(x);
+        }
+        bits = bitsOf(x * 18014398509481984.0);  // 2^54
+        scale = -54;
+    }
+    const std::uint64_t offset = bits - LN_OFFSET;
+    const unsigned bucket = static_cast<unsigned>(offset >> 45) & 127;
+    const double k = static_cast<double>(static_cast<std::int64_t>(offset) >> 52) + scale;
+    const double z = fromBits(bits - (offset & EXPONENT_MASK));
+
+    // |r| <= 1/256; in bucket 64 the inverse is 1 and r = z - 1 exactly,
+    // so ln x keeps its relative accuracy next to x = 1
+    const double r = z * LN_INVERSE[bucket] - 1.0;
+
+    // ln(1 + r) by Taylor polynomial: truncation error below r^4/4 in
+    // Fast and r^6/6 in High, against |ln x| >= 1/512 outside bucket 64
+    const double r2 = r * r;
+    double log1p;
+    if (precision == MathPrecision::Fast) {
+        log1p = r + r2 * (-0.5 + r * (1.0 / 3));
+    } else {
+        log1p = r + r2 * (-0.5 + r * (1.0 / 3) + r2 * (-0.25 + r * 0.2));
+    }
+    return (k * LN2_HI + LN_CENTER[bucket]) + (log1p + k * LN2_LO);
+}
+
+double fastExp(double x, MathPrecision precision) {
+    if (precision == MathPrecision::Exact || !(std::fabs(x) <= EXP_LIMIT)) {
+        return std::exp(x);
+    }
+    // x = (64 k + j) ln2/64 + r with |r| <= ln2/128
+    const double shifted = x * INV_LN2_64 + ROUNDER;
+    const double n = shifted - ROUNDER;
+    const std::uint64_t nBits = bitsOf(shifted);
+    const unsigned j = static_cast<unsigned>(nBits) & 63;
+
+    // n * LN2_HI / 64 is exact, so r is within about 1e-17
+    const double r = (x - n * (LN2_HI / 64)) - n * (LN2_LO / 64);
+
+    // 2^(j/64) * 2^k by adding k to the exponent field of the table entry
+    const double scale = fromBits(bitsOf(EXP2_TABLE[j]) + ((nBits - j) << 46));
+
+    // e^r - 1 by Taylor polynomial: truncation error below r^3/6 in Fast
+    // and r^5/120 in High
+    const double r2 = r * r;
+    double expMinusOne;
+    if (precision == MathPrecision::Fast) {
+        expMinusOne = r + r2 * 0.5;
+    } else {
+        expMinusOne = r + r2 * (0.5 + r * (1.0 / 6) + r2 * (1.0 / 24));
+    }
+    return scale + scale * expMinusOne;
+}
+
+double fastPower(double base, double exp, MathPrecision precision) {
+    if (precision == MathPrecision::Exact) {
+        return std::pow(base, exp);
+    }
+    if (std::fabs(exp) <= 64 && static_cast<int>(exp) == exp) {
+        // Square and multiply: at most a dozen roundings, for any base
+        const int n = static_cast<int>(exp);
+        unsigned bitsLeft = static_cast<unsigned>(std::abs(n));
+        double result = 1.0;
+        double factor = base;
+        while (bitsLeft) {
+            if (bitsLeft & 1) {
+                result *= factor;
+            }
+            factor *= factor;
+            bitsLeft >>= 1;
+        }
+        if (n >= 0) {
+            return result;
+        }
+        // An intermediate that overflowed or lost digits to underflow
+        // would turn a tiny or huge reciprocal into 0 or infinity
+        return std::isnormal(result) ? 1.0 / result : std::pow(base, exp);
+    }
+    if (base > 0 && base < INFINITY && std::fabs(exp) < INFINITY) {
+        const double y = exp * fastLn(base, precision);
+        if (std::fabs(y) <= EXP_LIMIT) {
+            return fastExp(y, precision);
+        }
+    }
+    return std::pow(base, exp);
+}
@@ -0,0 +1,129 @@
+/**
+ * @file fast_math.h
+ * @brief Table-driven approximations of the scientific functions
+ */
+
+#ifndef FAST_MATH_H
+#define FAST_MATH_H
+
+/**
+ * @enum MathPrecision
+ * @brief Accuracy the scientific functions are computed to
+ *
+ * The bounds are on the relative error against the exact result
+ * (power: see fastPower()). They are checked by randomized and
+ * bucket-by-bucket tests against libm in tests/fast_math_test.cpp.
+ */
+enum class MathPrecision : unsigned char {
+    Exact,  ///< libm, correctly rounded or within an ulp
+    High,   ///< Relative error below 1e-12
+    Fast    ///< Relative error below 1e-7
+};
+
+/**
+ * @struct SineCosine
+ * @brief Sine and cosine of one angle
+ */
+struct SineCosine {
+    double sine;
+    double cosine;
+};
+
+/**
+ * @brief Get a printable name of a precision
+ * @return "exact", "high" or "fast"
+ */
+const char* mathPrecisionName(MathPrecision precision);
+
+/**
+ * @brief Get the documented error bound of a precision
+ * @return Largest relative error: 0 for Exact, 1e-12 for High, 1e-7 for Fast
+ */
+double mathPrecisionBound(MathPrecision precision);
+
+/**
+ * @brief Sine of an angle in radians
+ *
+ * Reduces x to r = x - n pi/64 with |r| <= pi/128 and combines a table
+ * of sin(n pi/64) with short polynomials for sin r and cos r. Table
+ * entries at multiples of pi/2 are exact, so results near zeros stay
+ * accurate relative to their size. Beyond |x| = 32768 the reduction
+ * multiplies x by 2/pi to 1408 bits in integer arithmetic (Payne-Hanek),
+ * so huge arguments keep the same bound. Infinities and NaN go to libm.
+ */
+double fastSin(double x, MathPrecision precision);
+
+/** @brief Cosine of an angle in radians, computed as fastSin() */
+double fastCos(double x, MathPrecision precision);
+
+/**
+ * @brief Tangent of an angle in radians
+ *
+ * Sine over cosine from one reduction; the error bound holds for the
+ * quotient as a whole.
+ */
+double fastTan(double x, MathPrecision precision);
+
+/**
+ * @brief Sine and cosine of an angle in radians, reduced once
+ *
+ * Exact uses glibc's sincos() where available.
+ */
+SineCosine fastSinCos(double x, MathPrecision precision);
+
+/**
+ * @brief Sine of an angle in degrees
+ *
+ * Reduces x to 90 n + d with |d| <= 45 exactly, in degrees, and only then
+ * converts d to radians. Multiples of 90 therefore give exact zeros and
+ * ones (sin 180 is 0, not 1.2e-16), 30 and 45 degrees give the correctly
+ * rounded 0.5 and sqrt(1/2), and large angles lose nothing to the
+ * conversion. With Exact the reduced angle goes to libm.
+ */
+double fastSinDegrees(double x, MathPrecision precision);
+
+/** @brief Cosine of an angle in degrees, see fastSinDegrees() */
+double fastCosDegrees(double x, MathPrecision precision);
+
+/**
+ * @brief Tangent of an angle in degrees, see fastSinDegrees()
+ *
+ * tan 45 is exactly 1; odd multiples of 90 give +infinity.
+ */
+double fastTanDegrees(double x, MathPrecision precision);
+
+/** @brief Sine and cosine of an angle in degrees, reduced once */
+SineCosine fastSinCosDegrees(double x, MathPrecision precision);
+
+/**
+ * @brief Natural logarithm
+ *
+ * Splits x into 2^e m with m in [0.75, 1.5), looks up ln c for the
+ * nearest c = k/128 and evaluates ln(m/c) by a polynomial; the bucket
+ * around 1 has c = 1 exactly, so ln x keeps its relative accuracy next
+ * to x = 1. Zero, negative numbers, infinities and NaN go to libm.
+ */
+double fastLn(double x, MathPrecision precision);
+
+/**
+ * @brief e^x
+ *
+ * 2^(k + j/64) e^r with a table of 2^(j/64) and a polynomial for e^r,
+ * |r| <= ln 2 / 128. |x| beyond 708, where the result would overflow or
+ * lose precision as a subnormal, goes to libm.
+ */
+double fastExp(double x, MathPrecision precision);
+
+/**
+ * @brief base raised to exp
+ *
+ * Integral exponents up to 64 in magnitude are computed by repeated
+ * squaring. Other exponents of positive finite bases go through
+ * fastExp(exp * fastLn(base)); since a power amplifies the relative
+ * error of its logarithm y = exp * ln(base) by |y|, as it does for an
+ * ulp of error in the operands, the bound of the precision applies
+ * multiplied by max(1, |y|). Everything else goes to libm.
+ */
+double fastPower(double base, double exp, MathPrecision precision);
+
+#endif // FAST_MATH_H
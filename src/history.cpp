@@ -0,0 +1,27 @@
+#include "history.h"
+#include <algorithm>
+
+const std::size_t HistoryBuffer::DEFAULT_CAPACITY;
+
+HistoryBuffer::HistoryBuffer(std::size_t capacity)
+    : records(capacity)
+    , head(0)
+    , count(0)
+    , pushed(0) {
+}
+
+void HistoryBuffer::setCapacity(std::size_t capacity) {
+    std::size_t kept = std::min(count, capacity);
+    std::vector<HistoryRecord> resized(capacity);
+    for (std::size_t i = 0; i < kept; ++i) {
+        resized[i] = (*this)[count - kept + i];
+    }
+    records.swap(resized);
+    count = kept;
+    head = (capacity == 0 || kept == capacity) ? 0 : kept;
+}
+
+void HistoryBuffer::clear() {
+    head = 0;
+    count = 0;
+}
@@ -0,0 +1,280 @@
+/**
+ * @file history.h
+ * @brief Fixed-capacity ring buffer of calculation records
+ */
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+/**
+ * @enum HistoryOp
+ * @brief Operation recorded in a history entry
+ */
+enum class HistoryOp : unsigned char {
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Sqrt,
+    Power,
+    Ln,
+    Sin,
+    Cos,
+    Tan,
+    MemoryStore,
+    MemoryRecall,
+    MemoryClear,
+    MemoryAdd,
+    MemorySubtract,
+    Sum,        ///< Bulk reductions: lhs holds the element count
+    Mean,
+    Variance,
+    StdDev,
+    Min,
+    Max,
+    PrefixSum,  ///< result holds the last element of the prefix sum
+    DecimalAdd, ///< Fixed-point operations: values converted to double
+    DecimalSubtract,
+    DecimalMultiply,
+    DecimalDivide,
+    SinDegrees, ///< Trigonometric functions of an angle in degrees
+    CosDegrees,
+    TanDegrees
+};
+
+/**
+ * @struct HistoryRecord
+ * @brief Compact binary record of one calculation
+ *
+ * Unary operations leave rhs at 0; memory operations keep the affected
+ * value in lhs; reductions keep the number of elements in lhs. Text is
+ * produced only when the history is displayed.
+ */
+struct HistoryRecord {
+    HistoryOp op;   ///< Operation performed
+    double lhs;     ///< First operand
+    double rhs;     ///< Second operand (binary operations only)
+    double result;  ///< Result of the operation
+};
+
+class HistoryView;
+
+/**
+ * @class HistoryBuffer
+ * @brief Ring buffer that keeps the most recent calculation records
+ *
+ * Once the buffer is full each push overwrites the oldest record, so
+ * recording costs a few stores and never shifts or allocates.
+ *
+ * Every push is numbered: the first record gets sequence 1 and each one
+ * after it the next number, whether or not the buffer keeps it. Numbers
+ * are never reused, not even after clear() or setCapacity(), so a reader
+ * can remember the last sequence it saw and ask for what came after.
+ */
+class HistoryBuffer {
+public:
+    /// Number of records kept when no capacity is given
+    static const std::size_t DEFAULT_CAPACITY = 100;
+
+    /**
+     * @brief Construct an empty buffer
+     * @param capacity Maximum number of records kept (0 disables recording)
+     */
+    explicit HistoryBuffer(std::size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief Append a record, dropping the oldest one when full
+     * @param op Operation performed
+     * @param lhs First operand
+     * @param rhs Second operand
+     * @param result Result of the operation
+     */
+    void push(HistoryOp op, double lhs, double rhs, double result) {
+        ++pushed;
+        if (records.empty()) {
+            return;
+        }
+        HistoryRecord& slot = records[head];
+        slot.op = op;
+        slot.lhs = lhs;
+        slot.rhs = rhs;
+        slot.result = result;
+        if (++head == records.size()) {
+            head = 0;
+        }
+        if (count < records.size()) {
+            ++count;
+        }
+    }
+
+    /**
+     * @brief Access a record by age
+     * @param index 0 for the oldest record, size() - 1 for the newest
+     * @return Record at the given position
+     */
+    const HistoryRecord& operator[](std::size_t index) const {
+        std::size_t pos = head + records.size() - count + index;
+        if (pos >= records.size()) {
+            pos -= records.size();
+        }
+        return records[pos];
+    }
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    std::size_t capacity() const { return records.size(); }
+
+    /**
+     * @brief Get the sequence number of the newest record pushed
+     * @return 0 before the first push; the record itself may be gone
+     */
+    std::uint64_t lastSequence() const { return pushed; }
+
+    /**
+     * @brief Get the sequence number of the oldest record kept
+     * @return lastSequence() + 1 when no record is kept
+     */
+    std::uint64_t firstSequence() const { return pushed - count + 1; }
+
+    /**
+     * @brief View every record kept, oldest first, without copying
+     */
+    HistoryView view() const;
+
+    /**
+     * @brief View the records pushed after a given one, without copying
+     *
+     * Records that were pushed after it but have since been dropped are
+     * missing from the view; its firstSequence() then exceeds sequence + 1.
+     *
+     * @param sequence Last sequence number already seen, 0 for none
+     * @return Records with a greater sequence number that are still kept
+     */
+    HistoryView since(std::uint64_t sequence) const;
+
+    /**
+     * @brief Change the capacity, keeping the newest records that fit
+     * @param capacity New maximum number of records (0 disables recording)
+     */
+    void setCapacity(std::size_t capacity);
+
+    /**
+     * @brief Remove all records
+     */
+    void clear();
+
+private:
+    std::vector<HistoryRecord> records; ///< Fixed storage, sized to capacity
+    std::size_t head;                   ///< Slot written by the next push
+    std::size_t count;                  ///< Number of valid records
+    std::uint64_t pushed;               ///< Records ever pushed, the newest one's sequence
+};
+
+/**
+ * @class HistoryView
+ * @brief Non-owning range over consecutive records of a HistoryBuffer
+ *
+ * Iterates oldest first and tells each record's sequence number. A view
+ * holds a pointer into the buffer: it is valid until the buffer is next
+ * changed (push, clear, setCapacity) or destroyed.
+ */
+class HistoryView {
+public:
+    /**
+     * @class Iterator
+     * @brief Forward iterator yielding records, with their sequence numbers
+     */
+    class Iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef HistoryRecord value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const HistoryRecord* pointer;
+        typedef const HistoryRecord& reference;
+
+        Iterator() : buffer(nullptr), index(0), seq(0) {}
+        Iterator(const HistoryBuffer* buffer, std::size_t index, std::uint64_t sequence)
+            : buffer(buffer), index(index), seq(sequence) {}
+
+        reference operator*() const { return (*buffer)[index]; }
+        pointer operator->() const { return &(*buffer)[index]; }
+
+        /// Sequence number of the current record
+        std::uint64_t sequence() const { return seq; }
+
+        Iterator& operator++() {
+            ++index;
+            ++seq;
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const { return seq == other.seq; }
+        bool operator!=(const Iterator& other) const { return seq != other.seq; }
+
+    private:
+        const HistoryBuffer* buffer;
+        std::size_t index;  ///< Position by age in the buffer
+        std::uint64_t seq;
+    };
+
+    HistoryView() : buffer(nullptr), offset(0), length(0), first(1) {}
+
+    /**
+     * @param buffer Buffer viewed
+     * @param offset Age index of the first record, 0 for the oldest kept
+     * @param length Number of records
+     * @param first Sequence number of the first record
+     */
+    HistoryView(const HistoryBuffer* buffer, std::size_t offset, std::size_t length, std::uint64_t first)
+        : buffer(buffer), offset(offset), length(length), first(first) {}
+
+    Iterator begin() const { return Iterator(buffer, offset, first); }
+    Iterator end() const { return Iterator(buffer, offset + length, first + length); }
+
+    /**
+     * @brief Access a record of the view
+     * @param index 0 for the oldest record, size() - 1 for the newest
+     */
+    const HistoryRecord& operator[](std::size_t index) const { return (*buffer)[offset + index]; }
+
+    std::size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    /// Sequence number of the first record
+    std::uint64_t firstSequence() const { return first; }
+
+    /// Sequence number of the last record; firstSequence() - 1 when empty
+    std::uint64_t lastSequence() const { return first + length - 1; }
+
+private:
+    const HistoryBuffer* buffer;
+    std::size_t offset;
+    std::size_t length;
+    std::uint64_t first;
+};
+
+inline HistoryView HistoryBuffer::view() const {
+    return HistoryView(this, 0, count, firstSequence());
+}
+
+inline HistoryView HistoryBuffer::since(std::uint64_t sequence) const {
+    std::uint64_t first = firstSequence();
+    if (sequence >= pushed) {
+        return HistoryView(this, count, 0, pushed + 1);
+    }
+    std::size_t skipped = sequence < first ? 0 : static_cast<std::size_t>(sequence - first + 1);
+    return HistoryView(this, skipped, count - skipped, first + skipped);
+}
+
+#endif // HISTORY_H
@@ -0,0 +1,344 @@
+#include "history_log.h"
+#include "calculator.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(HistoryLogRecord) == 32, "log records are 32 bytes");
+static_assert(sizeof(HistoryLogHeader) == 64, "log headers are 64 bytes");
+
+namespace {
+
+const char MAGIC[8] = {'C', 'A', 'L', 'C', 'H', 'L', 'O', 'G'};
+const std::uint32_t VERSION = 1;
+
+std::string segmentPath(const std::string& base, std::uint64_t index) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), ".%06llu", static_cast<unsigned long long>(index));
+    return base + suffix;
+}
+
+bool segmentExists(const std::string& base, std::uint64_t index) {
+    struct stat info;
+    return ::stat(segmentPath(base, index).c_str(), &info) == 0;
+}
+
+std::runtime_error systemError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+std::size_t segmentBytes(std::uint64_t capacity) {
+    return sizeof(HistoryLogHeader) + static_cast<std::size_t>(capacity) * sizeof(HistoryLogRecord);
+}
+
+// Checks a mapped segment header; returns an error message or null
+const char* headerProblem(const HistoryLogHeader& header, std::uint64_t index, std::size_t fileSize) {
+    if (fileSize < sizeof(HistoryLogHeader) || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        return "not a history log";
+    }
+    if (header.version != VERSION || header.recordSize != sizeof(HistoryLogRecord)) {
+        return "unsupported history log version";
+    }
+    // Divides rather than multiplies: an untrusted capacity must not wrap
+    if (header.segment != index || header.count > header.capacity ||
+        header.capacity > (fileSize - sizeof(HistoryLogHeader)) / sizeof(HistoryLogRecord)) {
+        return "corrupt history log segment";
+    }
+    return nullptr;
+}
+
+} // namespace
+
+HistoryLogOptions::HistoryLogOptions()
+    : segmentRecords(1 << 20)
+    , syncInterval(4096) {
+}
+
+HistoryLog::HistoryLog(const std::string& path, const HistoryLogOptions& options)
+    : basePath(path)
+    , segmentRecords(options.segmentRecords == 0 ? 1 : options.segmentRecords)
+    , syncInterval(options.syncInterval)
+    , untilSync(0)
+    , segmentIndex(0)
+    , mapping(nullptr)
+    , mappingSize(0)
+    , header(nullptr)
+    , records(nullptr)
+    , next(nullptr)
+    , limit(nullptr)
+    , synced(nullptr) {
+    std::uint64_t last = 0;
+    while (segmentExists(basePath, last + 1)) {
+        ++last;
+    }
+    openSegment(last, 0);
+    if (next == limit) {
+        openSegment(last + 1, size());
+    }
+}
+
+HistoryLog::~HistoryLog() {
+    try {
+        flush();
+    } catch (const std::exception&) {
+        // Nothing useful to do with the error while destroying
+    }
+    closeSegment();
+}
+
+void HistoryLog::openSegment(std::uint64_t index, std::uint64_t firstRecord) {
+    closeSegment();
+    const std::string file = segmentPath(basePath, index);
+    int fd = ::open(file.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw systemError("Cannot open", file);
+    }
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw systemError("Cannot stat", file);
+    }
+    bool created = info.st_size == 0;
+    std::size_t size = created ? segmentBytes(segmentRecords) : static_cast<std::size_t>(info.st_size);
+    if (created && ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        ::close(fd);
+        throw systemError("Cannot size", file);
+    }
+    void* mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        throw systemError("Cannot map", file);
+    }
+
+    HistoryLogHeader* h = static_cast<HistoryLogHeader*>(mapped);
+    if (created) {
+        std::memcpy(h->magic, MAGIC, sizeof(MAGIC));
+        h->version = VERSION;
+        h->recordSize = sizeof(HistoryLogRecord);
+        h->segment = index;
+        h->firstRecord = firstRecord;
+        h->capacity = segmentRecords;
+        h->count = 0;
+        h->reserved[0] = 0;
+        h->reserved[1] = 0;
+    } else if (const char* problem = headerProblem(*h, index, size)) {
+        ::munmap(mapped, size);
+        throw std::runtime_error(file + ": " + problem);
+    }
+
+    // Records are written front to back
+    ::madvise(mapped, size, MADV_SEQUENTIAL);
+
+    mapping = mapped;
+    mappingSize = size;
+    header = h;
+    segmentIndex = index;
+    segmentRecords = static_cast<std::size_t>(h->capacity);
+    records = reinterpret_cast<HistoryLogRecord*>(static_cast<char*>(mapped) + sizeof(HistoryLogHeader));
+    next = records + h->count;
+    limit = records + h->capacity;
+    synced = next;
+    untilSync = syncInterval == 0 ? std::numeric_limits<std::size_t>::max() : syncInterval;
+}
+
+void HistoryLog::closeSegment() {
+    if (mapping == nullptr) {
+        return;
+    }
+    ::msync(mapping, mappingSize, MS_ASYNC);
+    ::munmap(mapping, mappingSize);
+    mapping = nullptr;
+    header = nullptr;
+}
+
+void HistoryLog::syncAsync() {
+    untilSync = syncInterval == 0 ? std::numeric_limits<std::size_t>::max() : syncInterval;
+    // msync needs a page-aligned start; the header page is always included
+    // when the range reaches back to it, which keeps the count current
+    const std::uintptr_t pageSize = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+    std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(synced) & ~(pageSize - 1);
+    std::uintptr_t end = reinterpret_cast<std::uintptr_t>(next);
+    ::msync(reinterpret_cast<void*>(begin), end - begin, MS_ASYNC);
+    ::msync(mapping, sizeof(HistoryLogHeader), MS_ASYNC);
+    synced = next;
+}
+
+void HistoryLog::flush() {
+    if (mapping != nullptr && ::msync(mapping, mappingSize, MS_SYNC) != 0) {
+        throw systemError("Cannot sync", segmentPath(basePath, segmentIndex));
+    }
+    synced = next;
+}
+
+HistoryLogReader::Iterator::Iterator(const HistoryLogReader* reader, std::size_t segment)
+    : reader(reader)
+    , segment(segment)
+    , current(nullptr)
+    , segmentEnd(nullptr) {
+    if (segment < reader->segments.size()) {
+        const Segment& s = reader->segments[segment];
+        current = s.records;
+        segmentEnd = s.records + s.count;
+        if (current == segmentEnd) {
+            advanceSegment();
+        }
+    }
+}
+
+void HistoryLogReader::Iterator::advanceSegment() {
+    while (++segment < reader->segments.size()) {
+        const Segment& s = reader->segments[segment];
+        if (s.count > 0) {
+            current = s.records;
+            segmentEnd = s.records + s.count;
+            return;
+        }
+    }
+    current = nullptr;
+    segmentEnd = nullptr;
+}
+
+HistoryLogReader::HistoryLogReader(const std::string& path)
+    : segmentRecords(0)
+    , total(0) {
+    try {
+        for (std::uint64_t index = 0; index == 0 || segmentExists(path, index); ++index) {
+            const std::string file = segmentPath(path, index);
+            int fd = ::open(file.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw systemError("Cannot open", file);
+            }
+            struct stat info;
+            if (::fstat(fd, &info) != 0 || info.st_size == 0) {
+                ::close(fd);
+                throw std::runtime_error(file + ": not a history log");
+            }
+            std::size_t size = static_cast<std::size_t>(info.st_size);
+            void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mapped == MAP_FAILED) {
+                throw systemError("Cannot map", file);
+            }
+            Segment segment = {mapped, size, nullptr, 0};
+            segments.push_back(segment);
+
+            const HistoryLogHeader& h = *static_cast<const HistoryLogHeader*>(mapped);
+            const char* problem = headerProblem(h, index, size);
+            if (problem == nullptr && index == 0) {
+                segmentRecords = h.capacity;
+            }
+            if (problem == nullptr && (h.capacity != segmentRecords || h.firstRecord != total)) {
+                problem = "segments do not line up";
+            }
+            if (problem != nullptr) {
+                throw std::runtime_error(file + ": " + problem);
+            }
+            segments.back().records = reinterpret_cast<const HistoryLogRecord*>(
+                static_cast<const char*>(mapped) + sizeof(HistoryLogHeader));
+            segments.back().count = static_cast<std::size_t>(h.count);
+            total += h.count;
+            ::madvise(mapped, size, MADV_SEQUENTIAL);
+        }
+    } catch (...) {
+        for (const Segment& s : segments) {
+            ::munmap(s.mapping, s.mappingSize);
+        }
+        throw;
+    }
+}
+
+HistoryLogReader::~HistoryLogReader() {
+    for (const Segment& s : segments) {
+        ::munmap(s.mapping, s.mappingSize);
+    }
+}
+
+namespace {
+
+bool sameResult(double a, double b) {
+    if (std::isnan(a) && std::isnan(b)) {
+        return true;
+    }
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+// Runs a trigonometric function of calc in the given angle unit
+double inUnit(Calculator& calc, bool radians, double (Calculator::*function)(double), double x) {
+    const bool previous = calc.isRadians();
+    calc.setRadians(radians);
+    const double result = (calc.*function)(x);
+    calc.setRadians(previous);
+    return result;
+}
+
+// Recomputes a record into result; returns false for memory records,
+// reductions and decimal operations, whose exact inputs are not logged,
+// and sets failed if the operation now fails
+bool recompute(Calculator& calc, const HistoryLogRecord& record, double& result, bool& failed) {
+    CalcResult checked = CalcResult::success(0);
+    failed = false;
+    switch (record.operation()) {
+        case HistoryOp::Add: result = calc.add(record.lhs, record.rhs); return true;
+        case HistoryOp::Subtract: result = calc.subtract(record.lhs, record.rhs); return true;
+        case HistoryOp::Multiply: result = calc.multiply(record.lhs, record.rhs); return true;
+        case HistoryOp::Power: result = calc.power(record.lhs, record.rhs); return true;
+        case HistoryOp::Sin: result = inUnit(calc, true, &Calculator::sin, record.lhs); return true;
+        case HistoryOp::Cos: result = inUnit(calc, true, &Calculator::cos, record.lhs); return true;
+        case HistoryOp::Tan: result = inUnit(calc, true, &Calculator::tan, record.lhs); return true;
+        case HistoryOp::SinDegrees: result = inUnit(calc, false, &Calculator::sin, record.lhs); return true;
+        case HistoryOp::CosDegrees: result = inUnit(calc, false, &Calculator::cos, record.lhs); return true;
+        case HistoryOp::TanDegrees: result = inUnit(calc, false, &Calculator::tan, record.lhs); return true;
+        case HistoryOp::Divide: checked = calc.tryDivide(record.lhs, record.rhs); break;
+        case HistoryOp::Sqrt: checked = calc.trySqrt(record.lhs); break;
+        case HistoryOp::Ln: checked = calc.tryLn(record.lhs); break;
+        case HistoryOp::MemoryStore:
+        case HistoryOp::MemoryRecall:
+        case HistoryOp::MemoryClear:
+        case HistoryOp::MemoryAdd:
+        case HistoryOp::MemorySubtract:
+        case HistoryOp::Sum:
+        case HistoryOp::Mean:
+        case HistoryOp::Variance:
+        case HistoryOp::StdDev:
+        case HistoryOp::Min:
+        case HistoryOp::Max:
+        case HistoryOp::PrefixSum:
+        case HistoryOp::DecimalAdd:
+        case HistoryOp::DecimalSubtract:
+        case HistoryOp::DecimalMultiply:
+        case HistoryOp::DecimalDivide:
+            return false;
+    }
+    // Only successful operations are logged, so a failure is a mismatch
+    failed = !checked.ok();
+    result = checked.value;
+    return true;
+}
+
+} // namespace
+
+ReplayReport replayHistoryLog(const HistoryLogReader& log, Calculator& calc, std::size_t maxIndices) {
+    ReplayReport report = {0, 0, 0, std::vector<std::uint64_t>()};
+    for (const HistoryLogRecord& record : log) {
+        double result = 0;
+        bool failed = false;
+        if (recompute(calc, record, result, failed)) {
+            ++report.checked;
+            if (failed || !sameResult(result, record.result)) {
+                if (report.mismatchIndices.size() < maxIndices) {
+                    report.mismatchIndices.push_back(report.records);
+                }
+                ++report.mismatches;
+            }
+        }
+        ++report.records;
+    }
+    return report;
+}
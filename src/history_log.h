@@ -0,0 +1,282 @@
+/**
+ * @file history_log.h
+ * @brief Persistent, memory-mapped log of calculation records
+ */
+
+#ifndef HISTORY_LOG_H
+#define HISTORY_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "history.h"
+
+class Calculator;
+
+/**
+ * @struct HistoryLogRecord
+ * @brief On-disk form of a HistoryRecord
+ *
+ * 32 bytes with no padding, so every byte written to the file is
+ * defined. op holds the HistoryOp value.
+ */
+struct HistoryLogRecord {
+    std::uint32_t op;        ///< HistoryOp of the entry
+    std::uint32_t reserved;  ///< Always 0
+    double lhs;              ///< First operand
+    double rhs;              ///< Second operand (binary operations only)
+    double result;           ///< Result of the operation
+
+    HistoryOp operation() const { return static_cast<HistoryOp>(op); }
+};
+
+/**
+ * @struct HistoryLogHeader
+ * @brief First 64 bytes of every segment file
+ */
+struct HistoryLogHeader {
+    char magic[8];              ///< "CALCHLOG"
+    std::uint32_t version;      ///< Format version, 1
+    std::uint32_t recordSize;   ///< sizeof(HistoryLogRecord)
+    std::uint64_t segment;      ///< Index of this segment
+    std::uint64_t firstRecord;  ///< Log position of the segment's first record
+    std::uint64_t capacity;     ///< Records the segment holds
+    std::uint64_t count;        ///< Records written so far
+    std::uint64_t reserved[2];  ///< Always 0
+};
+
+/**
+ * @struct HistoryLogOptions
+ * @brief Settings for a HistoryLog
+ */
+struct HistoryLogOptions {
+    std::size_t segmentRecords;  ///< Records per segment file; an existing log keeps its own
+    std::size_t syncInterval;    ///< Appends between asynchronous msync calls (0 = only on flush)
+
+    HistoryLogOptions();
+};
+
+/**
+ * @class HistoryLog
+ * @brief Append-only log of calculation records in memory-mapped segments
+ *
+ * The log is a series of files named <path>.000000, <path>.000001, ...
+ * Each one is a HistoryLogHeader followed by a fixed number of
+ * HistoryLogRecord slots and is mapped shared, so an append is a
+ * 32-byte store into the mapping plus an update of the header count.
+ * When a segment is full the next one is created and mapped; the full
+ * one is written back and unmapped.
+ *
+ * Every syncInterval appends the pages written since the last sync are
+ * handed to msync(MS_ASYNC), which starts write-back without waiting;
+ * flush() waits for it. Records are therefore safe against the process
+ * crashing as soon as append() returns, and against the machine crashing
+ * once they have been flushed.
+ *
+ * Opening an existing log continues after its last record.
+ */
+class HistoryLog {
+public:
+    /**
+     * @brief Open or create a log
+     * @param path Base path of the segment files
+     * @param options Segment size and sync settings
+     * @throw std::runtime_error if a file cannot be created or mapped, or
+     *        an existing segment is not a history log
+     */
+    explicit HistoryLog(const std::string& path, const HistoryLogOptions& options = HistoryLogOptions());
+
+    /**
+     * @brief Flush and unmap the current segment
+     */
+    ~HistoryLog();
+
+    HistoryLog(const HistoryLog&) = delete;
+    HistoryLog& operator=(const HistoryLog&) = delete;
+
+    /**
+     * @brief Append a record
+     * @param op Operation performed
+     * @param lhs First operand
+     * @param rhs Second operand
+     * @param result Result of the operation
+     * @throw std::runtime_error if the next segment cannot be created
+     */
+    void append(HistoryOp op, double lhs, double rhs, double result) {
+        if (next == limit) {
+            openSegment(segmentIndex + 1, size());
+        }
+        next->op = static_cast<std::uint32_t>(op);
+        next->reserved = 0;
+        next->lhs = lhs;
+        next->rhs = rhs;
+        next->result = result;
+        ++next;
+        header->count = static_cast<std::uint64_t>(next - records);
+        if (--untilSync == 0) {
+            syncAsync();
+        }
+    }
+
+    /**
+     * @brief Write all appended records back to disk and wait for it
+     * @throw std::runtime_error if msync fails
+     */
+    void flush();
+
+    /**
+     * @brief Get the number of records in the log
+     * @return Records from all segments, including earlier sessions
+     */
+    std::uint64_t size() const { return header->firstRecord + header->count; }
+
+    /**
+     * @brief Get the base path of the segment files
+     * @return Path given to the constructor
+     */
+    const std::string& path() const { return basePath; }
+
+private:
+    std::string basePath;
+    std::size_t segmentRecords;
+    std::size_t syncInterval;
+    std::size_t untilSync;           ///< Appends left before the next msync
+    std::uint64_t segmentIndex;
+    void* mapping;                   ///< Current segment
+    std::size_t mappingSize;
+    HistoryLogHeader* header;
+    HistoryLogRecord* records;       ///< First slot of the current segment
+    HistoryLogRecord* next;          ///< Slot written by the next append
+    HistoryLogRecord* limit;         ///< One past the last slot
+    HistoryLogRecord* synced;        ///< First slot not yet passed to msync
+
+    void openSegment(std::uint64_t index, std::uint64_t firstRecord);
+    void closeSegment();
+    void syncAsync();
+};
+
+/**
+ * @class HistoryLogReader
+ * @brief Read-only, zero-copy view of a history log
+ *
+ * All segments are mapped when the reader is created; records appended
+ * afterwards are not visible. Because every segment but the last is
+ * full, the Nth record is found with one division, and iteration yields
+ * references straight into the mappings.
+ */
+class HistoryLogReader {
+public:
+    /**
+     * @brief Iterator over the records in log order
+     */
+    class Iterator {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef HistoryLogRecord value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const HistoryLogRecord* pointer;
+        typedef const HistoryLogRecord& reference;
+
+        reference operator*() const { return *current; }
+        pointer operator->() const { return current; }
+
+        Iterator& operator++() {
+            if (++current == segmentEnd) {
+                advanceSegment();
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const { return current == other.current; }
+        bool operator!=(const Iterator& other) const { return current != other.current; }
+
+    private:
+        friend class HistoryLogReader;
+
+        const HistoryLogReader* reader;
+        std::size_t segment;
+        const HistoryLogRecord* current;
+        const HistoryLogRecord* segmentEnd;
+
+        Iterator(const HistoryLogReader* reader, std::size_t segment);
+        void advanceSegment();
+    };
+
+    /**
+     * @brief Map every segment of a log
+     * @param path Base path of the segment files
+     * @throw std::runtime_error if the first segment is missing or a
+     *        segment is not a history log
+     */
+    explicit HistoryLogReader(const std::string& path);
+
+    ~HistoryLogReader();
+
+    HistoryLogReader(const HistoryLogReader&) = delete;
+    HistoryLogReader& operator=(const HistoryLogReader&) = delete;
+
+    /**
+     * @brief Get the number of records
+     * @return Records in all segments
+     */
+    std::uint64_t size() const { return total; }
+
+    /**
+     * @brief Access a record by position
+     * @param index 0 for the first record ever appended
+     * @return Record inside the mapping
+     */
+    const HistoryLogRecord& operator[](std::uint64_t index) const {
+        const Segment& s = segments[static_cast<std::size_t>(index / segmentRecords)];
+        return s.records[index % segmentRecords];
+    }
+
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, segments.size()); }
+
+private:
+    struct Segment {
+        void* mapping;
+        std::size_t mappingSize;
+        const HistoryLogRecord* records;
+        std::size_t count;
+    };
+
+    std::vector<Segment> segments;
+    std::uint64_t segmentRecords;
+    std::uint64_t total;
+};
+
+/**
+ * @struct ReplayReport
+ * @brief Outcome of replaying a history log
+ */
+struct ReplayReport {
+    std::uint64_t records;     ///< Records read
+    std::uint64_t checked;     ///< Records recomputed and compared
+    std::uint64_t mismatches;  ///< Checked records whose result differed from the log
+    std::vector<std::uint64_t> mismatchIndices;  ///< Positions of the first mismatches
+};
+
+/**
+ * @brief Re-execute a log and compare every result with the logged one
+ *
+ * Arithmetic and scientific records are recomputed through the
+ * calculator's operations; results must match bit for bit (any NaN
+ * matches any NaN). Memory records are counted but not checked, since
+ * the memory value may have come from an earlier session or a shared
+ * register; neither are reductions, whose input arrays are not logged,
+ * nor decimal operations, whose operands are logged only as doubles.
+ * Trigonometric records are recomputed in the calculator's angle unit.
+ *
+ * @param log Log to replay
+ * @param calc Calculator that performs the operations
+ * @param maxIndices Most mismatch positions to keep in the report
+ * @return Counts and the first mismatch positions
+ */
+ReplayReport replayHistoryLog(const HistoryLogReader& log, Calculator& calc, std::size_t maxIndices = 10);
+
+#endif // HISTORY_LOG_H
@@ -0,0 +1,247 @@
+#include "load_generator.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Connection {
+    int fd;
+    std::size_t queued;      ///< Requests written to output
+    std::size_t received;    ///< Responses read
+    std::string output;      ///< Bytes not yet sent
+    std::size_t outputSent;
+    std::string input;       ///< Partial response line
+    std::vector<Clock::time_point> sendTimes;  ///< Ring indexed by request number
+    unsigned events;
+};
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+int connectTo(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Invalid socket path: " + path);
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw systemError("Cannot create socket");
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::runtime_error error = systemError("Cannot connect to " + path);
+        ::close(fd);
+        throw error;
+    }
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+class LoadRun {
+public:
+    LoadRun(const std::string& path, const LoadOptions& options)
+        : options(options)
+        , epollFd(::epoll_create1(EPOLL_CLOEXEC))
+        , open(0)
+        , errors(0)
+        , maxNanoseconds(0) {
+        std::memset(&latency, 0, sizeof(latency));
+        if (epollFd < 0) {
+            throw systemError("Cannot create epoll instance");
+        }
+        std::size_t depth = std::max<std::size_t>(options.pipelineDepth, 1);
+        for (std::size_t i = 0; i < options.connections; ++i) {
+            std::unique_ptr<Connection> connection(new Connection);
+            connection->fd = connectTo(path);
+            connection->queued = 0;
+            connection->received = 0;
+            connection->outputSent = 0;
+            connection->sendTimes.resize(depth);
+            connection->events = 0;
+            connections.push_back(std::move(connection));
+        }
+    }
+
+    ~LoadRun() {
+        for (const auto& connection : connections) {
+            if (connection->fd >= 0) {
+                ::close(connection->fd);
+            }
+        }
+        ::close(epollFd);
+    }
+
+    LoadRun(const LoadRun&) = delete;
+    LoadRun& operator=(const LoadRun&) = delete;
+
+    void run() {
+        for (const auto& connection : connections) {
+            if (options.requestsPerConnection == 0) {
+                continue;
+            }
+            epoll_event event;
+            event.events = 0;
+            event.data.ptr = connection.get();
+            if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, connection->fd, &event) != 0) {
+                throw systemError("Cannot add connection to epoll");
+            }
+            ++open;
+            pump(*connection);
+        }
+
+        epoll_event events[256];
+        while (open > 0) {
+            int count = ::epoll_wait(epollFd, events, 256, -1);
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw systemError("epoll_wait failed");
+            }
+            for (int i = 0; i < count; ++i) {
+                Connection& connection = *static_cast<Connection*>(events[i].data.ptr);
+                if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                    receive(connection);
+                }
+                if (connection.fd >= 0) {
+                    pump(connection);
+                }
+            }
+        }
+    }
+
+    void report(LoadReport& report) const {
+        report.requests = latency.calls;
+        report.errors = errors;
+        report.p50Nanoseconds = latency.percentile(0.50);
+        report.p99Nanoseconds = latency.percentile(0.99);
+        report.maxNanoseconds = maxNanoseconds;
+    }
+
+private:
+    const LoadOptions& options;
+    int epollFd;
+    std::size_t open;
+    std::vector<std::unique_ptr<Connection>> connections;
+    OpMetrics latency;
+    std::uint64_t errors;
+    std::uint64_t maxNanoseconds;
+
+    void receive(Connection& connection) {
+        char buffer[64 * 1024];
+        ssize_t count = ::read(connection.fd, buffer, sizeof(buffer));
+        if (count < 0 && (errno == EAGAIN || errno == EINTR)) {
+            return;
+        }
+        if (count <= 0) {
+            throw std::runtime_error("Server closed a connection after " +
+                                     std::to_string(connection.received) + " responses");
+        }
+        Clock::time_point now = Clock::now();
+        connection.input.append(buffer, static_cast<std::size_t>(count));
+
+        std::size_t start = 0;
+        std::size_t newline;
+        while ((newline = connection.input.find('\n', start)) != std::string::npos) {
+            const Clock::time_point sent =
+                connection.sendTimes[connection.received % connection.sendTimes.size()];
+            std::uint64_t nanoseconds = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent).count());
+            ++latency.calls;
+            latency.totalNanoseconds += nanoseconds;
+            ++latency.buckets[metricBucket(nanoseconds)];
+            maxNanoseconds = std::max(maxNanoseconds, nanoseconds);
+            if (connection.input.compare(start, 3, "ERR") == 0) {
+                ++errors;
+            }
+            ++connection.received;
+            start = newline + 1;
+        }
+        connection.input.erase(0, start);
+
+        if (connection.received == options.requestsPerConnection) {
+            ::epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+            ::close(connection.fd);
+            connection.fd = -1;
+            --open;
+        }
+    }
+
+    // Queues requests up to the pipeline depth, sends what the socket takes
+    // and waits for writability only while output is left over
+    void pump(Connection& connection) {
+        const std::size_t depth = connection.sendTimes.size();
+        Clock::time_point now = Clock::now();
+        while (connection.queued < options.requestsPerConnection &&
+               connection.queued - connection.received < depth) {
+            connection.output += options.request;
+            connection.output += '\n';
+            connection.sendTimes[connection.queued % depth] = now;
+            ++connection.queued;
+        }
+
+        while (connection.outputSent < connection.output.size()) {
+            ssize_t written = ::send(connection.fd, connection.output.data() + connection.outputSent,
+                                     connection.output.size() - connection.outputSent, MSG_NOSIGNAL);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    break;
+                }
+                throw systemError("Cannot send request");
+            }
+            connection.outputSent += static_cast<std::size_t>(written);
+        }
+        if (connection.outputSent == connection.output.size()) {
+            connection.output.clear();
+            connection.outputSent = 0;
+        }
+
+        unsigned wanted = EPOLLIN | (connection.output.empty() ? 0u : static_cast<unsigned>(EPOLLOUT));
+        if (wanted != connection.events) {
+            epoll_event event;
+            event.events = wanted;
+            event.data.ptr = &connection;
+            ::epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+            connection.events = wanted;
+        }
+    }
+};
+
+} // namespace
+
+LoadOptions::LoadOptions()
+    : connections(64)
+    , requestsPerConnection(10000)
+    , pipelineDepth(16)
+    , request("eval 1 + 2 * 3") {
+}
+
+LoadReport runLoad(const std::string& socketPath, const LoadOptions& options) {
+    LoadReport report = {0, 0, 0.0, 0.0, 0, 0, 0};
+    LoadRun load(socketPath, options);
+    Clock::time_point start = Clock::now();
+    load.run();
+    report.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    load.report(report);
+    report.throughput = report.seconds > 0 ? static_cast<double>(report.requests) / report.seconds : 0.0;
+    return report;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file load_generator.h
+ * @brief Load generator for a CalculatorServer
+ */
+
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @struct LoadOptions
+ * @brief Shape of the load sent to a server
+ */
+struct LoadOptions {
+    std::size_t connections;            ///< Concurrent client sessions
+    std::size_t requestsPerConnection;  ///< Requests sent on each session
+    std::size_t pipelineDepth;          ///< Requests in flight per session
+    std::string request;                ///< Request line sent every time, without the newline
+
+    LoadOptions();
+};
+
+/**
+ * @struct LoadReport
+ * @brief Throughput and latency seen by the load generator
+ *
+ * Latency runs from queueing a request to reading its response, so with
+ * pipelining it includes the time spent behind earlier requests.
+ * Percentiles come from the same log-linear histogram as the operation
+ * metrics and are bucket upper bounds.
+ */
+struct LoadReport {
+    std::uint64_t requests;         ///< Responses received
+    std::uint64_t errors;           ///< Responses starting with "ERR"
+    double seconds;                 ///< Wall time of the run
+    double throughput;              ///< Requests per second
+    std::uint64_t p50Nanoseconds;   ///< Median latency
+    std::uint64_t p99Nanoseconds;   ///< 99th percentile latency
+    std::uint64_t maxNanoseconds;   ///< Slowest request
+};
+
+/**
+ * @brief Drive a server from one thread and measure it
+ * @param socketPath Path the server listens on
+ * @param options Connections, request count and pipeline depth
+ * @return Counts, throughput and latency percentiles
+ * @throw std::runtime_error if a connection fails or the server closes one early
+ */
+LoadReport runLoad(const std::string& socketPath, const LoadOptions& options = LoadOptions());
+
+#endif // LOAD_GENERATOR_H
@@ -0,0 +1,77 @@
+#include "load_generator.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+void displayUsage(const char* program) {
+    LoadOptions defaults;
+    std::cerr << "Usage: " << program << " --socket <path> [--connections N] [--requests N]"
+              << " [--pipeline N] [--request TEXT]\n"
+              << "  Sends requests to a calculator started with --serve and reports\n"
+              << "  throughput and latency.\n"
+              << "  --connections N  Concurrent sessions (default " << defaults.connections << ")\n"
+              << "  --requests N     Requests per session (default " << defaults.requestsPerConnection << ")\n"
+              << "  --pipeline N     Requests in flight per session (default " << defaults.pipelineDepth << ")\n"
+              << "  --request TEXT   Request line (default \"" << defaults.request << "\")\n";
+}
+
+bool parseCount(const char* text, std::size_t& value) {
+    char* end;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (*text == '\0' || *text == '-' || *end != '\0') {
+        return false;
+    }
+    value = static_cast<std::size_t>(parsed);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* socketPath = nullptr;
+    LoadOptions options;
+    for (int i = 1; i < argc; ++i) {
+        bool ok = i + 1 < argc;
+        if (ok && std::strcmp(argv[i], "--socket") == 0) {
+            socketPath = argv[++i];
+        } else if (ok && std::strcmp(argv[i], "--connections") == 0) {
+            ok = parseCount(argv[++i], options.connections);
+        } else if (ok && std::strcmp(argv[i], "--requests") == 0) {
+            ok = parseCount(argv[++i], options.requestsPerConnection);
+        } else if (ok && std::strcmp(argv[i], "--pipeline") == 0) {
+            ok = parseCount(argv[++i], options.pipelineDepth) && options.pipelineDepth > 0;
+        } else if (ok && std::strcmp(argv[i], "--request") == 0) {
+            options.request = argv[++i];
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            displayUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (socketPath == nullptr) {
+        displayUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        LoadReport report = runLoad(socketPath, options);
+        std::cout << std::fixed << std::setprecision(3)
+                  << "requests:   " << report.requests << " (" << report.errors << " errors)\n"
+                  << "seconds:    " << report.seconds << "\n"
+                  << std::setprecision(0)
+                  << "throughput: " << report.throughput << " requests/s\n"
+                  << std::setprecision(1)
+                  << "p50:        " << report.p50Nanoseconds / 1000.0 << " us\n"
+                  << "p99:        " << report.p99Nanoseconds / 1000.0 << " us\n"
+                  << "max:        " << report.maxNanoseconds / 1000.0 << " us\n";
+        return report.errors == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 2;
+    }
+}
@@ -1,7 +1,18 @@
+#include "batch.h"
 #include "calculator.h"
+#include "calculator_server.h"
+#include "history_log.h"
+#include "metrics.h"
+#include "parallel_evaluator.h"
+#include "session.h"
+#include "trace.h"
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <iomanip>
 #include <limits>
+#include <memory>
 #include <string>
 
 void displayMenu() {
@@ -35,19 +46,278 @@ void displayMenu() {
 
 void displayHistory(const Calculator& calc) {
     std::cout << "\n=== Calculation History ===\n";
-    const auto& history = calc.getHistory();
+    HistoryView history = calc.historyView();
     if (history.empty()) {
         std::cout << "No calculations performed yet.\n";
         return;
     }
     
-    for (const auto& entry : history) {
-        std::cout << entry << "\n";
+    for (const HistoryRecord& record : history) {
+        std::cout << calc.formatHistoryRecord(record) << "\n";
     }
 }
 
-int main() {
+void displayUsage(const char* program) {
+    std::cerr << "Usage: " << program
+              << " [--stats[=json|prometheus]] [--history-log <path>]"
+              << " [--batch <file|-> [--no-history] [--shortest] [--threads N]]"
+              << " [--serve <socket>] [--decimal N] [--precision exact|high|fast]"
+              << " [--record-session <path>] [--trace <path> [--trace-sample F]]\n"
+              << "  --batch <file|->  Evaluate one expression per line from a file or stdin\n"
+              << "  --no-history      Do not record calculation history in batch mode\n"
+              << "  --shortest        Print full-precision results in batch mode\n"
+              << "  --threads N       Evaluate the batch on N threads (0 = one per core)\n"
+              << "  --stats[=FORMAT]  Print per-operation call counts and latencies to stderr\n"
+              << "                    on exit, as json (default) or prometheus text\n"
+              << "  --history-log <path>  Append every calculation to a persistent log\n"
+              << "                    (<path>.000000, ...); check it with calculator_replay\n"
+              << "  --serve <socket>  Serve calculator sessions on a Unix domain socket\n"
+              << "                    until interrupted\n"
+              << "  --decimal N       Use fixed-point decimals with N digits after the point\n"
+              << "                    in the interactive menu (0-18)\n"
+              << "  --precision P     Accuracy of sin, cos, tan, ln and ^: exact (default),\n"
+              << "                    high (1e-12 relative) or fast (1e-7 relative)\n"
+              << "  --record-session <path>  Record the menu choices and input of the\n"
+              << "                    interactive session; replay with calculator_sessions\n"
+              << "  --trace <path>    Write spans of every calculator call and menu step as\n"
+              << "                    Chrome trace JSON (open in ui.perfetto.dev)\n"
+              << "  --trace-sample F  Trace only this share of the time, 0 < F <= 1\n"
+              << "                    (default 1; 0.01 keeps the overhead within 2%)\n";
+}
+
+int runBatch(const char* path, const BatchOptions& options, int threads, HistoryLog* log,
+             MathPrecision precision) {
+    Calculator calc;
+    calc.attachHistoryLog(log);
+    calc.setMathPrecision(precision);
+    try {
+        if (threads == 1) {
+            BatchEvaluator evaluator(calc, 1, options);
+            evaluator.run(path);
+        } else {
+            ParallelOptions parallelOptions;
+            parallelOptions.threads = static_cast<std::size_t>(threads);
+            parallelOptions.recordHistory = options.recordHistory;
+            parallelOptions.shortestOutput = options.shortestOutput;
+            ParallelEvaluator evaluator(parallelOptions);
+            evaluator.run(path, 1);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+CalculatorServer* activeServer = nullptr;
+
+void stopServer(int) {
+    if (activeServer != nullptr) {
+        activeServer->stop();
+    }
+}
+
+int runServer(const char* socketPath) {
+    try {
+        CalculatorServer server(socketPath);
+        activeServer = &server;
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+        server.run();
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        activeServer = nullptr;
+    } catch (const std::exception& e) {
+        activeServer = nullptr;
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Finishes the --trace file on every way out of main
+struct TraceGuard {
+    const char* path;
+
+    explicit TraceGuard(const char* path) : path(path) {}
+
+    ~TraceGuard() {
+        if (!tracingEnabled()) {
+            return;
+        }
+        try {
+            TraceStats stats = stopTracing();
+            std::cerr << "Trace: " << stats.written << " spans written to " << path << " ("
+                      << stats.dropped << " dropped)\n";
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+        }
+    }
+};
+
+enum class StatsFormat { None, Json, Prometheus };
+
+void printStats(StatsFormat format) {
+    if (format == StatsFormat::None) {
+        return;
+    }
+    MetricsSnapshot snapshot = metricsSnapshot();
+    std::cerr << (format == StatsFormat::Json ? snapshot.toJson() : snapshot.toPrometheus());
+}
+
+int main(int argc, char* argv[]) {
+    const char* batchPath = nullptr;
+    BatchOptions batchOptions;
+    int threads = 1;
+    StatsFormat statsFormat = StatsFormat::None;
+    const char* historyLogPath = nullptr;
+    const char* socketPath = nullptr;
+    int decimalScale = -1;
+    MathPrecision precision = MathPrecision::Exact;
+    const char* sessionPath = nullptr;
+    const char* tracePath = nullptr;
+    TraceOptions traceOptions;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--no-history") == 0) {
+            batchOptions.recordHistory = false;
+        } else if (std::strcmp(argv[i], "--shortest") == 0) {
+            batchOptions.shortestOutput = true;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            char* end;
+            long value = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 0 || value > 1024) {
+                displayUsage(argv[0]);
+                return 2;
+            }
+            threads = static_cast<int>(value);
+        } else if (std::strcmp(argv[i], "--stats") == 0 || std::strcmp(argv[i], "--stats=json") == 0) {
+            statsFormat = StatsFormat::Json;
+        } else if (std::strcmp(argv[i], "--stats=prometheus") == 0) {
+            statsFormat = StatsFormat::Prometheus;
+        } else if (std::strcmp(argv[i], "--history-log") == 0 && i + 1 < argc) {
+            historyLogPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--decimal") == 0 && i + 1 < argc) {
+            char* end;
+            long value = std::strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 0 || value > DecimalContext::MAX_SCALE) {
+                displayUsage(argv[0]);
+                return 2;
+            }
+            decimalScale = static_cast<int>(value);
+        } else if (std::strcmp(argv[i], "--precision") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            if (std::strcmp(name, "exact") == 0) {
+                precision = MathPrecision::Exact;
+            } else if (std::strcmp(name, "high") == 0) {
+                precision = MathPrecision::High;
+            } else if (std::strcmp(name, "fast") == 0) {
+                precision = MathPrecision::Fast;
+            } else {
+                displayUsage(argv[0]);
+                return 2;
+            }
+        } else if (std::strcmp(argv[i], "--record-session") == 0 && i + 1 < argc) {
+            sessionPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace-sample") == 0 && i + 1 < argc) {
+            char* end;
+            double value = std::strtod(argv[++i], &end);
+            if (*end != '\0' || !(value > 0 && value <= 1)) {
+                displayUsage(argv[0]);
+                return 2;
+            }
+            traceOptions.sampleFraction = value;
+        } else {
+            displayUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (sessionPath != nullptr && (batchPath != nullptr || socketPath != nullptr)) {
+        std::cerr << "--record-session records the interactive menu only\n";
+        return 2;
+    }
+    if (statsFormat != StatsFormat::None) {
+#ifdef CALCULATOR_METRICS
+        setMetricsEnabled(true);
+#else
+        std::cerr << "--stats: built without CALCULATOR_METRICS\n";
+        return 2;
+#endif
+    }
+    TraceGuard trace(tracePath);
+    if (tracePath != nullptr) {
+#ifdef CALCULATOR_METRICS
+        try {
+            startTracing(tracePath, traceOptions);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+#else
+        std::cerr << "--trace: built without CALCULATOR_METRICS\n";
+        return 2;
+#endif
+    }
+    if (historyLogPath != nullptr && batchPath != nullptr && threads != 1) {
+        std::cerr << "--history-log needs a single-threaded batch\n";
+        return 2;
+    }
+    if (precision != MathPrecision::Exact && historyLogPath != nullptr) {
+        // calculator_replay re-executes the log with the exact functions
+        std::cerr << "--history-log cannot be combined with --precision\n";
+        return 2;
+    }
+    if (precision != MathPrecision::Exact && batchPath != nullptr && threads != 1) {
+        std::cerr << "--precision needs a single-threaded batch\n";
+        return 2;
+    }
+    if (socketPath != nullptr) {
+        if (batchPath != nullptr || historyLogPath != nullptr || precision != MathPrecision::Exact) {
+            std::cerr << "--serve cannot be combined with --batch, --history-log or --precision\n";
+            return 2;
+        }
+        int status = runServer(socketPath);
+        printStats(statsFormat);
+        return status;
+    }
+    std::unique_ptr<HistoryLog> historyLog;
+    if (historyLogPath != nullptr) {
+        try {
+            historyLog.reset(new HistoryLog(historyLogPath));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+    if (batchPath != nullptr) {
+        int status = runBatch(batchPath, batchOptions, threads, historyLog.get(), precision);
+        printStats(statsFormat);
+        return status;
+    }
+
     Calculator calc;
+    calc.attachHistoryLog(historyLog.get());
+    calc.setMathPrecision(precision);
+    if (decimalScale >= 0) {
+        calc.enableDecimalMode(decimalScale);
+    }
+    std::unique_ptr<SessionRecorder> recorder;
+    if (sessionPath != nullptr) {
+        SessionSettings settings;
+        settings.precision = precision;
+        settings.decimalScale = decimalScale;
+        try {
+            recorder.reset(new SessionRecorder(sessionPath, settings));
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
     bool running = true;
     
     std::cout << "Welcome to Professional Calculator!\n";
@@ -55,119 +325,108 @@ int main() {
     std::cout << "memory functions, and calculation history.\n";
     
     while (running) {
-        std::cout << "\nCurrent display: " << calc.getDisplayText() << "\n";
-        displayMenu();
+        {
+            TraceSpan span("render_menu");
+            std::cout << "\nCurrent display: " << calc.getDisplayText() << "\n";
+            displayMenu();
+            std::cout << "\nChoose an option (1-21): " << std::flush;
+        }
         
-        std::cout << "\nChoose an option (1-21): ";
         int choice;
-        std::cin >> choice;
+        {
+            TraceSpan span("read_choice");
+            std::cin >> choice;
+            if (std::cin.eof()) {
+                break;
+            }
+            
+            // Clear input buffer
+            std::cin.clear();
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        }
         
-        // Clear input buffer
-        std::cin.clear();
-        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (choice == 21) {
+            running = false;
+            continue;
+        }
+        if (choice < 1 || choice > 20) {
+            std::cout << "Invalid option. Please try again.\n";
+            continue;
+        }
+        SessionStep step(static_cast<SessionAction>(choice));
+        if (step.action == SessionAction::EnterNumber) {
+            TraceSpan span("read_number");
+            std::cout << "Enter a number: " << std::flush;
+            std::string input;
+            std::getline(std::cin, input);
+            for (char digit : input) {
+                if (std::isdigit(digit) || digit == '.' || digit == '-' ||
+                    digit == 'e' || digit == 'E') {
+                    step.keys += digit;
+                }
+            }
+        }
         
         try {
-            switch (choice) {
-                case 1: {
-                    std::cout << "Enter a number: ";
-                    std::string input;
-                    std::getline(std::cin, input);
-                    for (char digit : input) {
-                        if (std::isdigit(digit) || digit == '.' || digit == '-') {
-                            calc.appendNumber(digit);
-                        }
-                    }
-                    break;
-                }
-                case 2:
-                    calc.setOperation('+');
-                    break;
-                case 3:
-                    calc.setOperation('-');
-                    break;
-                case 4:
-                    calc.setOperation('*');
-                    break;
-                case 5:
-                    calc.setOperation('/');
-                    break;
-                case 6: {
-                    double current = std::stod(calc.getDisplayText());
-                    double result = calc.sqrt(current);
-                    std::cout << "Square root of " << current << " = " << result << "\n";
+            TraceSpan span("menu_step");
+            if (recorder) {
+                recorder->record(step);
+            }
+            double operand = 0;
+            double result = performSessionStep(calc, step, &operand);
+            switch (step.action) {
+                case SessionAction::SquareRoot:
+                    std::cout << "Square root of " << operand << " = " << result << "\n";
                     break;
-                }
-                case 7:
-                    calc.setOperation('^');
+                case SessionAction::NaturalLog:
+                    std::cout << "Natural log of " << operand << " = " << result << "\n";
                     break;
-                case 8: {
-                    double current = std::stod(calc.getDisplayText());
-                    double result = calc.ln(current);
-                    std::cout << "Natural log of " << current << " = " << result << "\n";
+                case SessionAction::Sine:
+                    std::cout << "Sine of " << operand << " = " << result << "\n";
                     break;
-                }
-                case 9: {
-                    double current = std::stod(calc.getDisplayText());
-                    double result = calc.sin(current);
-                    std::cout << "Sine of " << current << " = " << result << "\n";
+                case SessionAction::Cosine:
+                    std::cout << "Cosine of " << operand << " = " << result << "\n";
                     break;
-                }
-                case 10: {
-                    double current = std::stod(calc.getDisplayText());
-                    double result = calc.cos(current);
-                    std::cout << "Cosine of " << current << " = " << result << "\n";
+                case SessionAction::Tangent:
+                    std::cout << "Tangent of " << operand << " = " << result << "\n";
                     break;
-                }
-                case 11: {
-                    double current = std::stod(calc.getDisplayText());
-                    double result = calc.tan(current);
-                    std::cout << "Tangent of " << current << " = " << result << "\n";
-                    break;
-                }
-                case 12:
-                    calc.memoryStore();
+                case SessionAction::MemoryStore:
                     std::cout << "Current value stored in memory\n";
                     break;
-                case 13:
-                    calc.memoryRecall();
+                case SessionAction::MemoryRecall:
                     std::cout << "Memory value recalled\n";
                     break;
-                case 14:
-                    calc.memoryClear();
+                case SessionAction::MemoryClear:
                     std::cout << "Memory cleared\n";
                     break;
-                case 15:
-                    calc.memoryAdd();
+                case SessionAction::MemoryAdd:
                     std::cout << "Current value added to memory\n";
                     break;
-                case 16:
-                    calc.memorySubtract();
+                case SessionAction::MemorySubtract:
                     std::cout << "Current value subtracted from memory\n";
                     break;
-                case 17:
-                    calc.calculate();
-                    break;
-                case 18:
-                    calc.clear();
-                    break;
-                case 19:
+                case SessionAction::ShowHistory:
                     displayHistory(calc);
                     break;
-                case 20:
-                    // Toggle between radians and degrees would go here
-                    std::cout << "Angle unit toggled\n";
-                    break;
-                case 21:
-                    running = false;
+                case SessionAction::ToggleAngleUnit:
+                    std::cout << "Angle unit: " << (calc.isRadians() ? "radians" : "degrees") << "\n";
                     break;
                 default:
-                    std::cout << "Invalid option. Please try again.\n";
+                    break;
             }
         } catch (const std::exception& e) {
             std::cout << "Error: " << e.what() << "\n";
         }
     }
     
+    if (recorder) {
+        try {
+            recorder->finish(calc);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+        }
+    }
     std::cout << "\nThank you for using Professional Calculator!\n";
+    printStats(statsFormat);
     return 0;
 }
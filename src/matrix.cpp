@@ -0,0 +1,520 @@
+#include "matrix.h"
+#include "array_kernels.h"
+#include "array_ops.h"
+#include "calc_result.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+// Columns of the factored panel in LuDecomposition
+const std::size_t LU_PANEL = 64;
+
+// Edge of the square tiles transpose() copies
+const std::size_t TRANSPOSE_TILE = 32;
+
+const std::size_t DOUBLES_PER_LINE = MatrixPool::ALIGNMENT / sizeof(double);
+
+std::size_t roundUp(std::size_t value, std::size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+std::size_t sizeClass(std::size_t count) {
+    std::size_t sizeClass = 0;
+    while (sizeClass < MatrixPool::SIZE_CLASSES && (DOUBLES_PER_LINE << sizeClass) < count) {
+        ++sizeClass;
+    }
+    return sizeClass;
+}
+
+double* alignedAllocate(std::size_t bytes) {
+#ifdef _WIN32
+    void* block = _aligned_malloc(bytes, MatrixPool::ALIGNMENT);
+#else
+    void* block = nullptr;
+    if (posix_memalign(&block, MatrixPool::ALIGNMENT, bytes) != 0) {
+        block = nullptr;
+    }
+#endif
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    return static_cast<double*>(block);
+}
+
+void alignedFree(double* block) {
+#ifdef _WIN32
+    _aligned_free(block);
+#else
+    std::free(block);
+#endif
+}
+
+// Scratch block returned to the shared pool when it goes out of scope
+class PooledBlock {
+public:
+    explicit PooledBlock(std::size_t count) : count(count), block(MatrixPool::shared().allocate(count)) {}
+    ~PooledBlock() { MatrixPool::shared().release(block, count); }
+
+    PooledBlock(const PooledBlock&) = delete;
+    PooledBlock& operator=(const PooledBlock&) = delete;
+
+    double* get() const { return block; }
+
+private:
+    std::size_t count;
+    double* block;
+};
+
+std::string shapeName(const Matrix& m) {
+    return std::to_string(m.rows()) + "x" + std::to_string(m.cols());
+}
+
+void checkSameShape(const Matrix& a, const Matrix& b) {
+    if (a.rows() != b.rows() || a.cols() != b.cols()) {
+        throw std::invalid_argument("Matrix shapes differ: " + shapeName(a) + " and " + shapeName(b));
+    }
+}
+
+// Runs an array operation over both operands' storage; the zero padding
+// of the rows stays zero under add, subtract and multiply
+template <typename Op>
+Matrix elementwise(const Matrix& a, const Matrix& b, Op op) {
+    checkSameShape(a, b);
+    Matrix out(a.rows(), a.cols());
+    if (a.rows() > 0) {
+        op(a.row(0), b.row(0), out.row(0), a.rows() * a.stride());
+    }
+    return out;
+}
+
+// Copies rows x depth of the left operand, times alpha, into micro-panels
+// of tileRows rows stored column by column, zero-padding the last one
+void packLeft(const double* a, std::size_t lda, std::size_t rows, std::size_t depth, std::size_t tileRows,
+              double alpha, double* packed) {
+    for (std::size_t i0 = 0; i0 < rows; i0 += tileRows) {
+        const std::size_t height = std::min(tileRows, rows - i0);
+        for (std::size_t k = 0; k < depth; ++k) {
+            for (std::size_t i = 0; i < height; ++i) {
+                packed[i] = alpha * a[(i0 + i) * lda + k];
+            }
+            for (std::size_t i = height; i < tileRows; ++i) {
+                packed[i] = 0.0;
+            }
+            packed += tileRows;
+        }
+    }
+}
+
+// Copies depth x cols of the right operand into micro-panels of GEMM_COLS
+// columns stored row by row, zero-padding the last one
+void packRight(const double* b, std::size_t ldb, std::size_t depth, std::size_t cols, double* packed) {
+    for (std::size_t j0 = 0; j0 < cols; j0 += GEMM_COLS) {
+        const std::size_t width = std::min(GEMM_COLS, cols - j0);
+        for (std::size_t k = 0; k < depth; ++k) {
+            const double* source = b + k * ldb + j0;
+            for (std::size_t j = 0; j < width; ++j) {
+                packed[j] = source[j];
+            }
+            for (std::size_t j = width; j < GEMM_COLS; ++j) {
+                packed[j] = 0.0;
+            }
+            packed += GEMM_COLS;
+        }
+    }
+}
+
+// c += alpha * a * b for an m x depth a and a depth x n b, all row-major.
+// Every element of c sums its products in k order whatever the blocking,
+// so the result does not depend on the pool.
+void multiplyAccumulate(std::size_t m, std::size_t n, std::size_t depth, double alpha, const double* a,
+                        std::size_t lda, const double* b, std::size_t ldb, double* c, std::size_t ldc,
+                        WorkStealingPool* pool, const MatrixOptions& options) {
+    if (m == 0 || n == 0 || depth == 0) {
+        return;
+    }
+    const ArrayKernelTable& kernels = activeArrayKernels();
+    const std::size_t tileRows = kernels.gemmRows;
+    std::size_t blockRows = roundUp(std::max<std::size_t>(options.blockRows, 1), tileRows);
+    if (pool) {
+        // At least two row blocks per worker, so that stealing can balance them
+        blockRows = std::min(blockRows, roundUp((m + 2 * pool->size() - 1) / (2 * pool->size()), tileRows));
+    }
+    const std::size_t blockDepth = std::min(std::max<std::size_t>(options.blockDepth, 1), depth);
+    const std::size_t blockCols = std::min(roundUp(std::max<std::size_t>(options.blockCols, 1), GEMM_COLS),
+                                           roundUp(n, GEMM_COLS));
+    const std::size_t rowBlocks = (m + blockRows - 1) / blockRows;
+
+    PooledBlock right(blockDepth * blockCols);
+    for (std::size_t j0 = 0; j0 < n; j0 += blockCols) {
+        const std::size_t width = std::min(blockCols, n - j0);
+        for (std::size_t k0 = 0; k0 < depth; k0 += blockDepth) {
+            const std::size_t panelDepth = std::min(blockDepth, depth - k0);
+            packRight(b + k0 * ldb + j0, ldb, panelDepth, width, right.get());
+            parallelFor(pool, rowBlocks, [&](std::size_t block) {
+                const std::size_t i0 = block * blockRows;
+                const std::size_t height = std::min(blockRows, m - i0);
+                PooledBlock left(roundUp(height, tileRows) * panelDepth);
+                packLeft(a + i0 * lda + k0, lda, height, panelDepth, tileRows, alpha, left.get());
+                for (std::size_t j = 0; j < width; j += GEMM_COLS) {
+                    const double* rightPanel = right.get() + j * panelDepth;
+                    for (std::size_t i = 0; i < height; i += tileRows) {
+                        kernels.gemmTile(panelDepth, left.get() + i * panelDepth, rightPanel,
+                                         c + (i0 + i) * ldc + j0 + j, ldc, std::min(tileRows, height - i),
+                                         std::min(GEMM_COLS, width - j));
+                    }
+                }
+            });
+        }
+    }
+}
+
+} // namespace
+
+MatrixPool::MatrixPool(std::size_t maxCachedBytes) : cached(0), maxCached(maxCachedBytes) {}
+
+MatrixPool::~MatrixPool() {
+    trim();
+}
+
+double* MatrixPool::allocate(std::size_t count) {
+    if (count == 0) {
+        return nullptr;
+    }
+    const std::size_t index = sizeClass(count);
+    if (index >= MatrixPool::SIZE_CLASSES) {
+        throw std::bad_alloc();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<double*>& blocks = freeBlocks[index];
+        if (!blocks.empty()) {
+            double* block = blocks.back();
+            blocks.pop_back();
+            cached -= (DOUBLES_PER_LINE << index) * sizeof(double);
+            return block;
+        }
+    }
+    return alignedAllocate((DOUBLES_PER_LINE << index) * sizeof(double));
+}
+
+void MatrixPool::release(double* block, std::size_t count) {
+    if (!block) {
+        return;
+    }
+    const std::size_t index = sizeClass(count);
+    const std::size_t bytes = (DOUBLES_PER_LINE << index) * sizeof(double);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cached + bytes <= maxCached) {
+            freeBlocks[index].push_back(block);
+            cached += bytes;
+            return;
+        }
+    }
+    alignedFree(block);
+}
+
+void MatrixPool::trim() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::vector<double*>& blocks : freeBlocks) {
+        for (double* block : blocks) {
+            alignedFree(block);
+        }
+        blocks.clear();
+    }
+    cached = 0;
+}
+
+std::size_t MatrixPool::cachedBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return cached;
+}
+
+MatrixPool& MatrixPool::shared() {
+    // Never destroyed, so matrices in other static objects can outlive it
+    static MatrixPool* pool = new MatrixPool();
+    return *pool;
+}
+
+Matrix::Matrix() : rowCount(0), colCount(0), rowStride(0), elements(nullptr) {}
+
+Matrix::Matrix(std::size_t rows, std::size_t cols, double fill) : Matrix() {
+    allocate(rows, cols);
+    if (fill != 0.0 || std::signbit(fill)) {
+        for (std::size_t i = 0; i < rows; ++i) {
+            std::fill(row(i), row(i) + cols, fill);
+        }
+    }
+}
+
+Matrix::Matrix(std::size_t rows, std::size_t cols, std::initializer_list<double> values) : Matrix(rows, cols) {
+    if (values.size() != rows * cols) {
+        throw std::invalid_argument("A " + std::to_string(rows) + "x" + std::to_string(cols) + " matrix needs " +
+                                    std::to_string(rows * cols) + " values, got " + std::to_string(values.size()));
+    }
+    const double* value = values.begin();
+    for (std::size_t i = 0; i < rows; ++i) {
+        std::copy(value, value + cols, row(i));
+        value += cols;
+    }
+}
+
+Matrix Matrix::column(const std::vector<double>& values) {
+    Matrix m(values.size(), 1);
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        m(i, 0) = values[i];
+    }
+    return m;
+}
+
+Matrix Matrix::identity(std::size_t size) {
+    Matrix m(size, size);
+    for (std::size_t i = 0; i < size; ++i) {
+        m(i, i) = 1.0;
+    }
+    return m;
+}
+
+Matrix::Matrix(const Matrix& other) : Matrix() {
+    allocate(other.rowCount, other.colCount);
+    std::copy(other.elements, other.elements + rowCount * rowStride, elements);
+}
+
+Matrix::Matrix(Matrix&& other) noexcept
+    : rowCount(other.rowCount), colCount(other.colCount), rowStride(other.rowStride), elements(other.elements) {
+    other.rowCount = other.colCount = other.rowStride = 0;
+    other.elements = nullptr;
+}
+
+Matrix& Matrix::operator=(const Matrix& other) {
+    if (this != &other) {
+        Matrix copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+Matrix& Matrix::operator=(Matrix&& other) noexcept {
+    std::swap(rowCount, other.rowCount);
+    std::swap(colCount, other.colCount);
+    std::swap(rowStride, other.rowStride);
+    std::swap(elements, other.elements);
+    return *this;
+}
+
+Matrix::~Matrix() {
+    MatrixPool::shared().release(elements, rowCount * rowStride);
+}
+
+void Matrix::allocate(std::size_t rows, std::size_t cols) {
+    rowStride = roundUp(cols, DOUBLES_PER_LINE);
+    elements = MatrixPool::shared().allocate(rows * rowStride);
+    rowCount = rows;
+    colCount = cols;
+    if (elements) {
+        std::fill(elements, elements + rows * rowStride, 0.0);
+    }
+}
+
+double Matrix::at(std::size_t i, std::size_t j) const {
+    if (i >= rowCount || j >= colCount) {
+        throw std::out_of_range("Element (" + std::to_string(i) + ", " + std::to_string(j) + ") is outside a " +
+                                shapeName(*this) + " matrix");
+    }
+    return (*this)(i, j);
+}
+
+bool Matrix::operator==(const Matrix& other) const {
+    if (rowCount != other.rowCount || colCount != other.colCount) {
+        return false;
+    }
+    for (std::size_t i = 0; i < rowCount; ++i) {
+        if (!std::equal(row(i), row(i) + colCount, other.row(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+MatrixOptions::MatrixOptions() : blockRows(96), blockDepth(256), blockCols(512) {}
+
+Matrix matrixAdd(const Matrix& a, const Matrix& b) {
+    return elementwise(a, b, arrayAdd);
+}
+
+Matrix matrixSubtract(const Matrix& a, const Matrix& b) {
+    return elementwise(a, b, arraySubtract);
+}
+
+Matrix matrixMultiplyElements(const Matrix& a, const Matrix& b) {
+    return elementwise(a, b, arrayMultiply);
+}
+
+Matrix matrixDivideElements(const Matrix& a, const Matrix& b) {
+    checkSameShape(a, b);
+    Matrix out(a.rows(), a.cols());
+    // Row by row: the zero padding would count as division by zero
+    for (std::size_t i = 0; i < a.rows(); ++i) {
+        if (arrayDivide(a.row(i), b.row(i), out.row(i), a.cols()) != 0) {
+            throw std::domain_error(calcStatusMessage(CalcStatus::DivisionByZero));
+        }
+    }
+    return out;
+}
+
+Matrix matrixProduct(const Matrix& a, const Matrix& b, WorkStealingPool* pool, const MatrixOptions& options) {
+    if (a.cols() != b.rows()) {
+        throw std::invalid_argument("Cannot multiply a " + shapeName(a) + " matrix by a " + shapeName(b) + " one");
+    }
+    Matrix c(a.rows(), b.cols());
+    if (c.rows() > 0 && c.cols() > 0) {
+        multiplyAccumulate(a.rows(), b.cols(), a.cols(), 1.0, a.row(0), a.stride(), b.row(0), b.stride(),
+                           c.row(0), c.stride(), pool, options);
+    }
+    return c;
+}
+
+Matrix transpose(const Matrix& a) {
+    Matrix t(a.cols(), a.rows());
+    for (std::size_t i0 = 0; i0 < a.rows(); i0 += TRANSPOSE_TILE) {
+        const std::size_t i1 = std::min(i0 + TRANSPOSE_TILE, a.rows());
+        for (std::size_t j0 = 0; j0 < a.cols(); j0 += TRANSPOSE_TILE) {
+            const std::size_t j1 = std::min(j0 + TRANSPOSE_TILE, a.cols());
+            for (std::size_t i = i0; i < i1; ++i) {
+                const double* source = a.row(i);
+                for (std::size_t j = j0; j < j1; ++j) {
+                    t(j, i) = source[j];
+                }
+            }
+        }
+    }
+    return t;
+}
+
+LuDecomposition::LuDecomposition(const Matrix& a, WorkStealingPool* pool) : lu(a), swaps(a.rows()) {
+    if (a.rows() != a.cols()) {
+        throw std::invalid_argument("LU decomposition needs a square matrix, got " + shapeName(a));
+    }
+    const std::size_t n = a.rows();
+    for (std::size_t k0 = 0; k0 < n; k0 += LU_PANEL) {
+        const std::size_t end = std::min(k0 + LU_PANEL, n);
+        // Factor the panel of columns k0 .. end, swapping whole rows
+        for (std::size_t j = k0; j < end; ++j) {
+            std::size_t pivot = j;
+            double largest = std::fabs(lu(j, j));
+            for (std::size_t i = j + 1; i < n; ++i) {
+                if (std::fabs(lu(i, j)) > largest) {
+                    largest = std::fabs(lu(i, j));
+                    pivot = i;
+                }
+            }
+            if (largest == 0.0) {
+                throw std::domain_error(calcStatusMessage(CalcStatus::SingularMatrix));
+            }
+            swaps[j] = pivot;
+            if (pivot != j) {
+                std::swap_ranges(lu.row(j), lu.row(j) + n, lu.row(pivot));
+            }
+            const double* pivotRow = lu.row(j);
+            for (std::size_t i = j + 1; i < n; ++i) {
+                double* target = lu.row(i);
+                const double factor = target[j] /= pivotRow[j];
+                for (std::size_t c = j + 1; c < end; ++c) {
+                    target[c] -= factor * pivotRow[c];
+                }
+            }
+        }
+        if (end == n) {
+            break;
+        }
+        // U12 = L11^-1 A12, then A22 -= L21 U12 with the blocked product
+        for (std::size_t j = k0; j < end; ++j) {
+            const double* source = lu.row(j);
+            for (std::size_t i = j + 1; i < end; ++i) {
+                double* target = lu.row(i);
+                const double factor = target[j];
+                for (std::size_t c = end; c < n; ++c) {
+                    target[c] -= factor * source[c];
+                }
+            }
+        }
+        multiplyAccumulate(n - end, n - end, end - k0, -1.0, lu.row(end) + k0, lu.stride(), lu.row(k0) + end,
+                           lu.stride(), lu.row(end) + end, lu.stride(), pool, MatrixOptions());
+    }
+}
+
+double LuDecomposition::determinant() const {
+    double determinant = 1.0;
+    for (std::size_t i = 0; i < lu.rows(); ++i) {
+        determinant *= swaps[i] == i ? lu(i, i) : -lu(i, i);
+    }
+    return determinant;
+}
+
+Matrix LuDecomposition::solve(const Matrix& b) const {
+    const std::size_t n = lu.rows();
+    if (b.rows() != n) {
+        throw std::invalid_argument("Right-hand side has " + std::to_string(b.rows()) + " rows, expected " +
+                                    std::to_string(n));
+    }
+    Matrix x(b);
+    const std::size_t width = x.cols();
+    for (std::size_t i = 0; i < n; ++i) {
+        if (swaps[i] != i) {
+            std::swap_ranges(x.row(i), x.row(i) + width, x.row(swaps[i]));
+        }
+    }
+    // L y = P b, then U x = y, a row of right-hand sides at a time
+    for (std::size_t i = 0; i < n; ++i) {
+        double* target = x.row(i);
+        for (std::size_t j = 0; j < i; ++j) {
+            const double factor = lu(i, j);
+            const double* source = x.row(j);
+            for (std::size_t c = 0; c < width; ++c) {
+                target[c] -= factor * source[c];
+            }
+        }
+    }
+    for (std::size_t i = n; i-- > 0;) {
+        double* target = x.row(i);
+        for (std::size_t j = i + 1; j < n; ++j) {
+            const double factor = lu(i, j);
+            const double* source = x.row(j);
+            for (std::size_t c = 0; c < width; ++c) {
+                target[c] -= factor * source[c];
+            }
+        }
+        for (std::size_t c = 0; c < width; ++c) {
+            target[c] /= lu(i, i);
+        }
+    }
+    return x;
+}
+
+std::vector<double> LuDecomposition::solve(const std::vector<double>& b) const {
+    Matrix x = solve(Matrix::column(b));
+    std::vector<double> result(x.rows());
+    for (std::size_t i = 0; i < x.rows(); ++i) {
+        result[i] = x(i, 0);
+    }
+    return result;
+}
+
+Matrix solve(const Matrix& a, const Matrix& b, WorkStealingPool* pool) {
+    return LuDecomposition(a, pool).solve(b);
+}
+
+std::vector<double> solve(const Matrix& a, const std::vector<double>& b, WorkStealingPool* pool) {
+    return LuDecomposition(a, pool).solve(b);
+}
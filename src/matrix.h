@@ -0,0 +1,276 @@
+/**
+ * @file matrix.h
+ * @brief Dense matrices with blocked multiplication and LU decomposition
+ */
+
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include <cstddef>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+class WorkStealingPool;
+
+/**
+ * @class MatrixPool
+ * @brief Recycles 64-byte aligned blocks of doubles for matrix storage
+ *
+ * Blocks come in power-of-two sizes. Released blocks are kept on a free
+ * list per size, up to a byte limit, so that temporaries of a repeated
+ * computation reuse the same memory instead of going back to the system
+ * allocator. Safe to use from several threads.
+ */
+class MatrixPool {
+public:
+    /// Alignment of every block: one cache line, one AVX-512 register
+    static const std::size_t ALIGNMENT = 64;
+
+    /// Block sizes served: 8, 16, 32, ... up to 8 << 47 doubles
+    static const std::size_t SIZE_CLASSES = 48;
+
+    /**
+     * @brief Construct an empty pool
+     * @param maxCachedBytes Released bytes kept for reuse; beyond that
+     *        blocks are freed
+     */
+    explicit MatrixPool(std::size_t maxCachedBytes = 64 << 20);
+
+    ~MatrixPool();
+
+    MatrixPool(const MatrixPool&) = delete;
+    MatrixPool& operator=(const MatrixPool&) = delete;
+
+    /**
+     * @brief Get a block of at least count doubles
+     * @param count Doubles needed
+     * @return Aligned, uninitialized block, or nullptr when count is 0
+     * @throw std::bad_alloc if the memory cannot be allocated
+     */
+    double* allocate(std::size_t count);
+
+    /**
+     * @brief Return a block obtained from allocate()
+     * @param block Block to return, may be nullptr
+     * @param count The count it was allocated with
+     */
+    void release(double* block, std::size_t count);
+
+    /**
+     * @brief Free every cached block
+     */
+    void trim();
+
+    /**
+     * @brief Get the bytes held on the free lists
+     */
+    std::size_t cachedBytes() const;
+
+    /**
+     * @brief Get the pool Matrix uses
+     */
+    static MatrixPool& shared();
+
+private:
+    mutable std::mutex mutex;
+    std::vector<double*> freeBlocks[SIZE_CLASSES];  ///< Blocks of 8 << index doubles
+    std::size_t cached;                              ///< Bytes on the free lists
+    std::size_t maxCached;
+};
+
+/**
+ * @class Matrix
+ * @brief Row-major matrix of doubles on aligned, padded rows
+ *
+ * Every row starts on a 64-byte boundary: rows are stride() doubles
+ * apart, stride() being cols() rounded up to a multiple of 8. The padding
+ * is kept at zero. Storage comes from MatrixPool::shared().
+ */
+class Matrix {
+public:
+    /** @brief Construct a 0 x 0 matrix */
+    Matrix();
+
+    /**
+     * @brief Construct a matrix with every element set to a value
+     * @param rows Number of rows
+     * @param cols Number of columns
+     * @param fill Initial value of the elements
+     */
+    Matrix(std::size_t rows, std::size_t cols, double fill = 0.0);
+
+    /**
+     * @brief Construct a matrix from values listed row by row
+     * @throw std::invalid_argument if values does not hold rows * cols numbers
+     */
+    Matrix(std::size_t rows, std::size_t cols, std::initializer_list<double> values);
+
+    /**
+     * @brief Construct a column vector
+     * @param values Elements, one per row
+     */
+    static Matrix column(const std::vector<double>& values);
+
+    /**
+     * @brief Construct an identity matrix
+     * @param size Number of rows and columns
+     */
+    static Matrix identity(std::size_t size);
+
+    Matrix(const Matrix& other);
+    Matrix(Matrix&& other) noexcept;
+    Matrix& operator=(const Matrix& other);
+    Matrix& operator=(Matrix&& other) noexcept;
+    ~Matrix();
+
+    std::size_t rows() const { return rowCount; }
+    std::size_t cols() const { return colCount; }
+
+    /** @brief Get the distance between row starts in doubles */
+    std::size_t stride() const { return rowStride; }
+
+    double* row(std::size_t i) { return elements + i * rowStride; }
+    const double* row(std::size_t i) const { return elements + i * rowStride; }
+
+    /** @brief Get an element without bounds checks */
+    double& operator()(std::size_t i, std::size_t j) { return elements[i * rowStride + j]; }
+    double operator()(std::size_t i, std::size_t j) const { return elements[i * rowStride + j]; }
+
+    /**
+     * @brief Get an element
+     * @throw std::out_of_range if i or j is outside the matrix
+     */
+    double at(std::size_t i, std::size_t j) const;
+
+    /** @brief Compare shapes and elements exactly */
+    bool operator==(const Matrix& other) const;
+    bool operator!=(const Matrix& other) const { return !(*this == other); }
+
+private:
+    void allocate(std::size_t rows, std::size_t cols);
+
+    std::size_t rowCount;
+    std::size_t colCount;
+    std::size_t rowStride;
+    double* elements;  ///< rowCount * rowStride doubles from MatrixPool::shared()
+};
+
+/**
+ * @struct MatrixOptions
+ * @brief Cache block sizes of matrixProduct()
+ *
+ * A blockDepth x blockCols panel of the right operand (1 MiB by default)
+ * is packed to stay in the L2 cache while blockRows x blockDepth blocks
+ * of the left operand are packed and multiplied with it; the micro-kernel
+ * then works on a register tile with one packed slice of each in L1.
+ */
+struct MatrixOptions {
+    std::size_t blockRows;   ///< Rows of the left operand packed per task
+    std::size_t blockDepth;  ///< Inner dimension packed at a time
+    std::size_t blockCols;   ///< Columns of the right operand packed at a time
+
+    MatrixOptions();
+};
+
+/**
+ * @brief Element-wise a + b
+ * @throw std::invalid_argument if the shapes differ
+ */
+Matrix matrixAdd(const Matrix& a, const Matrix& b);
+
+/** @brief Element-wise a - b */
+Matrix matrixSubtract(const Matrix& a, const Matrix& b);
+
+/** @brief Element-wise (Hadamard) product of a and b */
+Matrix matrixMultiplyElements(const Matrix& a, const Matrix& b);
+
+/**
+ * @brief Element-wise a / b
+ * @throw std::invalid_argument if the shapes differ
+ * @throw std::domain_error "Division by zero" if any element of b is 0,
+ *        as Calculator::divide does
+ */
+Matrix matrixDivideElements(const Matrix& a, const Matrix& b);
+
+/**
+ * @brief Matrix product a * b
+ *
+ * Packs cache blocks of both operands and runs the SIMD micro-kernel of
+ * the active array instruction set (see setArrayIsa()) over register
+ * tiles. With a pool, the row blocks of each packed panel are spread
+ * over the workers; the result does not depend on the worker count.
+ *
+ * @param pool Workers, or nullptr for the calling thread
+ * @throw std::invalid_argument if a.cols() != b.rows()
+ */
+Matrix matrixProduct(const Matrix& a, const Matrix& b, WorkStealingPool* pool = nullptr,
+                     const MatrixOptions& options = MatrixOptions());
+
+/**
+ * @brief Transpose, copying in cache-sized tiles
+ */
+Matrix transpose(const Matrix& a);
+
+/**
+ * @class LuDecomposition
+ * @brief PA = LU factorization with partial pivoting
+ *
+ * Factors column panels and updates the trailing matrix with the blocked
+ * product of matrixProduct(), so large factorizations run at close to
+ * its speed.
+ */
+class LuDecomposition {
+public:
+    /**
+     * @brief Factor a square matrix
+     * @param a Matrix to factor
+     * @param pool Workers for the trailing updates, or nullptr
+     * @throw std::invalid_argument if a is not square
+     * @throw std::domain_error "Singular matrix" if a pivot is exactly 0
+     */
+    explicit LuDecomposition(const Matrix& a, WorkStealingPool* pool = nullptr);
+
+    /**
+     * @brief Get L and U in one matrix
+     *
+     * U is the upper triangle including the diagonal; L is the strict
+     * lower triangle, its unit diagonal implied.
+     */
+    const Matrix& factors() const { return lu; }
+
+    /**
+     * @brief Get the row interchanges
+     * @return Row i was swapped with row pivots()[i] >= i at step i
+     */
+    const std::vector<std::size_t>& pivots() const { return swaps; }
+
+    /** @brief Get the determinant of the factored matrix */
+    double determinant() const;
+
+    /**
+     * @brief Solve A X = B
+     * @param b Right-hand sides, one per column
+     * @throw std::invalid_argument if b.rows() differs from the size of A
+     */
+    Matrix solve(const Matrix& b) const;
+
+    /** @brief Solve A x = b for one right-hand side */
+    std::vector<double> solve(const std::vector<double>& b) const;
+
+private:
+    Matrix lu;
+    std::vector<std::size_t> swaps;
+};
+
+/**
+ * @brief Solve A X = B by LU decomposition
+ * @throw std::invalid_argument for mismatched shapes
+ * @throw std::domain_error "Singular matrix" if A has no inverse
+ */
+Matrix solve(const Matrix& a, const Matrix& b, WorkStealingPool* pool = nullptr);
+
+/** @brief Solve A x = b by LU decomposition */
+std::vector<double> solve(const Matrix& a, const std::vector<double>& b, WorkStealingPool* pool = nullptr);
+
+#endif // MATRIX_H
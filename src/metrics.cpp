@@ -0,0 +1,291 @@
+#include "metrics.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+
+namespace {
+
+const char* const OP_NAMES[METRIC_OP_COUNT] = {
+    "add", "subtract", "multiply", "divide", "sqrt", "power", "ln", "sin", "cos", "tan", "sincos",
+    "memory_store", "memory_recall", "memory_clear", "memory_add", "memory_subtract",
+    "get_history", "clear_history", "append_number", "set_operation", "calculate", "clear",
+    "compile", "reduce", "format_number", "record_history"
+};
+
+/**
+ * Counters of one operation on one thread. Only the owning thread
+ * writes them, so increments are plain relaxed load/store pairs without
+ * a locked instruction; the atomics only make concurrent snapshots safe.
+ * Each block starts on its own cache line.
+ */
+struct alignas(64) OpCounters {
+    std::atomic<std::uint64_t> calls;
+    std::atomic<std::uint64_t> errors;
+    std::atomic<std::uint64_t> totalNanoseconds;
+    std::atomic<std::uint64_t> buckets[METRIC_BUCKET_COUNT];
+};
+
+void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+void addTo(OpMetrics& total, const OpCounters& counters) {
+    total.calls += counters.calls.load(std::memory_order_relaxed);
+    total.errors += counters.errors.load(std::memory_order_relaxed);
+    total.totalNanoseconds += counters.totalNanoseconds.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < METRIC_BUCKET_COUNT; ++i) {
+        total.buckets[i] += counters.buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+void clearCounters(OpCounters& counters) {
+    counters.calls.store(0, std::memory_order_relaxed);
+    counters.errors.store(0, std::memory_order_relaxed);
+    counters.totalNanoseconds.store(0, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < METRIC_BUCKET_COUNT; ++i) {
+        counters.buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+struct ThreadMetrics;
+
+// Live threads, plus the totals of threads that have exited
+struct Registry {
+    std::mutex mutex;
+    std::vector<ThreadMetrics*> threads;
+    MetricsSnapshot retired;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+struct ThreadMetrics {
+    OpCounters ops[METRIC_OP_COUNT];
+
+    ThreadMetrics() {
+        for (OpCounters& counters : ops) {
+            clearCounters(counters);
+        }
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.threads.push_back(this);
+    }
+
+    ~ThreadMetrics() {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+            addTo(reg.retired.ops[op], ops[op]);
+        }
+        reg.threads.erase(std::find(reg.threads.begin(), reg.threads.end(), this));
+    }
+};
+
+ThreadMetrics& threadMetrics() {
+    static thread_local ThreadMetrics metrics;
+    return metrics;
+}
+
+std::uint64_t steadyNanoseconds() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))) || \
+    (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+// Nanoseconds per time-stamp counter tick, measured against steady_clock
+// over 5 ms; the counter runs at a constant rate on current CPUs
+double calibrateTicks() {
+    std::uint64_t startNanoseconds = steadyNanoseconds();
+    std::uint64_t startTicks = metricTicks();
+    std::uint64_t elapsed;
+    do {
+        elapsed = steadyNanoseconds() - startNanoseconds;
+    } while (elapsed < 5000000);
+    std::uint64_t ticks = metricTicks() - startTicks;
+    return ticks == 0 ? 1.0 : static_cast<double>(elapsed) / static_cast<double>(ticks);
+}
+#else
+double calibrateTicks() {
+    return 1.0;
+}
+#endif
+
+double nanosecondsPerTick() {
+    static const double ratio = calibrateTicks();
+    return ratio;
+}
+
+double seconds(std::uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) * 1e-9;
+}
+
+} // namespace
+
+std::atomic<unsigned> instrumentationFlags(0);
+
+const char* metricOpName(MetricOp op) {
+    std::size_t index = static_cast<std::size_t>(op);
+    return index < METRIC_OP_COUNT ? OP_NAMES[index] : "unknown";
+}
+
+std::size_t metricBucket(std::uint64_t nanoseconds) {
+    if (nanoseconds < METRIC_SUB_BUCKETS) {
+        return static_cast<std::size_t>(nanoseconds);
+    }
+    unsigned exponent = 0;
+    while ((nanoseconds >> exponent) >= 2 * METRIC_SUB_BUCKETS) {
+        ++exponent;
+    }
+    std::size_t bucket = (exponent + 1) * METRIC_SUB_BUCKETS +
+                         static_cast<std::size_t>((nanoseconds >> exponent) - METRIC_SUB_BUCKETS);
+    return std::min(bucket, METRIC_BUCKET_COUNT - 1);
+}
+
+std::uint64_t metricBucketLowerBound(std::size_t bucket) {
+    if (bucket < METRIC_SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned exponent = static_cast<unsigned>(bucket / METRIC_SUB_BUCKETS - 1);
+    return (METRIC_SUB_BUCKETS + bucket % METRIC_SUB_BUCKETS) << exponent;
+}
+
+std::uint64_t OpMetrics::percentile(double fraction) const {
+    if (calls == 0) {
+        return 0;
+    }
+    std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(calls));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < METRIC_BUCKET_COUNT - 1; ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            return metricBucketLowerBound(i + 1) - 1;
+        }
+    }
+    return metricBucketLowerBound(METRIC_BUCKET_COUNT - 1);
+}
+
+MetricsSnapshot::MetricsSnapshot() : ops(METRIC_OP_COUNT) {
+    std::memset(ops.data(), 0, ops.size() * sizeof(OpMetrics));
+}
+
+std::string MetricsSnapshot::toJson() const {
+    std::ostringstream out;
+    out << "{";
+    const char* separator = "\n";
+    for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+        const OpMetrics& m = ops[op];
+        if (m.calls == 0) {
+            continue;
+        }
+        out << separator << "  \"" << OP_NAMES[op] << "\": {"
+            << "\"calls\": " << m.calls
+            << ", \"errors\": " << m.errors
+            << ", \"total_ns\": " << m.totalNanoseconds
+            << ", \"p50_ns\": " << m.percentile(0.5)
+            << ", \"p90_ns\": " << m.percentile(0.9)
+            << ", \"p99_ns\": " << m.percentile(0.99)
+            << ", \"buckets\": [";
+        const char* bucketSeparator = "";
+        for (std::size_t i = 0; i < METRIC_BUCKET_COUNT; ++i) {
+            if (m.buckets[i] != 0) {
+                out << bucketSeparator << "[" << metricBucketLowerBound(i) << ", " << m.buckets[i] << "]";
+                bucketSeparator = ", ";
+            }
+        }
+        out << "]}";
+        separator = ",\n";
+    }
+    out << "\n}\n";
+    return out.str();
+}
+
+std::string MetricsSnapshot::toPrometheus() const {
+    std::ostringstream out;
+    out << "# HELP calculator_calls_total Completed calculator calls.\n"
+        << "# TYPE calculator_calls_total counter\n";
+    for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+        out << "calculator_calls_total{op=\"" << OP_NAMES[op] << "\"} " << ops[op].calls << "\n";
+    }
+    out << "# HELP calculator_errors_total Calls that hit a domain error.\n"
+        << "# TYPE calculator_errors_total counter\n";
+    for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+        out << "calculator_errors_total{op=\"" << OP_NAMES[op] << "\"} " << ops[op].errors << "\n";
+    }
+    out << "# HELP calculator_latency_seconds Latency of calculator calls.\n"
+        << "# TYPE calculator_latency_seconds summary\n";
+    const double quantiles[] = {0.5, 0.9, 0.99};
+    for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+        const OpMetrics& m = ops[op];
+        for (double q : quantiles) {
+            out << "calculator_latency_seconds{op=\"" << OP_NAMES[op] << "\",quantile=\"" << q << "\"} "
+                << seconds(m.percentile(q)) << "\n";
+        }
+        out << "calculator_latency_seconds_sum{op=\"" << OP_NAMES[op] << "\"} "
+            << seconds(m.totalNanoseconds) << "\n";
+        out << "calculator_latency_seconds_count{op=\"" << OP_NAMES[op] << "\"} " << m.calls << "\n";
+    }
+    return out.str();
+}
+
+void setMetricsEnabled(bool enabled) {
+    if (enabled) {
+        // Calibrate and register the calling thread up front rather than
+        // inside its first measured call
+        nanosecondsPerTick();
+        threadMetrics();
+        instrumentationFlags.fetch_or(INSTRUMENT_METRICS, std::memory_order_relaxed);
+    } else {
+        instrumentationFlags.fetch_and(~INSTRUMENT_METRICS, std::memory_order_relaxed);
+    }
+}
+
+MetricsSnapshot metricsSnapshot() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    MetricsSnapshot snapshot = reg.retired;
+    for (const ThreadMetrics* thread : reg.threads) {
+        for (std::size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+            addTo(snapshot.ops[op], thread->ops[op]);
+        }
+    }
+    return snapshot;
+}
+
+void resetMetrics() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.retired = MetricsSnapshot();
+    for (ThreadMetrics* thread : reg.threads) {
+        for (OpCounters& counters : thread->ops) {
+            clearCounters(counters);
+        }
+    }
+}
+
+#if !(defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))) && \
+    !(defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+std::uint64_t metricTicks() {
+    return steadyNanoseconds();
+}
+#endif
+
+std::uint64_t metricTicksToNanoseconds(std::uint64_t ticks) {
+    return static_cast<std::uint64_t>(static_cast<double>(ticks) * nanosecondsPerTick());
+}
+
+void recordMetric(MetricOp op, std::uint64_t start, bool error) {
+    std::uint64_t elapsed = metricTicksToNanoseconds(metricTicks() - start);
+    OpCounters& counters = threadMetrics().ops[static_cast<std::size_t>(op)];
+    bump(counters.calls, 1);
+    if (error) {
+        bump(counters.errors, 1);
+    }
+    bump(counters.totalNanoseconds, elapsed);
+    bump(counters.buckets[metricBucket(elapsed)], 1);
+}
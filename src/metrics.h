@@ -0,0 +1,272 @@
+/**
+ * @file metrics.h
+ * @brief Per-operation call counters and latency histograms
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+/**
+ * @enum MetricOp
+ * @brief Calculator method a measurement belongs to
+ */
+enum class MetricOp : unsigned char {
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Sqrt,
+    Power,
+    Ln,
+    Sin,
+    Cos,
+    Tan,
+    SinCos,
+    MemoryStore,
+    MemoryRecall,
+    MemoryClear,
+    MemoryAdd,
+    MemorySubtract,
+    GetHistory,
+    ClearHistory,
+    AppendNumber,
+    SetOperation,
+    Calculate,
+    Clear,
+    Compile,
+    Reduce,         ///< Bulk reductions over arrays (sum, mean, ...)
+    FormatNumber,   ///< Display and history text formatting
+    RecordHistory   ///< Appending a record to the history buffer
+};
+
+/// Number of MetricOp values
+const std::size_t METRIC_OP_COUNT = static_cast<std::size_t>(MetricOp::RecordHistory) + 1;
+
+/// Sub-buckets per power of two; latencies are kept within 12.5%
+const unsigned METRIC_SUB_BUCKETS = 8;
+
+/// Buckets per histogram, covering 0 ns to about 17 s
+const std::size_t METRIC_BUCKET_COUNT = 256;
+
+/**
+ * @brief Get the snake_case name of an operation
+ * @param op Operation
+ * @return Name such as "memory_store"
+ */
+const char* metricOpName(MetricOp op);
+
+/**
+ * @brief Get the histogram bucket a latency falls into
+ *
+ * Values below METRIC_SUB_BUCKETS have a bucket each; above that every
+ * power of two is split into METRIC_SUB_BUCKETS equal parts, as in an
+ * HDR histogram with one significant octal digit.
+ *
+ * @param nanoseconds Latency
+ * @return Bucket index, clamped to METRIC_BUCKET_COUNT - 1
+ */
+std::size_t metricBucket(std::uint64_t nanoseconds);
+
+/**
+ * @brief Get the smallest latency counted in a bucket
+ * @param bucket Bucket index
+ * @return Lower bound in nanoseconds
+ */
+std::uint64_t metricBucketLowerBound(std::size_t bucket);
+
+/**
+ * @struct OpMetrics
+ * @brief Counters and latency histogram of one operation
+ */
+struct OpMetrics {
+    std::uint64_t calls;             ///< Completed calls
+    std::uint64_t errors;            ///< Calls that hit a domain error
+    std::uint64_t totalNanoseconds;  ///< Sum of all latencies
+    std::uint64_t buckets[METRIC_BUCKET_COUNT];  ///< Calls per latency bucket
+
+    /**
+     * @brief Estimate a latency percentile
+     * @param fraction Percentile as a fraction, e.g. 0.99
+     * @return Upper bound of the bucket holding that percentile, 0 without calls
+     */
+    std::uint64_t percentile(double fraction) const;
+};
+
+/**
+ * @struct MetricsSnapshot
+ * @brief Merged metrics of every thread at one point in time
+ */
+struct MetricsSnapshot {
+    std::vector<OpMetrics> ops;  ///< Indexed by MetricOp
+
+    MetricsSnapshot();
+
+    const OpMetrics& operator[](MetricOp op) const { return ops[static_cast<std::size_t>(op)]; }
+
+    /**
+     * @brief Format as a JSON object keyed by operation name
+     *
+     * Operations that were never called are left out. Each entry has the
+     * counters, p50/p90/p99 and the non-empty buckets as
+     * [lower bound ns, count] pairs.
+     */
+    std::string toJson() const;
+
+    /**
+     * @brief Format in the Prometheus text exposition format
+     *
+     * Calls and errors become counters; latencies become a summary with
+     * 0.5, 0.9 and 0.99 quantiles in seconds.
+     */
+    std::string toPrometheus() const;
+};
+
+/**
+ * @brief Turn measurement on or off at run time
+ *
+ * Measurement starts off. While it is off an instrumented call costs one
+ * relaxed load and branch; while on it adds two clock reads and a few
+ * uncontended stores to thread-local counters. Turning it on the first
+ * time calibrates the clock, which takes a few milliseconds.
+ *
+ * @param enabled True to start measuring
+ */
+void setMetricsEnabled(bool enabled);
+
+/// Bit of instrumentationFlags set while metrics are measured
+const unsigned INSTRUMENT_METRICS = 1;
+
+/// Bit of instrumentationFlags set while spans are traced (see trace.h)
+const unsigned INSTRUMENT_TRACING = 2;
+
+/// Set by setMetricsEnabled() and the tracer; one load tells an
+/// instrumented call whether anything is listening
+extern std::atomic<unsigned> instrumentationFlags;
+
+/**
+ * @brief Check whether measurement is on
+ * @return True after setMetricsEnabled(true)
+ */
+inline bool metricsEnabled() {
+    return (instrumentationFlags.load(std::memory_order_relaxed) & INSTRUMENT_METRICS) != 0;
+}
+
+/**
+ * @brief Merge the counters of all threads, including finished ones
+ * @return Snapshot of everything recorded since the last reset
+ */
+MetricsSnapshot metricsSnapshot();
+
+/**
+ * @brief Zero every counter
+ *
+ * Calls that complete concurrently with the reset may be lost.
+ */
+void resetMetrics();
+
+/**
+ * @brief Read the clock used for measurements
+ *
+ * On x86 this is the time-stamp counter, read inline so that starting a
+ * measurement involves no call and the instrumented function keeps its
+ * operands in registers; recordMetric() converts ticks to nanoseconds.
+ * Elsewhere it is std::chrono::steady_clock in nanoseconds.
+ *
+ * @return Current tick count
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+inline std::uint64_t metricTicks() {
+    return __builtin_ia32_rdtsc();
+}
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+inline std::uint64_t metricTicks() {
+    return __rdtsc();
+}
+#else
+std::uint64_t metricTicks();
+#endif
+
+/**
+ * @brief Record a call that started at metricTicks()
+ * @param op Operation
+ * @param start Value of metricTicks() when the call started
+ * @param error True if the call hit a domain error
+ */
+void recordMetric(MetricOp op, std::uint64_t start, bool error);
+
+/**
+ * @brief Convert a difference of metricTicks() values to nanoseconds
+ */
+std::uint64_t metricTicksToNanoseconds(std::uint64_t ticks);
+
+/**
+ * @brief Write a span that started at metricTicks() to the trace
+ *
+ * Defined in trace.cpp; called by MetricTimer and TraceSpan while
+ * tracing is on.
+ *
+ * @param name Span name; must outlive the trace, e.g. a string literal
+ * @param start Value of metricTicks() when the span started
+ * @param error True if the call hit a domain error
+ */
+void recordTraceSpan(const char* name, std::uint64_t start, bool error);
+
+/**
+ * @class MetricTimer
+ * @brief Measures the enclosing scope as one call of an operation
+ *
+ * The call is counted in the metrics and, while tracing, written to the
+ * trace as a span named after the operation. Built without
+ * CALCULATOR_METRICS the timer is empty and every use of it compiles to
+ * nothing.
+ */
+class MetricTimer {
+public:
+#ifdef CALCULATOR_METRICS
+    explicit MetricTimer(MetricOp op)
+        : op(op), active(instrumentationFlags.load(std::memory_order_relaxed)), failed(false), start(0) {
+        if (active) {
+            start = metricTicks();
+        }
+    }
+
+    ~MetricTimer() {
+        if (active & INSTRUMENT_METRICS) {
+            recordMetric(op, start, failed);
+        }
+        if (active & INSTRUMENT_TRACING) {
+            recordTraceSpan(metricOpName(op), start, failed);
+        }
+    }
+
+    /** @brief Count this call as a domain error */
+    void fail() { failed = true; }
+
+private:
+    MetricOp op;
+    unsigned char active;  ///< instrumentationFlags when the call started
+    bool failed;
+    std::uint64_t start;
+#else
+    explicit MetricTimer(MetricOp) {
+    }
+
+    void fail() {
+    }
+#endif
+
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+};
+
+#endif // METRICS_H
@@ -0,0 +1,290 @@
+#include "number_format.h"
+#include "big_uint.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+__extension__ typedef unsigned __int128 Uint128;
+
+const int FIXED_DECIMALS = 6;
+const std::uint32_t FIXED_SCALE = 1000000;
+
+/// Compare a + b against c without modifying the operands
+int compareSum(const BigUint& a, const BigUint& b, const BigUint& c) {
+    BigUint sum = a;
+    sum.add(b);
+    return BigUint::compare(sum, c);
+}
+
+/// Write "nan"/"inf" with sign; returns 0 for finite values
+std::size_t formatSpecial(double value, char* buffer) {
+    if (!std::isnan(value) && !std::isinf(value)) {
+        return 0;
+    }
+    std::size_t length = 0;
+    if (std::signbit(value)) {
+        buffer[length++] = '-';
+    }
+    std::memcpy(buffer + length, std::isnan(value) ? "nan" : "inf", 4);
+    return length + 3;
+}
+
+/// Write the decimal digits of a value, most significant first
+std::size_t writeDigits(std::uint64_t value, char* out) {
+    char reversed[20];
+    std::size_t count = 0;
+    do {
+        reversed[count++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = reversed[count - 1 - i];
+    }
+    return count;
+}
+
+std::size_t writeDigits(BigUint value, char* out) {
+    char reversed[NUMBER_BUFFER_SIZE];
+    std::size_t count = 0;
+    while (!value.isZero()) {
+        std::uint32_t chunk = value.divideSmall(1000000000);
+        for (int i = 0; i < 9; ++i) {
+            reversed[count++] = static_cast<char>('0' + chunk % 10);
+            chunk /= 10;
+        }
+    }
+    while (count > 1 && reversed[count - 1] == '0') {
+        --count;
+    }
+    if (count == 0) {
+        reversed[count++] = '0';
+    }
+    for (std::size_t i = 0; i < count; ++i) {
+        out[i] = reversed[count - 1 - i];
+    }
+    return count;
+}
+
+/**
+ * @brief Insert the decimal point into a scaled integer and trim zeros
+ * @param digits Digits of value * 10^6, written after an optional sign
+ * @param count Number of digits
+ * @return Length of the finished text starting at digits
+ */
+std::size_t placeDecimalPoint(char* digits, std::size_t count) {
+    if (count <= static_cast<std::size_t>(FIXED_DECIMALS)) {
+        std::size_t pad = FIXED_DECIMALS + 1 - count;
+        std::memmove(digits + pad, digits, count);
+        std::memset(digits, '0', pad);
+        count += pad;
+    }
+    std::size_t integerDigits = count - FIXED_DECIMALS;
+    std::size_t end = count;
+    while (end > integerDigits && digits[end - 1] == '0') {
+        --end;
+    }
+    if (end == integerDigits) {
+        return integerDigits;
+    }
+    std::memmove(digits + integerDigits + 1, digits + integerDigits,
+                 end - integerDigits);
+    digits[integerDigits] = '.';
+    return end + 1;
+}
+
+/**
+ * @brief Generate the shortest digits that identify a double
+ *
+ * Free-format algorithm of Steele & White / Burger & Dybvig on exact
+ * big integers. The value equals 0.d1d2... * 10^decimalExponent.
+ *
+ * @return Number of digits written
+ */
+std::size_t shortestDigits(std::uint64_t mantissa, int exponent, char* digits,
+                           int& decimalExponent) {
+    bool even = (mantissa & 1) == 0;
+    bool tightLow = mantissa == HIDDEN_BIT && exponent > MIN_EXPONENT;
+    BigUint r(mantissa);
+    BigUint s(1);
+    BigUint plus(1);
+    BigUint minus(1);
+    if (exponent >= 0) {
+        r.shiftLeft(exponent + (tightLow ? 2 : 1));
+        s.shiftLeft(tightLow ? 2 : 1);
+        plus.shiftLeft(exponent + (tightLow ? 1 : 0));
+        minus.shiftLeft(exponent);
+    } else {
+        r.shiftLeft(tightLow ? 2 : 1);
+        s.shiftLeft(-exponent + (tightLow ? 2 : 1));
+        plus.shiftLeft(tightLow ? 1 : 0);
+    }
+
+    double value = std::ldexp(static_cast<double>(mantissa), exponent);
+    int k = static_cast<int>(std::ceil(std::log10(value) - 1e-10));
+    if (k >= 0) {
+        s.multiplyPow10(k);
+    } else {
+        r.multiplyPow10(-k);
+        plus.multiplyPow10(-k);
+        minus.multiplyPow10(-k);
+    }
+
+    // Correct the logarithm estimate so that (r + plus) / s lies in [0.1, 1)
+    const int highLimit = even ? 0 : 1;
+    while (compareSum(r, plus, s) >= highLimit) {
+        s.multiplySmall(10);
+        ++k;
+    }
+    for (;;) {
+        BigUint scaled = r;
+        scaled.add(plus);
+        scaled.multiplySmall(10);
+        if (BigUint::compare(scaled, s) >= highLimit) {
+            break;
+        }
+        r.multiplySmall(10);
+        plus.multiplySmall(10);
+        minus.multiplySmall(10);
+        --k;
+    }
+
+    std::size_t count = 0;
+    for (;;) {
+        r.multiplySmall(10);
+        plus.multiplySmall(10);
+        minus.multiplySmall(10);
+        int digit = 0;
+        while (BigUint::compare(r, s) >= 0) {
+            r.subtract(s);
+            ++digit;
+        }
+        int lowCompare = BigUint::compare(r, minus);
+        bool low = even ? lowCompare <= 0 : lowCompare < 0;
+        bool high = compareSum(r, plus, s) >= highLimit;
+        if (!low && !high) {
+            digits[count++] = static_cast<char>('0' + digit);
+            continue;
+        }
+        if (low && high) {
+            BigUint twice = r;
+            twice.add(r);
+            if (BigUint::compare(twice, s) >= 0) {
+                ++digit;
+            }
+        } else if (high) {
+            ++digit;
+        }
+        digits[count++] = static_cast<char>('0' + digit);
+        break;
+    }
+    decimalExponent = k;
+    return count;
+}
+
+} // namespace
+
+std::size_t formatFixed(double value, char* buffer) {
+    std::size_t length = formatSpecial(value, buffer);
+    if (length != 0) {
+        return length;
+    }
+    std::uint64_t mantissa;
+    int exponent;
+    if (decomposeDouble(value, mantissa, exponent)) {
+        buffer[length++] = '-';
+    }
+    char* digits = buffer + length;
+    std::size_t count;
+
+    // Round value * 10^6 to an integer, ties to even
+    if (exponent > 54) {
+        BigUint scaled(mantissa);
+        scaled.multiplySmall(FIXED_SCALE);
+        scaled.shiftLeft(exponent);
+        count = writeDigits(scaled, digits);
+    } else {
+        Uint128 scaled = Uint128(mantissa) * FIXED_SCALE;
+        if (exponent >= 0) {
+            scaled <<= exponent;
+        } else if (exponent > -75) {
+            int shift = -exponent;
+            Uint128 half = Uint128(1) << (shift - 1);
+            Uint128 remainder = scaled & ((half << 1) - 1);
+            scaled >>= shift;
+            if (remainder > half || (remainder == half && (scaled & 1) != 0)) {
+                ++scaled;
+            }
+        } else {
+            scaled = 0;
+        }
+        if ((scaled >> 64) == 0) {
+            count = writeDigits(static_cast<std::uint64_t>(scaled), digits);
+        } else {
+            BigUint wide(static_cast<std::uint64_t>(scaled));
+            BigUint upper(static_cast<std::uint64_t>(scaled >> 64));
+            upper.shiftLeft(64);
+            wide.add(upper);
+            count = writeDigits(wide, digits);
+        }
+    }
+    length += placeDecimalPoint(digits, count);
+    buffer[length] = '\0';
+    return length;
+}
+
+std::size_t formatShortest(double value, char* buffer) {
+    std::size_t length = formatSpecial(value, buffer);
+    if (length != 0) {
+        return length;
+    }
+    std::uint64_t mantissa;
+    int exponent;
+    if (decomposeDouble(value, mantissa, exponent)) {
+        buffer[length++] = '-';
+    }
+    if (mantissa == 0) {
+        buffer[length++] = '0';
+        buffer[length] = '\0';
+        return length;
+    }
+
+    char digits[20];
+    int k;
+    int count = static_cast<int>(shortestDigits(mantissa, exponent, digits, k));
+    char* out = buffer + length;
+    if (k > 21 || k < -5) {
+        // Scientific notation: d[.ddd]e+XX
+        *out++ = digits[0];
+        if (count > 1) {
+            *out++ = '.';
+            std::memcpy(out, digits + 1, count - 1);
+            out += count - 1;
+        }
+        int power = k - 1;
+        *out++ = 'e';
+        *out++ = power < 0 ? '-' : '+';
+        out += writeDigits(static_cast<std::uint64_t>(power < 0 ? -power : power), out);
+    } else if (k <= 0) {
+        *out++ = '0';
+        *out++ = '.';
+        std::memset(out, '0', -k);
+        out += -k;
+        std::memcpy(out, digits, count);
+        out += count;
+    } else if (k >= count) {
+        std::memcpy(out, digits, count);
+        out += count;
+        std::memset(out, '0', k - count);
+        out += k - count;
+    } else {
+        std::memcpy(out, digits, k);
+        out += k;
+        *out++ = '.';
+        std::memcpy(out, digits + k, count - k);
+        out += count - k;
+    }
+    *out = '\0';
+    return static_cast<std::size_t>(out - buffer);
+}
@@ -0,0 +1,41 @@
+/**
+ * @file number_format.h
+ * @brief Allocation-free conversion of doubles to display text
+ */
+
+#ifndef NUMBER_FORMAT_H
+#define NUMBER_FORMAT_H
+
+#include <cstddef>
+
+/// Buffer size that fits any formatted double plus the terminating null
+const std::size_t NUMBER_BUFFER_SIZE = 336;
+
+/**
+ * @brief Format a number the way the calculator displays it
+ *
+ * Produces the same bytes as streaming the value with std::fixed and
+ * std::setprecision(6) in the "C" locale, then removing trailing zeros
+ * and a trailing decimal point ("2.500000" becomes "2.5", "-0.000000"
+ * becomes "-0"). Rounding is exact, so ties round to even like printf.
+ *
+ * @param value Number to format
+ * @param buffer Output buffer of at least NUMBER_BUFFER_SIZE bytes
+ * @return Number of characters written, excluding the terminating null
+ */
+std::size_t formatFixed(double value, char* buffer);
+
+/**
+ * @brief Format a number with the fewest digits that read back exactly
+ *
+ * The result parses back to the same double with strtod. Decimal
+ * notation is used for magnitudes from 1e-6 up to 1e21 and scientific
+ * notation ("1.5e+300") outside that range.
+ *
+ * @param value Number to format
+ * @param buffer Output buffer of at least NUMBER_BUFFER_SIZE bytes
+ * @return Number of characters written, excluding the terminating null
+ */
+std::size_t formatShortest(double value, char* buffer);
+
+#endif // NUMBER_FORMAT_H
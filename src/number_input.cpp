@@ -0,0 +1,195 @@
+#include "number_input.h"
+#include "big_uint.h"
+#include <cfloat>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const int MAX_EXPONENT_DIGITS_VALUE = 99999;
+
+/// Powers of ten that are exact doubles
+const double EXACT_POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * @brief Compare mantissa * 10^exponent against boundary * 2^binaryExponent
+ *
+ * A truncated mantissa counts as mantissa + 1/2, which only matters
+ * when the two sides would otherwise be equal.
+ *
+ * @return Negative, zero or positive like strcmp
+ */
+int compareDecimalToBinary(std::uint64_t mantissa, int exponent, bool truncated,
+                           std::uint64_t boundary, int binaryExponent) {
+    BigUint lhs(mantissa);
+    lhs.shiftLeft(1);
+    if (truncated) {
+        lhs.limb[0] |= 1;
+    }
+    BigUint rhs(boundary);
+    rhs.shiftLeft(1);
+    if (exponent >= 0) {
+        lhs.multiplyPow10(exponent);
+    } else {
+        rhs.multiplyPow10(-exponent);
+    }
+    if (binaryExponent >= 0) {
+        rhs.shiftLeft(binaryExponent);
+    } else {
+        lhs.shiftLeft(-binaryExponent);
+    }
+    return BigUint::compare(lhs, rhs);
+}
+
+int countDigits(std::uint64_t value) {
+    int count = 0;
+    do {
+        ++count;
+        value /= 10;
+    } while (value != 0);
+    return count;
+}
+
+} // namespace
+
+double decimalToDouble(std::uint64_t mantissa, int exponent, bool truncated) {
+    if (mantissa == 0) {
+        return 0.0;
+    }
+    if (!truncated && mantissa <= (std::uint64_t(1) << 53)
+        && exponent >= -22 && exponent <= 22) {
+        // Both operands are exact, so one IEEE operation rounds correctly
+        double m = static_cast<double>(mantissa);
+        return exponent >= 0 ? m * EXACT_POW10[exponent] : m / EXACT_POW10[-exponent];
+    }
+
+    int magnitude = countDigits(mantissa) + exponent;
+    if (magnitude > DBL_MAX_10_EXP + 1) {
+        return std::numeric_limits<double>::infinity();
+    }
+    if (magnitude < -324) {
+        return 0.0;
+    }
+
+    // Start from an estimate within a few ulps, then walk to the exact answer
+    long double estimate = static_cast<long double>(mantissa)
+        * std::pow(10.0L, static_cast<long double>(exponent));
+    double z = static_cast<double>(estimate);
+    if (std::isinf(z)) {
+        z = DBL_MAX;
+    } else if (z == 0.0) {
+        z = std::numeric_limits<double>::denorm_min();
+    }
+
+    const double infinity = std::numeric_limits<double>::infinity();
+    for (;;) {
+        std::uint64_t zm;
+        int ze;
+        decomposeDouble(z, zm, ze);
+        bool odd = (zm & 1) != 0;
+
+        // Above the midpoint to the next double up?
+        int upper = compareDecimalToBinary(mantissa, exponent, truncated,
+                                           2 * zm + 1, ze - 1);
+        if (upper > 0 || (upper == 0 && odd)) {
+            if (z == DBL_MAX) {
+                return infinity;
+            }
+            z = std::nextafter(z, infinity);
+            continue;
+        }
+
+        // Below the midpoint to the next double down? The gap below a
+        // power of two is half as wide.
+        int lower = (zm == HIDDEN_BIT && ze > MIN_EXPONENT)
+            ? compareDecimalToBinary(mantissa, exponent, truncated, 4 * zm - 1, ze - 2)
+            : compareDecimalToBinary(mantissa, exponent, truncated, 2 * zm - 1, ze - 1);
+        if (lower < 0 || (lower == 0 && odd)) {
+            z = std::nextafter(z, 0.0);
+            if (z == 0.0) {
+                return 0.0;
+            }
+            continue;
+        }
+        return z;
+    }
+}
+
+const int NumberInput::MAX_DIGITS;
+
+NumberInput::NumberInput() {
+    reset();
+}
+
+void NumberInput::reset() {
+    mantissa = 0;
+    digitCount = 0;
+    decimalShift = 0;
+    exponent = 0;
+    keyCount = 0;
+    negative = false;
+    seenPoint = false;
+    seenExponent = false;
+    exponentNegative = false;
+    exponentStarted = false;
+    truncated = false;
+}
+
+bool NumberInput::append(char key) {
+    if (key >= '0' && key <= '9') {
+        int digit = key - '0';
+        if (seenExponent) {
+            if (exponent <= MAX_EXPONENT_DIGITS_VALUE) {
+                exponent = exponent * 10 + digit;
+            }
+            exponentStarted = true;
+        } else if (digitCount == 0 && digit == 0) {
+            // Leading zeros only move the decimal point
+            if (seenPoint) {
+                --decimalShift;
+            }
+        } else if (digitCount < MAX_DIGITS) {
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(digit);
+            ++digitCount;
+            if (seenPoint) {
+                --decimalShift;
+            }
+        } else {
+            if (!seenPoint) {
+                ++decimalShift;
+            }
+            truncated = truncated || digit != 0;
+        }
+    } else if (key == '.') {
+        if (seenPoint || seenExponent) {
+            return false;
+        }
+        seenPoint = true;
+    } else if (key == '-') {
+        if (keyCount == 0) {
+            negative = true;
+        } else if (seenExponent && !exponentStarted) {
+            exponentNegative = true;
+            exponentStarted = true;
+        } else {
+            return false;
+        }
+    } else if (key == 'e' || key == 'E') {
+        if (seenExponent) {
+            return false;
+        }
+        seenExponent = true;
+    } else {
+        return false;
+    }
+    ++keyCount;
+    return true;
+}
+
+double NumberInput::value() const {
+    double magnitude = decimalToDouble(mantissa, decimalExponent(), truncated);
+    return negative ? -magnitude : magnitude;
+}
@@ -0,0 +1,99 @@
+/**
+ * @file number_input.h
+ * @brief Incremental accumulator for numbers typed one key at a time
+ */
+
+#ifndef NUMBER_INPUT_H
+#define NUMBER_INPUT_H
+
+#include <cstdint>
+
+/**
+ * @class NumberInput
+ * @brief Builds a double from keystrokes without reparsing the text
+ *
+ * Each key updates a decimal mantissa, exponent and sign in constant
+ * time. value() rounds the accumulated decimal to the nearest double
+ * (ties to even), so entering an N-digit number costs O(N) in total.
+ *
+ * Accepted keys are '0'-'9', '.', '-' and 'e'/'E'. A '-' negates the
+ * number only as the first key or right after 'e'; a second '.', a
+ * second 'e', or a '.' inside the exponent is ignored. A lone "-" or "."
+ * is zero (negative zero for "-").
+ *
+ * At most MAX_DIGITS significant digits are kept; later digits only
+ * break ties upward, which cannot change the result unless the number
+ * lies within 1e-19 relative of a rounding boundary.
+ */
+class NumberInput {
+public:
+    /// Significant digits held exactly in the mantissa
+    static const int MAX_DIGITS = 19;
+
+    NumberInput();
+
+    /**
+     * @brief Discard the current entry
+     */
+    void reset();
+
+    /**
+     * @brief Feed one key into the entry
+     * @param key Digit, '.', '-', 'e' or 'E'
+     * @return true if the key changed the entry, false if it was ignored
+     */
+    bool append(char key);
+
+    /**
+     * @brief Get the entered number
+     * @return Correctly rounded double (infinity on overflow)
+     */
+    double value() const;
+
+    /**
+     * @brief Check whether any key has been accepted since reset()
+     * @return true if nothing has been entered
+     */
+    bool empty() const { return keyCount == 0; }
+
+    /**
+     * @brief Get the entry as an exact decimal
+     *
+     * The entry is significand() * 10^decimalExponent(), negated if
+     * isNegative(); isTruncated() tells whether non-zero digits beyond
+     * MAX_DIGITS followed the significand.
+     */
+    std::uint64_t significand() const { return mantissa; }
+    int decimalExponent() const { return decimalShift + (exponentNegative ? -exponent : exponent); }
+    bool isNegative() const { return negative; }
+    bool isTruncated() const { return truncated; }
+
+private:
+    std::uint64_t mantissa;   ///< Significant digits entered so far
+    int digitCount;           ///< Significant digits held in mantissa
+    int decimalShift;         ///< Power of ten applied to mantissa
+    int exponent;             ///< Explicit exponent typed after 'e'
+    int keyCount;             ///< Keys accepted since reset()
+    bool negative;            ///< Sign of the mantissa
+    bool seenPoint;           ///< Decimal point entered
+    bool seenExponent;        ///< 'e' entered; digits go to the exponent
+    bool exponentNegative;    ///< Sign of the explicit exponent
+    bool exponentStarted;     ///< A digit or sign follows the 'e'
+    bool truncated;           ///< Non-zero digits beyond MAX_DIGITS were dropped
+};
+
+/**
+ * @brief Round a decimal number to the nearest double
+ *
+ * Uses exact double arithmetic when the mantissa and power of ten are
+ * both exactly representable, and exact big-integer comparison
+ * otherwise.
+ *
+ * @param mantissa Decimal significand
+ * @param exponent Power of ten applied to mantissa
+ * @param truncated true if non-zero digits followed the mantissa
+ * @return Nearest double to mantissa * 10^exponent (ties to even)
+ */
+double decimalToDouble(std::uint64_t mantissa, int exponent, bool truncated);
+
+#endif // NUMBER_INPUT_H
@@ -0,0 +1,351 @@
+#include "parallel_evaluator.h"
+#include "number_format.h"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @struct ParallelEvaluator::Chunk
+ * @brief One task: a run of complete input lines and the output they produce
+ */
+struct ParallelEvaluator::Chunk {
+    const char* data;                  ///< Input lines (into storage or a mapped file)
+    std::size_t size;                  ///< Input bytes
+    std::vector<char> storage;         ///< Owned input when not reading from memory
+    std::vector<char> output;          ///< Formatted results
+    std::size_t outputSize;            ///< Bytes used in output
+    std::vector<std::string> history;  ///< Worker history for this chunk
+    std::size_t lines;
+    std::size_t errors;
+    bool done;                         ///< Set by the worker under the reorder lock
+
+    Chunk() : data(nullptr), size(0), outputSize(0), lines(0), errors(0), done(false) {
+    }
+};
+
+/**
+ * @class ParallelEvaluator::ChunkSource
+ * @brief Produces chunks that end on a line boundary
+ */
+class ParallelEvaluator::ChunkSource {
+public:
+    virtual ~ChunkSource() {
+    }
+
+    /**
+     * @brief Fill the next chunk
+     * @return false once the input is exhausted
+     */
+    virtual bool next(Chunk& chunk) = 0;
+};
+
+/// Cuts an in-memory buffer into chunks without copying
+class ParallelEvaluator::MemorySource : public ParallelEvaluator::ChunkSource {
+public:
+    MemorySource(const char* data, std::size_t size, std::size_t chunkSize)
+        : data(data), size(size), chunkSize(chunkSize), pos(0) {
+    }
+
+    bool next(Chunk& chunk) override {
+        if (pos >= size) {
+            return false;
+        }
+        std::size_t end = std::min(pos + chunkSize, size);
+        if (end < size) {
+            const char* newline = static_cast<const char*>(std::memchr(data + end, '\n', size - end));
+            end = newline == nullptr ? size : static_cast<std::size_t>(newline - data) + 1;
+        }
+        chunk.data = data + pos;
+        chunk.size = end - pos;
+        pos = end;
+        return true;
+    }
+
+private:
+    const char* data;
+    std::size_t size;
+    std::size_t chunkSize;
+    std::size_t pos;
+};
+
+/// Reads a stream into owned chunks, carrying partial lines forward
+class ParallelEvaluator::StreamSource : public ParallelEvaluator::ChunkSource {
+public:
+    StreamSource(int fd, std::size_t chunkSize)
+        : fd(fd), chunkSize(chunkSize), finished(false) {
+    }
+
+    bool next(Chunk& chunk) override {
+        std::vector<char>& buffer = chunk.storage;
+        buffer.swap(carry);
+        carry.clear();
+        std::size_t scanned = 0;
+        for (;;) {
+            // Read until a newline appears beyond the target size or input ends
+            while (!finished && buffer.size() < chunkSize) {
+                readMore(buffer);
+            }
+            if (finished) {
+                break;
+            }
+            const char* begin = buffer.data();
+            const char* newline = nullptr;
+            for (std::size_t i = buffer.size(); i > scanned; --i) {
+                if (begin[i - 1] == '\n') {
+                    newline = begin + i - 1;
+                    break;
+                }
+            }
+            if (newline != nullptr) {
+                std::size_t keep = static_cast<std::size_t>(newline - begin) + 1;
+                carry.assign(buffer.begin() + keep, buffer.end());
+                buffer.resize(keep);
+                break;
+            }
+            scanned = buffer.size();
+            readMore(buffer);
+        }
+        if (buffer.empty()) {
+            return false;
+        }
+        chunk.data = buffer.data();
+        chunk.size = buffer.size();
+        return true;
+    }
+
+private:
+    int fd;
+    std::size_t chunkSize;
+    bool finished;
+    std::vector<char> carry;
+
+    void readMore(std::vector<char>& buffer) {
+        std::size_t used = buffer.size();
+        buffer.resize(used + chunkSize);
+        for (;;) {
+            ssize_t count = ::read(fd, buffer.data() + used, chunkSize);
+            if (count >= 0) {
+                buffer.resize(used + static_cast<std::size_t>(count));
+                finished = count == 0;
+                return;
+            }
+            if (errno != EINTR) {
+                buffer.resize(used);
+                throw std::runtime_error(std::string("Read failed: ") + std::strerror(errno));
+            }
+        }
+    }
+};
+
+namespace {
+
+void writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Write failed: ") + std::strerror(errno));
+        }
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+void reserveOutput(std::vector<char>& output, std::size_t used, std::size_t needed) {
+    if (output.size() - used < needed) {
+        output.resize(std::max(output.size() * 2, used + needed));
+    }
+}
+
+} // namespace
+
+ParallelOptions::ParallelOptions()
+    : threads(0)
+    , chunkSize(256 * 1024)
+    , chunksInFlight(0)
+    , recordHistory(false)
+    , shortestOutput(false) {
+}
+
+ParallelEvaluator::ParallelEvaluator(const ParallelOptions& options)
+    : options(options)
+    , pool(options.threads) {
+    if (this->options.chunkSize == 0) {
+        this->options.chunkSize = 1;
+    }
+    if (this->options.chunksInFlight == 0) {
+        this->options.chunksInFlight = 4 * pool.size();
+    }
+    for (std::size_t i = 0; i < pool.size(); ++i) {
+        calculators.emplace_back(new Calculator(options.recordHistory ? HistoryBuffer::DEFAULT_CAPACITY : 0));
+    }
+    counters.lines = 0;
+    counters.errors = 0;
+}
+
+ParallelEvaluator::~ParallelEvaluator() {
+    pool.wait();
+}
+
+void ParallelEvaluator::evaluate(const char* data, std::size_t size, int outputFd) {
+    MemorySource source(data, size, options.chunkSize);
+    process(source, outputFd);
+}
+
+void ParallelEvaluator::run(const std::string& path, int outputFd) {
+    if (path == "-") {
+        StreamSource source(0, options.chunkSize);
+        process(source, outputFd);
+        return;
+    }
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    }
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    std::size_t size = 0;
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        size = static_cast<std::size_t>(info.st_size);
+        mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    try {
+        if (mapped != MAP_FAILED) {
+            ::madvise(mapped, size, MADV_SEQUENTIAL);
+            evaluate(static_cast<const char*>(mapped), size, outputFd);
+        } else {
+            StreamSource source(fd, options.chunkSize);
+            process(source, outputFd);
+        }
+    } catch (...) {
+        if (mapped != MAP_FAILED) {
+            ::munmap(mapped, size);
+        }
+        ::close(fd);
+        throw;
+    }
+    if (mapped != MAP_FAILED) {
+        ::munmap(mapped, size);
+    }
+    ::close(fd);
+}
+
+std::vector<std::string> ParallelEvaluator::mergedHistory() const {
+    return history;
+}
+
+void ParallelEvaluator::process(ChunkSource& source, int outputFd) {
+    const std::size_t window = options.chunksInFlight;
+    const std::size_t historyLimit = HistoryBuffer::DEFAULT_CAPACITY;
+    std::vector<Chunk> slots(window);
+    std::mutex reorderMutex;
+    std::condition_variable chunkDone;
+    std::size_t submitted = 0;
+    std::size_t written = 0;
+    bool exhausted = false;
+
+    history.clear();
+    counters.lines = 0;
+    counters.errors = 0;
+
+    try {
+        for (;;) {
+            while (!exhausted && submitted - written < window) {
+                Chunk& chunk = slots[submitted % window];
+                chunk.done = false;
+                if (!source.next(chunk)) {
+                    exhausted = true;
+                    break;
+                }
+                pool.submit([this, &chunk, &reorderMutex, &chunkDone](std::size_t worker) {
+                    evaluateChunk(chunk, worker);
+                    std::lock_guard<std::mutex> lock(reorderMutex);
+                    chunk.done = true;
+                    chunkDone.notify_all();
+                });
+                ++submitted;
+            }
+            if (written == submitted) {
+                break;
+            }
+
+            // Emit the oldest chunk once its worker is done
+            Chunk& chunk = slots[written % window];
+            {
+                std::unique_lock<std::mutex> lock(reorderMutex);
+                chunkDone.wait(lock, [&chunk] { return chunk.done; });
+            }
+            writeAll(outputFd, chunk.output.data(), chunk.outputSize);
+            counters.lines += chunk.lines;
+            counters.errors += chunk.errors;
+            if (options.recordHistory) {
+                history.insert(history.end(), chunk.history.begin(), chunk.history.end());
+                if (history.size() > 2 * historyLimit) {
+                    history.erase(history.begin(), history.end() - historyLimit);
+                }
+            }
+            ++written;
+        }
+    } catch (...) {
+        // Workers still reference the slots
+        pool.wait();
+        throw;
+    }
+    if (history.size() > historyLimit) {
+        history.erase(history.begin(), history.end() - historyLimit);
+    }
+}
+
+void ParallelEvaluator::evaluateChunk(Chunk& chunk, std::size_t worker) {
+    Calculator& calc = *calculators[worker];
+    calc.clearHistory();
+    chunk.outputSize = 0;
+    chunk.lines = 0;
+    chunk.errors = 0;
+
+    std::string error;
+    const char* data = chunk.data;
+    const char* end = chunk.data + chunk.size;
+    while (data < end) {
+        const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+        const char* lineEnd = newline == nullptr ? end : newline;
+        double result;
+        ++chunk.lines;
+        switch (evaluateBatchLine(calc, data, lineEnd - data, result, error)) {
+            case BatchLineStatus::Value: {
+                reserveOutput(chunk.output, chunk.outputSize, NUMBER_BUFFER_SIZE + 1);
+                char* out = chunk.output.data() + chunk.outputSize;
+                std::size_t length = options.shortestOutput ? formatShortest(result, out)
+                                                            : formatFixed(result, out);
+                out[length] = '\n';
+                chunk.outputSize += length + 1;
+                break;
+            }
+            case BatchLineStatus::Blank:
+                reserveOutput(chunk.output, chunk.outputSize, 1);
+                chunk.output[chunk.outputSize++] = '\n';
+                break;
+            case BatchLineStatus::Error:
+                ++chunk.errors;
+                reserveOutput(chunk.output, chunk.outputSize, error.size() + 8);
+                std::memcpy(chunk.output.data() + chunk.outputSize, "Error: ", 7);
+                std::memcpy(chunk.output.data() + chunk.outputSize + 7, error.data(), error.size());
+                chunk.outputSize += error.size() + 7;
+                chunk.output[chunk.outputSize++] = '\n';
+                break;
+        }
+        data = lineEnd + 1;
+    }
+    if (options.recordHistory) {
+        chunk.history = calc.getHistory();
+    }
+}
@@ -0,0 +1,109 @@
+/**
+ * @file parallel_evaluator.h
+ * @brief Multi-threaded evaluation of large expression batches
+ */
+
+#ifndef PARALLEL_EVALUATOR_H
+#define PARALLEL_EVALUATOR_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "batch.h"
+#include "calculator.h"
+#include "work_stealing_pool.h"
+
+/**
+ * @struct ParallelOptions
+ * @brief Settings for a ParallelEvaluator
+ */
+struct ParallelOptions {
+    std::size_t threads;          ///< Worker threads (0 uses the hardware concurrency)
+    std::size_t chunkSize;        ///< Approximate bytes of input per task
+    std::size_t chunksInFlight;   ///< Tasks allowed ahead of the output (0 = 4 per thread)
+    bool recordHistory;           ///< Keep history so mergedHistory() can return it
+    bool shortestOutput;          ///< Print full-precision results instead of the display format
+
+    ParallelOptions();
+};
+
+/**
+ * @class ParallelEvaluator
+ * @brief Evaluates newline-delimited expressions on a work-stealing pool
+ *
+ * The input is cut into chunks at line boundaries. Each chunk is a task
+ * evaluated with the Calculator owned by the worker that runs it, into a
+ * private output buffer. A reorder buffer writes the chunks in input
+ * order, so the output is byte-identical to BatchEvaluator's. The number
+ * of chunks in flight is bounded, which keeps memory flat on inputs of
+ * any size.
+ */
+class ParallelEvaluator {
+public:
+    /**
+     * @brief Create the worker pool and the per-worker calculators
+     * @param options Evaluation settings
+     */
+    explicit ParallelEvaluator(const ParallelOptions& options = ParallelOptions());
+
+    ~ParallelEvaluator();
+
+    /**
+     * @brief Evaluate all lines of an in-memory buffer
+     * @param data Input text
+     * @param size Number of bytes
+     * @param outputFd Destination for the results
+     * @throw std::runtime_error if writing fails
+     */
+    void evaluate(const char* data, std::size_t size, int outputFd);
+
+    /**
+     * @brief Evaluate a file, memory-mapping it when possible
+     * @param path File to read, or "-" for standard input
+     * @param outputFd Destination for the results
+     * @throw std::runtime_error if the file cannot be read or writing fails
+     */
+    void run(const std::string& path, int outputFd);
+
+    /**
+     * @brief Get the history of all workers in input order
+     *
+     * Entries are formatted as by Calculator::getHistory() and limited
+     * to the last HistoryBuffer::DEFAULT_CAPACITY operations of the most
+     * recent evaluate() or run(). Empty unless recordHistory is set.
+     *
+     * @return History entries, oldest first
+     */
+    std::vector<std::string> mergedHistory() const;
+
+    /**
+     * @brief Get line and error counts of the most recent evaluate() or run()
+     * @return Counters
+     */
+    const BatchStats& stats() const { return counters; }
+
+    /**
+     * @brief Get the number of worker threads
+     * @return Worker count
+     */
+    std::size_t threadCount() const { return pool.size(); }
+
+private:
+    struct Chunk;
+    class ChunkSource;
+    class MemorySource;
+    class StreamSource;
+
+    ParallelOptions options;
+    WorkStealingPool pool;
+    std::vector<std::unique_ptr<Calculator>> calculators; ///< One per worker
+    std::vector<std::string> history;                     ///< Merged history of the last run
+    BatchStats counters;
+
+    void process(ChunkSource& source, int outputFd);
+    void evaluateChunk(Chunk& chunk, std::size_t worker);
+};
+
+#endif // PARALLEL_EVALUATOR_H
@@ -0,0 +1,154 @@
+#include "register_bank.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Threads take stripes round-robin in the order they first add, so up to
+// the stripe count every thread has a stripe of its own
+std::atomic<std::size_t> nextStripe(0);
+
+std::size_t threadStripe() {
+    static thread_local const std::size_t index = nextStripe.fetch_add(1, std::memory_order_relaxed);
+    return index;
+}
+
+std::size_t roundUpToPowerOfTwo(std::size_t n) {
+    std::size_t power = 1;
+    while (power < n) {
+        power <<= 1;
+    }
+    return power;
+}
+
+// Adds delta with a compare-and-swap loop and returns the previous value
+double atomicAdd(std::atomic<double>& target, double delta) {
+    double expected = target.load(std::memory_order_relaxed);
+    while (!target.compare_exchange_weak(expected, expected + delta, std::memory_order_relaxed)) {
+    }
+    return expected;
+}
+
+// Neumaier's two-sum: the exact rounding error of sum = a + b
+double roundingError(double a, double b, double sum) {
+    return std::fabs(a) >= std::fabs(b) ? (a - sum) + b : (b - sum) + a;
+}
+
+// Running Neumaier sum
+struct CompensatedSum {
+    double sum;
+    double compensation;
+
+    CompensatedSum() : sum(0), compensation(0) {
+    }
+
+    void add(double x) {
+        double t = sum + x;
+        compensation += roundingError(sum, x, t);
+        sum = t;
+    }
+
+    double value() const { return sum + compensation; }
+};
+
+} // namespace
+
+SharedRegister::SharedRegister(RegisterMode mode, std::size_t stripeCount)
+    : value(0)
+    , stripes(nullptr)
+    , stripeMask(0) {
+    if (mode == RegisterMode::Direct) {
+        return;
+    }
+    if (stripeCount == 0) {
+        stripeCount = 2 * std::max(1u, std::thread::hardware_concurrency());
+    }
+    stripeCount = roundUpToPowerOfTwo(stripeCount);
+    stripeMask = stripeCount - 1;
+
+    // One stripe per cache line, so two threads never write the same line
+    storage.reset(new char[(stripeCount + 1) * CACHE_LINE]);
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(storage.get());
+    address = (address + CACHE_LINE - 1) & ~static_cast<std::uintptr_t>(CACHE_LINE - 1);
+    stripes = reinterpret_cast<Stripe*>(address);
+    for (std::size_t i = 0; i < stripeCount; ++i) {
+        Stripe* s = new (reinterpret_cast<char*>(stripes) + i * CACHE_LINE) Stripe;
+        s->sum.store(0, std::memory_order_relaxed);
+        s->error.store(0, std::memory_order_relaxed);
+    }
+}
+
+double SharedRegister::load() const {
+    if (!stripes) {
+        return value.load(std::memory_order_relaxed);
+    }
+    CompensatedSum total;
+    total.add(value.load(std::memory_order_relaxed));
+    for (std::size_t i = 0; i <= stripeMask; ++i) {
+        total.add(stripe(i).sum.load(std::memory_order_relaxed));
+    }
+    for (std::size_t i = 0; i <= stripeMask; ++i) {
+        total.add(stripe(i).error.load(std::memory_order_relaxed));
+    }
+    return total.value();
+}
+
+void SharedRegister::store(double newValue) {
+    if (stripes) {
+        for (std::size_t i = 0; i <= stripeMask; ++i) {
+            stripe(i).sum.store(0, std::memory_order_relaxed);
+            stripe(i).error.store(0, std::memory_order_relaxed);
+        }
+    }
+    value.store(newValue, std::memory_order_relaxed);
+}
+
+void SharedRegister::add(double delta) {
+    if (!stripes) {
+        atomicAdd(value, delta);
+        return;
+    }
+    Stripe& s = stripe(threadStripe() & stripeMask);
+    double previous = atomicAdd(s.sum, delta);
+    double error = roundingError(previous, delta, previous + delta);
+    if (error != 0) {
+        atomicAdd(s.error, error);
+    }
+}
+
+double SharedRegister::fetchAdd(double delta) {
+    if (stripes) {
+        throw std::logic_error("fetchAdd on a striped register");
+    }
+    return atomicAdd(value, delta);
+}
+
+SharedRegister& RegisterBank::at(const std::string& name, RegisterMode mode) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = byName.find(name);
+    if (it != byName.end()) {
+        if (it->second->mode() != mode) {
+            throw std::invalid_argument("Register " + name + " exists with another mode");
+        }
+        return *it->second;
+    }
+    registers.emplace_back(mode);
+    order.push_back(name);
+    byName[name] = &registers.back();
+    return registers.back();
+}
+
+SharedRegister* RegisterBank::find(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = byName.find(name);
+    return it == byName.end() ? nullptr : it->second;
+}
+
+std::vector<std::string> RegisterBank::names() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return order;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file register_bank.h
+ * @brief Named memory registers that many threads can update at once
+ */
+
+#ifndef REGISTER_BANK_H
+#define REGISTER_BANK_H
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @enum RegisterMode
+ * @brief How a shared register absorbs concurrent additions
+ */
+enum class RegisterMode {
+    Direct,   ///< One atomic value; every add is a compare-and-swap on it
+    Striped   ///< Adds go to per-thread stripes that are summed on read
+};
+
+/**
+ * @class SharedRegister
+ * @brief Lock-free counterpart of the calculator's memory value
+ *
+ * A Direct register is a single std::atomic<double> updated with a
+ * compare-and-swap loop, so fetchAdd() behaves like an atomic fetch_add
+ * on an integer. Under heavy write contention the threads keep stealing
+ * the cache line from each other; a Striped register avoids that by
+ * giving each thread its own cache line to add into.
+ *
+ * Striped additions are compensated: after each compare-and-swap the
+ * exact rounding error of that addition (Neumaier's two-sum) is added to
+ * the stripe's error term, and load() sums the base value, the stripes
+ * and their error terms with Neumaier summation. The result is usually
+ * the correctly rounded sum of everything added.
+ *
+ * store() and clear() are not atomic with respect to concurrent adds on
+ * a Striped register: an add that races with them may be lost.
+ */
+class SharedRegister {
+public:
+    /**
+     * @brief Create a register holding 0
+     * @param mode Direct or Striped
+     * @param stripes Stripe count for Striped registers, rounded up to a
+     *                power of two (0 picks twice the hardware concurrency)
+     */
+    explicit SharedRegister(RegisterMode mode = RegisterMode::Direct, std::size_t stripes = 0);
+
+    SharedRegister(const SharedRegister&) = delete;
+    SharedRegister& operator=(const SharedRegister&) = delete;
+
+    /**
+     * @brief Read the value (MR)
+     * @return Base value plus every addition so far
+     */
+    double load() const;
+
+    /**
+     * @brief Replace the value (MS)
+     * @param value New value
+     */
+    void store(double value);
+
+    /**
+     * @brief Reset the value to 0 (MC)
+     */
+    void clear() { store(0); }
+
+    /**
+     * @brief Add to the value (M+)
+     * @param delta Amount to add
+     */
+    void add(double delta);
+
+    /**
+     * @brief Subtract from the value (M-)
+     * @param delta Amount to subtract
+     */
+    void subtract(double delta) { add(-delta); }
+
+    /**
+     * @brief Atomically add and return the previous value
+     * @param delta Amount to add
+     * @return Value before the addition
+     * @throw std::logic_error for a Striped register, which has no single
+     *        previous value
+     */
+    double fetchAdd(double delta);
+
+    /**
+     * @brief Get the register's mode
+     * @return Direct or Striped
+     */
+    RegisterMode mode() const { return stripes ? RegisterMode::Striped : RegisterMode::Direct; }
+
+private:
+    // One cache line of a Striped register
+    struct Stripe {
+        std::atomic<double> sum;
+        std::atomic<double> error;
+    };
+
+    static const std::size_t CACHE_LINE = 64;
+
+    std::atomic<double> value;         ///< Direct value, or base of a Striped register
+    std::unique_ptr<char[]> storage;   ///< Backing memory of the stripes
+    Stripe* stripes;                   ///< Cache-line-aligned stripes, null when Direct
+    std::size_t stripeMask;            ///< Stripe count - 1
+
+    Stripe& stripe(std::size_t index) const {
+        return *reinterpret_cast<Stripe*>(reinterpret_cast<char*>(stripes) + index * CACHE_LINE);
+    }
+};
+
+/**
+ * @class RegisterBank
+ * @brief Set of named shared registers
+ *
+ * Registers are created on first use and live as long as the bank, so
+ * the reference returned by at() can be kept and used from any thread.
+ * Looking a name up takes a mutex; operations on the register do not.
+ */
+class RegisterBank {
+public:
+    /**
+     * @brief Get a register, creating it with the given mode if needed
+     * @param name Register name, e.g. "M"
+     * @param mode Mode used when the register is created
+     * @return The register
+     * @throw std::invalid_argument if the register exists with another mode
+     */
+    SharedRegister& at(const std::string& name, RegisterMode mode = RegisterMode::Direct);
+
+    /**
+     * @brief Look up an existing register
+     * @param name Register name
+     * @return The register, or nullptr if it has not been created
+     */
+    SharedRegister* find(const std::string& name);
+
+    /**
+     * @brief Get the names of all registers
+     * @return Names in creation order
+     */
+    std::vector<std::string> names() const;
+
+private:
+    mutable std::mutex mutex;
+    std::deque<SharedRegister> registers;  ///< Stable addresses
+    std::vector<std::string> order;
+    std::unordered_map<std::string, SharedRegister*> byName;
+};
+
+#endif // REGISTER_BANK_H
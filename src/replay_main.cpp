@@ -0,0 +1,99 @@
+#include "calculator.h"
+#include "history_log.h"
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace {
+
+const char* opName(HistoryOp op) {
+    switch (op) {
+        case HistoryOp::Add: return "add";
+        case HistoryOp::Subtract: return "subtract";
+        case HistoryOp::Multiply: return "multiply";
+        case HistoryOp::Divide: return "divide";
+        case HistoryOp::Sqrt: return "sqrt";
+        case HistoryOp::Power: return "power";
+        case HistoryOp::Ln: return "ln";
+        case HistoryOp::Sin: return "sin";
+        case HistoryOp::Cos: return "cos";
+        case HistoryOp::Tan: return "tan";
+        case HistoryOp::MemoryStore: return "MS";
+        case HistoryOp::MemoryRecall: return "MR";
+        case HistoryOp::MemoryClear: return "MC";
+        case HistoryOp::MemoryAdd: return "M+";
+        case HistoryOp::MemorySubtract: return "M-";
+        case HistoryOp::Sum: return "sum";
+        case HistoryOp::Mean: return "mean";
+        case HistoryOp::Variance: return "variance";
+        case HistoryOp::StdDev: return "stddev";
+        case HistoryOp::Min: return "min";
+        case HistoryOp::Max: return "max";
+        case HistoryOp::PrefixSum: return "prefix_sum";
+        case HistoryOp::DecimalAdd: return "decimal_add";
+        case HistoryOp::DecimalSubtract: return "decimal_subtract";
+        case HistoryOp::DecimalMultiply: return "decimal_multiply";
+        case HistoryOp::DecimalDivide: return "decimal_divide";
+        case HistoryOp::SinDegrees: return "sin_degrees";
+        case HistoryOp::CosDegrees: return "cos_degrees";
+        case HistoryOp::TanDegrees: return "tan_degrees";
+    }
+    return "unknown";
+}
+
+void printRecord(std::uint64_t index, const HistoryLogRecord& record) {
+    std::cout << "#" << index << " " << opName(record.operation()) << " " << record.lhs << " "
+              << record.rhs << " = " << record.result << "\n";
+}
+
+void displayUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--print] <log>\n"
+              << "  Re-executes a history log written with --history-log and\n"
+              << "  reports records whose result no longer matches.\n"
+              << "  --print  List every record\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const char* path = nullptr;
+    bool print = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--print") == 0) {
+            print = true;
+        } else if (argv[i][0] != '-' && path == nullptr) {
+            path = argv[i];
+        } else {
+            displayUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (path == nullptr) {
+        displayUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        HistoryLogReader log(path);
+        std::cout.precision(std::numeric_limits<double>::max_digits10);
+        if (print) {
+            std::uint64_t index = 0;
+            for (const HistoryLogRecord& record : log) {
+                printRecord(index++, record);
+            }
+        }
+
+        Calculator calc(0);
+        ReplayReport report = replayHistoryLog(log, calc);
+        for (std::uint64_t index : report.mismatchIndices) {
+            std::cout << "Mismatch: ";
+            printRecord(index, log[index]);
+        }
+        std::cout << report.records << " records, " << report.checked << " checked, "
+                  << report.mismatches << " mismatches\n";
+        return report.mismatches == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 2;
+    }
+}
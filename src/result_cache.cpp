@@ -0,0 +1,95 @@
+#include "result_cache.h"
+#include <new>
+
+namespace {
+
+const std::size_t CACHE_LINE = 64;
+
+// Allocates zeroed, cache-line-aligned memory for sets of two slots
+template <typename Slot>
+Slot* allocateSets(std::unique_ptr<char[]>& storage, std::size_t entries) {
+    static_assert(2 * sizeof(Slot) == CACHE_LINE, "two slots fill one cache line");
+    storage.reset(new char[entries * sizeof(Slot) + CACHE_LINE]);
+    std::uintptr_t address = reinterpret_cast<std::uintptr_t>(storage.get());
+    address = (address + CACHE_LINE - 1) & ~static_cast<std::uintptr_t>(CACHE_LINE - 1);
+    return reinterpret_cast<Slot*>(address);
+}
+
+} // namespace
+
+std::size_t result_cache_detail::roundUpEntries(std::size_t entries) {
+    std::size_t rounded = 2;
+    while (rounded < entries) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+ResultCache::ResultCache(std::size_t entries)
+    : sets(nullptr)
+    , setMask(result_cache_detail::roundUpEntries(entries) / 2 - 1) {
+    sets = allocateSets<Slot>(storage, capacity());
+    clear();
+}
+
+void ResultCache::clear() {
+    for (std::size_t i = 0; i < capacity(); ++i) {
+        new (&sets[i]) Slot();
+    }
+}
+
+SharedResultCache::SharedResultCache(std::size_t entries)
+    : sets(nullptr)
+    , setMask(result_cache_detail::roundUpEntries(entries) / 2 - 1) {
+    sets = allocateSets<Slot>(storage, capacity());
+    for (std::size_t i = 0; i < capacity(); ++i) {
+        Slot* slot = new (&sets[i]) Slot;
+        slot->state.store(0, std::memory_order_relaxed);
+        slot->a.store(0, std::memory_order_relaxed);
+        slot->b.store(0, std::memory_order_relaxed);
+        slot->result.store(0, std::memory_order_relaxed);
+    }
+}
+
+void SharedResultCache::insert(CachedFunction function, double a, double b, double result) {
+    const std::uint64_t ka = result_cache_detail::bits(a);
+    const std::uint64_t kb = result_cache_detail::bits(b);
+    const std::uint64_t h = result_cache_detail::hash(function, ka, kb);
+    Slot* set = sets + 2 * (h & setMask);
+
+    // Prefer an empty slot; otherwise let a hash bit pick the victim
+    Slot* slot = &set[(h >> 63) & 1];
+    for (int way = 0; way < 2; ++way) {
+        if ((set[way].state.load(std::memory_order_relaxed) & FUNCTION_MASK) == 0) {
+            slot = &set[way];
+            break;
+        }
+    }
+
+    std::uint64_t state = slot->state.load(std::memory_order_relaxed);
+    std::uint64_t version = state >> 8;
+    if ((version & 1) != 0) {
+        return;
+    }
+    if (!slot->state.compare_exchange_strong(state, (version + 1) << 8, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->a.store(ka, std::memory_order_relaxed);
+    slot->b.store(kb, std::memory_order_relaxed);
+    slot->result.store(result_cache_detail::bits(result), std::memory_order_relaxed);
+    slot->state.store(((version + 2) << 8) | static_cast<std::uint64_t>(function), std::memory_order_release);
+}
+
+void SharedResultCache::clear() {
+    for (std::size_t i = 0; i < capacity(); ++i) {
+        Slot& slot = sets[i];
+        // Keep the version moving so a concurrent reader cannot match
+        std::uint64_t version = ((slot.state.load(std::memory_order_relaxed) >> 8) + 2) & ~std::uint64_t(1);
+        slot.state.store(version << 8, std::memory_order_release);
+        slot.a.store(0, std::memory_order_relaxed);
+        slot.b.store(0, std::memory_order_relaxed);
+        slot.result.store(0, std::memory_order_relaxed);
+    }
+}
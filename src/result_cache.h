@@ -0,0 +1,267 @@
+/**
+ * @file result_cache.h
+ * @brief Memoization tables for the calculator's expensive operations
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+/**
+ * @enum CachedFunction
+ * @brief Computation a cached result belongs to
+ *
+ * The trigonometric functions have one value per angle unit, so a
+ * result computed in degrees is never returned in radians mode.
+ */
+enum class CachedFunction : std::uint8_t {
+    Power = 1,
+    Ln,
+    SinRadians,
+    SinDegrees,
+    CosRadians,
+    CosDegrees,
+    TanRadians,
+    TanDegrees
+};
+
+/**
+ * @struct CacheStats
+ * @brief Lookup counts of a result cache
+ */
+struct CacheStats {
+    std::uint64_t hits;    ///< Lookups answered from the cache
+    std::uint64_t misses;  ///< Lookups that had to compute the result
+
+    /**
+     * @brief Get the fraction of lookups that hit
+     * @return hits / (hits + misses), 0 without lookups
+     */
+    double hitRate() const {
+        std::uint64_t lookups = hits + misses;
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
+
+namespace result_cache_detail {
+
+inline std::uint64_t bits(double value) {
+    std::uint64_t result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+inline double fromBits(std::uint64_t value) {
+    double result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+// Operands often differ only in their exponent and top mantissa bits, so
+// the high bits are folded down before the multiplications (SplitMix64)
+inline std::uint64_t hash(CachedFunction function, std::uint64_t a, std::uint64_t b) {
+    std::uint64_t h = a ^ (b * 0x9E3779B97F4A7C15ULL) ^ static_cast<std::uint64_t>(function);
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+std::size_t roundUpEntries(std::size_t entries);
+
+} // namespace result_cache_detail
+
+/**
+ * @class ResultCache
+ * @brief Bounded memoization table for one calculator
+ *
+ * Results are keyed on the function and the exact bit patterns of the
+ * operands, so 0.0 and -0.0 (or two NaN payloads) are different keys and
+ * a hit returns exactly the bits the computation produced. The table is
+ * open-addressed in sets of two 32-byte slots that share one cache line:
+ * a lookup hashes the key to a set and compares both slots, so it touches
+ * a single line. Inserting into a full set evicts the less recently
+ * inserted slot.
+ *
+ * Not thread-safe; see SharedResultCache for a cache used by many
+ * threads.
+ */
+class ResultCache {
+public:
+    static const std::size_t DEFAULT_ENTRIES = 4096;
+
+    /**
+     * @brief Create an empty cache
+     * @param entries Results kept, rounded up to a power of two (at least 2)
+     */
+    explicit ResultCache(std::size_t entries = DEFAULT_ENTRIES);
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /**
+     * @brief Look a result up
+     * @param function Computation
+     * @param a First operand
+     * @param b Second operand (0 for unary functions)
+     * @param result Receives the cached result on a hit
+     * @return true on a hit
+     */
+    bool lookup(CachedFunction function, double a, double b, double& result) const {
+        const std::uint64_t ka = result_cache_detail::bits(a);
+        const std::uint64_t kb = result_cache_detail::bits(b);
+        const Slot* set = sets + 2 * (result_cache_detail::hash(function, ka, kb) & setMask);
+        for (int way = 0; way < 2; ++way) {
+            if (set[way].function == function && set[way].a == ka && set[way].b == kb) {
+                result = set[way].result;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Remember a result
+     * @param function Computation
+     * @param a First operand
+     * @param b Second operand (0 for unary functions)
+     * @param result Result of the computation
+     */
+    void insert(CachedFunction function, double a, double b, double result) {
+        const std::uint64_t ka = result_cache_detail::bits(a);
+        const std::uint64_t kb = result_cache_detail::bits(b);
+        Slot* set = sets + 2 * (result_cache_detail::hash(function, ka, kb) & setMask);
+        set[1] = set[0];
+        set[0].a = ka;
+        set[0].b = kb;
+        set[0].result = result;
+        set[0].function = function;
+    }
+
+    /**
+     * @brief Forget every result
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of results the cache can hold
+     * @return Slot count
+     */
+    std::size_t capacity() const { return 2 * (setMask + 1); }
+
+private:
+    struct Slot {
+        std::uint64_t a;
+        std::uint64_t b;
+        double result;
+        CachedFunction function;  ///< 0 while empty
+    };
+
+    std::unique_ptr<char[]> storage;  ///< Backing memory of the sets
+    Slot* sets;                       ///< Cache-line-aligned pairs of slots
+    std::size_t setMask;              ///< Set count - 1
+};
+
+/**
+ * @class SharedResultCache
+ * @brief Memoization table shared by calculators on many threads
+ *
+ * Same layout and keys as ResultCache, but every slot is guarded by a
+ * sequence number so lookups never write: a reader loads the sequence,
+ * the key and the result, and accepts the result only if the sequence is
+ * even and unchanged. Inserting takes the slot with a compare-and-swap
+ * and simply gives up if another thread is writing it, so neither side
+ * ever waits. Hits on a warm cache therefore scale with the number of
+ * readers; misses pay one compare-and-swap.
+ *
+ * In a full set the slot to replace is picked by a hash bit, since
+ * reordering the slots as ResultCache does would make readers retry.
+ */
+class SharedResultCache {
+public:
+    /**
+     * @brief Create an empty cache
+     * @param entries Results kept, rounded up to a power of two (at least 2)
+     */
+    explicit SharedResultCache(std::size_t entries = ResultCache::DEFAULT_ENTRIES);
+
+    SharedResultCache(const SharedResultCache&) = delete;
+    SharedResultCache& operator=(const SharedResultCache&) = delete;
+
+    /**
+     * @brief Look a result up; safe to call from any thread
+     * @param function Computation
+     * @param a First operand
+     * @param b Second operand (0 for unary functions)
+     * @param result Receives the cached result on a hit
+     * @return true on a hit
+     */
+    bool lookup(CachedFunction function, double a, double b, double& result) const {
+        const std::uint64_t ka = result_cache_detail::bits(a);
+        const std::uint64_t kb = result_cache_detail::bits(b);
+        const Slot* set = sets + 2 * (result_cache_detail::hash(function, ka, kb) & setMask);
+        for (int way = 0; way < 2; ++way) {
+            const Slot& slot = set[way];
+            std::uint64_t state = slot.state.load(std::memory_order_acquire);
+            if (static_cast<CachedFunction>(state & FUNCTION_MASK) != function ||
+                slot.a.load(std::memory_order_relaxed) != ka ||
+                slot.b.load(std::memory_order_relaxed) != kb) {
+                continue;
+            }
+            std::uint64_t value = slot.result.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.state.load(std::memory_order_relaxed) == state) {
+                result = result_cache_detail::fromBits(value);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Remember a result; safe to call from any thread
+     *
+     * The result may be dropped if another thread is writing the slot.
+     *
+     * @param function Computation
+     * @param a First operand
+     * @param b Second operand (0 for unary functions)
+     * @param result Result of the computation
+     */
+    void insert(CachedFunction function, double a, double b, double result);
+
+    /**
+     * @brief Forget every result; must not run concurrently with insert()
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of results the cache can hold
+     * @return Slot count
+     */
+    std::size_t capacity() const { return 2 * (setMask + 1); }
+
+private:
+    // state is (version << 8) | function; the version is odd while the
+    // slot is being written, which also clears the function
+    struct Slot {
+        std::atomic<std::uint64_t> state;
+        std::atomic<std::uint64_t> a;
+        std::atomic<std::uint64_t> b;
+        std::atomic<std::uint64_t> result;
+    };
+
+    static const std::uint64_t FUNCTION_MASK = 0xff;
+
+    std::unique_ptr<char[]> storage;  ///< Backing memory of the sets
+    Slot* sets;                       ///< Cache-line-aligned pairs of slots
+    std::size_t setMask;              ///< Set count - 1
+};
+
+#endif // RESULT_CACHE_H
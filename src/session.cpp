@@ -0,0 +1,385 @@
+#include "session.h"
+#include "calculator.h"
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+
+namespace {
+
+const char SESSION_MAGIC[8] = {'C', 'A', 'L', 'C', 'S', 'E', 'S', 'S'};
+const unsigned char SESSION_VERSION = 1;
+const std::size_t SESSION_HEADER_SIZE = 16;
+const unsigned char END_OF_STEPS = 0;
+const unsigned char NO_DECIMAL_SCALE = 0xFF;
+const unsigned char FLAG_RADIANS = 1;
+
+void putVarint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void putString(std::string& out, const std::string& text) {
+    putVarint(out, text.size());
+    out += text;
+}
+
+void putHeader(std::string& out, const SessionSettings& settings) {
+    out.append(SESSION_MAGIC, sizeof(SESSION_MAGIC));
+    out += static_cast<char>(SESSION_VERSION);
+    out += static_cast<char>(settings.precision);
+    out += static_cast<char>(settings.decimalScale < 0 ? NO_DECIMAL_SCALE : settings.decimalScale);
+    out += static_cast<char>(settings.radians ? FLAG_RADIANS : 0);
+    out.append(SESSION_HEADER_SIZE - out.size(), '\0');
+}
+
+void putStep(std::string& out, const SessionStep& step) {
+    out += static_cast<char>(step.action);
+    if (step.action == SessionAction::EnterNumber) {
+        putString(out, step.keys);
+    }
+}
+
+void putOutcome(std::string& out, const std::string& display, const std::vector<std::string>& history) {
+    out += static_cast<char>(END_OF_STEPS);
+    putString(out, display);
+    putVarint(out, history.size());
+    for (const std::string& entry : history) {
+        putString(out, entry);
+    }
+}
+
+/// Decodes a recording held in memory
+class SessionParser {
+public:
+    SessionParser(const std::string& data, const std::string& path, std::size_t position)
+        : data(data), path(path), position(position) {}
+
+    bool atEnd() const { return position == data.size(); }
+
+    unsigned char byte() {
+        if (position == data.size()) {
+            fail("Truncated session recording: ");
+        }
+        return static_cast<unsigned char>(data[position++]);
+    }
+
+    std::uint64_t varint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            unsigned char b = byte();
+            value |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                return value;
+            }
+        }
+        fail("Invalid session recording: ");
+        return 0;
+    }
+
+    std::string text() {
+        std::uint64_t length = varint();
+        if (length > data.size() - position) {
+            fail("Truncated session recording: ");
+        }
+        std::string result = data.substr(position, static_cast<std::size_t>(length));
+        position += static_cast<std::size_t>(length);
+        return result;
+    }
+
+    [[noreturn]] void fail(const char* what) const {
+        throw std::runtime_error(what + path);
+    }
+
+private:
+    const std::string& data;
+    const std::string& path;
+    std::size_t position;
+};
+
+double displayedNumber(const Calculator& calc, double* operand) {
+    double value = std::stod(calc.getDisplayText());
+    if (operand != nullptr) {
+        *operand = value;
+    }
+    return value;
+}
+
+std::string numberKeys(std::mt19937_64& random, std::size_t maxDigits) {
+    std::uniform_int_distribution<std::size_t> digitCount(1, maxDigits < 1 ? 1 : maxDigits);
+    std::uniform_int_distribution<int> digit(0, 9);
+    std::uniform_int_distribution<int> shape(0, 9);
+    std::string keys;
+    int form = shape(random);
+    if (form == 0) {
+        keys += '-';
+    }
+    std::size_t count = digitCount(random);
+    keys += static_cast<char>('1' + digit(random) % 9);
+    for (std::size_t i = 1; i < count; ++i) {
+        keys += static_cast<char>('0' + digit(random));
+    }
+    if (form >= 7) {
+        keys += '.';
+        keys += static_cast<char>('0' + digit(random));
+        keys += static_cast<char>('0' + digit(random));
+    }
+    return keys;
+}
+
+} // namespace
+
+const char* sessionActionName(SessionAction action) {
+    switch (action) {
+        case SessionAction::EnterNumber: return "enter_number";
+        case SessionAction::Add: return "add";
+        case SessionAction::Subtract: return "subtract";
+        case SessionAction::Multiply: return "multiply";
+        case SessionAction::Divide: return "divide";
+        case SessionAction::SquareRoot: return "sqrt";
+        case SessionAction::Power: return "power";
+        case SessionAction::NaturalLog: return "ln";
+        case SessionAction::Sine: return "sin";
+        case SessionAction::Cosine: return "cos";
+        case SessionAction::Tangent: return "tan";
+        case SessionAction::MemoryStore: return "memory_store";
+        case SessionAction::MemoryRecall: return "memory_recall";
+        case SessionAction::MemoryClear: return "memory_clear";
+        case SessionAction::MemoryAdd: return "memory_add";
+        case SessionAction::MemorySubtract: return "memory_subtract";
+        case SessionAction::Calculate: return "calculate";
+        case SessionAction::Clear: return "clear";
+        case SessionAction::ShowHistory: return "show_history";
+        case SessionAction::ToggleAngleUnit: return "toggle_angle_unit";
+    }
+    return "unknown";
+}
+
+SessionStep::SessionStep(SessionAction action, const std::string& keys)
+    : action(action)
+    , keys(keys) {}
+
+SessionSettings::SessionSettings()
+    : precision(MathPrecision::Exact)
+    , decimalScale(-1)
+    , radians(true) {}
+
+void SessionSettings::apply(Calculator& calc) const {
+    calc.setMathPrecision(precision);
+    calc.setRadians(radians);
+    if (decimalScale >= 0) {
+        calc.enableDecimalMode(decimalScale);
+    }
+}
+
+Session::Session()
+    : hasOutcome(false) {}
+
+double performSessionStep(Calculator& calc, const SessionStep& step, double* operand) {
+    switch (step.action) {
+        case SessionAction::EnterNumber:
+            for (char key : step.keys) {
+                calc.appendNumber(key);
+            }
+            break;
+        case SessionAction::Add: calc.setOperation('+'); break;
+        case SessionAction::Subtract: calc.setOperation('-'); break;
+        case SessionAction::Multiply: calc.setOperation('*'); break;
+        case SessionAction::Divide: calc.setOperation('/'); break;
+        case SessionAction::SquareRoot: return calc.sqrt(displayedNumber(calc, operand));
+        case SessionAction::Power: calc.setOperation('^'); break;
+        case SessionAction::NaturalLog: return calc.ln(displayedNumber(calc, operand));
+        case SessionAction::Sine: return calc.sin(displayedNumber(calc, operand));
+        case SessionAction::Cosine: return calc.cos(displayedNumber(calc, operand));
+        case SessionAction::Tangent: return calc.tan(displayedNumber(calc, operand));
+        case SessionAction::MemoryStore: calc.memoryStore(); break;
+        case SessionAction::MemoryRecall: calc.memoryRecall(); break;
+        case SessionAction::MemoryClear: calc.memoryClear(); break;
+        case SessionAction::MemoryAdd: calc.memoryAdd(); break;
+        case SessionAction::MemorySubtract: calc.memorySubtract(); break;
+        case SessionAction::Calculate: calc.calculate(); break;
+        case SessionAction::Clear: calc.clear(); break;
+        case SessionAction::ShowHistory:
+            for (const HistoryRecord& record : calc.historyView()) {
+                calc.formatHistoryRecord(record);
+            }
+            break;
+        case SessionAction::ToggleAngleUnit: calc.setRadians(!calc.isRadians()); break;
+    }
+    return std::numeric_limits<double>::quiet_NaN();
+}
+
+void captureSessionOutcome(Session& session) {
+    Calculator calc;
+    session.settings.apply(calc);
+    for (const SessionStep& step : session.steps) {
+        try {
+            performSessionStep(calc, step);
+        } catch (const std::exception&) {
+            // The menu reports the error and carries on
+        }
+    }
+    session.display = calc.getDisplayText();
+    session.history = calc.getHistory();
+    session.hasOutcome = true;
+}
+
+SessionRecorder::SessionRecorder(const std::string& path, const SessionSettings& settings)
+    : file(path.c_str(), std::ios::binary | std::ios::trunc)
+    , steps(0)
+    , finished(false) {
+    if (!file) {
+        throw std::runtime_error("Cannot create session recording: " + path);
+    }
+    putHeader(buffer, settings);
+    write();
+}
+
+void SessionRecorder::record(const SessionStep& step) {
+    putStep(buffer, step);
+    write();
+    ++steps;
+}
+
+void SessionRecorder::finish(const Calculator& calc) {
+    if (finished) {
+        return;
+    }
+    putOutcome(buffer, calc.getDisplayText(), calc.getHistory());
+    write();
+    finished = true;
+}
+
+void SessionRecorder::write() {
+    file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    file.flush();
+    buffer.clear();
+    if (!file) {
+        throw std::runtime_error("Cannot write session recording");
+    }
+}
+
+void writeSession(const std::string& path, const Session& session) {
+    std::string data;
+    putHeader(data, session.settings);
+    for (const SessionStep& step : session.steps) {
+        putStep(data, step);
+    }
+    if (session.hasOutcome) {
+        putOutcome(data, session.display, session.history);
+    }
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.close();
+    if (!file) {
+        throw std::runtime_error("Cannot write session recording: " + path);
+    }
+}
+
+Session readSession(const std::string& path) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open session recording: " + path);
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < SESSION_HEADER_SIZE ||
+        std::memcmp(data.data(), SESSION_MAGIC, sizeof(SESSION_MAGIC)) != 0 ||
+        static_cast<unsigned char>(data[8]) != SESSION_VERSION) {
+        throw std::runtime_error("Not a session recording: " + path);
+    }
+    Session session;
+    unsigned char precision = static_cast<unsigned char>(data[9]);
+    unsigned char scale = static_cast<unsigned char>(data[10]);
+    if (precision > static_cast<unsigned char>(MathPrecision::Fast) ||
+        (scale != NO_DECIMAL_SCALE && scale > DecimalContext::MAX_SCALE)) {
+        throw std::runtime_error("Invalid session recording: " + path);
+    }
+    session.settings.precision = static_cast<MathPrecision>(precision);
+    session.settings.decimalScale = scale == NO_DECIMAL_SCALE ? -1 : scale;
+    session.settings.radians = (data[11] & FLAG_RADIANS) != 0;
+
+    SessionParser parser(data, path, SESSION_HEADER_SIZE);
+    while (!parser.atEnd()) {
+        unsigned char action = parser.byte();
+        if (action == END_OF_STEPS) {
+            session.display = parser.text();
+            std::uint64_t count = parser.varint();
+            for (std::uint64_t i = 0; i < count; ++i) {
+                session.history.push_back(parser.text());
+            }
+            if (!parser.atEnd()) {
+                parser.fail("Invalid session recording: ");
+            }
+            session.hasOutcome = true;
+            break;
+        }
+        if (action >= SESSION_ACTION_COUNT) {
+            parser.fail("Invalid session recording: ");
+        }
+        SessionStep step(static_cast<SessionAction>(action));
+        if (step.action == SessionAction::EnterNumber) {
+            step.keys = parser.text();
+        }
+        session.steps.push_back(step);
+    }
+    return session;
+}
+
+SessionProfile::SessionProfile()
+    : steps(200)
+    , scientificRate(0.15)
+    , memoryRate(0.05)
+    , clearRate(0.05)
+    , historyRate(0.01)
+    , maxDigits(4) {}
+
+Session syntheticSession(const SessionProfile& profile, std::uint64_t seed) {
+    static const SessionAction OPERATORS[] = {
+        SessionAction::Add, SessionAction::Subtract, SessionAction::Multiply,
+        SessionAction::Divide, SessionAction::Add, SessionAction::Multiply,
+        SessionAction::Subtract, SessionAction::Power
+    };
+    static const SessionAction SCIENTIFIC[] = {
+        SessionAction::SquareRoot, SessionAction::NaturalLog, SessionAction::Sine,
+        SessionAction::Cosine, SessionAction::Tangent
+    };
+    static const SessionAction MEMORY[] = {
+        SessionAction::MemoryStore, SessionAction::MemoryAdd, SessionAction::MemorySubtract,
+        SessionAction::MemoryRecall, SessionAction::MemoryClear
+    };
+
+    std::mt19937_64 random(seed);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::uniform_int_distribution<std::size_t> pickOperator(0, sizeof(OPERATORS) / sizeof(OPERATORS[0]) - 1);
+    std::uniform_int_distribution<std::size_t> pickScientific(0, sizeof(SCIENTIFIC) / sizeof(SCIENTIFIC[0]) - 1);
+    std::uniform_int_distribution<std::size_t> pickMemory(0, sizeof(MEMORY) / sizeof(MEMORY[0]) - 1);
+
+    Session session;
+    session.settings = profile.settings;
+    std::vector<SessionStep>& steps = session.steps;
+    while (steps.size() < profile.steps) {
+        steps.push_back(SessionStep(SessionAction::EnterNumber, numberKeys(random, profile.maxDigits)));
+        if (chance(random) < profile.scientificRate) {
+            steps.push_back(SessionStep(SCIENTIFIC[pickScientific(random)]));
+        } else {
+            steps.push_back(SessionStep(OPERATORS[pickOperator(random)]));
+            steps.push_back(SessionStep(SessionAction::EnterNumber, numberKeys(random, profile.maxDigits)));
+            steps.push_back(SessionStep(SessionAction::Calculate));
+        }
+        if (chance(random) < profile.memoryRate) {
+            steps.push_back(SessionStep(MEMORY[pickMemory(random)]));
+        }
+        if (chance(random) < profile.clearRate) {
+            steps.push_back(SessionStep(SessionAction::Clear));
+        }
+        if (chance(random) < profile.historyRate) {
+            steps.push_back(SessionStep(SessionAction::ShowHistory));
+        }
+    }
+    captureSessionOutcome(session);
+    return session;
+}
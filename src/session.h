@@ -0,0 +1,220 @@
+/**
+ * @file session.h
+ * @brief Recordings of interactive calculator sessions
+ */
+
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "fast_math.h"
+
+class Calculator;
+
+/**
+ * @enum SessionAction
+ * @brief Menu choice of the interactive calculator
+ *
+ * Values are the menu numbers; Exit is not recorded, the end of a
+ * recording takes its place.
+ */
+enum class SessionAction : unsigned char {
+    EnterNumber = 1,  ///< Keys typed into the display
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    SquareRoot,       ///< Scientific functions apply to the displayed number
+    Power,
+    NaturalLog,
+    Sine,
+    Cosine,
+    Tangent,
+    MemoryStore,
+    MemoryRecall,
+    MemoryClear,
+    MemoryAdd,
+    MemorySubtract,
+    Calculate,
+    Clear,
+    ShowHistory,
+    ToggleAngleUnit
+};
+
+/// Number of SessionAction values, counting the unused 0
+const std::size_t SESSION_ACTION_COUNT = static_cast<std::size_t>(SessionAction::ToggleAngleUnit) + 1;
+
+/**
+ * @brief Get the snake_case name of an action
+ * @param action Action
+ * @return Name such as "enter_number"
+ */
+const char* sessionActionName(SessionAction action);
+
+/**
+ * @struct SessionStep
+ * @brief One menu selection and its input
+ */
+struct SessionStep {
+    SessionAction action;
+    std::string keys;  ///< Keys passed to Calculator::appendNumber, EnterNumber only
+
+    explicit SessionStep(SessionAction action = SessionAction::Clear, const std::string& keys = std::string());
+};
+
+/**
+ * @struct SessionSettings
+ * @brief Calculator settings in effect when a session starts
+ */
+struct SessionSettings {
+    MathPrecision precision;  ///< Set with Calculator::setMathPrecision
+    int decimalScale;         ///< Decimal mode scale, or -1 for doubles
+    bool radians;             ///< Initial angle unit
+
+    SessionSettings();
+
+    /**
+     * @brief Configure a fresh calculator like the recorded one
+     * @param calc Calculator to set up
+     */
+    void apply(Calculator& calc) const;
+};
+
+/**
+ * @struct Session
+ * @brief A recorded or generated session and the state it ended in
+ */
+struct Session {
+    SessionSettings settings;
+    std::vector<SessionStep> steps;
+    bool hasOutcome;                   ///< false if the recording was cut short
+    std::string display;               ///< Final display text
+    std::vector<std::string> history;  ///< Final history, as Calculator::getHistory()
+
+    Session();
+};
+
+/**
+ * @brief Apply one step to a calculator exactly as the interactive menu does
+ *
+ * Scientific functions parse the display text and apply the function to
+ * it; ShowHistory formats the history. Errors propagate as exceptions,
+ * which the menu reports and otherwise ignores.
+ *
+ * @param calc Calculator to drive
+ * @param step Step to apply
+ * @param operand Receives the displayed number a scientific function was applied to, if not null
+ * @return Result of a scientific function, NaN for other actions
+ * @throw std::exception whatever the calculator operation throws
+ */
+double performSessionStep(Calculator& calc, const SessionStep& step, double* operand = nullptr);
+
+/**
+ * @brief Play a session on a fresh calculator and store the state it ends in
+ *
+ * Gives generated sessions the outcome replays are checked against.
+ *
+ * @param session Session to complete
+ */
+void captureSessionOutcome(Session& session);
+
+/**
+ * @class SessionRecorder
+ * @brief Writes a session recording as the session happens
+ *
+ * The file starts with a 16-byte header ("CALCSESS", version, settings).
+ * Each step is its menu number in one byte; EnterNumber is followed by
+ * the key count as a LEB128 varint and the keys, so a typical step takes
+ * one to eight bytes. finish() writes a 0 byte and the final display
+ * and history as length-prefixed strings. Every step is flushed, so a
+ * recording survives the process being killed, without its outcome.
+ */
+class SessionRecorder {
+public:
+    /**
+     * @brief Create a recording
+     * @param path File to write, replaced if it exists
+     * @param settings Settings the session starts with
+     * @throw std::runtime_error if the file cannot be created
+     */
+    SessionRecorder(const std::string& path, const SessionSettings& settings);
+
+    SessionRecorder(const SessionRecorder&) = delete;
+    SessionRecorder& operator=(const SessionRecorder&) = delete;
+
+    /**
+     * @brief Append a step
+     * @throw std::runtime_error if writing fails
+     */
+    void record(const SessionStep& step);
+
+    /**
+     * @brief End the recording with the calculator's final display and history
+     * @throw std::runtime_error if writing fails
+     */
+    void finish(const Calculator& calc);
+
+    /** @brief Get the number of steps recorded */
+    std::size_t size() const { return steps; }
+
+private:
+    std::ofstream file;
+    std::string buffer;  ///< Encoding of the step being written
+    std::size_t steps;
+    bool finished;
+
+    void write();
+};
+
+/**
+ * @brief Write a complete session in the SessionRecorder format
+ * @param path File to write, replaced if it exists
+ * @param session Session to write; its outcome is written if it has one
+ * @throw std::runtime_error if the file cannot be written
+ */
+void writeSession(const std::string& path, const Session& session);
+
+/**
+ * @brief Read a recording written by SessionRecorder or writeSession()
+ * @param path File to read
+ * @return Settings, steps and, if the recording was finished, its outcome
+ * @throw std::runtime_error if the file cannot be read, is not a session
+ *        recording, or ends in the middle of a step
+ */
+Session readSession(const std::string& path);
+
+/**
+ * @struct SessionProfile
+ * @brief Shape of generated sessions
+ *
+ * A generated session is a series of calculations as a person at the
+ * menu would key them: a number, an operator, another number and '='
+ * most of the time, with scientific functions, memory operations,
+ * clears and history views mixed in at the given rates.
+ */
+struct SessionProfile {
+    std::size_t steps;         ///< Steps per session, at least
+    double scientificRate;     ///< Share of calculations that apply sqrt, ln, sin, cos or tan
+    double memoryRate;         ///< Share followed by a memory operation
+    double clearRate;          ///< Share followed by a clear
+    double historyRate;        ///< Share followed by a history view
+    std::size_t maxDigits;     ///< Most digits per number
+    SessionSettings settings;  ///< Settings of every generated session
+
+    SessionProfile();
+};
+
+/**
+ * @brief Generate a session and capture its outcome
+ * @param profile Shape of the session
+ * @param seed Seed of the generator; equal seeds give equal sessions
+ * @return Session ready to replay and check
+ */
+Session syntheticSession(const SessionProfile& profile, std::uint64_t seed);
+
+#endif // SESSION_H
@@ -0,0 +1,179 @@
+#include "session_replay.h"
+#include "calculator.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/// Instances driven by one worker, and what it measured
+struct Shard {
+    std::size_t begin;
+    std::size_t end;
+    std::vector<std::unique_ptr<Calculator>> calculators;
+    OpMetrics latency;
+    std::vector<OpMetrics> actions;
+    std::uint64_t stepErrors;
+    std::uint64_t maxNanoseconds;
+    std::uint64_t verified;
+    std::uint64_t unverified;
+    std::vector<std::size_t> mismatches;
+
+    Shard(std::size_t begin, std::size_t end)
+        : begin(begin)
+        , end(end)
+        , latency()
+        , actions(SESSION_ACTION_COUNT)
+        , stepErrors(0)
+        , maxNanoseconds(0)
+        , verified(0)
+        , unverified(0) {}
+};
+
+void addMetrics(OpMetrics& total, const OpMetrics& part) {
+    total.calls += part.calls;
+    total.errors += part.errors;
+    total.totalNanoseconds += part.totalNanoseconds;
+    for (std::size_t i = 0; i < METRIC_BUCKET_COUNT; ++i) {
+        total.buckets[i] += part.buckets[i];
+    }
+}
+
+void playShard(Shard& shard, const std::vector<Session>& sessions) {
+    std::size_t longest = 0;
+    for (const Session& session : sessions) {
+        longest = std::max(longest, session.steps.size());
+    }
+    for (std::size_t step = 0; step < longest; ++step) {
+        for (std::size_t i = shard.begin; i < shard.end; ++i) {
+            const Session& session = sessions[i % sessions.size()];
+            if (step >= session.steps.size()) {
+                continue;
+            }
+            const SessionStep& current = session.steps[step];
+            Calculator& calc = *shard.calculators[i - shard.begin];
+            bool failed = false;
+            Clock::time_point start = Clock::now();
+            try {
+                performSessionStep(calc, current);
+            } catch (const std::exception&) {
+                failed = true;
+            }
+            std::uint64_t nanoseconds = static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+            std::size_t bucket = metricBucket(nanoseconds);
+            OpMetrics& action = shard.actions[static_cast<std::size_t>(current.action)];
+            ++action.calls;
+            action.totalNanoseconds += nanoseconds;
+            ++action.buckets[bucket];
+            ++shard.latency.calls;
+            shard.latency.totalNanoseconds += nanoseconds;
+            ++shard.latency.buckets[bucket];
+            if (failed) {
+                ++action.errors;
+                ++shard.latency.errors;
+                ++shard.stepErrors;
+            }
+            shard.maxNanoseconds = std::max(shard.maxNanoseconds, nanoseconds);
+        }
+    }
+}
+
+void checkShard(Shard& shard, const std::vector<Session>& sessions) {
+    for (std::size_t i = shard.begin; i < shard.end; ++i) {
+        const Session& session = sessions[i % sessions.size()];
+        const Calculator& calc = *shard.calculators[i - shard.begin];
+        if (!session.hasOutcome) {
+            ++shard.unverified;
+        } else if (calc.getDisplayText() == session.display && calc.getHistory() == session.history) {
+            ++shard.verified;
+        } else {
+            shard.mismatches.push_back(i);
+        }
+    }
+    shard.calculators.clear();
+}
+
+} // namespace
+
+SessionLoadOptions::SessionLoadOptions()
+    : instances(1000)
+    , threads(0)
+    , maxMismatches(10) {}
+
+SessionLoadReport::SessionLoadReport()
+    : instances(0)
+    , steps(0)
+    , stepErrors(0)
+    , verified(0)
+    , mismatches(0)
+    , unverified(0)
+    , seconds(0)
+    , throughput(0)
+    , maxNanoseconds(0)
+    , latency()
+    , actions(SESSION_ACTION_COUNT) {}
+
+SessionLoadReport runSessionLoad(const std::vector<Session>& sessions, const SessionLoadOptions& options) {
+    if (sessions.empty()) {
+        throw std::invalid_argument("No sessions to replay");
+    }
+    WorkStealingPool pool(options.threads);
+    std::size_t shardCount = std::max<std::size_t>(1, std::min(pool.size(), options.instances));
+    std::vector<Shard> shards;
+    shards.reserve(shardCount);
+    for (std::size_t s = 0; s < shardCount; ++s) {
+        shards.push_back(Shard(options.instances * s / shardCount, options.instances * (s + 1) / shardCount));
+    }
+
+    // Calculators are created on the workers that drive them
+    for (Shard& shard : shards) {
+        pool.submit([&shard, &sessions](std::size_t) {
+            for (std::size_t i = shard.begin; i < shard.end; ++i) {
+                std::unique_ptr<Calculator> calc(new Calculator);
+                sessions[i % sessions.size()].settings.apply(*calc);
+                shard.calculators.push_back(std::move(calc));
+            }
+        });
+    }
+    pool.wait();
+
+    Clock::time_point start = Clock::now();
+    for (Shard& shard : shards) {
+        pool.submit([&shard, &sessions](std::size_t) { playShard(shard, sessions); });
+    }
+    pool.wait();
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (Shard& shard : shards) {
+        pool.submit([&shard, &sessions](std::size_t) { checkShard(shard, sessions); });
+    }
+    pool.wait();
+
+    SessionLoadReport report;
+    report.instances = options.instances;
+    report.seconds = seconds;
+    for (const Shard& shard : shards) {
+        addMetrics(report.latency, shard.latency);
+        for (std::size_t a = 0; a < SESSION_ACTION_COUNT; ++a) {
+            addMetrics(report.actions[a], shard.actions[a]);
+        }
+        report.stepErrors += shard.stepErrors;
+        report.maxNanoseconds = std::max(report.maxNanoseconds, shard.maxNanoseconds);
+        report.verified += shard.verified;
+        report.unverified += shard.unverified;
+        report.mismatches += shard.mismatches.size();
+        for (std::size_t instance : shard.mismatches) {
+            if (report.mismatchInstances.size() < options.maxMismatches) {
+                report.mismatchInstances.push_back(instance);
+            }
+        }
+    }
+    report.steps = report.latency.calls;
+    report.throughput = seconds > 0 ? static_cast<double>(report.steps) / seconds : 0;
+    return report;
+}
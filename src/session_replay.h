@@ -0,0 +1,71 @@
+/**
+ * @file session_replay.h
+ * @brief Replays recorded sessions on many calculators at once
+ */
+
+#ifndef SESSION_REPLAY_H
+#define SESSION_REPLAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "metrics.h"
+#include "session.h"
+
+/**
+ * @struct SessionLoadOptions
+ * @brief Shape of a session replay run
+ */
+struct SessionLoadOptions {
+    std::size_t instances;      ///< Calculators, each playing one session
+    std::size_t threads;        ///< Worker threads (0 uses the hardware concurrency)
+    std::size_t maxMismatches;  ///< Most mismatching instances listed in the report
+
+    SessionLoadOptions();
+};
+
+/**
+ * @struct SessionLoadReport
+ * @brief Throughput, step latency and verification results of a replay
+ *
+ * Latencies are of single steps, taken with the steady clock around
+ * performSessionStep(). Percentiles come from the same log-linear
+ * histogram as the operation metrics and are bucket upper bounds.
+ */
+struct SessionLoadReport {
+    std::uint64_t instances;    ///< Calculators driven
+    std::uint64_t steps;        ///< Steps performed
+    std::uint64_t stepErrors;   ///< Steps that threw, as the menu would show "Error: ..."
+    std::uint64_t verified;     ///< Instances whose final display and history matched the recording
+    std::uint64_t mismatches;   ///< Instances that ended in a different state
+    std::uint64_t unverified;   ///< Instances playing a recording without an outcome
+    std::vector<std::size_t> mismatchInstances;  ///< First mismatching instances
+    double seconds;             ///< Wall time of the replay, setup and checks excluded
+    double throughput;          ///< Steps per second
+    std::uint64_t maxNanoseconds;  ///< Slowest step
+    OpMetrics latency;             ///< All steps
+    std::vector<OpMetrics> actions;  ///< Steps by SessionAction
+
+    SessionLoadReport();
+};
+
+/**
+ * @brief Play sessions on many calculators concurrently and check the results
+ *
+ * Instance i plays sessions[i % sessions.size()] on its own Calculator,
+ * set up with the session's settings. The instances are split into one
+ * shard per worker; a worker advances all instances of its shard by one
+ * step before taking the next, so every calculator stays live for the
+ * whole run, as sessions of a busy server would. At the end each
+ * calculator's display and history are compared with the recording.
+ *
+ * @param sessions Sessions to play
+ * @param options Instance count and threads
+ * @return Counts, throughput and latency percentiles
+ * @throw std::invalid_argument if sessions is empty
+ */
+SessionLoadReport runSessionLoad(const std::vector<Session>& sessions,
+                                 const SessionLoadOptions& options = SessionLoadOptions());
+
+#endif // SESSION_REPLAY_H
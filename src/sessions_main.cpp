@@ -0,0 +1,117 @@
+#include "session.h"
+#include "session_replay.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+void displayUsage(const char* program) {
+    SessionLoadOptions defaults;
+    SessionProfile profile;
+    std::cerr << "Usage: " << program << " [--instances N] [--threads N]"
+              << " [--synthetic N [--steps N] [--seed N]] [recording...]\n"
+              << "  Replays sessions recorded with --record-session, or generated ones,\n"
+              << "  on many calculators at once; reports throughput and step latency\n"
+              << "  and checks every final display and history against the recording.\n"
+              << "  --instances N  Calculators driven concurrently (default " << defaults.instances << ")\n"
+              << "  --threads N    Worker threads (default: one per core)\n"
+              << "  --synthetic N  Add N generated sessions\n"
+              << "  --steps N      Steps per generated session (default " << profile.steps << ")\n"
+              << "  --seed N       Seed of the first generated session (default 1)\n";
+}
+
+bool parseCount(const char* text, std::size_t& value) {
+    char* end;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (*text == '\0' || *text == '-' || *end != '\0') {
+        return false;
+    }
+    value = static_cast<std::size_t>(parsed);
+    return true;
+}
+
+void printLatency(const char* name, const OpMetrics& metrics) {
+    std::cout << std::left << std::setw(20) << name << std::right
+              << std::setw(10) << metrics.calls
+              << std::setw(10) << metrics.percentile(0.50) / 1000.0
+              << std::setw(10) << metrics.percentile(0.90) / 1000.0
+              << std::setw(10) << metrics.percentile(0.99) / 1000.0 << "\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    SessionLoadOptions options;
+    SessionProfile profile;
+    std::size_t synthetic = 0;
+    std::size_t seed = 1;
+    std::vector<const char*> paths;
+    for (int i = 1; i < argc; ++i) {
+        bool ok = i + 1 < argc;
+        if (ok && std::strcmp(argv[i], "--instances") == 0) {
+            ok = parseCount(argv[++i], options.instances) && options.instances > 0;
+        } else if (ok && std::strcmp(argv[i], "--threads") == 0) {
+            ok = parseCount(argv[++i], options.threads);
+        } else if (ok && std::strcmp(argv[i], "--synthetic") == 0) {
+            ok = parseCount(argv[++i], synthetic);
+        } else if (ok && std::strcmp(argv[i], "--steps") == 0) {
+            ok = parseCount(argv[++i], profile.steps);
+        } else if (ok && std::strcmp(argv[i], "--seed") == 0) {
+            ok = parseCount(argv[++i], seed);
+        } else if (argv[i][0] != '-') {
+            paths.push_back(argv[i]);
+            ok = true;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            displayUsage(argv[0]);
+            return 2;
+        }
+    }
+    if (paths.empty() && synthetic == 0) {
+        displayUsage(argv[0]);
+        return 2;
+    }
+
+    try {
+        std::vector<Session> sessions;
+        for (const char* path : paths) {
+            sessions.push_back(readSession(path));
+        }
+        for (std::size_t i = 0; i < synthetic; ++i) {
+            sessions.push_back(syntheticSession(profile, seed + i));
+        }
+
+        SessionLoadReport report = runSessionLoad(sessions, options);
+        std::cout << std::fixed << std::setprecision(3)
+                  << "instances:  " << report.instances << " (" << sessions.size() << " sessions)\n"
+                  << "steps:      " << report.steps << " (" << report.stepErrors << " errors)\n"
+                  << "seconds:    " << report.seconds << "\n"
+                  << std::setprecision(0)
+                  << "throughput: " << report.throughput << " steps/s\n"
+                  << "verified:   " << report.verified << " (" << report.mismatches << " mismatches, "
+                  << report.unverified << " without outcome)\n";
+        for (std::size_t instance : report.mismatchInstances) {
+            std::cout << "mismatch:   instance " << instance << "\n";
+        }
+        std::cout << std::setprecision(1) << "\n"
+                  << std::left << std::setw(20) << "step" << std::right
+                  << std::setw(10) << "count" << std::setw(10) << "p50 us"
+                  << std::setw(10) << "p90 us" << std::setw(10) << "p99 us" << "\n";
+        for (std::size_t a = 1; a < SESSION_ACTION_COUNT; ++a) {
+            if (report.actions[a].calls > 0) {
+                printLatency(sessionActionName(static_cast<SessionAction>(a)), report.actions[a]);
+            }
+        }
+        printLatency("all", report.latency);
+        std::cout << "max:        " << report.maxNanoseconds / 1000.0 << " us\n";
+        return report.mismatches == 0 ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 2;
+    }
+}
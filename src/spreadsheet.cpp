@@ -0,0 +1,288 @@
+#include "spreadsheet.h"
+#include "calculator.h"
+#include "work_stealing_pool.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+bool sameBits(double a, double b) {
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+} // namespace
+
+const std::size_t Spreadsheet::PARALLEL_LEVEL_SIZE;
+const std::uint32_t Spreadsheet::NO_FORMULA;
+
+Spreadsheet::Spreadsheet(const Calculator& calc, WorkStealingPool* pool)
+    : calc(calc)
+    , pool(pool)
+    , lowestBucket(0)
+    , queuedCells(0)
+    , searchEpoch(0) {
+}
+
+void Spreadsheet::setValue(const std::string& name, double value) {
+    const std::uint32_t id = cellId(name);
+    Cell& cell = cells[id];
+    bool changed = cell.formula != NO_FORMULA || cell.status != CalcStatus::Ok || !sameBits(cell.value, value);
+    if (cell.formula != NO_FORMULA) {
+        detachInputs(id);
+        freeFormulas.push_back(cell.formula);
+        cell.formula = NO_FORMULA;
+    }
+    cell.value = value;
+    cell.status = CalcStatus::Ok;
+    if (changed) {
+        enqueueReaders(id);
+    }
+}
+
+void Spreadsheet::setFormula(const std::string& name, const std::string& formula) {
+    CompiledExpr expr = calc.compile(formula);
+
+    // Reject cycles before touching anything: the new inputs must not
+    // already read this cell, directly or indirectly
+    std::vector<std::uint32_t> existingInputs;
+    for (const std::string& variable : expr.variables()) {
+        if (variable == name) {
+            throw std::invalid_argument("Circular reference: " + name + " depends on itself");
+        }
+        auto found = ids.find(variable);
+        if (found != ids.end()) {
+            existingInputs.push_back(found->second);
+        }
+    }
+    auto self = ids.find(name);
+    if (self != ids.end() && !existingInputs.empty() && reaches(self->second, existingInputs)) {
+        throw std::invalid_argument("Circular reference: " + name + " depends on itself");
+    }
+
+    const std::uint32_t id = cellId(name);
+    if (cells[id].formula != NO_FORMULA) {
+        detachInputs(id);
+    }
+    std::vector<std::uint32_t> inputs;
+    inputs.reserve(expr.variableCount());
+    for (const std::string& variable : expr.variables()) {
+        std::uint32_t input = cellId(variable);
+        cells[input].readers.push_back(id);
+        inputs.push_back(input);
+    }
+
+    Cell& cell = cells[id];
+    cell.inputs.swap(inputs);
+    if (cell.formula == NO_FORMULA) {
+        if (freeFormulas.empty()) {
+            cell.formula = static_cast<std::uint32_t>(formulas.size());
+            formulas.push_back(std::move(expr));
+        } else {
+            cell.formula = freeFormulas.back();
+            freeFormulas.pop_back();
+            formulas[cell.formula] = std::move(expr);
+        }
+    } else {
+        formulas[cell.formula] = std::move(expr);
+    }
+    raiseLevels(id);
+    enqueue(id);
+}
+
+std::size_t Spreadsheet::recalculate() {
+    std::size_t evaluated = 0;
+    std::vector<std::uint32_t> bucket;
+    std::vector<std::uint32_t> ready;
+    // Evaluating a level only queues cells of higher levels, so one pass
+    // over the buckets finishes everything
+    for (std::size_t level = lowestBucket; level < buckets.size() && queuedCells > 0; ++level) {
+        if (buckets[level].empty()) {
+            continue;
+        }
+        bucket.swap(buckets[level]);
+        ready.clear();
+        for (std::uint32_t id : bucket) {
+            Cell& cell = cells[id];
+            if (cell.level != level) {
+                // Raised by a later setFormula(); wait for the new level
+                if (buckets.size() <= cell.level) {
+                    buckets.resize(cell.level + 1);
+                }
+                buckets[cell.level].push_back(id);
+            } else if (cell.formula == NO_FORMULA) {
+                // Turned into a number after being queued
+                cell.queued = false;
+                --queuedCells;
+            } else {
+                ready.push_back(id);
+            }
+        }
+        bucket.clear();
+
+        evaluateAll(ready);
+        for (std::uint32_t id : ready) {
+            cells[id].queued = false;
+            --queuedCells;
+            if (cells[id].changed) {
+                enqueueReaders(id);
+            }
+        }
+        evaluated += ready.size();
+    }
+    lowestBucket = buckets.size();
+    return evaluated;
+}
+
+double Spreadsheet::value(const std::string& name) const {
+    const Cell& cell = find(name);
+    if (cell.status != CalcStatus::Ok) {
+        throw std::domain_error(calcStatusMessage(cell.status));
+    }
+    return cell.value;
+}
+
+CalcResult Spreadsheet::result(const std::string& name) const {
+    const Cell& cell = find(name);
+    CalcResult result = {cell.status, cell.value};
+    return result;
+}
+
+std::uint32_t Spreadsheet::cellId(const std::string& name) {
+    auto found = ids.find(name);
+    if (found != ids.end()) {
+        return found->second;
+    }
+    const std::uint32_t id = static_cast<std::uint32_t>(cells.size());
+    Cell cell;
+    cell.value = 0;
+    cell.status = CalcStatus::Ok;
+    cell.queued = false;
+    cell.changed = false;
+    cell.level = 0;
+    cell.formula = NO_FORMULA;
+    cells.push_back(std::move(cell));
+    visited.push_back(0);
+    ids.emplace(name, id);
+    return id;
+}
+
+const Spreadsheet::Cell& Spreadsheet::find(const std::string& name) const {
+    auto found = ids.find(name);
+    if (found == ids.end()) {
+        throw std::invalid_argument("Unknown cell: " + name);
+    }
+    return cells[found->second];
+}
+
+void Spreadsheet::detachInputs(std::uint32_t id) {
+    for (std::uint32_t input : cells[id].inputs) {
+        std::vector<std::uint32_t>& readers = cells[input].readers;
+        readers.erase(std::find(readers.begin(), readers.end(), id));
+    }
+    cells[id].inputs.clear();
+}
+
+bool Spreadsheet::reaches(std::uint32_t from, const std::vector<std::uint32_t>& targets) const {
+    if (++searchEpoch == 0) {
+        std::fill(visited.begin(), visited.end(), 0);
+        searchEpoch = 1;
+    }
+    std::vector<std::uint32_t> stack(1, from);
+    visited[from] = searchEpoch;
+    while (!stack.empty()) {
+        std::uint32_t id = stack.back();
+        stack.pop_back();
+        if (std::find(targets.begin(), targets.end(), id) != targets.end()) {
+            return true;
+        }
+        for (std::uint32_t reader : cells[id].readers) {
+            if (visited[reader] != searchEpoch) {
+                visited[reader] = searchEpoch;
+                stack.push_back(reader);
+            }
+        }
+    }
+    return false;
+}
+
+void Spreadsheet::raiseLevels(std::uint32_t id) {
+    std::uint32_t needed = 0;
+    for (std::uint32_t input : cells[id].inputs) {
+        needed = std::max(needed, cells[input].level + 1);
+    }
+    if (needed <= cells[id].level) {
+        // A level above the inputs is all that is required, so a cell
+        // whose inputs got shallower keeps its level
+        return;
+    }
+    cells[id].level = needed;
+    std::vector<std::uint32_t> stack(1, id);
+    while (!stack.empty()) {
+        const Cell& cell = cells[stack.back()];
+        stack.pop_back();
+        for (std::uint32_t reader : cell.readers) {
+            if (cells[reader].level <= cell.level) {
+                cells[reader].level = cell.level + 1;
+                stack.push_back(reader);
+            }
+        }
+    }
+}
+
+void Spreadsheet::enqueue(std::uint32_t id) {
+    Cell& cell = cells[id];
+    if (cell.queued) {
+        return;
+    }
+    cell.queued = true;
+    if (buckets.size() <= cell.level) {
+        buckets.resize(cell.level + 1);
+    }
+    buckets[cell.level].push_back(id);
+    lowestBucket = std::min<std::size_t>(lowestBucket, cell.level);
+    ++queuedCells;
+}
+
+void Spreadsheet::enqueueReaders(std::uint32_t id) {
+    for (std::uint32_t reader : cells[id].readers) {
+        enqueue(reader);
+    }
+}
+
+void Spreadsheet::evaluate(std::uint32_t id) {
+    Cell& cell = cells[id];
+    double values[CompiledExpr::MAX_REGISTERS];
+    CalcResult result = CalcResult::success(0);
+    for (std::size_t i = 0; i < cell.inputs.size(); ++i) {
+        const Cell& input = cells[cell.inputs[i]];
+        if (input.status != CalcStatus::Ok) {
+            result = CalcResult::failure(input.status);
+            break;
+        }
+        values[i] = input.value;
+    }
+    if (result.ok()) {
+        result = formulas[cell.formula].tryEvaluate(values);
+    }
+    cell.changed = result.status != cell.status || !sameBits(result.value, cell.value);
+    cell.value = result.value;
+    cell.status = result.status;
+}
+
+void Spreadsheet::evaluateAll(const std::vector<std::uint32_t>& ready) {
+    if (pool == nullptr || ready.size() < PARALLEL_LEVEL_SIZE) {
+        for (std::uint32_t id : ready) {
+            evaluate(id);
+        }
+        return;
+    }
+    // A few chunks per worker so stealing can even out uneven formulas
+    const std::size_t chunks = pool->size() * 4;
+    const std::size_t count = ready.size();
+    parallelFor(pool, chunks, [this, &ready, chunks, count](std::size_t c) {
+        for (std::size_t i = count * c / chunks; i < count * (c + 1) / chunks; ++i) {
+            evaluate(ready[i]);
+        }
+    });
+}
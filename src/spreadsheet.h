@@ -0,0 +1,160 @@
+/**
+ * @file spreadsheet.h
+ * @brief Named cells with formulas that are recomputed incrementally
+ */
+
+#ifndef SPREADSHEET_H
+#define SPREADSHEET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "calc_result.h"
+#include "expression.h"
+
+class Calculator;
+class WorkStealingPool;
+
+/**
+ * @class Spreadsheet
+ * @brief Model of named cells holding numbers or formulas over other cells
+ *
+ * A formula is an expression in the CompiledExpr syntax whose variables
+ * are cell names, e.g. setFormula("total", "price * qty * (1 + tax)").
+ * Cells named by a formula but never set hold 0. Formulas are compiled
+ * once, with the angle unit of the calculator given to the constructor.
+ *
+ * The cells form a dependency DAG; a formula that would close a cycle is
+ * rejected. Every cell has a level greater than the levels of its inputs,
+ * so processing levels in increasing order is a topological order.
+ *
+ * Changing a cell does not compute anything; it queues the cells that
+ * read it. recalculate() then evaluates queued cells level by level, and
+ * queues the readers of a cell only if its value or status actually
+ * changed, so the work is proportional to the part of the model the
+ * change reaches. Cells of one level do not depend on each other; when a
+ * level has many queued cells and a pool was given, they are evaluated
+ * on the pool's workers.
+ *
+ * Domain errors do not throw during recalculation. The failing cell gets
+ * the error status, and cells that read it inherit that status.
+ *
+ * Not thread-safe; only recalculate() uses other threads internally.
+ */
+class Spreadsheet {
+public:
+    /// Queued cells in one level before the level is split across the pool
+    static const std::size_t PARALLEL_LEVEL_SIZE = 4096;
+
+    /**
+     * @brief Create an empty spreadsheet
+     * @param calc Calculator whose angle unit the formulas use; must
+     *             outlive the spreadsheet
+     * @param pool Workers for large levels, or nullptr to stay on the
+     *             calling thread; must outlive the spreadsheet
+     */
+    explicit Spreadsheet(const Calculator& calc, WorkStealingPool* pool = nullptr);
+
+    Spreadsheet(const Spreadsheet&) = delete;
+    Spreadsheet& operator=(const Spreadsheet&) = delete;
+
+    /**
+     * @brief Make a cell hold a number
+     * @param name Cell name; created if new
+     * @param value Number to hold
+     */
+    void setValue(const std::string& name, double value);
+
+    /**
+     * @brief Make a cell hold a formula
+     * @param name Cell name; created if new
+     * @param formula Expression over other cell names
+     * @throw std::invalid_argument if the formula does not parse or would
+     *        make the cell depend on itself; the cell is left unchanged
+     * @throw std::length_error if the formula is too large
+     */
+    void setFormula(const std::string& name, const std::string& formula);
+
+    /**
+     * @brief Bring every cell up to date
+     * @return Number of formulas evaluated
+     */
+    std::size_t recalculate();
+
+    /**
+     * @brief Check whether changes are waiting for recalculate()
+     * @return true if some cell may be out of date
+     */
+    bool needsRecalculation() const { return queuedCells > 0; }
+
+    /**
+     * @brief Get a cell's value as of the last recalculate()
+     * @param name Cell name
+     * @return Value of the cell
+     * @throw std::invalid_argument if there is no such cell
+     * @throw std::domain_error if the cell's formula failed
+     */
+    double value(const std::string& name) const;
+
+    /**
+     * @brief Get a cell's value or error without throwing on errors
+     * @param name Cell name
+     * @return Value and status of the cell
+     * @throw std::invalid_argument if there is no such cell
+     */
+    CalcResult result(const std::string& name) const;
+
+    /**
+     * @brief Check whether a cell exists
+     * @param name Cell name
+     * @return true if the cell was set or is named by a formula
+     */
+    bool contains(const std::string& name) const { return ids.count(name) != 0; }
+
+    /**
+     * @brief Get the number of cells
+     * @return Cell count
+     */
+    std::size_t size() const { return cells.size(); }
+
+private:
+    static const std::uint32_t NO_FORMULA = UINT32_MAX;
+
+    struct Cell {
+        double value;
+        CalcStatus status;
+        bool queued;                          ///< Waiting in a level bucket
+        bool changed;                         ///< Set by evaluate() when value or status changed
+        std::uint32_t level;                  ///< 0 for numbers; above every input otherwise
+        std::uint32_t formula;                ///< Index into formulas, or NO_FORMULA
+        std::vector<std::uint32_t> inputs;    ///< Cells in formula variables() order
+        std::vector<std::uint32_t> readers;   ///< Cells whose formulas name this one
+    };
+
+    const Calculator& calc;
+    WorkStealingPool* pool;
+    std::unordered_map<std::string, std::uint32_t> ids;
+    std::vector<Cell> cells;
+    std::vector<CompiledExpr> formulas;
+    std::vector<std::uint32_t> freeFormulas;              ///< Reusable formula slots
+    std::vector<std::vector<std::uint32_t>> buckets;      ///< Queued cells by level
+    std::size_t lowestBucket;                             ///< No queued cell is below this level
+    std::size_t queuedCells;
+    mutable std::vector<std::uint32_t> visited;           ///< Per-cell epoch of the last search that reached it
+    mutable std::uint32_t searchEpoch;
+
+    std::uint32_t cellId(const std::string& name);
+    const Cell& find(const std::string& name) const;
+    void detachInputs(std::uint32_t id);
+    bool reaches(std::uint32_t from, const std::vector<std::uint32_t>& targets) const;
+    void raiseLevels(std::uint32_t id);
+    void enqueue(std::uint32_t id);
+    void enqueueReaders(std::uint32_t id);
+    void evaluate(std::uint32_t id);
+    void evaluateAll(const std::vector<std::uint32_t>& ready);
+};
+
+#endif // SPREADSHEET_H
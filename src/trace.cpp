@@ -0,0 +1,337 @@
+#include "trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    std::uint64_t start;  ///< metricTicks()
+    std::uint64_t end;
+    bool error;
+};
+
+/**
+ * Ring buffer of one thread's spans. The owning thread is the only
+ * producer and advances head; the writer thread is the only consumer and
+ * advances tail. Slots are plain memory, published by the release store
+ * of head and handed back by the release store of tail.
+ */
+struct ThreadTrace {
+    std::vector<TraceEvent> events;
+    std::uint64_t mask;
+    std::atomic<std::uint64_t> head;
+    std::atomic<std::uint64_t> tail;
+    std::atomic<std::uint64_t> dropped;
+    std::atomic<bool> retired;  ///< The thread has exited; free once drained
+    unsigned id;
+    bool named;                 ///< Thread name written to the current trace
+
+    ThreadTrace(std::size_t capacity, unsigned id)
+        : events(capacity), mask(capacity - 1), head(0), tail(0), dropped(0), retired(false), id(id),
+          named(false) {}
+};
+
+struct Tracer;
+
+TraceStats finishTrace(Tracer& t);
+
+struct Tracer {
+    std::mutex control;              ///< Serializes start and stop; guards stopping
+    std::condition_variable wake;
+    bool stopping;
+    std::atomic<bool> running;
+
+    std::mutex mutex;                ///< Guards everything below
+    std::vector<std::unique_ptr<ThreadTrace>> threads;
+    unsigned nextThread;
+    TraceOptions options;
+    std::FILE* file;
+    std::string text;                ///< Formatted events not yet written
+    std::uint64_t startTicks;
+    TraceStats stats;
+    std::thread writer;
+
+    std::atomic<std::uint64_t> minTicks;
+
+    Tracer() : stopping(false), running(false), nextThread(1), file(nullptr), startTicks(0), stats(),
+               minTicks(0) {}
+
+    ~Tracer() {
+        if (running.load()) {
+            try {
+                finishTrace(*this);
+            } catch (const std::exception&) {
+                // Nothing to report to at exit
+            }
+        }
+    }
+};
+
+Tracer& tracer() {
+    static Tracer instance;
+    return instance;
+}
+
+// Marks the thread's buffer for release when the thread exits
+struct ThreadTraceHandle {
+    ThreadTrace* trace;
+
+    ThreadTraceHandle() : trace(nullptr) {}
+
+    ~ThreadTraceHandle() {
+        if (trace != nullptr) {
+            trace->retired.store(true, std::memory_order_release);
+        }
+    }
+};
+
+ThreadTrace& threadTrace() {
+    static thread_local ThreadTraceHandle handle;
+    if (handle.trace == nullptr) {
+        Tracer& t = tracer();
+        std::lock_guard<std::mutex> lock(t.mutex);
+        std::size_t capacity = 1;
+        while (capacity < t.options.bufferEvents) {
+            capacity <<= 1;
+        }
+        t.threads.push_back(std::unique_ptr<ThreadTrace>(new ThreadTrace(capacity, t.nextThread++)));
+        handle.trace = t.threads.back().get();
+    }
+    return *handle.trace;
+}
+
+void setTracingFlag(bool on) {
+    if (on) {
+        instrumentationFlags.fetch_or(INSTRUMENT_TRACING, std::memory_order_relaxed);
+    } else {
+        instrumentationFlags.fetch_and(~INSTRUMENT_TRACING, std::memory_order_relaxed);
+    }
+}
+
+void appendUnsigned(std::string& out, std::uint64_t value) {
+    char digits[20];
+    char* end = digits + sizeof(digits);
+    char* p = end;
+    do {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    out.append(p, end);
+}
+
+void appendMicroseconds(std::string& out, std::uint64_t nanoseconds) {
+    appendUnsigned(out, nanoseconds / 1000);
+    unsigned fraction = static_cast<unsigned>(nanoseconds % 1000);
+    char digits[4] = {'.', static_cast<char>('0' + fraction / 100), static_cast<char>('0' + fraction / 10 % 10),
+                      static_cast<char>('0' + fraction % 10)};
+    out.append(digits, sizeof(digits));
+}
+
+void appendEvent(Tracer& t, unsigned thread, const TraceEvent& event) {
+    std::uint64_t start = event.start > t.startTicks ? event.start - t.startTicks : 0;
+    std::uint64_t duration = event.end > event.start ? event.end - event.start : 0;
+    t.text += ",\n{\"name\":\"";
+    t.text += event.name;
+    t.text += "\",\"ph\":\"X\",\"pid\":1,\"tid\":";
+    appendUnsigned(t.text, thread);
+    t.text += ",\"ts\":";
+    appendMicroseconds(t.text, metricTicksToNanoseconds(start));
+    t.text += ",\"dur\":";
+    appendMicroseconds(t.text, metricTicksToNanoseconds(duration));
+    if (event.error) {
+        t.text += ",\"args\":{\"error\":true}";
+    }
+    t.text += "}";
+}
+
+// Moves every buffered span into the file; called with t.mutex held
+void drain(Tracer& t) {
+    for (std::size_t i = 0; i < t.threads.size();) {
+        ThreadTrace& thread = *t.threads[i];
+        bool retired = thread.retired.load(std::memory_order_acquire);
+        std::uint64_t tail = thread.tail.load(std::memory_order_relaxed);
+        std::uint64_t head = thread.head.load(std::memory_order_acquire);
+        if (!thread.named && tail != head) {
+            t.text += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":";
+            t.text += std::to_string(thread.id);
+            t.text += ",\"args\":{\"name\":\"thread " + std::to_string(thread.id) + "\"}}";
+            thread.named = true;
+        }
+        for (; tail != head; ++tail) {
+            appendEvent(t, thread.id, thread.events[tail & thread.mask]);
+            ++t.stats.written;
+        }
+        thread.tail.store(tail, std::memory_order_release);
+        t.stats.dropped += thread.dropped.exchange(0, std::memory_order_relaxed);
+        if (retired) {
+            t.threads.erase(t.threads.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            ++i;
+        }
+    }
+    if (!t.text.empty()) {
+        std::fwrite(t.text.data(), 1, t.text.size(), t.file);
+        t.text.clear();
+    }
+}
+
+void writerLoop(Tracer& t) {
+    typedef std::chrono::steady_clock Clock;
+    const double fraction = t.options.sampleFraction;
+    const std::chrono::microseconds period(std::max<std::uint64_t>(t.options.samplePeriodMicroseconds, 1));
+    const std::chrono::microseconds window(static_cast<std::int64_t>(static_cast<double>(period.count()) * fraction));
+    const std::chrono::milliseconds flushInterval(t.options.flushMilliseconds);
+    Clock::time_point nextFlush = Clock::now() + flushInterval;
+
+    std::unique_lock<std::mutex> lock(t.control);
+    while (!t.stopping) {
+        if (fraction < 1) {
+            // Wake-ups run late, most of all when the traced threads keep
+            // every core busy; the pause is sized by how long the window
+            // actually lasted, so the traced share of time stays right
+            Clock::time_point opened = Clock::now();
+            setTracingFlag(true);
+            t.wake.wait_for(lock, window, [&t] { return t.stopping; });
+            setTracingFlag(false);
+            std::chrono::duration<double, std::micro> open = Clock::now() - opened;
+            std::chrono::microseconds pause(static_cast<std::int64_t>(open.count() * (1 - fraction) / fraction));
+            t.wake.wait_for(lock, std::max<std::chrono::microseconds>(pause, period - window),
+                            [&t] { return t.stopping; });
+        } else {
+            t.wake.wait_for(lock, std::max<std::chrono::microseconds>(flushInterval, period),
+                            [&t] { return t.stopping; });
+        }
+        if (Clock::now() >= nextFlush && !t.stopping) {
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> buffers(t.mutex);
+                drain(t);
+            }
+            lock.lock();
+            nextFlush = Clock::now() + flushInterval;
+        }
+    }
+}
+
+TraceStats finishTrace(Tracer& t) {
+    {
+        std::lock_guard<std::mutex> control(t.control);
+        if (!t.running.load()) {
+            return TraceStats();
+        }
+        t.stopping = true;
+    }
+    t.wake.notify_all();
+    t.writer.join();
+    setTracingFlag(false);
+
+    std::lock_guard<std::mutex> control(t.control);
+    std::lock_guard<std::mutex> lock(t.mutex);
+    drain(t);
+    std::string footer = "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_spans\":\"" +
+                         std::to_string(t.stats.dropped) + "\"}}\n";
+    std::fwrite(footer.data(), 1, footer.size(), t.file);
+    bool failed = std::ferror(t.file) != 0;
+    failed = std::fclose(t.file) != 0 || failed;
+    t.file = nullptr;
+    t.running.store(false);
+    if (failed) {
+        throw std::runtime_error("Cannot write trace file");
+    }
+    return t.stats;
+}
+
+} // namespace
+
+TraceOptions::TraceOptions()
+    : bufferEvents(1 << 16)
+    , sampleFraction(1.0)
+    , samplePeriodMicroseconds(10000)
+    , minNanoseconds(0)
+    , flushMilliseconds(20) {}
+
+void startTracing(const std::string& path, const TraceOptions& options) {
+    Tracer& t = tracer();
+    std::lock_guard<std::mutex> control(t.control);
+    if (t.running.load()) {
+        throw std::logic_error("A trace is already being written");
+    }
+    if (!(options.sampleFraction > 0 && options.sampleFraction <= 1)) {
+        throw std::invalid_argument("Trace sample fraction must be in (0, 1]");
+    }
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Cannot create trace file: " + path);
+    }
+
+    // Calibrates the clock before the first span rather than inside it
+    const std::uint64_t calibration = 1 << 30;
+    double nanosecondsPerTick = static_cast<double>(metricTicksToNanoseconds(calibration)) / calibration;
+    {
+        std::lock_guard<std::mutex> lock(t.mutex);
+        for (std::size_t i = 0; i < t.threads.size();) {
+            ThreadTrace& thread = *t.threads[i];
+            if (thread.retired.load(std::memory_order_acquire)) {
+                t.threads.erase(t.threads.begin() + static_cast<std::ptrdiff_t>(i));
+                continue;
+            }
+            // Spans that ended after the previous trace stopped
+            thread.tail.store(thread.head.load(std::memory_order_acquire), std::memory_order_release);
+            thread.dropped.store(0, std::memory_order_relaxed);
+            thread.named = false;
+            ++i;
+        }
+        t.options = options;
+        t.file = file;
+        t.stats = TraceStats();
+        t.text = "{\"traceEvents\":[\n"
+                 "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"calculator\"}}";
+        t.minTicks.store(nanosecondsPerTick > 0
+                             ? static_cast<std::uint64_t>(static_cast<double>(options.minNanoseconds) /
+                                                          nanosecondsPerTick)
+                             : 0,
+                         std::memory_order_relaxed);
+        t.startTicks = metricTicks();
+    }
+    t.stopping = false;
+    t.running.store(true);
+    t.writer = std::thread(writerLoop, std::ref(t));
+    setTracingFlag(true);
+}
+
+TraceStats stopTracing() {
+    return finishTrace(tracer());
+}
+
+bool tracingEnabled() {
+    return tracer().running.load();
+}
+
+void recordTraceSpan(const char* name, std::uint64_t start, bool error) {
+    std::uint64_t end = metricTicks();
+    if (end - start < tracer().minTicks.load(std::memory_order_relaxed)) {
+        return;
+    }
+    ThreadTrace& thread = threadTrace();
+    std::uint64_t head = thread.head.load(std::memory_order_relaxed);
+    if (head - thread.tail.load(std::memory_order_acquire) > thread.mask) {
+        thread.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    TraceEvent& event = thread.events[head & thread.mask];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.error = error;
+    thread.head.store(head + 1, std::memory_order_release);
+}
@@ -0,0 +1,123 @@
+/**
+ * @file trace.h
+ * @brief Span tracing of calculator calls to Chrome trace JSON
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "metrics.h"
+
+/**
+ * @struct TraceOptions
+ * @brief Buffering and sampling of a trace
+ *
+ * Sampling works in time windows: out of every samplePeriod, spans are
+ * recorded for the first sampleFraction of it and the instrumentation is
+ * off for the rest, so an unsampled call costs what it costs with
+ * tracing off. Spans cut by a window edge are kept whole if they began
+ * inside the window.
+ */
+struct TraceOptions {
+    std::size_t bufferEvents;           ///< Spans buffered per thread, rounded up to a power of two
+    double sampleFraction;              ///< Share of time spans are recorded, 0 to 1
+    std::uint64_t samplePeriodMicroseconds;  ///< Length of one sampling window plus its pause
+    std::uint64_t minNanoseconds;       ///< Spans shorter than this are not recorded
+    std::uint64_t flushMilliseconds;    ///< Longest time spans wait to be written (at least samplePeriod)
+
+    TraceOptions();
+};
+
+/**
+ * @struct TraceStats
+ * @brief Spans handled by a finished trace
+ */
+struct TraceStats {
+    std::uint64_t written;  ///< Spans written to the file
+    std::uint64_t dropped;  ///< Spans lost because a thread's buffer was full
+};
+
+/**
+ * @brief Start writing spans to a Chrome trace JSON file
+ *
+ * Every MetricTimer scope (the arithmetic and scientific operations,
+ * calculate(), formatNumber, history recording, ...) and every TraceSpan
+ * becomes a complete ("X") event with its thread, start and duration;
+ * nested calls nest in the viewer. The file loads in Perfetto
+ * (ui.perfetto.dev) and chrome://tracing.
+ *
+ * A thread appends its spans to its own single-producer ring buffer with
+ * plain stores, never taking a lock; a background thread drains all
+ * buffers into the file every flushMilliseconds. Spans that find their
+ * thread's buffer full are dropped and counted.
+ *
+ * Needs a build with CALCULATOR_METRICS; without it no spans are emitted.
+ *
+ * @param path File to write, replaced if it exists
+ * @param options Buffer size and sampling
+ * @throw std::logic_error if a trace is already being written
+ * @throw std::invalid_argument if sampleFraction is not in (0, 1]
+ * @throw std::runtime_error if the file cannot be created
+ */
+void startTracing(const std::string& path, const TraceOptions& options = TraceOptions());
+
+/**
+ * @brief Write the remaining spans and close the trace
+ *
+ * Spans still open on other threads are not written.
+ *
+ * @return Counts of the trace, all zero if none was being written
+ */
+TraceStats stopTracing();
+
+/**
+ * @brief Check whether a trace is being written
+ * @return True between startTracing() and stopTracing()
+ */
+bool tracingEnabled();
+
+/**
+ * @class TraceSpan
+ * @brief Traces the enclosing scope as a span with a given name
+ *
+ * For steps that are not calculator calls, such as reading input in the
+ * interactive menu. Costs one relaxed load and branch while not tracing.
+ */
+class TraceSpan {
+public:
+#ifdef CALCULATOR_METRICS
+    /**
+     * @param name Span name; must outlive the trace, e.g. a string literal
+     */
+    explicit TraceSpan(const char* name)
+        : name(name), active((instrumentationFlags.load(std::memory_order_relaxed) & INSTRUMENT_TRACING) != 0),
+          start(0) {
+        if (active) {
+            start = metricTicks();
+        }
+    }
+
+    ~TraceSpan() {
+        if (active) {
+            recordTraceSpan(name, start, false);
+        }
+    }
+
+private:
+    const char* name;
+    bool active;
+    std::uint64_t start;
+#else
+    explicit TraceSpan(const char*) {
+    }
+#endif
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+};
+
+#endif // TRACE_H
@@ -0,0 +1,160 @@
+#include "work_stealing_pool.h"
+
+namespace {
+
+/// Pool and worker index of the current thread when it is a pool worker
+thread_local const void* currentPool = nullptr;
+thread_local std::size_t currentWorker = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(std::size_t threadCount)
+    : nextQueue(0)
+    , queued(0)
+    , unfinished(0)
+    , stopping(false) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0) {
+            threadCount = 1;
+        }
+    }
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        queues.emplace_back(new Queue);
+    }
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    std::size_t target = currentPool == this
+        ? currentWorker
+        : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    unfinished.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        // Publish under the state lock so a worker about to sleep sees it
+        std::lock_guard<std::mutex> lock(stateMutex);
+        queued.fetch_add(1, std::memory_order_release);
+    }
+    workAvailable.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return unfinished.load(std::memory_order_acquire) == 0; });
+}
+
+bool WorkStealingPool::takeTask(std::size_t index, Task& task) {
+    {
+        Queue& own = *queues[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (std::size_t offset = 1; offset < queues.size(); ++offset) {
+        Queue& victim = *queues[(index + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WorkStealingPool::runTask(std::size_t index) {
+    Task task;
+    if (!takeTask(index, task)) {
+        return false;
+    }
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    task(index);
+    task = nullptr;
+    if (unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        allDone.notify_all();
+    }
+    return true;
+}
+
+void WorkStealingPool::workerLoop(std::size_t index) {
+    currentPool = this;
+    currentWorker = index;
+    for (;;) {
+        if (runTask(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(stateMutex);
+        workAvailable.wait(lock, [this] {
+            return stopping || queued.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping && queued.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+TaskGroup::TaskGroup(WorkStealingPool& pool)
+    : pool(pool)
+    , pending(0) {
+}
+
+TaskGroup::~TaskGroup() {
+    wait();
+}
+
+void TaskGroup::submit(WorkStealingPool::Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++pending;
+    }
+    pool.submit([this, task](std::size_t worker) {
+        task(worker);
+        // Counted down under the lock: once wait() sees zero, no task
+        // touches the group again
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--pending == 0) {
+            done.notify_all();
+        }
+    });
+}
+
+void TaskGroup::wait() {
+    if (currentPool == &pool) {
+        // Blocking would hold a worker the group's tasks may need
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (pending == 0) {
+                    return;
+                }
+            }
+            if (!pool.runTask(currentWorker)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return pending == 0; });
+}
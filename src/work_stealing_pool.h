@@ -0,0 +1,174 @@
+/**
+ * @file work_stealing_pool.h
+ * @brief Thread pool with per-worker task queues and work stealing
+ */
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @class WorkStealingPool
+ * @brief Fixed set of worker threads that balance load by stealing
+ *
+ * Every worker owns a task queue. Tasks submitted from outside the pool
+ * are dealt round-robin across the queues; tasks submitted from a worker
+ * go to its own queue. A worker takes from the back of its own queue
+ * (most recent, cache-warm work) and, when that is empty, steals from
+ * the front of another worker's queue.
+ *
+ * Each task receives the index of the worker running it, so callers can
+ * keep per-thread state (such as one Calculator per worker) without
+ * locking.
+ */
+class WorkStealingPool {
+public:
+    /// Work item; the argument is the index of the executing worker
+    typedef std::function<void(std::size_t)> Task;
+
+    /**
+     * @brief Start the worker threads
+     * @param threadCount Number of workers (0 uses the hardware concurrency)
+     */
+    explicit WorkStealingPool(std::size_t threadCount = 0);
+
+    /**
+     * @brief Finish all queued tasks and join the workers
+     */
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    /**
+     * @brief Queue a task for execution
+     * @param task Work item
+     */
+    void submit(Task task);
+
+    /**
+     * @brief Block until every submitted task has finished
+     *
+     * Waits for the tasks of every submitter, so it suits a pool owned
+     * by one caller. It must not be called from a task of this pool,
+     * which would wait for itself; use a TaskGroup there, or whenever
+     * the pool is shared.
+     *
+     * Exceptions escaping a task terminate the program, so tasks should
+     * report errors through their own results.
+     */
+    void wait();
+
+    /**
+     * @brief Get the number of worker threads
+     * @return Worker count
+     */
+    std::size_t size() const { return queues.size(); }
+
+private:
+    friend class TaskGroup;
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> nextQueue;  ///< Round-robin target for outside submissions
+    std::atomic<std::size_t> queued;     ///< Tasks waiting in any queue
+    std::atomic<std::size_t> unfinished; ///< Tasks submitted but not yet completed
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    bool stopping;
+
+    void workerLoop(std::size_t index);
+    bool takeTask(std::size_t index, Task& task);
+
+    /**
+     * @brief Run one queued task on the calling worker, if there is one
+     * @return false if every queue was empty
+     */
+    bool runTask(std::size_t index);
+};
+
+/**
+ * @class TaskGroup
+ * @brief Tasks submitted to a pool together and waited for together
+ *
+ * wait() returns once this group's own tasks have finished, whatever
+ * else the pool is running, so independent callers can share a pool.
+ * Called from a worker of the same pool, wait() runs queued tasks
+ * instead of blocking; a task can therefore fan out into a group of its
+ * own, even on a single-worker pool.
+ */
+class TaskGroup {
+public:
+    /**
+     * @param pool Pool the tasks run on; must outlive the group
+     */
+    explicit TaskGroup(WorkStealingPool& pool);
+
+    /**
+     * @brief Wait for the tasks still running
+     */
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    /**
+     * @brief Queue a task of the group
+     * @param task Work item, given the index of the executing worker
+     */
+    void submit(WorkStealingPool::Task task);
+
+    /**
+     * @brief Block until every task of the group has finished
+     */
+    void wait();
+
+private:
+    WorkStealingPool& pool;
+    std::mutex mutex;
+    std::condition_variable done;
+    std::size_t pending;  ///< Tasks submitted but not yet finished
+};
+
+/**
+ * @brief Call fn(0) ... fn(count - 1), on the pool's workers if there is one
+ *
+ * Waits for these calls only, through a TaskGroup, so it may run inside
+ * a task of the same pool or on a pool shared with other callers. fn
+ * must be safe to call concurrently for different indices.
+ *
+ * @param pool Workers to use, or nullptr to call fn on this thread
+ * @param count Number of calls
+ * @param fn Callable taking the index
+ */
+template <typename Fn>
+void parallelFor(WorkStealingPool* pool, std::size_t count, const Fn& fn) {
+    if (!pool || count < 2) {
+        for (std::size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+    TaskGroup group(*pool);
+    for (std::size_t i = 0; i < count; ++i) {
+        group.submit([&fn, i](std::size_t) { fn(i); });
+    }
+    group.wait();
+}
+
+#endif // WORK_STEALING_POOL_H
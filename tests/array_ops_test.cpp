@@ -0,0 +1,361 @@
+#include <gtest/gtest.h>
+#include "array_ops.h"
+#include "calculator.h"
+#include "work_stealing_pool.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <random>
+#include <vector>
+
+namespace {
+
+// Distance in units in the last place; 0 for equal values or two NaNs
+double ulpDistance(double a, double b) {
+    if ((std::isnan(a) && std::isnan(b)) || a == b) {
+        return 0;
+    }
+    std::int64_t ia;
+    std::int64_t ib;
+    std::memcpy(&ia, &a, sizeof(ia));
+    std::memcpy(&ib, &b, sizeof(ib));
+    if (ia < 0) ia = INT64_MIN - ia;
+    if (ib < 0) ib = INT64_MIN - ib;
+    return static_cast<double>(ia > ib ? ia - ib : ib - ia);
+}
+
+std::vector<double> uniform(std::size_t n, double low, double high, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> dist(low, high);
+    std::vector<double> values(n);
+    for (double& v : values) {
+        v = dist(rng);
+    }
+    return values;
+}
+
+// Runs the test body once per instruction set this CPU supports
+class ArrayOpsTest : public ::testing::TestWithParam<ArrayIsa> {
+protected:
+    void SetUp() override {
+        if (setArrayIsa(GetParam()) != GetParam()) {
+            GTEST_SKIP() << arrayIsaName(GetParam()) << " not supported";
+        }
+    }
+
+    void TearDown() override {
+        setArrayIsa(supportedArrayIsa());
+    }
+};
+
+// Odd length so every kernel also runs its scalar tail
+const std::size_t COUNT = 1001;
+
+} // namespace
+
+TEST_P(ArrayOpsTest, ArithmeticMatchesScalar) {
+    std::vector<double> a = uniform(COUNT, -1e3, 1e3, 1);
+    std::vector<double> b = uniform(COUNT, -1e3, 1e3, 2);
+    std::vector<double> out(COUNT);
+
+    arrayAdd(a.data(), b.data(), out.data(), COUNT);
+    for (std::size_t i = 0; i < COUNT; ++i) ASSERT_EQ(out[i], a[i] + b[i]);
+    arraySubtract(a.data(), b.data(), out.data(), COUNT);
+    for (std::size_t i = 0; i < COUNT; ++i) ASSERT_EQ(out[i], a[i] - b[i]);
+    arrayMultiply(a.data(), b.data(), out.data(), COUNT);
+    for (std::size_t i = 0; i < COUNT; ++i) ASSERT_EQ(out[i], a[i] * b[i]);
+    arrayPower(a.data(), b.data(), out.data(), 64);
+    for (std::size_t i = 0; i < 64; ++i) ASSERT_EQ(ulpDistance(out[i], std::pow(a[i], b[i])), 0);
+
+    // In place
+    std::vector<double> square = a;
+    arrayMultiply(square.data(), square.data(), square.data(), COUNT);
+    for (std::size_t i = 0; i < COUNT; ++i) ASSERT_EQ(square[i], a[i] * a[i]);
+}
+
+TEST_P(ArrayOpsTest, DomainErrorMask) {
+    std::vector<double> a = uniform(COUNT, -10, 10, 3);
+    std::vector<double> b = uniform(COUNT, -10, 10, 4);
+    for (std::size_t i = 0; i < COUNT; i += 7) {
+        b[i] = (i % 2) ? 0.0 : -0.0;
+    }
+    std::vector<double> out(COUNT);
+    std::vector<unsigned char> errors(COUNT, 0xFF);
+
+    std::size_t failed = arrayDivide(a.data(), b.data(), out.data(), COUNT, errors.data());
+    EXPECT_EQ(failed, (COUNT + 6) / 7);
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        ASSERT_EQ(errors[i], i % 7 == 0 ? 1 : 0) << i;
+        if (i % 7 == 0) {
+            ASSERT_TRUE(std::isnan(out[i]));
+        } else {
+            ASSERT_EQ(out[i], a[i] / b[i]);
+        }
+    }
+
+    failed = arraySqrt(a.data(), out.data(), COUNT, errors.data());
+    std::size_t negatives = 0;
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        bool negative = a[i] < 0;
+        negatives += negative;
+        ASSERT_EQ(errors[i], negative ? 1 : 0);
+        if (!negative) {
+            ASSERT_EQ(out[i], std::sqrt(a[i]));
+        }
+    }
+    EXPECT_EQ(failed, negatives);
+
+    // The mask is optional
+    EXPECT_EQ(arrayLn(a.data(), out.data(), COUNT), negatives);
+}
+
+TEST_P(ArrayOpsTest, LnAccuracy) {
+    std::vector<double> x = uniform(COUNT, -1074, 1023, 5);
+    for (double& v : x) {
+        v = std::exp2(v);
+    }
+    std::vector<double> near1 = uniform(COUNT, 0.5, 2.0, 6);
+    std::vector<double> out(COUNT);
+
+    EXPECT_EQ(arrayLn(x.data(), out.data(), COUNT), 0);
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        ASSERT_LE(ulpDistance(out[i], std::log(x[i])), 1) << x[i];
+    }
+    arrayLn(near1.data(), out.data(), COUNT);
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        ASSERT_LE(ulpDistance(out[i], std::log(near1[i])), 1) << near1[i];
+    }
+
+    double special[] = {0.0, -0.0, -1.0, 1.0, INFINITY, -INFINITY, NAN, 5e-324};
+    unsigned char errors[8];
+    double result[8];
+    EXPECT_EQ(arrayLn(special, result, 8, errors), 4);
+    const unsigned char expected[] = {1, 1, 1, 0, 0, 1, 0, 0};
+    for (int i = 0; i < 8; ++i) {
+        EXPECT_EQ(errors[i], expected[i]) << special[i];
+    }
+    EXPECT_EQ(result[3], 0.0);
+    EXPECT_EQ(result[4], INFINITY);
+    EXPECT_TRUE(std::isnan(result[6]));
+    EXPECT_EQ(result[7], std::log(5e-324));
+}
+
+TEST_P(ArrayOpsTest, TrigAccuracy) {
+    const double ranges[] = {1.0, 100.0, 1e5, 1e8};
+    std::vector<double> out(COUNT);
+    for (double range : ranges) {
+        std::vector<double> x = uniform(COUNT, -range, range, 7);
+        arraySin(x.data(), out.data(), COUNT);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            ASSERT_LE(ulpDistance(out[i], std::sin(x[i])), 2) << x[i];
+        }
+        arrayCos(x.data(), out.data(), COUNT);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            ASSERT_LE(ulpDistance(out[i], std::cos(x[i])), 2) << x[i];
+        }
+        arrayTan(x.data(), out.data(), COUNT);
+        for (std::size_t i = 0; i < COUNT; ++i) {
+            ASSERT_LE(ulpDistance(out[i], std::tan(x[i])), 4) << x[i];
+        }
+    }
+
+    double special[] = {0.0, -0.0, INFINITY, NAN};
+    double result[4];
+    arraySin(special, result, 4);
+    EXPECT_TRUE(std::signbit(result[1]));
+    EXPECT_EQ(result[0], 0.0);
+    EXPECT_TRUE(std::isnan(result[2]));
+    EXPECT_TRUE(std::isnan(result[3]));
+}
+
+TEST_P(ArrayOpsTest, DegreesAndCalculatorOverloads) {
+    std::vector<double> x = uniform(COUNT, -720, 720, 8);
+    std::vector<double> out(COUNT);
+    arrayCos(x.data(), out.data(), COUNT, false);
+    for (std::size_t i = 0; i < COUNT; ++i) {
+        ASSERT_LE(ulpDistance(out[i], fastCosDegrees(x[i], MathPrecision::Exact)), 2) << x[i];
+    }
+
+    // Exact reduction in degrees: zeros are zeros, not 1e-16
+    double angles[] = {0, 30, 45, 90, 180, -180, 270, 360, 3600, -45, 1e20, INFINITY};
+    const std::size_t count = sizeof(angles) / sizeof(angles[0]);
+    double sines[count];
+    double cosines[count];
+    double tangents[count];
+    arraySin(angles, sines, count, false);
+    arrayTan(angles, tangents, count, false);
+    double expectedSines[] = {0, 0.5, std::sqrt(0.5), 1, 0, 0, -1, 0, 0, -std::sqrt(0.5)};
+    double expectedTangents[] = {0, tangents[1], 1, INFINITY, 0, 0, INFINITY, 0, 0, -1};
+    for (std::size_t i = 0; i < 10; ++i) {
+        EXPECT_EQ(sines[i], expectedSines[i]) << angles[i];
+        EXPECT_EQ(std::signbit(sines[i]), expectedSines[i] < 0) << angles[i];
+        EXPECT_EQ(tangents[i], expectedTangents[i]) << angles[i];
+    }
+    EXPECT_EQ(sines[10], fastSinDegrees(1e20, MathPrecision::Exact));
+    EXPECT_TRUE(std::isnan(sines[11]));
+
+    // One reduction for both, same results as separately
+    arraySinCos(angles, sines, cosines, count, false);
+    arrayCos(angles, out.data(), count, false);
+    for (std::size_t i = 0; i < 10; ++i) {
+        EXPECT_EQ(sines[i], expectedSines[i]) << angles[i];
+        EXPECT_EQ(cosines[i], out[i]) << angles[i];
+    }
+    std::vector<double> radians = uniform(COUNT, -2e6, 2e6, 10);
+    std::vector<double> sinesOut(COUNT);
+    std::vector<double> cosinesOut(COUNT);
+    std::vector<double> separate(COUNT);
+    arraySinCos(radians.data(), sinesOut.data(), cosinesOut.data(), COUNT);
+    arraySin(radians.data(), separate.data(), COUNT);
+    EXPECT_EQ(sinesOut, separate);
+    arrayCos(radians.data(), separate.data(), COUNT);
+    EXPECT_EQ(cosinesOut, separate);
+
+    Calculator calc;
+    std::vector<double> expected(COUNT);
+    calc.tan(x.data(), out.data(), COUNT);
+    arrayTan(x.data(), expected.data(), COUNT);
+    EXPECT_EQ(out, expected);
+    std::vector<unsigned char> errors(COUNT);
+    EXPECT_GT(calc.ln(x.data(), out.data(), COUNT, errors.data()), 0);
+    EXPECT_TRUE(calc.getHistory().empty());
+}
+
+TEST_P(ArrayOpsTest, CompensatedReductions) {
+    // 1 followed by many values that plain summation would lose
+    std::vector<double> x(3 * REDUCTION_BLOCK + 5, 1e-16);
+    x[0] = 1;
+    const double expected = 1 + (x.size() - 1) * 1e-16;
+    EXPECT_LE(ulpDistance(arraySum(x.data(), x.size()), expected), 1);
+
+    // Large offset: a one-pass variance would cancel to garbage
+    std::vector<double> y = uniform(COUNT, -1, 1, 9);
+    double plainMean = 0;
+    for (double& v : y) {
+        v += 1e9;
+        plainMean += v;
+    }
+    plainMean /= COUNT;
+    long double squares = 0;
+    for (double v : y) {
+        squares += (static_cast<long double>(v) - plainMean) * (static_cast<long double>(v) - plainMean);
+    }
+    EXPECT_NEAR(arrayVariance(y.data(), COUNT), static_cast<double>(squares / (COUNT - 1)), 1e-9);
+    EXPECT_NEAR(arrayMean(y.data(), COUNT), 1e9, 1);
+
+    EXPECT_EQ(arraySum(x.data(), 0), 0.0);
+    EXPECT_TRUE(std::isnan(arrayMean(x.data(), 0)));
+    EXPECT_TRUE(std::isnan(arrayVariance(x.data(), 1)));
+}
+
+TEST_P(ArrayOpsTest, MinMaxAndSpecialValues) {
+    std::vector<double> x = uniform(COUNT, -5, 5, 10);
+    x[777] = -6;
+    x[3] = 7;
+    EXPECT_EQ(arrayMin(x.data(), COUNT), -6);
+    EXPECT_EQ(arrayMax(x.data(), COUNT), 7);
+
+    x[1000] = INFINITY;
+    EXPECT_EQ(arraySum(x.data(), COUNT), INFINITY);
+    EXPECT_EQ(arrayMax(x.data(), COUNT), INFINITY);
+    x[500] = NAN;
+    EXPECT_TRUE(std::isnan(arraySum(x.data(), COUNT)));
+    EXPECT_TRUE(std::isnan(arrayMin(x.data(), COUNT)));
+    EXPECT_TRUE(std::isnan(arrayMax(x.data(), COUNT)));
+    EXPECT_TRUE(std::isnan(arrayMin(x.data(), 0)));
+}
+
+TEST_P(ArrayOpsTest, PrefixSum) {
+    std::vector<double> x(2 * REDUCTION_BLOCK + 3);
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        x[i] = static_cast<double>(i % 10) + 0.1;
+    }
+    std::vector<double> out(x.size());
+    arrayPrefixSum(x.data(), out.data(), x.size());
+    // Kahan summation in long double as the reference
+    long double running = 0;
+    long double lost = 0;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        long double y = x[i] - lost;
+        long double t = running + y;
+        lost = (t - running) - y;
+        running = t;
+        ASSERT_LE(ulpDistance(out[i], static_cast<double>(running)), 1) << i;
+    }
+
+    // In place
+    arrayPrefixSum(x.data(), x.data(), x.size());
+    EXPECT_EQ(x, out);
+}
+
+// Blocks, lanes and the combining tree are fixed, so neither the
+// instruction set nor the number of threads changes a single bit
+TEST_P(ArrayOpsTest, ReductionsAreDeterministic) {
+    std::vector<double> x = uniform(40 * REDUCTION_BLOCK + 123, -1e6, 1e6, 11);
+    std::vector<double> prefix(x.size());
+    std::vector<double> expectedPrefix(x.size());
+    const ArrayIsa isa = activeArrayIsa();
+
+    setArrayIsa(ArrayIsa::Scalar);
+    const double sum = arraySum(x.data(), x.size());
+    const double variance = arrayVariance(x.data(), x.size());
+    const double min = arrayMin(x.data(), x.size());
+    arrayPrefixSum(x.data(), expectedPrefix.data(), x.size());
+    setArrayIsa(isa);
+
+    for (std::size_t threads : {1, 3, 4}) {
+        WorkStealingPool pool(threads);
+        EXPECT_EQ(ulpDistance(arraySum(x.data(), x.size(), &pool), sum), 0) << threads;
+        EXPECT_EQ(ulpDistance(arrayVariance(x.data(), x.size(), &pool), variance), 0) << threads;
+        EXPECT_EQ(arrayMin(x.data(), x.size(), &pool), min);
+        arrayPrefixSum(x.data(), prefix.data(), x.size(), &pool);
+        EXPECT_EQ(prefix, expectedPrefix);
+    }
+    EXPECT_EQ(ulpDistance(arraySum(x.data(), x.size()), sum), 0);
+}
+
+// A reduction waits for its own blocks only: it may run inside a task
+// of the pool it uses, even a single-worker one, and is not held up by
+// unrelated work on a shared pool
+TEST(ArrayOpsPoolTest, ReductionsInsidePoolTasks) {
+    std::vector<double> x(40 * REDUCTION_BLOCK, 0.5);
+    const double expected = arraySum(x.data(), x.size());
+    for (std::size_t threads : {1, 3}) {
+        WorkStealingPool pool(threads);
+        std::vector<double> sums(6);
+        {
+            TaskGroup group(pool);
+            for (std::size_t i = 0; i < sums.size(); ++i) {
+                group.submit([&, i](std::size_t) {
+                    Calculator calc(0);
+                    calc.attachWorkerPool(&pool);
+                    sums[i] = calc.sum(x.data(), x.size());
+                });
+            }
+        }
+        for (double sum : sums) {
+            EXPECT_EQ(sum, expected) << threads;
+        }
+    }
+}
+
+TEST(ArrayOpsPoolTest, SharedPoolDoesNotWaitForOtherWork) {
+    std::vector<double> x(40 * REDUCTION_BLOCK, 0.25);
+    WorkStealingPool pool(2);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    pool.submit([released](std::size_t) { released.wait(); });
+
+    Calculator calc(0);
+    calc.attachWorkerPool(&pool);
+    EXPECT_EQ(calc.sum(x.data(), x.size()), 0.25 * static_cast<double>(x.size()));
+    release.set_value();
+    pool.wait();
+}
+
+INSTANTIATE_TEST_SUITE_P(AllIsas, ArrayOpsTest,
+                         ::testing::Values(ArrayIsa::Scalar, ArrayIsa::Sse2, ArrayIsa::Avx2, ArrayIsa::Avx512),
+                         [](const ::testing::TestParamInfo<ArrayIsa>& info) {
+                             return std::string(arrayIsaName(info.param));
+                         });
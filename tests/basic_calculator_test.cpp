@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include "basic_calculator.h"
+#include "calculator.h"
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+namespace {
+
+typedef BasicCalculator<NoHistory, Radians, StatusOnError> FastCalculator;
+
+constexpr double constantArithmetic() {
+    BasicCalculator<NoHistory, Radians, ThrowOnError> calc;
+    return calc.multiply(calc.add(1.5, 2.5), calc.divide(9, 3));
+}
+
+constexpr bool constantDivisionFails() {
+    FastCalculator calc;
+    return !calc.divide(1, 0).ok();
+}
+
+static_assert(constantArithmetic() == 12.0, "arithmetic is usable in constant expressions");
+static_assert(constantDivisionFails(), "status errors are usable in constant expressions");
+static_assert(std::is_empty<NoHistory>::value, "NoHistory adds no state");
+static_assert(sizeof(FastCalculator) == 1, "FastCalculator carries no data");
+
+} // namespace
+
+TEST(BasicCalculatorTest, MatchesCalculator) {
+    Calculator calc;
+    BasicCalculator<> basic;
+    EXPECT_EQ(basic.add(2, 3), calc.add(2, 3));
+    EXPECT_EQ(basic.divide(1, 3), calc.divide(1, 3));
+    EXPECT_EQ(basic.power(2, 0.5), calc.power(2, 0.5));
+    EXPECT_EQ(basic.ln(10), calc.ln(10));
+    EXPECT_EQ(basic.tan(1), calc.tan(1));
+    EXPECT_THROW(basic.sqrt(-1), std::domain_error);
+    EXPECT_EQ(basic.getHistory().records.size(), 5);
+    EXPECT_EQ(basic.getHistory().records[4].op, HistoryOp::Tan);
+}
+
+TEST(BasicCalculatorTest, Policies) {
+    FastCalculator fast;
+    CalcResult result = fast.ln(0);
+    EXPECT_EQ(result.status, CalcStatus::NonPositiveLog);
+    EXPECT_DOUBLE_EQ(fast.sqrt(16).value, 4);
+
+    BasicCalculator<FullHistory, Degrees> degrees;
+    EXPECT_EQ(degrees.sin(90), 1);
+    EXPECT_EQ(degrees.sin(180), 0);
+    EXPECT_EQ(degrees.cos(60), 0.5);
+    EXPECT_EQ(degrees.getHistory().records[1].op, HistoryOp::SinDegrees);
+    for (int i = 0; i < 150; ++i) {
+        degrees.add(i, 1);
+    }
+    EXPECT_EQ(degrees.getHistory().records.size(), 153);
+
+    BasicCalculator<RingHistory> ring(RingHistory(4));
+    for (int i = 0; i < 10; ++i) {
+        ring.multiply(i, 2);
+    }
+    ASSERT_EQ(ring.getHistory().records.size(), 4);
+    EXPECT_EQ(ring.getHistory().records[0].lhs, 6);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include "batch.h"
+#include "temp_dir.h"
+#include <cstdio>
+#include <string>
+
+class BatchTest : public ::testing::Test {
+protected:
+    Calculator calc;
+    std::FILE* sink = nullptr;
+
+    void SetUp() override {
+        sink = std::tmpfile();
+        ASSERT_NE(sink, nullptr);
+    }
+
+    void TearDown() override {
+        std::fclose(sink);
+    }
+
+    std::string written() {
+        std::string text;
+        char buffer[256];
+        std::size_t count;
+        std::rewind(sink);
+        while ((count = std::fread(buffer, 1, sizeof(buffer), sink)) > 0) {
+            text.append(buffer, count);
+        }
+        return text;
+    }
+};
+
+TEST_F(BatchTest, EvaluatesLines) {
+    {
+        BatchEvaluator evaluator(calc, fileno(sink));
+        std::string input = "1 + 2\n\n2 ^ 10\r\n1 / 0\nsqrt(2) * sqrt(2)\n  10/4";
+        evaluator.feed(input.data(), input.size());
+        evaluator.finish();
+        EXPECT_EQ(evaluator.stats().lines, 6);
+        EXPECT_EQ(evaluator.stats().errors, 1);
+    }
+    EXPECT_EQ(written(), "3\n\n1024\nError: Division by zero\n2\n2.5\n");
+    auto history = calc.getHistory();
+    ASSERT_FALSE(history.empty());
+    EXPECT_EQ(history.front(), "1 + 2 = 3");
+}
+
+TEST_F(BatchTest, SplitChunksAndOptions) {
+    BatchOptions options;
+    options.recordHistory = false;
+    options.shortestOutput = true;
+    options.outputBufferSize = 1;
+    {
+        BatchEvaluator evaluator(calc, fileno(sink), options);
+        evaluator.feed("0.1 +", 5);
+        evaluator.feed(" 0.2\nx\n", 7);
+        evaluator.finish();
+    }
+    EXPECT_EQ(written(), "0.30000000000000004\nError: Unknown variable 'x'\n");
+    EXPECT_TRUE(calc.getHistory().empty());
+}
+
+TEST_F(BatchTest, OverDeepLineIsAnError) {
+    {
+        BatchEvaluator evaluator(calc, fileno(sink));
+        std::string input = std::string(60000, '(') + "1" + std::string(60000, ')') + "\n2 * 3\n";
+        evaluator.feed(input.data(), input.size());
+        evaluator.finish();
+        EXPECT_EQ(evaluator.stats().lines, 2);
+        EXPECT_EQ(evaluator.stats().errors, 1);
+    }
+    std::string output = written();
+    EXPECT_EQ(output.compare(0, 48, "Error: Expression nested too deeply at position "), 0);
+    EXPECT_EQ(output.compare(output.size() - 3, 3, "\n6\n"), 0);
+}
+
+TEST_F(BatchTest, RunsFile) {
+    TempDir temp("batch_test");
+    std::string path = temp.write("input.txt", "6 * 7\nln(1)\n");
+    {
+        BatchEvaluator evaluator(calc, fileno(sink));
+        evaluator.run(path);
+        EXPECT_THROW(evaluator.run("/nonexistent/input"), std::runtime_error);
+    }
+    EXPECT_EQ(written(), "42\n0\n");
+}
@@ -0,0 +1,255 @@
+#include <gtest/gtest.h>
+#include "calculator_server.h"
+#include "load_generator.h"
+#include "temp_dir.h"
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+std::string run(Calculator& calc, const std::string& request) {
+    std::string response;
+    CalculatorServer::execute(calc, request.data(), request.size(), response);
+    return response;
+}
+
+// Blocking client that sends raw bytes and reads whole response lines
+class Client {
+public:
+    explicit Client(const std::string& path) : fd(socket(AF_UNIX, SOCK_STREAM, 0)) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, path.c_str());
+        connected = connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+    ~Client() { close(fd); }
+
+    bool isConnected() const { return connected; }
+
+    void send(const std::string& data) {
+        ASSERT_EQ(::send(fd, data.data(), data.size(), MSG_NOSIGNAL), static_cast<ssize_t>(data.size()));
+    }
+
+    // Returns the next line without its newline, or "<closed>" at end of stream
+    std::string readLine() {
+        for (;;) {
+            std::size_t newline = buffer.find('\n');
+            if (newline != std::string::npos) {
+                std::string line = buffer.substr(0, newline);
+                buffer.erase(0, newline + 1);
+                return line;
+            }
+            char chunk[4096];
+            ssize_t count = read(fd, chunk, sizeof(chunk));
+            if (count <= 0) {
+                return "<closed>";
+            }
+            buffer.append(chunk, static_cast<std::size_t>(count));
+        }
+    }
+
+private:
+    int fd;
+    bool connected;
+    std::string buffer;
+};
+
+// Server on a private socket path, running on a background thread
+class CalculatorServerTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        if (thread.joinable()) {
+            server->stop();
+            thread.join();
+        }
+        server.reset();
+    }
+
+    void start(const ServerOptions& options = ServerOptions()) {
+        server.reset(new CalculatorServer(path, options));
+        thread = std::thread([this] { server->run(); });
+    }
+
+    TempDir temp{"calculator_server_test"};
+    std::string path = temp.path("calc.sock");
+    std::unique_ptr<CalculatorServer> server;
+    std::thread thread;
+};
+
+} // namespace
+
+TEST(CalculatorServerExecuteTest, KeystrokeCommandsDriveTheDisplay) {
+    Calculator calc;
+    EXPECT_EQ(run(calc, "num 12"), "OK 12");
+    EXPECT_EQ(run(calc, "op +"), "OK 12");
+    EXPECT_EQ(run(calc, "num 30"), "OK 30");
+    EXPECT_EQ(run(calc, "="), "OK 42");
+    EXPECT_EQ(run(calc, "display"), "OK 42");
+    EXPECT_EQ(run(calc, "C"), "OK 0");
+}
+
+TEST(CalculatorServerExecuteTest, EvaluatesExpressions) {
+    Calculator calc;
+    EXPECT_EQ(run(calc, "eval 1 + 2 * 3"), "OK 7");
+    EXPECT_EQ(run(calc, "eval 2 ^ 10\r"), "OK 1024");
+    EXPECT_EQ(run(calc, "eval 1 / 0"), "ERR Division by zero");
+    EXPECT_EQ(run(calc, "eval"), "ERR Empty expression");
+}
+
+TEST(CalculatorServerExecuteTest, ScientificAndMemoryCommands) {
+    Calculator calc;
+    run(calc, "num 16");
+    EXPECT_EQ(run(calc, "sqrt"), "OK 4");
+    EXPECT_EQ(run(calc, "MS"), "OK 16");
+    run(calc, "C");
+    EXPECT_EQ(run(calc, "MR"), "OK 16");
+    run(calc, "num -1");
+    EXPECT_EQ(run(calc, "ln").compare(0, 4, "ERR "), 0);
+    EXPECT_EQ(run(calc, "history"), "OK \u221A(16) = 4 | M\u2190 16 | MR 16");
+}
+
+TEST(CalculatorServerExecuteTest, RejectsUnknownCommands) {
+    Calculator calc;
+    EXPECT_EQ(run(calc, "launch"), "ERR Unknown command");
+    EXPECT_EQ(run(calc, "op %"), "ERR Unknown operation");
+    EXPECT_EQ(run(calc, ""), "ERR Unknown command");
+}
+
+TEST_F(CalculatorServerTest, AnswersPipelinedRequestsInOrder) {
+    start();
+    Client client(path);
+    ASSERT_TRUE(client.isConnected());
+    client.send("num 2\nop ^\nnum 8\n=\neval 3 * 3\n");
+    EXPECT_EQ(client.readLine(), "OK 2");
+    EXPECT_EQ(client.readLine(), "OK 2");
+    EXPECT_EQ(client.readLine(), "OK 8");
+    EXPECT_EQ(client.readLine(), "OK 256");
+    EXPECT_EQ(client.readLine(), "OK 9");
+}
+
+TEST_F(CalculatorServerTest, RequestsSplitAcrossWrites) {
+    start();
+    Client client(path);
+    client.send("ev");
+    client.send("al 6 ");
+    client.send("* 7\n");
+    EXPECT_EQ(client.readLine(), "OK 42");
+}
+
+TEST_F(CalculatorServerTest, SessionsHaveTheirOwnState) {
+    start();
+    Client first(path);
+    Client second(path);
+    first.send("num 5\nMS\n");
+    EXPECT_EQ(first.readLine(), "OK 5");
+    EXPECT_EQ(first.readLine(), "OK 5");
+    second.send("MR\ndisplay\n");
+    EXPECT_EQ(second.readLine(), "OK 0");
+    EXPECT_EQ(second.readLine(), "OK 0");
+    first.send("C\nMR\n");
+    EXPECT_EQ(first.readLine(), "OK 0");
+    EXPECT_EQ(first.readLine(), "OK 5");
+}
+
+TEST_F(CalculatorServerTest, PooledCalculatorsStartClean) {
+    start();
+    {
+        Client client(path);
+        client.send("num 9\nMS\nsqrt\n");
+        EXPECT_EQ(client.readLine(), "OK 9");
+        EXPECT_EQ(client.readLine(), "OK 9");
+        EXPECT_EQ(client.readLine(), "OK 3");
+    }
+    Client next(path);
+    next.send("history\nMR\n");
+    EXPECT_EQ(next.readLine(), "OK ");
+    EXPECT_EQ(next.readLine(), "OK 0");
+}
+
+TEST_F(CalculatorServerTest, RefusesClientsBeyondTheLimit) {
+    ServerOptions options;
+    options.maxSessions = 1;
+    start(options);
+    Client first(path);
+    first.send("display\n");
+    EXPECT_EQ(first.readLine(), "OK 0");
+    Client second(path);
+    EXPECT_EQ(second.readLine(), "ERR Server full");
+    EXPECT_EQ(second.readLine(), "<closed>");
+    EXPECT_EQ(server->sessionCount(), 1u);
+}
+
+TEST_F(CalculatorServerTest, ClosesSessionsWithOversizedRequests) {
+    ServerOptions options;
+    options.maxRequestSize = 16;
+    start(options);
+    Client client(path);
+    client.send(std::string(64, '1'));
+    EXPECT_EQ(client.readLine(), "<closed>");
+}
+
+TEST_F(CalculatorServerTest, PipelinedRequestsBeyondThePendingOutputLimit) {
+    ServerOptions options;
+    options.maxPendingOutput = 16;
+    start(options);
+    Client client(path);
+    // Everything arrives at once; the server holds requests back while
+    // their responses are pending, and must come back to them without
+    // waiting for more input
+    std::string requests;
+    for (int i = 0; i < 10; ++i) {
+        requests += "display\n";
+    }
+    for (int i = 0; i < 200; ++i) {
+        requests += "eval 1+1\nhistory\n";
+    }
+    client.send(requests);
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(client.readLine(), "OK 0") << i;
+    }
+    for (int i = 0; i < 200; ++i) {
+        EXPECT_EQ(client.readLine(), "OK 2") << i;
+        EXPECT_EQ(client.readLine().compare(0, 3, "OK "), 0) << i;
+    }
+}
+
+TEST_F(CalculatorServerTest, OverDeepExpressionIsAnError) {
+    start();
+    Client client(path);
+    Client other(path);
+    // Fits under the request size limit; parsing it recursively once
+    // overflowed the stack and took the whole server down
+    client.send("eval " + std::string(63000, '(') + "1\n");
+    EXPECT_EQ(client.readLine().compare(0, 45, "ERR Expression nested too deeply at position "), 0);
+    client.send("eval 1 + 1\n");
+    EXPECT_EQ(client.readLine(), "OK 2");
+    other.send("eval 2 * 3\n");
+    EXPECT_EQ(other.readLine(), "OK 6");
+}
+
+TEST_F(CalculatorServerTest, LoadGeneratorReportsEveryRequest) {
+    start();
+    LoadOptions options;
+    options.connections = 8;
+    options.requestsPerConnection = 200;
+    options.pipelineDepth = 4;
+    LoadReport report = runLoad(path, options);
+    EXPECT_EQ(report.requests, 1600u);
+    EXPECT_EQ(report.errors, 0u);
+    EXPECT_GT(report.throughput, 0.0);
+    EXPECT_LE(report.p50Nanoseconds, report.p99Nanoseconds);
+    EXPECT_GT(report.maxNanoseconds, 0u);
+
+    options.request = "eval 1 / 0";
+    options.connections = 1;
+    options.requestsPerConnection = 10;
+    EXPECT_EQ(runLoad(path, options).errors, 10u);
+}
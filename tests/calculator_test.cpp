@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
 #include "calculator.h"
 #include <cmath>
+#include <cstdint>
 #include <stdexcept>
+#include <vector>
 
 class CalculatorTest : public ::testing::Test {
 protected:
@@ -74,6 +76,55 @@ TEST_F(CalculatorTest, Trigonometry) {
     EXPECT_TRUE(nearlyEqual(calc.cos(M_PI), -1));
     EXPECT_TRUE(nearlyEqual(calc.tan(0), 0));
     EXPECT_TRUE(nearlyEqual(calc.tan(M_PI/4), 1));
+
+    SineCosine both = calc.sincos(0.75);
+    EXPECT_EQ(both.sine, calc.sin(0.75));
+    EXPECT_EQ(both.cosine, calc.cos(0.75));
+}
+
+TEST_F(CalculatorTest, TrigonometryInDegrees) {
+    EXPECT_TRUE(calc.isRadians());
+    calc.setRadians(false);
+    EXPECT_FALSE(calc.isRadians());
+
+    // Reduced modulo 90 exactly before conversion
+    EXPECT_EQ(calc.sin(180), 0.0);
+    EXPECT_FALSE(std::signbit(calc.sin(180)));
+    EXPECT_EQ(calc.sin(-180), 0.0);
+    EXPECT_EQ(calc.cos(90), 0.0);
+    EXPECT_EQ(calc.cos(180), -1.0);
+    EXPECT_EQ(calc.sin(30), 0.5);
+    EXPECT_EQ(calc.cos(60), 0.5);
+    EXPECT_EQ(calc.sin(45), std::sqrt(0.5));
+    EXPECT_EQ(calc.tan(45), 1.0);
+    EXPECT_EQ(calc.tan(-135), 1.0);
+    EXPECT_EQ(calc.tan(90), INFINITY);
+    EXPECT_EQ(calc.sin(1e6 * 360 + 30), 0.5);
+    EXPECT_EQ(calc.sin(-0.0), 0.0);
+    EXPECT_TRUE(std::signbit(calc.sin(-0.0)));
+    EXPECT_TRUE(std::isnan(calc.sin(INFINITY)));
+    EXPECT_NEAR(calc.sin(1), std::sin(M_PI / 180), 1e-17);
+
+    SineCosine both = calc.sincos(120);
+    EXPECT_EQ(both.sine, calc.sin(120));
+    EXPECT_EQ(both.cosine, -0.5);
+
+    // The history and the array overloads follow the unit
+    calc.clearHistory();
+    calc.sin(90);
+    EXPECT_EQ(calc.getHistory().back(), "sin(90°) = 1");
+    double angles[] = {0, 90, 180, 270};
+    double sines[4];
+    calc.sin(angles, sines, 4);
+    EXPECT_EQ(sines[2], 0.0);
+    EXPECT_EQ(sines[3], -1.0);
+
+    // Degree and radian results never share cache entries
+    calc.enableResultCache();
+    EXPECT_EQ(calc.sin(90), 1.0);
+    calc.setRadians(true);
+    EXPECT_EQ(calc.sin(90), std::sin(90.0));
+    EXPECT_EQ(calc.getHistory().back().substr(0, 10), "sin(90) = ");
 }
 
 // Memory Operations Tests
@@ -107,6 +158,20 @@ TEST_F(CalculatorTest, DisplayOperations) {
     EXPECT_EQ(calc.getDisplayText(), "12.5");
 }
 
+TEST_F(CalculatorTest, InputEdgeCases) {
+    calc.appendNumber('.');
+    EXPECT_EQ(calc.getDisplayText(), "0");
+    calc.appendNumber('5');
+    EXPECT_EQ(calc.getDisplayText(), "0.5");
+
+    calc.clear();
+    calc.appendNumber('-');
+    EXPECT_EQ(calc.getDisplayText(), "-0");
+    calc.appendNumber('7');
+    calc.appendNumber('-');
+    EXPECT_EQ(calc.getDisplayText(), "-7");
+}
+
 TEST_F(CalculatorTest, ComplexCalculations) {
     calc.appendNumber('5');
     calc.setOperation('+');
@@ -133,6 +198,120 @@ TEST_F(CalculatorTest, HistoryTracking) {
     EXPECT_TRUE(calc.getHistory().empty());
 }
 
+TEST_F(CalculatorTest, Reductions) {
+    const double values[] = {2, 4, 4, 4, 5, 5, 7, 9};
+    EXPECT_EQ(calc.sum(values, 8), 40);
+    EXPECT_EQ(calc.mean(values, 8), 5);
+    EXPECT_DOUBLE_EQ(calc.variance(values, 8), 32.0 / 7);
+    EXPECT_DOUBLE_EQ(calc.stddev(values, 8), std::sqrt(32.0 / 7));
+    EXPECT_EQ(calc.min(values, 8), 2);
+    EXPECT_EQ(calc.max(values, 8), 9);
+    double prefix[8];
+    calc.prefixSum(values, prefix, 8);
+    EXPECT_EQ(prefix[2], 10);
+
+    // One history entry per call, however long the array
+    auto history = calc.getHistory();
+    ASSERT_EQ(history.size(), 7u);
+    EXPECT_EQ(history[0], "sum(8 values) = 40");
+    EXPECT_EQ(history[5], "max(8 values) = 9");
+    EXPECT_EQ(history[6], "prefix sum(8 values) = [..., 40]");
+
+    EXPECT_THROW(calc.sum(values, 0), std::invalid_argument);
+    EXPECT_THROW(calc.variance(values, 1), std::invalid_argument);
+    EXPECT_EQ(calc.getHistory().size(), 7u);
+}
+
+TEST_F(CalculatorTest, HistoryCapacity) {
+    Calculator small(3);
+    EXPECT_EQ(small.getHistoryCapacity(), 3);
+    for (int i = 1; i <= 5; ++i) {
+        small.add(i, i);
+    }
+    auto history = small.getHistory();
+    ASSERT_EQ(history.size(), 3);
+    EXPECT_EQ(history[0], "3 + 3 = 6");
+    EXPECT_EQ(history[2], "5 + 5 = 10");
+
+    small.setHistoryCapacity(2);
+    history = small.getHistory();
+    ASSERT_EQ(history.size(), 2);
+    EXPECT_EQ(history[0], "4 + 4 = 8");
+
+    small.setHistoryCapacity(0);
+    small.sqrt(4);
+    EXPECT_TRUE(small.getHistory().empty());
+}
+
+TEST_F(CalculatorTest, HistoryViewsAndSequences) {
+    Calculator small(3);
+    EXPECT_EQ(small.historySequence(), 0u);
+    EXPECT_TRUE(small.historyView().empty());
+    for (int i = 1; i <= 5; ++i) {
+        small.add(i, i);
+    }
+    EXPECT_EQ(small.historySequence(), 5u);
+
+    // Only the newest three are kept, numbered 3 to 5
+    HistoryView all = small.historyView();
+    ASSERT_EQ(all.size(), 3u);
+    EXPECT_EQ(all.firstSequence(), 3u);
+    EXPECT_EQ(all.lastSequence(), 5u);
+    std::uint64_t expected = 3;
+    for (HistoryView::Iterator it = all.begin(); it != all.end(); ++it) {
+        EXPECT_EQ(it.sequence(), expected);
+        EXPECT_EQ(it->lhs, static_cast<double>(expected));
+        ++expected;
+    }
+    EXPECT_EQ(small.formatHistoryRecord(all[2]), "5 + 5 = 10");
+
+    HistoryView newer = small.historySince(4);
+    ASSERT_EQ(newer.size(), 1u);
+    EXPECT_EQ(newer.firstSequence(), 5u);
+    EXPECT_EQ(newer[0].result, 10);
+    EXPECT_TRUE(small.historySince(5).empty());
+    EXPECT_EQ(small.historySince(1).size(), 3u);
+
+    // Numbers are not reused after clearing or while nothing is kept
+    small.clearHistory();
+    EXPECT_TRUE(small.historySince(0).empty());
+    small.sqrt(9);
+    newer = small.historySince(5);
+    ASSERT_EQ(newer.size(), 1u);
+    EXPECT_EQ(newer.begin().sequence(), 6u);
+    small.setHistoryCapacity(0);
+    small.sqrt(16);
+    EXPECT_EQ(small.historySequence(), 7u);
+    EXPECT_TRUE(small.historySince(6).empty());
+}
+
+TEST_F(CalculatorTest, HistorySubscriptions) {
+    std::vector<std::uint64_t> sequences;
+    std::vector<double> results;
+    std::size_t id = calc.subscribeHistory([&](std::uint64_t sequence, const HistoryRecord& record) {
+        sequences.push_back(sequence);
+        results.push_back(record.result);
+    });
+    int others = 0;
+    std::size_t other = calc.subscribeHistory([&](std::uint64_t, const HistoryRecord&) { ++others; });
+    EXPECT_NE(id, other);
+
+    calc.add(2, 3);
+    calc.multiply(4, 5);
+    EXPECT_THROW(calc.sqrt(-1), std::domain_error);
+    ASSERT_EQ(sequences.size(), 2u);
+    EXPECT_EQ(sequences[1], calc.historySequence());
+    EXPECT_EQ(sequences[1], sequences[0] + 1);
+    EXPECT_EQ(results[1], 20);
+
+    calc.unsubscribeHistory(id);
+    calc.unsubscribeHistory(id);
+    calc.setHistoryCapacity(0);
+    calc.subtract(1, 1);
+    EXPECT_EQ(sequences.size(), 2u);
+    EXPECT_EQ(others, 3);
+}
+
 // Error Handling Tests
 TEST_F(CalculatorTest, ErrorHandling) {
     // Division by zero
@@ -149,6 +328,35 @@ TEST_F(CalculatorTest, ErrorHandling) {
     EXPECT_THROW(calc.sqrt(-4), std::domain_error);
 }
 
+TEST_F(CalculatorTest, NonThrowingOperations) {
+    CalcResult result = calc.tryDivide(10, 4);
+    EXPECT_TRUE(result.ok());
+    EXPECT_DOUBLE_EQ(result.value, 2.5);
+
+    result = calc.tryDivide(1, 0);
+    EXPECT_EQ(result.status, CalcStatus::DivisionByZero);
+    EXPECT_STREQ(calcStatusMessage(result.status), "Division by zero");
+    EXPECT_EQ(calc.trySqrt(-1).status, CalcStatus::NegativeSqrt);
+    EXPECT_EQ(calc.tryLn(0).status, CalcStatus::NonPositiveLog);
+    EXPECT_DOUBLE_EQ(calc.trySqrt(9).value, 3);
+    EXPECT_DOUBLE_EQ(calc.tryLn(1).value, 0);
+
+    // Failures are not recorded, and the throwing wrappers keep their messages
+    EXPECT_EQ(calc.getHistory().size(), 3);
+    try {
+        calc.ln(-1);
+        FAIL() << "expected std::domain_error";
+    } catch (const std::domain_error& e) {
+        EXPECT_STREQ(e.what(), "Logarithm of non-positive number");
+    }
+
+    calc.appendNumber('5');
+    calc.setOperation('/');
+    calc.appendNumber('0');
+    calc.calculate();
+    EXPECT_EQ(calc.getDisplayText(), "Error: Division by zero");
+}
+
 // Number Formatting Tests
 TEST_F(CalculatorTest, NumberFormatting) {
     calc.appendNumber('1');
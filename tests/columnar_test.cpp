@@ -0,0 +1,241 @@
+#include <gtest/gtest.h>
+#include "columnar.h"
+#include "temp_dir.h"
+#include "work_stealing_pool.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Writes input CSVs and reads back evaluated outputs
+class ColumnarTest : public ::testing::Test {
+protected:
+    std::string path(const std::string& name) const {
+        return temp.path(name);
+    }
+
+    std::string write(const std::string& name, const std::string& contents) const {
+        return temp.write(name, contents);
+    }
+
+    std::string read(const std::string& file) {
+        std::ifstream in(file, std::ios::binary);
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        return contents.str();
+    }
+
+    // Small blocks and chunks so the tests cross block and chunk edges
+    static ColumnarOptions smallBlocks() {
+        ColumnarOptions options;
+        options.blockRows = 8;
+        options.chunkRows = 24;
+        return options;
+    }
+
+    TempDir temp{"columnar_test"};
+};
+
+} // namespace
+
+TEST_F(ColumnarTest, ParsesCsvColumns) {
+    ColumnSet columns;
+    columns.loadCsv(write("data.csv", "x, y ,label\r\n1.5,-2e3,7\r\n\r\n 0.1 ,nan,8\n-inf,1e400,9"));
+    EXPECT_EQ(columns.rows(), 3u);
+    EXPECT_TRUE(columns.contains("y"));
+    EXPECT_TRUE(columns.contains("label"));
+
+    const double* x = columns.column("x");
+    const double* y = columns.column("y");
+    EXPECT_EQ(x[0], 1.5);
+    EXPECT_EQ(x[1], 0.1);
+    EXPECT_EQ(x[2], -INFINITY);
+    EXPECT_EQ(y[0], -2000.0);
+    EXPECT_TRUE(std::isnan(y[1]));
+    EXPECT_EQ(y[2], INFINITY);
+    EXPECT_EQ(columns.column("label")[2], 9.0);
+    EXPECT_THROW(columns.column("z"), std::invalid_argument);
+}
+
+TEST_F(ColumnarTest, ParsesOnlySelectedColumns) {
+    ColumnSet columns;
+    columns.loadCsv(write("data.csv", "a;b;c\n1;oops;3\n4;;6\n"), {"c", "a"}, nullptr, [] {
+        ColumnarOptions options;
+        options.delimiter = ';';
+        return options;
+    }());
+    EXPECT_EQ(columns.rows(), 2u);
+    EXPECT_FALSE(columns.contains("b"));
+    EXPECT_EQ(columns.column("c")[1], 6.0);
+    EXPECT_EQ(columns.column("a")[1], 4.0);
+}
+
+TEST_F(ColumnarTest, ReportsMalformedCsv) {
+    ColumnSet columns;
+    try {
+        columns.loadCsv(write("bad.csv", "x,y\n1,2\n3,4x\n"));
+        FAIL() << "expected invalid_argument";
+    } catch (const std::invalid_argument& e) {
+        EXPECT_NE(std::string(e.what()).find("Line 3"), std::string::npos) << e.what();
+    }
+    EXPECT_THROW(columns.loadCsv(write("short.csv", "x,y\n1\n")), std::invalid_argument);
+    EXPECT_THROW(columns.loadCsv(write("other.csv", "x,y\n1,2\n"), {"z"}), std::invalid_argument);
+    EXPECT_THROW(columns.loadCsv(path("missing.csv")), std::runtime_error);
+    EXPECT_EQ(columns.rows(), 0u);
+}
+
+TEST_F(ColumnarTest, ParsesLargeCsvOnPool) {
+    std::ostringstream csv;
+    csv.precision(17);
+    csv << "i,half\n";
+    const int rows = 300000;
+    for (int i = 0; i < rows; ++i) {
+        csv << i << "," << i * 0.5 << "\n";
+    }
+    WorkStealingPool pool(4);
+    ColumnSet columns;
+    columns.loadCsv(write("large.csv", csv.str()), {}, &pool);
+    ASSERT_EQ(columns.rows(), static_cast<std::size_t>(rows));
+    for (int i = 0; i < rows; i += 997) {
+        EXPECT_EQ(columns.column("i")[i], i);
+        EXPECT_EQ(columns.column("half")[i], i * 0.5);
+    }
+}
+
+TEST_F(ColumnarTest, LoadsAndEvaluatesInsideAPoolTask) {
+    std::ostringstream csv;
+    csv << "x\n";
+    const std::size_t rows = 500;
+    for (std::size_t i = 0; i < rows; ++i) {
+        csv << i << "\n";
+    }
+    std::string file = write("nested.csv", csv.str());
+
+    // One worker, busy running the task that fans out
+    WorkStealingPool pool(1);
+    ColumnSet columns;
+    std::vector<double> out(rows);
+    std::size_t errors = 1;
+    {
+        TaskGroup group(pool);
+        group.submit([&](std::size_t) {
+            columns.loadCsv(file, {}, &pool, smallBlocks());
+            ColumnarFormula formula(CompiledExpr::compile("x * 2"), columns, smallBlocks());
+            errors = formula.evaluateAll(out.data(), &pool);
+        });
+    }
+    ASSERT_EQ(columns.rows(), rows);
+    EXPECT_EQ(errors, 0u);
+    for (std::size_t i = 0; i < rows; ++i) {
+        EXPECT_EQ(out[i], 2.0 * static_cast<double>(i));
+    }
+}
+
+TEST_F(ColumnarTest, MapsBinaryColumns) {
+    std::vector<double> values = {1.0, -2.5, 1e300};
+    std::string file = write("values.bin", std::string(reinterpret_cast<const char*>(values.data()),
+                                                       values.size() * sizeof(double)));
+    ColumnSet columns;
+    columns.mapBinary("v", file);
+    ASSERT_EQ(columns.rows(), 3u);
+    EXPECT_EQ(columns.column("v")[2], 1e300);
+    EXPECT_EQ(columns.sourceBytes(), 24u);
+
+    EXPECT_THROW(columns.add("w", {1.0, 2.0}), std::invalid_argument);
+    EXPECT_THROW(columns.add("v", {1.0, 2.0, 3.0}), std::invalid_argument);
+    EXPECT_THROW(columns.mapBinary("odd", write("odd.bin", "12345")), std::invalid_argument);
+}
+
+TEST_F(ColumnarTest, MatchesScalarEvaluation) {
+    const std::size_t rows = 100;
+    std::vector<double> x(rows);
+    std::vector<double> y(rows);
+    for (std::size_t i = 0; i < rows; ++i) {
+        x[i] = static_cast<double>(i) * 0.37 - 10;
+        y[i] = static_cast<double>(i % 7) + 0.5;
+    }
+    ColumnSet columns;
+    columns.add("x", x);
+    columns.add("y", y);
+
+    const char* sources[] = {"x * y + 3", "-(x - y) / (y * 2)", "x ^ 2 + sqrt(y) - ln(y) * 4", "x", "2.5"};
+    for (const char* source : sources) {
+        CompiledExpr expr = CompiledExpr::compile(source);
+        ColumnarFormula formula(expr, columns, smallBlocks());
+        std::vector<double> out(rows);
+        EXPECT_EQ(formula.evaluateAll(out.data()), 0u) << source;
+        for (std::size_t i = 0; i < rows; ++i) {
+            double values[] = {x[i], y[i]};
+            double expected = expr.evaluate(values);
+            EXPECT_NEAR(out[i], expected, 1e-12 * std::fabs(expected)) << source << " row " << i;
+        }
+    }
+
+    CompiledExpr trig = CompiledExpr::compile("sin(x) * cos(y) + tan(x / 4)", false);
+    ColumnarFormula formula(trig, columns, smallBlocks());
+    std::vector<double> out(rows);
+    WorkStealingPool pool(3);
+    formula.evaluateAll(out.data(), &pool);
+    for (std::size_t i = 0; i < rows; ++i) {
+        EXPECT_NEAR(out[i], trig.evaluate({x[i], y[i]}), 1e-12);
+    }
+
+    EXPECT_THROW(ColumnarFormula(CompiledExpr::compile("x + z"), columns), std::invalid_argument);
+}
+
+TEST_F(ColumnarTest, DomainErrorsYieldNan) {
+    ColumnSet columns;
+    columns.add("x", {4, 0, -1, 9, 1});
+    ColumnarFormula formula(CompiledExpr::compile("(1 / x) ^ 0 + sqrt(x)"), columns, smallBlocks());
+    std::vector<double> out(5);
+    EXPECT_EQ(formula.evaluate(0, 5, out.data()), 2u);
+    EXPECT_EQ(out[0], 3.0);
+    EXPECT_TRUE(std::isnan(out[1]));
+    EXPECT_TRUE(std::isnan(out[2]));
+    EXPECT_EQ(out[3], 4.0);
+
+    EXPECT_EQ(formula.evaluate(3, 5, out.data()), 0u);
+    EXPECT_EQ(out[0], 4.0);
+    EXPECT_EQ(out[1], 2.0);
+}
+
+TEST_F(ColumnarTest, WritesResultFiles) {
+    ColumnSet columns;
+    std::vector<double> x;
+    for (int i = 0; i < 50; ++i) {
+        x.push_back(i - 1);
+    }
+    columns.add("x", x);
+
+    ColumnarFormula formula(CompiledExpr::compile("(x + 1) / x"), columns, smallBlocks());
+    std::vector<double> direct(x.size());
+    formula.evaluateAll(direct.data());
+
+    WorkStealingPool pool(2);
+    std::string text = path("out.txt");
+    EXPECT_EQ(formula.evaluateToFile(text, &pool), 1u);
+    std::istringstream lines(read(text));
+    std::string line;
+    for (std::size_t i = 0; i < x.size(); ++i) {
+        ASSERT_TRUE(std::getline(lines, line));
+        if (i == 1) {
+            EXPECT_EQ(line, "nan");
+        } else {
+            EXPECT_EQ(std::stod(line), direct[i]) << line;
+        }
+    }
+    EXPECT_FALSE(std::getline(lines, line));
+
+    std::string binary = path("out.bin");
+    EXPECT_EQ(formula.evaluateToFile(binary), 1u);
+    std::string bytes = read(binary);
+    ASSERT_EQ(bytes.size(), x.size() * sizeof(double));
+    EXPECT_EQ(std::memcmp(bytes.data() + 2 * sizeof(double), &direct[2], (x.size() - 2) * sizeof(double)), 0);
+
+    EXPECT_THROW(formula.evaluateToFile(path("missing/out.txt")), std::runtime_error);
+}
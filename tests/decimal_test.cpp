@@ -0,0 +1,320 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "decimal.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Raw units from a string of digits, so tests can spell out 128-bit values
+Decimal units(const char* digits) {
+    bool negative = *digits == '-';
+    DecimalUnits value = 0;
+    for (const char* p = digits + (negative ? 1 : 0); *p != '\0'; ++p) {
+        value = value * 10 + (*p - '0');
+    }
+    return Decimal::fromUnits(negative ? -value : value);
+}
+
+std::string text(const DecimalContext& context, Decimal value) {
+    char buffer[DECIMAL_BUFFER_SIZE];
+    std::size_t length = context.format(value, buffer);
+    EXPECT_EQ(std::strlen(buffer), length);
+    return std::string(buffer, length);
+}
+
+std::string text(const DecimalContext& context, DecimalResult result) {
+    return result.ok() ? text(context, result.value) : calcStatusMessage(result.status);
+}
+
+// Number as keyed in, rounded by the context
+DecimalResult enter(const DecimalContext& context, const char* keys) {
+    NumberInput input;
+    for (const char* key = keys; *key != '\0'; ++key) {
+        input.append(*key);
+    }
+    return context.fromDecimal(input.isNegative(), input.significand(), input.decimalExponent(),
+                               input.isTruncated());
+}
+
+const char* const MAX_UNITS = "170141183460469231731687303715884105727";
+
+} // namespace
+
+TEST(DecimalTest, Formats) {
+    DecimalContext cents;
+    EXPECT_EQ(cents.scale(), 2);
+    EXPECT_EQ(cents.one(), 100u);
+    EXPECT_EQ(text(cents, Decimal()), "0.00");
+    EXPECT_EQ(text(cents, units("150")), "1.50");
+    EXPECT_EQ(text(cents, units("-5")), "-0.05");
+    EXPECT_EQ(text(cents, units("123456789")), "1234567.89");
+
+    DecimalContext whole(0);
+    EXPECT_EQ(text(whole, units("42")), "42");
+    EXPECT_EQ(text(whole, units("-0")), "0");
+    EXPECT_EQ(text(whole, units(MAX_UNITS)), MAX_UNITS);
+
+    DecimalContext fine(DecimalContext::MAX_SCALE);
+    EXPECT_EQ(text(fine, units("-170141183460469231731687303715884105727")),
+              "-170141183460469231731.687303715884105727");
+    EXPECT_EQ(text(fine, units("10000000000000000001")), "10.000000000000000001");
+    EXPECT_EQ(text(fine, units("7")), "0.000000000000000007");
+
+    EXPECT_THROW(DecimalContext(-1), std::invalid_argument);
+    EXPECT_THROW(DecimalContext(DecimalContext::MAX_SCALE + 1), std::invalid_argument);
+}
+
+TEST(DecimalTest, ExactArithmetic) {
+    DecimalContext cents;
+    Decimal tenth = enter(cents, "0.1").value;
+    Decimal fifth = enter(cents, "0.2").value;
+    EXPECT_EQ(text(cents, cents.add(tenth, fifth)), "0.30");
+    EXPECT_EQ(text(cents, cents.subtract(tenth, fifth)), "-0.10");
+    EXPECT_EQ(text(cents, cents.multiply(enter(cents, "19.99").value, enter(cents, "-3").value)), "-59.97");
+    EXPECT_EQ(text(cents, cents.divide(enter(cents, "10").value, enter(cents, "4").value)), "2.50");
+    EXPECT_EQ(text(cents, cents.divide(enter(cents, "1").value, enter(cents, "3").value)), "0.33");
+    EXPECT_EQ(text(cents, cents.divide(enter(cents, "2").value, enter(cents, "3").value)), "0.67");
+
+    // Ten cents added a thousand times is exactly 100
+    DecimalResult total = DecimalResult::success(Decimal());
+    for (int i = 0; i < 1000; ++i) {
+        total = cents.add(total.value, tenth);
+    }
+    EXPECT_EQ(text(cents, total), "100.00");
+
+    EXPECT_EQ(cents.divide(tenth, Decimal()).status, CalcStatus::DivisionByZero);
+}
+
+TEST(DecimalTest, RoundingModes) {
+    struct Case {
+        RoundingMode mode;
+        const char* eighth;         // 1 / 8 = 0.125
+        const char* negativeEighth; // -1 / 8
+        const char* threeEighths;   // 3 / 8 = 0.375
+        const char* third;          // 2 / 3 = 0.666...
+    };
+    const Case cases[] = {
+        {RoundingMode::HalfEven, "0.12", "-0.12", "0.38", "0.67"},
+        {RoundingMode::HalfUp, "0.13", "-0.13", "0.38", "0.67"},
+        {RoundingMode::TowardZero, "0.12", "-0.12", "0.37", "0.66"},
+        {RoundingMode::Floor, "0.12", "-0.13", "0.37", "0.66"},
+        {RoundingMode::Ceiling, "0.13", "-0.12", "0.38", "0.67"},
+    };
+    for (const Case& c : cases) {
+        DecimalContext context(2, c.mode);
+        Decimal one = enter(context, "1").value;
+        Decimal eight = enter(context, "8").value;
+        SCOPED_TRACE(static_cast<int>(c.mode));
+        EXPECT_EQ(text(context, context.divide(one, eight)), c.eighth);
+        EXPECT_EQ(text(context, context.divide(one, enter(context, "-8").value)), c.negativeEighth);
+        EXPECT_EQ(text(context, context.divide(enter(context, "3").value, eight)), c.threeEighths);
+        EXPECT_EQ(text(context, context.divide(enter(context, "2").value, enter(context, "3").value)), c.third);
+        EXPECT_EQ(text(context, enter(context, "0.125")), c.eighth);
+        EXPECT_EQ(text(context, enter(context, "-0.125")), c.negativeEighth);
+        EXPECT_EQ(text(context, context.multiply(enter(context, "0.5").value, enter(context, "0.25").value)),
+                  c.eighth);
+    }
+}
+
+TEST(DecimalTest, Conversions) {
+    DecimalContext cents(2, RoundingMode::HalfUp);
+    // 2.675 is slightly below 2.675 as a double but exact when keyed in
+    EXPECT_EQ(text(cents, cents.fromDouble(2.675)), "2.67");
+    EXPECT_EQ(text(cents, enter(cents, "2.675")), "2.68");
+    EXPECT_EQ(text(cents, cents.fromDouble(-0.005)), "-0.01");
+    EXPECT_EQ(text(cents, cents.fromDouble(1e-300)), "0.00");
+    EXPECT_EQ(text(cents, cents.fromDouble(1e30)), "1000000000000000019884624838656.00");
+    EXPECT_EQ(cents.fromDouble(1e40).status, CalcStatus::Overflow);
+    EXPECT_EQ(cents.fromDouble(std::numeric_limits<double>::quiet_NaN()).status, CalcStatus::Overflow);
+    EXPECT_EQ(cents.fromDouble(-std::numeric_limits<double>::infinity()).status, CalcStatus::Overflow);
+
+    DecimalContext fine(DecimalContext::MAX_SCALE);
+    EXPECT_EQ(text(fine, fine.fromDouble(0.1)), "0.100000000000000006");
+    EXPECT_EQ(text(fine, enter(fine, "1e-19")), "0.000000000000000000");
+    EXPECT_EQ(text(fine, enter(fine, "6e-19")), "0.000000000000000001");
+    EXPECT_EQ(text(fine, enter(fine, "1.5e20")), "150000000000000000000.000000000000000000");
+    EXPECT_EQ(enter(fine, "1e21").status, CalcStatus::Overflow);
+    EXPECT_EQ(text(cents, enter(cents, "0")), "0.00");
+
+    // Digits past NumberInput::MAX_DIGITS may only fall below the scale
+    EXPECT_EQ(enter(cents, "12345678901234567890123").status, CalcStatus::TooManyDigits);
+    EXPECT_EQ(enter(cents, "1234567890123456789.25").status, CalcStatus::TooManyDigits);
+    EXPECT_EQ(text(cents, enter(cents, "0.12345678901234567890123")), "0.12");
+    EXPECT_EQ(text(cents, enter(cents, "1234567890123456789")), "1234567890123456789.00");
+
+    EXPECT_EQ(cents.toDouble(enter(cents, "0.1").value), 0.1);
+    EXPECT_EQ(cents.toDouble(enter(cents, "-19.99").value), -19.99);
+    EXPECT_EQ(fine.toDouble(fine.fromDouble(0.1).value), 0.1);
+    EXPECT_EQ(fine.toDouble(units(MAX_UNITS)), 170141183460469231731.687303715884105727);
+    EXPECT_EQ(DecimalContext(0).toDouble(units(MAX_UNITS)), std::ldexp(1.0, 127));
+}
+
+TEST(DecimalTest, OverflowIsDetected) {
+    DecimalContext whole(0);
+    Decimal max = units(MAX_UNITS);
+    Decimal one = units("1");
+    EXPECT_EQ(whole.add(max, one).status, CalcStatus::Overflow);
+    EXPECT_EQ(whole.subtract(Decimal(), max).value, units("-170141183460469231731687303715884105727"));
+    EXPECT_EQ(whole.subtract(units("-170141183460469231731687303715884105727"), one).status,
+              CalcStatus::Overflow);
+    EXPECT_EQ(whole.multiply(max, units("-1")).value, whole.subtract(Decimal(), max).value);
+    EXPECT_EQ(whole.multiply(max, units("2")).status, CalcStatus::Overflow);
+    EXPECT_EQ(whole.multiply(units("10000000000000000000"), units("10000000000000000000")).value,
+              units("100000000000000000000000000000000000000"));
+
+    DecimalContext fine(DecimalContext::MAX_SCALE);
+    EXPECT_EQ(fine.multiply(max, units("2000000000000000000")).status, CalcStatus::Overflow);
+    EXPECT_EQ(fine.divide(max, units("500000000000000000")).status, CalcStatus::Overflow);
+    EXPECT_EQ(fine.divide(max, units("1")).status, CalcStatus::Overflow);
+    // Rounding up past the largest value
+    DecimalContext cents(2, RoundingMode::Ceiling);
+    EXPECT_EQ(cents.multiply(max, units("101")).status, CalcStatus::Overflow);
+}
+
+TEST(DecimalTest, WideIntermediates) {
+    // Products and dividends beyond 128 bits; expected values computed
+    // with exact rational arithmetic
+    DecimalContext fine(DecimalContext::MAX_SCALE);
+    EXPECT_EQ(text(fine, fine.multiply(units("12345678901234567890123"), units("98765432109876543210987"))),
+              "1219326311.370217952261797134");
+    EXPECT_EQ(text(fine, fine.multiply(enter(fine, "20").value, enter(fine, "-30").value)),
+              "-600.000000000000000000");
+    EXPECT_EQ(text(fine, fine.divide(enter(fine, "1000").value, enter(fine, "30").value)),
+              "33.333333333333333333");
+    EXPECT_EQ(text(fine, fine.divide(units("-123456789012345678901234567"), units("98765432109876543210"))),
+              "-1249999.988609375000154883");
+    EXPECT_EQ(text(fine, fine.divide(enter(fine, "1000").value, enter(fine, "3").value)),
+              "333.333333333333333333");
+}
+
+TEST(DecimalTest, CalculatorKeypad) {
+    Calculator calc;
+    calc.enableDecimalMode();
+    EXPECT_TRUE(calc.isDecimalMode());
+    EXPECT_EQ(calc.getDisplayText(), "0.00");
+
+    calc.appendNumber('0');
+    calc.appendNumber('.');
+    calc.appendNumber('1');
+    EXPECT_EQ(calc.getDisplayText(), "0.10");
+    calc.setOperation('+');
+    calc.appendNumber('0');
+    calc.appendNumber('.');
+    calc.appendNumber('2');
+    calc.calculate();
+    EXPECT_EQ(calc.getDisplayText(), "0.30");
+
+    calc.setOperation('/');
+    calc.appendNumber('7');
+    calc.calculate();
+    EXPECT_EQ(calc.getDisplayText(), "0.04");
+
+    calc.setOperation('^');
+    calc.appendNumber('2');
+    calc.calculate();
+    EXPECT_EQ(calc.getDisplayText(), "0.00");
+
+    calc.clear();
+    calc.appendNumber('5');
+    calc.setOperation('/');
+    calc.appendNumber('0');
+    calc.calculate();
+    EXPECT_EQ(calc.getDisplayText(), "Error: Division by zero");
+
+    calc.appendNumber('1');
+    calc.appendNumber('e');
+    calc.appendNumber('4');
+    calc.appendNumber('0');
+    EXPECT_EQ(calc.getDisplayText(), "Error: Decimal overflow");
+
+    // Memory is rounded to the scale on entering decimal mode
+    calc.clear();
+    calc.appendNumber('2');
+    calc.appendNumber('.');
+    calc.appendNumber('5');
+    calc.memoryStore();
+    calc.enableDecimalMode(0, RoundingMode::HalfEven);
+    EXPECT_EQ(calc.getDisplayText(), "0");
+    EXPECT_EQ(calc.memoryRecall(), 2);
+    EXPECT_EQ(calc.getDisplayText(), "2");
+
+    calc.disableDecimalMode();
+    EXPECT_FALSE(calc.isDecimalMode());
+    EXPECT_EQ(calc.getDisplayText(), "0");
+    calc.appendNumber('0');
+    calc.appendNumber('.');
+    calc.appendNumber('5');
+    EXPECT_EQ(calc.getDisplayText(), "0.5");
+
+    EXPECT_THROW(calc.enableDecimalMode(19), std::invalid_argument);
+    EXPECT_FALSE(calc.isDecimalMode());
+}
+
+namespace {
+
+void keyIn(Calculator& calc, const char* keys) {
+    for (const char* key = keys; *key != '\0'; ++key) {
+        calc.appendNumber(*key);
+    }
+}
+
+} // namespace
+
+TEST(DecimalTest, CalculatorMemoryIsExact) {
+    // 1000 x M+ 0.10: a double memory would be off in the 12th digit
+    Calculator calc;
+    calc.enableDecimalMode(DecimalContext::MAX_SCALE);
+    keyIn(calc, "0.10");
+    for (int i = 0; i < 1000; ++i) {
+        calc.memoryAdd();
+    }
+    calc.memoryRecall();
+    EXPECT_EQ(calc.getDisplayText(), "100.000000000000000000");
+
+    // Cents beyond 2^53 units, where doubles no longer hold every cent
+    calc.enableDecimalMode(2);
+    keyIn(calc, "90071992547409.91");
+    calc.memoryStore();
+    calc.clear();
+    keyIn(calc, "0.10");
+    for (int i = 0; i < 10; ++i) {
+        calc.memoryAdd();
+    }
+    calc.memorySubtract();
+    calc.memoryRecall();
+    EXPECT_EQ(calc.getDisplayText(), "90071992547410.81");
+
+    calc.memoryClear();
+    calc.memoryRecall();
+    EXPECT_EQ(calc.getDisplayText(), "0.00");
+
+    // Digits the keypad cannot hold are an error, not silently dropped
+    calc.clear();
+    keyIn(calc, "123456789012345678901");
+    EXPECT_EQ(calc.getDisplayText(), "Error: Too many digits");
+}
+
+TEST(DecimalTest, CalculatorOperations) {
+    Calculator calc;
+    const DecimalContext& cents = calc.getDecimalContext();
+    Decimal price = enter(cents, "19.99").value;
+    Decimal quantity = enter(cents, "3").value;
+    EXPECT_EQ(text(cents, calc.multiply(price, quantity)), "59.97");
+    EXPECT_EQ(text(cents, calc.add(price, quantity)), "22.99");
+    EXPECT_EQ(text(cents, calc.subtract(price, quantity)), "16.99");
+    EXPECT_EQ(text(cents, calc.divide(price, quantity)), "6.66");
+
+    auto history = calc.getHistory();
+    ASSERT_EQ(history.size(), 4u);
+    EXPECT_EQ(history[0], "19.99 × 3 = 59.97");
+    EXPECT_EQ(history[3], "19.99 ÷ 3 = 6.66");
+
+    EXPECT_THROW(calc.divide(price, Decimal()), std::domain_error);
+    EXPECT_THROW(calc.multiply(units(MAX_UNITS), quantity), std::overflow_error);
+    EXPECT_EQ(calc.tryAdd(units(MAX_UNITS), price).status, CalcStatus::Overflow);
+    EXPECT_EQ(calc.getHistory().size(), 4u);
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "expression.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+class ExpressionTest : public ::testing::Test {
+protected:
+    Calculator calc;
+};
+
+TEST_F(ExpressionTest, Arithmetic) {
+    EXPECT_EQ(calc.compile("1 + 2 * 3").evaluate(), 7);
+    EXPECT_EQ(calc.compile("(1 + 2) * 3").evaluate(), 9);
+    EXPECT_EQ(calc.compile("2 ^ 3 ^ 2").evaluate(), 512);
+    EXPECT_EQ(calc.compile("-2 ^ 2").evaluate(), -4);
+    EXPECT_EQ(calc.compile("2 ^ -1").evaluate(), 0.5);
+    EXPECT_EQ(calc.compile("10 - 4 - 3").evaluate(), 3);
+    EXPECT_EQ(calc.compile("1.5e3 / 3").evaluate(), 500);
+}
+
+TEST_F(ExpressionTest, Variables) {
+    CompiledExpr expr = calc.compile("sin(x)^2 + ln(y)/3");
+    ASSERT_EQ(expr.variableCount(), 2);
+    EXPECT_EQ(expr.variableIndex("x"), 0);
+    EXPECT_EQ(expr.variableIndex("y"), 1);
+    EXPECT_EQ(expr.variableIndex("z"), -1);
+    for (double x = -3; x < 3; x += 0.25) {
+        double expected = std::pow(std::sin(x), 2) + std::log(x + 4) / 3;
+        EXPECT_DOUBLE_EQ(expr.evaluate({x, x + 4}), expected);
+    }
+    EXPECT_THROW(expr.evaluate({1.0}), std::invalid_argument);
+}
+
+TEST_F(ExpressionTest, FoldingAndSharing) {
+    EXPECT_EQ(calc.compile("2 * pi + sqrt(16)").instructionCount(), 0);
+    EXPECT_EQ(calc.compile("x + 0.5 * 4").instructionCount(), 1);
+    // sin(x) and x*y are computed once each
+    CompiledExpr shared = calc.compile("sin(x) * sin(x) + x*y - y*x");
+    EXPECT_EQ(shared.instructionCount(), 5);
+    EXPECT_DOUBLE_EQ(shared.evaluate({0.5, 2.0}), std::sin(0.5) * std::sin(0.5));
+}
+
+TEST_F(ExpressionTest, DomainErrors) {
+    EXPECT_THROW(calc.compile("1 / x").evaluate({0.0}), std::domain_error);
+    EXPECT_THROW(calc.compile("sqrt(x)").evaluate({-1.0}), std::domain_error);
+    EXPECT_THROW(calc.compile("ln(x)").evaluate({0.0}), std::domain_error);
+    EXPECT_THROW(calc.compile("ln(0)").evaluate(), std::domain_error);
+    EXPECT_TRUE(calc.getHistory().empty());
+}
+
+TEST_F(ExpressionTest, DegreeMode) {
+    CompiledExpr radians = CompiledExpr::compile("sin(x)", true);
+    CompiledExpr degrees = CompiledExpr::compile("sin(x)", false);
+    EXPECT_EQ(radians.evaluate({M_PI / 2}), 1);
+    EXPECT_EQ(degrees.evaluate({90.0}), 1);
+}
+
+TEST_F(ExpressionTest, SyntaxErrors) {
+    EXPECT_THROW(calc.compile(""), std::invalid_argument);
+    EXPECT_THROW(calc.compile("1 +"), std::invalid_argument);
+    EXPECT_THROW(calc.compile("(1 + 2"), std::invalid_argument);
+    EXPECT_THROW(calc.compile("foo(1)"), std::invalid_argument);
+    EXPECT_THROW(calc.compile("1 $ 2"), std::invalid_argument);
+    EXPECT_THROW(calc.compile("1..2"), std::invalid_argument);
+    EXPECT_THROW(calc.compile("2e3e4"), std::invalid_argument);
+    EXPECT_THROW(calc.compile("1.5e-3e2"), std::invalid_argument);
+}
+
+TEST_F(ExpressionTest, NestingLimit) {
+    // Deep but reasonable nesting still compiles
+    std::string nested = std::string(200, '(') + "a" + std::string(200, ')');
+    EXPECT_EQ(calc.compile(nested).evaluate({3.0}), 3);
+    std::string negations = std::string(200, '-') + "1";
+    EXPECT_EQ(calc.compile(negations).evaluate({}), 1);
+
+    // Far past the limit: an error rather than a stack overflow
+    std::string hostile = std::string(60000, '(') + "a" + std::string(60000, ')');
+    try {
+        calc.compile(hostile);
+        ADD_FAILURE() << "compiled";
+    } catch (const std::invalid_argument& e) {
+        EXPECT_EQ(std::string(e.what()).compare(0, 41, "Expression nested too deeply at position "), 0);
+    }
+    EXPECT_THROW(calc.compile(std::string(60000, '-') + "1"), std::invalid_argument);
+    std::string powers = "2";
+    std::string calls;
+    for (int i = 0; i < 60000; ++i) {
+        powers += "^2";
+        calls += "sin(";
+    }
+    EXPECT_THROW(calc.compile(powers), std::invalid_argument);
+    EXPECT_THROW(calc.compile(calls + "1"), std::invalid_argument);
+}
@@ -0,0 +1,343 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "fast_math.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const long double PI_LONG = 3.14159265358979323846264338327950288L;
+
+// Largest relative error of an approximation against a long double
+// reference, over a set of arguments
+struct ErrorTracker {
+    double largest = 0;
+    double worstArgument = 0;
+
+    void check(double x, double actual, long double expected, double allowance = 1.0) {
+        const long double size = std::max(std::fabs(expected), static_cast<long double>(std::numeric_limits<double>::min()));
+        const double error = static_cast<double>(std::fabs(actual - expected) / size) / allowance;
+        if (error > largest) {
+            largest = error;
+            worstArgument = x;
+        }
+    }
+};
+
+class FastMathTest : public ::testing::TestWithParam<MathPrecision> {
+protected:
+    double bound() const { return mathPrecisionBound(GetParam()); }
+
+    void checkTrig(ErrorTracker& sine, ErrorTracker& cosine, ErrorTracker& tangent, double x) const {
+        const long double lx = x;
+        sine.check(x, fastSin(x, GetParam()), std::sin(lx));
+        cosine.check(x, fastCos(x, GetParam()), std::cos(lx));
+        tangent.check(x, fastTan(x, GetParam()), std::tan(lx));
+    }
+};
+
+} // namespace
+
+TEST(FastMathNamesTest, NamesAndBounds) {
+    EXPECT_EQ(std::string(mathPrecisionName(MathPrecision::Exact)), "exact");
+    EXPECT_EQ(std::string(mathPrecisionName(MathPrecision::High)), "high");
+    EXPECT_EQ(std::string(mathPrecisionName(MathPrecision::Fast)), "fast");
+    EXPECT_EQ(mathPrecisionBound(MathPrecision::Exact), 0.0);
+    EXPECT_EQ(mathPrecisionBound(MathPrecision::High), 1e-12);
+    EXPECT_EQ(mathPrecisionBound(MathPrecision::Fast), 1e-7);
+}
+
+TEST(FastMathNamesTest, ExactIsLibm) {
+    for (double x : {-3.7, -0.5, 0.1, 1.0, 2.5, 1e5}) {
+        EXPECT_EQ(fastSin(x, MathPrecision::Exact), std::sin(x));
+        EXPECT_EQ(fastCos(x, MathPrecision::Exact), std::cos(x));
+        EXPECT_EQ(fastTan(x, MathPrecision::Exact), std::tan(x));
+        EXPECT_EQ(fastExp(x, MathPrecision::Exact), std::exp(x));
+        EXPECT_EQ(fastPower(2.5, x, MathPrecision::Exact), std::pow(2.5, x));
+        if (x > 0) {
+            EXPECT_EQ(fastLn(x, MathPrecision::Exact), std::log(x));
+        }
+    }
+}
+
+TEST_P(FastMathTest, RandomArguments) {
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> angle(-32768.0, 32768.0);
+    std::uniform_real_distribution<double> smallAngle(-10.0, 10.0);
+    std::uniform_real_distribution<double> exponent(-1021.0, 1023.0);
+    std::uniform_real_distribution<double> mantissa(1.0, 2.0);
+    std::uniform_real_distribution<double> expArgument(-708.0, 708.0);
+    std::uniform_real_distribution<double> powerExponent(-40.0, 40.0);
+
+    ErrorTracker sine, cosine, tangent, log, exp, power;
+    for (int i = 0; i < 200000; ++i) {
+        checkTrig(sine, cosine, tangent, (i & 1) ? angle(rng) : smallAngle(rng));
+
+        const double x = std::ldexp(mantissa(rng), static_cast<int>(exponent(rng)));
+        log.check(x, fastLn(x, GetParam()), std::log(static_cast<long double>(x)));
+
+        const double e = expArgument(rng);
+        exp.check(e, fastExp(e, GetParam()), std::exp(static_cast<long double>(e)));
+
+        const double base = std::ldexp(mantissa(rng), static_cast<int>(smallAngle(rng)));
+        const double y = powerExponent(rng);
+        const long double expected = std::pow(static_cast<long double>(base), static_cast<long double>(y));
+        const double logResult = static_cast<double>(std::fabs(y * std::log(static_cast<long double>(base))));
+        power.check(base, fastPower(base, y, GetParam()), expected, std::max(1.0, logResult));
+    }
+    EXPECT_LT(sine.largest, bound()) << "at " << sine.worstArgument;
+    EXPECT_LT(cosine.largest, bound()) << "at " << cosine.worstArgument;
+    EXPECT_LT(tangent.largest, bound()) << "at " << tangent.worstArgument;
+    EXPECT_LT(log.largest, bound()) << "at " << log.worstArgument;
+    EXPECT_LT(exp.largest, bound()) << "at " << exp.worstArgument;
+    EXPECT_LT(power.largest, bound()) << "at " << power.worstArgument;
+}
+
+TEST_P(FastMathTest, EveryTrigTableEntry) {
+    // Both ends and the middle of every pi/64 interval, over several turns
+    // in both directions, plus the neighbours of the zeros and poles
+    ErrorTracker sine, cosine, tangent;
+    for (int n = -1024; n <= 1024; ++n) {
+        const double center = n * (PI / 64);
+        for (double offset : {-0.4999, -0.25, -1e-9, 0.0, 1e-9, 0.25, 0.4999}) {
+            checkTrig(sine, cosine, tangent, center + offset * (PI / 64));
+        }
+        if (n % 32 == 0) {
+            checkTrig(sine, cosine, tangent, std::nextafter(center, 0.0));
+            checkTrig(sine, cosine, tangent, std::nextafter(center, 1e9));
+            checkTrig(sine, cosine, tangent, std::nextafter(center, -1e9));
+        }
+    }
+    EXPECT_LT(sine.largest, bound()) << "at " << sine.worstArgument;
+    EXPECT_LT(cosine.largest, bound()) << "at " << cosine.worstArgument;
+    EXPECT_LT(tangent.largest, bound()) << "at " << tangent.worstArgument;
+}
+
+TEST_P(FastMathTest, EveryLogBucket) {
+    // Bucket edges fall at odd multiples of 1/256 of the mantissa; check
+    // both sides of each in a spread of binades, next to 1 and subnormal
+    ErrorTracker log;
+    for (int scale : {-1074, -1060, -1022, -100, -1, 0, 1, 52, 1000, 1023}) {
+        for (int step = 0; step <= 1024; ++step) {
+            const double m = 0.75 + step / 1024.0 * 0.75;
+            const double x = std::ldexp(m, scale);
+            if (x == 0 || std::isinf(x)) {
+                continue;
+            }
+            for (double y : {std::nextafter(x, 0.0), x, std::nextafter(x, INFINITY)}) {
+                log.check(y, fastLn(y, GetParam()), std::log(static_cast<long double>(y)));
+            }
+        }
+    }
+    for (double delta : {1e-15, 1e-10, 1e-5, 3e-3}) {
+        for (double x : {1.0 + delta, 1.0 - delta}) {
+            log.check(x, fastLn(x, GetParam()), std::log(static_cast<long double>(x)));
+        }
+    }
+    EXPECT_LT(log.largest, bound()) << "at " << log.worstArgument;
+    EXPECT_EQ(fastLn(1.0, GetParam()), 0.0);
+}
+
+TEST_P(FastMathTest, EveryExpTableEntry) {
+    const double ln2 = 0.69314718055994530942;
+    ErrorTracker exp;
+    for (int k : {-1021, -500, -10, -1, 0, 1, 10, 500, 1020}) {
+        for (int j = 0; j < 64; ++j) {
+            const double center = (k + j / 64.0) * ln2;
+            if (std::fabs(center) > 708) {
+                continue;
+            }
+            for (double offset : {-0.4999, -1e-12, 0.0, 1e-12, 0.4999}) {
+                const double x = center + offset * (ln2 / 64);
+                exp.check(x, fastExp(x, GetParam()), std::exp(static_cast<long double>(x)));
+            }
+        }
+    }
+    EXPECT_LT(exp.largest, bound()) << "at " << exp.worstArgument;
+    EXPECT_EQ(fastExp(0.0, GetParam()), 1.0);
+}
+
+TEST_P(FastMathTest, IntegralPowers) {
+    ErrorTracker power;
+    for (double base : {-3.5, -2.0, -0.7, 0.3, 1.0001, 2.0, 10.0}) {
+        for (int n = -64; n <= 64; ++n) {
+            power.check(base, fastPower(base, n, GetParam()),
+                        std::pow(static_cast<long double>(base), static_cast<long double>(n)));
+        }
+    }
+    EXPECT_LT(power.largest, bound()) << "at " << power.worstArgument;
+    EXPECT_EQ(fastPower(2.0, 10.0, GetParam()), 1024.0);
+    EXPECT_EQ(fastPower(-2.0, 3.0, GetParam()), -8.0);
+    EXPECT_EQ(fastPower(7.0, 0.0, GetParam()), 1.0);
+
+    // Negative exponents whose positive power overflows have subnormal
+    // results, not 0
+    for (double base : {1e5, -1e5}) {
+        EXPECT_EQ(fastPower(base, -62.0, GetParam()), std::pow(base, -62.0));
+    }
+    EXPECT_GT(fastPower(1e5, -62.0, GetParam()), 0.0);
+    EXPECT_EQ(fastPower(1e160, -2.0, GetParam()), std::pow(1e160, -2.0));
+    EXPECT_EQ(fastPower(1e-160, -2.0, GetParam()), std::pow(1e-160, -2.0));
+}
+
+TEST_P(FastMathTest, SpecialValues) {
+    const MathPrecision p = GetParam();
+    const double inf = std::numeric_limits<double>::infinity();
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    EXPECT_TRUE(std::isnan(fastSin(nan, p)));
+    EXPECT_TRUE(std::isnan(fastCos(inf, p)));
+    EXPECT_TRUE(std::isnan(fastTan(-inf, p)));
+    EXPECT_EQ(fastSin(0.0, p), 0.0);
+    EXPECT_EQ(fastCos(0.0, p), 1.0);
+    EXPECT_EQ(fastTan(0.0, p), 0.0);
+    EXPECT_NEAR(fastSin(1e22, p), std::sin(1e22), 1e-7);
+
+    EXPECT_TRUE(std::isnan(fastLn(nan, p)));
+    EXPECT_TRUE(std::isnan(fastLn(-1.0, p)));
+    EXPECT_EQ(fastLn(0.0, p), -inf);
+    EXPECT_EQ(fastLn(inf, p), inf);
+    const double subnormal = std::numeric_limits<double>::denorm_min();
+    EXPECT_NEAR(fastLn(subnormal, p), std::log(subnormal), 1e-9);
+
+    EXPECT_TRUE(std::isnan(fastExp(nan, p)));
+    EXPECT_EQ(fastExp(inf, p), inf);
+    EXPECT_EQ(fastExp(-inf, p), 0.0);
+    EXPECT_EQ(fastExp(710.0, p), inf);
+    EXPECT_EQ(fastExp(-745.5, p), std::exp(-745.5));
+
+    EXPECT_EQ(fastPower(0.0, -1.0, p), inf);
+    EXPECT_EQ(fastPower(0.0, 0.5, p), 0.0);
+    EXPECT_TRUE(std::isnan(fastPower(-2.0, 0.5, p)));
+    EXPECT_EQ(fastPower(2.0, 2000.0, p), inf);
+    EXPECT_EQ(fastPower(nan, 0.0, p), 1.0);
+    EXPECT_EQ(fastPower(1.0, nan, p), 1.0);
+}
+
+INSTANTIATE_TEST_SUITE_P(Approximations, FastMathTest, ::testing::Values(MathPrecision::High, MathPrecision::Fast),
+                         [](const ::testing::TestParamInfo<MathPrecision>& info) {
+                             return std::string(mathPrecisionName(info.param));
+                         });
+
+TEST(FastMathCalculatorTest, PrecisionRoutesTheScientificFunctions) {
+    Calculator calc;
+    EXPECT_EQ(calc.getMathPrecision(), MathPrecision::Exact);
+    EXPECT_EQ(calc.sin(0.5), std::sin(0.5));
+
+    calc.setMathPrecision(MathPrecision::Fast);
+    EXPECT_EQ(calc.getMathPrecision(), MathPrecision::Fast);
+    EXPECT_EQ(calc.sin(0.5), fastSin(0.5, MathPrecision::Fast));
+    EXPECT_EQ(calc.cos(0.5), fastCos(0.5, MathPrecision::Fast));
+    EXPECT_EQ(calc.tan(0.5), fastTan(0.5, MathPrecision::Fast));
+    EXPECT_EQ(calc.ln(3.0), fastLn(3.0, MathPrecision::Fast));
+    EXPECT_EQ(calc.power(3.0, 0.7), fastPower(3.0, 0.7, MathPrecision::Fast));
+    // sqrt stays exact
+    EXPECT_EQ(calc.sqrt(2.0), std::sqrt(2.0));
+    // Domain errors are unchanged
+    EXPECT_THROW(calc.ln(0.0), std::domain_error);
+    EXPECT_EQ(calc.tryLn(-1.0).status, CalcStatus::NonPositiveLog);
+    EXPECT_EQ(calc.getHistory().size(), 7u);
+}
+
+TEST(FastMathCalculatorTest, ApproximationsBypassTheCache) {
+    Calculator calc;
+    calc.enableResultCache();
+    EXPECT_EQ(calc.sin(1.25), std::sin(1.25));
+    EXPECT_EQ(calc.getResultCacheStats().misses, 1u);
+
+    // Approximations neither read nor fill the cache
+    calc.setMathPrecision(MathPrecision::High);
+    EXPECT_EQ(calc.sin(1.25), fastSin(1.25, MathPrecision::High));
+    EXPECT_EQ(calc.sin(1.25), fastSin(1.25, MathPrecision::High));
+    EXPECT_EQ(calc.getResultCacheStats().hits, 0u);
+    EXPECT_EQ(calc.getResultCacheStats().misses, 1u);
+
+    calc.setMathPrecision(MathPrecision::Exact);
+    EXPECT_EQ(calc.sin(1.25), std::sin(1.25));
+    EXPECT_EQ(calc.getResultCacheStats().hits, 1u);
+}
+
+TEST_P(FastMathTest, HugeRadianArguments) {
+    // Payne-Hanek reduction keeps the bound over the whole double range
+    std::mt19937_64 rng(7);
+    std::uniform_real_distribution<double> mantissa(1.0, 2.0);
+    ErrorTracker sine, cosine, tangent;
+    for (int i = 0; i < 100000; ++i) {
+        const int exponent = 15 + static_cast<int>(rng() % 1009);
+        const double x = std::ldexp(mantissa(rng), exponent) * ((i & 1) ? -1 : 1);
+        checkTrig(sine, cosine, tangent, x);
+    }
+    // Doubles closest to a multiple of pi/2, and the largest double
+    for (double x : {6381956970095103.0 * std::ldexp(1.0, 797), 5.319372648326541e+255, 1.7976931348623157e308,
+                     32768.000000000004, 32767.999999999996}) {
+        checkTrig(sine, cosine, tangent, x);
+        checkTrig(sine, cosine, tangent, -x);
+    }
+    EXPECT_LT(sine.largest, bound()) << "at " << sine.worstArgument;
+    EXPECT_LT(cosine.largest, bound()) << "at " << cosine.worstArgument;
+    EXPECT_LT(tangent.largest, bound()) << "at " << tangent.worstArgument;
+}
+
+TEST_P(FastMathTest, SinCosMatchesSinAndCos) {
+    std::mt19937_64 rng(8);
+    std::uniform_real_distribution<double> angle(-1e6, 1e6);
+    for (int i = 0; i < 10000; ++i) {
+        const double x = (i & 1) ? angle(rng) : std::ldexp(angle(rng), 200);
+        const SineCosine both = fastSinCos(x, GetParam());
+        ASSERT_EQ(both.sine, fastSin(x, GetParam())) << x;
+        ASSERT_EQ(both.cosine, fastCos(x, GetParam())) << x;
+        const SineCosine degrees = fastSinCosDegrees(x, GetParam());
+        ASSERT_EQ(degrees.sine, fastSinDegrees(x, GetParam())) << x;
+        ASSERT_EQ(degrees.cosine, fastCosDegrees(x, GetParam())) << x;
+    }
+}
+
+TEST_P(FastMathTest, Degrees) {
+    // Against long double sin of the angle reduced modulo 360 exactly
+    std::mt19937_64 rng(9);
+    std::uniform_real_distribution<double> angle(-1e5, 1e5);
+    ErrorTracker sine, cosine, tangent;
+    for (int i = 0; i < 100000; ++i) {
+        const double x = (i % 3 == 0) ? std::ldexp(angle(rng), 100) : angle(rng);
+        const long double radians = std::fmod(static_cast<long double>(x), 360.0L) * (PI_LONG / 180);
+        sine.check(x, fastSinDegrees(x, GetParam()), std::sin(radians));
+        cosine.check(x, fastCosDegrees(x, GetParam()), std::cos(radians));
+        tangent.check(x, fastTanDegrees(x, GetParam()), std::tan(radians));
+    }
+    EXPECT_LT(sine.largest, bound()) << "at " << sine.worstArgument;
+    EXPECT_LT(cosine.largest, bound()) << "at " << cosine.worstArgument;
+    EXPECT_LT(tangent.largest, bound()) << "at " << tangent.worstArgument;
+}
+
+TEST(FastMathDegreesTest, ExactAngles) {
+    for (MathPrecision p : {MathPrecision::Exact, MathPrecision::High, MathPrecision::Fast}) {
+        for (int k = -8; k <= 8; ++k) {
+            const double x = 90.0 * k;
+            const double expectedSine = (k & 1) ? ((k & 2) ? -1.0 : 1.0) : 0.0;
+            EXPECT_EQ(fastSinDegrees(x, p), expectedSine) << x;
+            if (expectedSine == 0) {
+                EXPECT_FALSE(std::signbit(fastSinDegrees(x, p))) << x;
+            }
+            EXPECT_EQ(fastCosDegrees(x - 90.0, p), expectedSine) << x;
+            EXPECT_EQ(fastTanDegrees(x, p), (k & 1) ? INFINITY : 0.0) << x;
+        }
+        EXPECT_EQ(fastSinDegrees(30, p), 0.5);
+        EXPECT_EQ(fastSinDegrees(150, p), 0.5);
+        EXPECT_EQ(fastSinDegrees(-210, p), 0.5);
+        EXPECT_EQ(fastCosDegrees(60, p), 0.5);
+        EXPECT_EQ(fastCosDegrees(300, p), 0.5);
+        EXPECT_EQ(fastSinDegrees(45, p), std::sqrt(0.5));
+        EXPECT_EQ(fastCosDegrees(315, p), std::sqrt(0.5));
+        EXPECT_EQ(fastTanDegrees(45, p), 1.0);
+        EXPECT_EQ(fastTanDegrees(135, p), -1.0);
+        EXPECT_EQ(fastTanDegrees(225, p), 1.0);
+        // 45 * 2^60 is a multiple of 360
+        EXPECT_EQ(fastSinDegrees(std::ldexp(45.0, 60), p), 0.0);
+        EXPECT_EQ(fastSinDegrees(1e300, p), fastSinDegrees(std::fmod(1e300, 360.0), p));
+        EXPECT_TRUE(std::isnan(fastSinDegrees(NAN, p)));
+        EXPECT_TRUE(std::isnan(fastCosDegrees(-INFINITY, p)));
+    }
+}
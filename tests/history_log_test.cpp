@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "history_log.h"
+#include "temp_dir.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Segments share one base path; TempDir deletes all of them
+class HistoryLogTest : public ::testing::Test {
+protected:
+    HistoryLogOptions smallSegments() const {
+        HistoryLogOptions options;
+        options.segmentRecords = 4;
+        options.syncInterval = 3;
+        return options;
+    }
+
+    TempDir temp{"history_log_test"};
+    std::string base = temp.path("session.hlog");
+};
+
+} // namespace
+
+TEST_F(HistoryLogTest, AppendAndRead) {
+    {
+        HistoryLog log(base);
+        for (int i = 0; i < 10; ++i) {
+            log.append(HistoryOp::Add, i, 1, i + 1);
+        }
+        EXPECT_EQ(log.size(), 10u);
+    }
+    HistoryLogReader reader(base);
+    ASSERT_EQ(reader.size(), 10u);
+    EXPECT_EQ(reader[7].operation(), HistoryOp::Add);
+    EXPECT_EQ(reader[7].lhs, 7.0);
+    EXPECT_EQ(reader[7].result, 8.0);
+
+    int count = 0;
+    for (const HistoryLogRecord& record : reader) {
+        EXPECT_EQ(record.lhs, count);
+        EXPECT_EQ(record.reserved, 0u);
+        ++count;
+    }
+    EXPECT_EQ(count, 10);
+}
+
+TEST_F(HistoryLogTest, RotatesSegmentsAndResumes) {
+    {
+        HistoryLog log(base, smallSegments());
+        for (int i = 0; i < 10; ++i) {
+            log.append(HistoryOp::Multiply, i, 2, i * 2.0);
+        }
+    }
+    {
+        // A later session continues in the last segment, keeping its size
+        HistoryLogOptions options;
+        options.segmentRecords = 1000;
+        HistoryLog log(base, options);
+        EXPECT_EQ(log.size(), 10u);
+        log.append(HistoryOp::Sqrt, 16, 0, 4);
+        log.append(HistoryOp::Sqrt, 25, 0, 5);
+        log.append(HistoryOp::Sqrt, 36, 0, 6);
+        log.flush();
+    }
+    std::ifstream fourthSegment(base + ".000003");
+    EXPECT_TRUE(fourthSegment.good());
+
+    HistoryLogReader reader(base);
+    ASSERT_EQ(reader.size(), 13u);
+    for (std::uint64_t i = 0; i < 10; ++i) {
+        ASSERT_EQ(reader[i].lhs, static_cast<double>(i));
+    }
+    EXPECT_EQ(reader[12].operation(), HistoryOp::Sqrt);
+    EXPECT_EQ(reader[12].result, 6.0);
+
+    std::uint64_t index = 0;
+    for (const HistoryLogRecord& record : reader) {
+        ASSERT_EQ(&record, &reader[index]);
+        ++index;
+    }
+    EXPECT_EQ(index, 13u);
+}
+
+TEST_F(HistoryLogTest, CalculatorLogsAndReplays) {
+    {
+        HistoryLog log(base, smallSegments());
+        Calculator calc(0);
+        calc.attachHistoryLog(&log);
+        calc.add(2, 3);
+        calc.divide(1, 3);
+        EXPECT_THROW(calc.ln(-1), std::domain_error);
+        calc.sin(0.5);
+        calc.power(2, 0.5);
+        calc.setRadians(false);
+        calc.sin(30);
+        calc.tan(100);
+        calc.setRadians(true);
+        calc.appendNumber('4');
+        calc.memoryStore();
+        calc.memoryRecall();
+        calc.attachHistoryLog(nullptr);
+        calc.add(1, 1);
+        EXPECT_EQ(log.size(), 8u);
+    }
+
+    // Degree records replay in degrees whatever the replaying unit
+    HistoryLogReader reader(base);
+    Calculator replay(0);
+    ReplayReport report = replayHistoryLog(reader, replay);
+    EXPECT_EQ(report.records, 8u);
+    EXPECT_EQ(report.checked, 6u);
+    EXPECT_EQ(report.mismatches, 0u);
+}
+
+TEST_F(HistoryLogTest, ReplayFindsAlteredResults) {
+    {
+        HistoryLog log(base);
+        log.append(HistoryOp::Add, 1, 2, 3);
+        log.append(HistoryOp::Add, 1, 2, 4);
+        log.append(HistoryOp::Ln, -1, 0, 0);
+        log.append(HistoryOp::Sqrt, 9, 0, 3);
+    }
+    HistoryLogReader reader(base);
+    Calculator calc(0);
+    ReplayReport report = replayHistoryLog(reader, calc);
+    EXPECT_EQ(report.mismatches, 2u);
+    ASSERT_EQ(report.mismatchIndices.size(), 2u);
+    EXPECT_EQ(report.mismatchIndices[0], 1u);
+    EXPECT_EQ(report.mismatchIndices[1], 2u);
+}
+
+TEST_F(HistoryLogTest, RejectsOtherFiles) {
+    EXPECT_THROW(HistoryLogReader reader(base), std::runtime_error);
+    {
+        std::ofstream junk(base + ".000000");
+        junk << "not a log, just some text that is long enough to fill a header.......";
+    }
+    EXPECT_THROW(HistoryLogReader reader(base), std::runtime_error);
+    EXPECT_THROW(HistoryLog log(base), std::runtime_error);
+}
+
+TEST_F(HistoryLogTest, RejectsCorruptCapacity) {
+    {
+        HistoryLog log(base, smallSegments());
+        log.append(HistoryOp::Add, 1, 2, 3);
+    }
+    // A capacity whose size in bytes wraps around, with a count to match
+    {
+        std::fstream file((base + ".000000").c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        std::uint64_t fields[2] = {std::uint64_t(1) << 59, std::uint64_t(1) << 58};
+        file.seekp(offsetof(HistoryLogHeader, capacity));
+        file.write(reinterpret_cast<const char*>(fields), sizeof(fields));
+    }
+    EXPECT_THROW(HistoryLogReader reader(base), std::runtime_error);
+    EXPECT_THROW(HistoryLog log(base), std::runtime_error);
+}
@@ -0,0 +1,229 @@
+#include <gtest/gtest.h>
+#include "array_ops.h"
+#include "matrix.h"
+#include "work_stealing_pool.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+Matrix random(std::size_t rows, std::size_t cols, unsigned seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    Matrix m(rows, cols);
+    for (std::size_t i = 0; i < rows; ++i) {
+        for (std::size_t j = 0; j < cols; ++j) {
+            m(i, j) = dist(rng);
+        }
+    }
+    return m;
+}
+
+Matrix naiveProduct(const Matrix& a, const Matrix& b) {
+    Matrix c(a.rows(), b.cols());
+    for (std::size_t i = 0; i < a.rows(); ++i) {
+        for (std::size_t j = 0; j < b.cols(); ++j) {
+            long double sum = 0;
+            for (std::size_t k = 0; k < a.cols(); ++k) {
+                sum += static_cast<long double>(a(i, k)) * b(k, j);
+            }
+            c(i, j) = static_cast<double>(sum);
+        }
+    }
+    return c;
+}
+
+double maxDifference(const Matrix& a, const Matrix& b) {
+    double largest = 0;
+    for (std::size_t i = 0; i < a.rows(); ++i) {
+        for (std::size_t j = 0; j < a.cols(); ++j) {
+            largest = std::max(largest, std::fabs(a(i, j) - b(i, j)));
+        }
+    }
+    return largest;
+}
+
+// Runs the test body once per instruction set this CPU supports
+class MatrixIsaTest : public ::testing::TestWithParam<ArrayIsa> {
+protected:
+    void SetUp() override {
+        if (setArrayIsa(GetParam()) != GetParam()) {
+            GTEST_SKIP() << arrayIsaName(GetParam()) << " not supported";
+        }
+    }
+
+    void TearDown() override {
+        setArrayIsa(supportedArrayIsa());
+    }
+};
+
+} // namespace
+
+TEST(MatrixTest, StorageIsAlignedAndPadded) {
+    Matrix m(5, 3, 2.5);
+    EXPECT_EQ(m.rows(), 5u);
+    EXPECT_EQ(m.cols(), 3u);
+    EXPECT_EQ(m.stride(), 8u);
+    for (std::size_t i = 0; i < m.rows(); ++i) {
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(m.row(i)) % MatrixPool::ALIGNMENT, 0u);
+        EXPECT_EQ(m(i, 2), 2.5);
+        EXPECT_EQ(m.row(i)[3], 0.0);
+    }
+    EXPECT_EQ(m.at(4, 2), 2.5);
+    EXPECT_THROW(m.at(5, 0), std::out_of_range);
+    EXPECT_THROW(Matrix(2, 2, {1, 2, 3}), std::invalid_argument);
+
+    Matrix copy(m);
+    EXPECT_EQ(copy, m);
+    copy(0, 0) = 1;
+    EXPECT_NE(copy, m);
+    Matrix moved(std::move(copy));
+    EXPECT_EQ(moved(0, 0), 1.0);
+    EXPECT_EQ(Matrix::identity(3), Matrix(3, 3, {1, 0, 0, 0, 1, 0, 0, 0, 1}));
+}
+
+TEST(MatrixTest, PoolReusesBlocks) {
+    MatrixPool pool(1 << 20);
+    double* block = pool.allocate(100);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(block) % MatrixPool::ALIGNMENT, 0u);
+    pool.release(block, 100);
+    EXPECT_EQ(pool.cachedBytes(), 128 * sizeof(double));
+    // Same size class, same block
+    EXPECT_EQ(pool.allocate(120), block);
+    EXPECT_EQ(pool.cachedBytes(), 0u);
+    pool.release(block, 120);
+
+    // Blocks beyond the cache limit go back to the system
+    double* large = pool.allocate(1 << 20);
+    pool.release(large, 1 << 20);
+    EXPECT_EQ(pool.cachedBytes(), 128 * sizeof(double));
+    pool.trim();
+    EXPECT_EQ(pool.cachedBytes(), 0u);
+    EXPECT_EQ(pool.allocate(0), nullptr);
+}
+
+TEST(MatrixTest, ElementwiseOperations) {
+    Matrix a(2, 3, {1, 2, 3, 4, 5, 6});
+    Matrix b(2, 3, {6, 5, 4, 3, 2, 1});
+    EXPECT_EQ(matrixAdd(a, b), Matrix(2, 3, 7.0));
+    EXPECT_EQ(matrixSubtract(a, b), Matrix(2, 3, {-5, -3, -1, 1, 3, 5}));
+    EXPECT_EQ(matrixMultiplyElements(a, b), Matrix(2, 3, {6, 10, 12, 12, 10, 6}));
+    EXPECT_EQ(matrixDivideElements(a, Matrix(2, 3, 2.0)), Matrix(2, 3, {0.5, 1, 1.5, 2, 2.5, 3}));
+    EXPECT_THROW(matrixAdd(a, transpose(b)), std::invalid_argument);
+
+    // Division by zero fails as it does in Calculator
+    b(1, 2) = 0;
+    try {
+        matrixDivideElements(a, b);
+        FAIL() << "expected a domain_error";
+    } catch (const std::domain_error& e) {
+        EXPECT_EQ(std::string(e.what()), "Division by zero");
+    }
+}
+
+TEST(MatrixTest, Transpose) {
+    Matrix a = random(37, 70, 1);
+    Matrix t = transpose(a);
+    ASSERT_EQ(t.rows(), 70u);
+    ASSERT_EQ(t.cols(), 37u);
+    for (std::size_t i = 0; i < a.rows(); ++i) {
+        for (std::size_t j = 0; j < a.cols(); ++j) {
+            EXPECT_EQ(t(j, i), a(i, j));
+        }
+    }
+    EXPECT_EQ(transpose(t), a);
+}
+
+TEST_P(MatrixIsaTest, ProductMatchesNaiveLoops) {
+    // Odd shapes so every edge tile is exercised, with small blocks so
+    // that every block boundary is too
+    MatrixOptions small;
+    small.blockRows = 10;
+    small.blockDepth = 7;
+    small.blockCols = 12;
+    const std::size_t shapes[][3] = {{1, 1, 1}, {3, 5, 2}, {17, 9, 23}, {64, 64, 64}, {45, 130, 71}};
+    for (const auto& shape : shapes) {
+        Matrix a = random(shape[0], shape[1], 2);
+        Matrix b = random(shape[1], shape[2], 3);
+        Matrix expected = naiveProduct(a, b);
+        EXPECT_LT(maxDifference(matrixProduct(a, b), expected), 1e-12) << shape[0] << "x" << shape[1];
+        EXPECT_LT(maxDifference(matrixProduct(a, b, nullptr, small), expected), 1e-12);
+    }
+    EXPECT_EQ(matrixProduct(Matrix(2, 0), Matrix(0, 3)), Matrix(2, 3));
+    EXPECT_THROW(matrixProduct(Matrix(2, 3), Matrix(2, 3)), std::invalid_argument);
+}
+
+TEST_P(MatrixIsaTest, ProductDoesNotDependOnThePool) {
+    Matrix a = random(301, 257, 4);
+    Matrix b = random(257, 190, 5);
+    Matrix serial = matrixProduct(a, b);
+    WorkStealingPool pool(4);
+    EXPECT_EQ(matrixProduct(a, b, &pool), serial);
+}
+
+TEST(MatrixTest, ProductInsideATaskOfItsPool) {
+    Matrix a = random(130, 120, 8);
+    Matrix b = random(120, 110, 9);
+    Matrix serial = matrixProduct(a, b);
+    WorkStealingPool pool(1);
+    Matrix nested;
+    {
+        TaskGroup group(pool);
+        group.submit([&](std::size_t) { nested = matrixProduct(a, b, &pool); });
+    }
+    EXPECT_EQ(nested, serial);
+}
+
+TEST_P(MatrixIsaTest, LuSolvesSystems) {
+    const std::size_t n = 150;  // more than two factored panels
+    Matrix a = random(n, n, 6);
+    Matrix x = random(n, 3, 7);
+    Matrix b = matrixProduct(a, x);
+    WorkStealingPool pool(3);
+    LuDecomposition lu(a, &pool);
+    EXPECT_LT(maxDifference(lu.solve(b), x), 1e-9);
+    EXPECT_LT(maxDifference(solve(a, b), x), 1e-9);
+
+    // Rebuild P A from the factors
+    Matrix l(n, n);
+    Matrix u(n, n);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j < n; ++j) {
+            (j < i ? l : u)(i, j) = lu.factors()(i, j);
+        }
+        l(i, i) = 1;
+    }
+    Matrix pa(a);
+    for (std::size_t i = 0; i < n; ++i) {
+        std::swap_ranges(pa.row(i), pa.row(i) + n, pa.row(lu.pivots()[i]));
+    }
+    EXPECT_LT(maxDifference(matrixProduct(l, u), pa), 1e-12);
+}
+
+INSTANTIATE_TEST_SUITE_P(AllIsas, MatrixIsaTest,
+                         ::testing::Values(ArrayIsa::Scalar, ArrayIsa::Sse2, ArrayIsa::Avx2, ArrayIsa::Avx512),
+                         [](const ::testing::TestParamInfo<ArrayIsa>& info) {
+                             return std::string(arrayIsaName(info.param));
+                         });
+
+TEST(MatrixTest, SmallSystemsAndSingularMatrices) {
+    Matrix a(2, 2, {2, 1, 1, 3});
+    std::vector<double> x = solve(a, std::vector<double>{3, 5});
+    EXPECT_DOUBLE_EQ(x[0], 0.8);
+    EXPECT_DOUBLE_EQ(x[1], 1.4);
+    EXPECT_DOUBLE_EQ(LuDecomposition(a).determinant(), 5.0);
+    // A row swap flips the sign
+    EXPECT_DOUBLE_EQ(LuDecomposition(Matrix(2, 2, {0, 1, 1, 0})).determinant(), -1.0);
+
+    try {
+        LuDecomposition(Matrix(2, 2, {1, 2, 2, 4}));
+        FAIL() << "expected a domain_error";
+    } catch (const std::domain_error& e) {
+        EXPECT_EQ(std::string(e.what()), "Singular matrix");
+    }
+    EXPECT_THROW(LuDecomposition(Matrix(2, 3)), std::invalid_argument);
+    EXPECT_THROW(LuDecomposition(a).solve(Matrix(3, 1)), std::invalid_argument);
+}
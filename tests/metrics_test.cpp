@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "metrics.h"
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Enables metrics on a clean slate and turns them off again afterwards
+class MetricsTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        resetMetrics();
+        setMetricsEnabled(true);
+    }
+
+    void TearDown() override {
+        setMetricsEnabled(false);
+        resetMetrics();
+    }
+};
+
+} // namespace
+
+TEST(MetricBucketTest, BoundariesRoundTrip) {
+    for (std::size_t i = 0; i < METRIC_BUCKET_COUNT; ++i) {
+        std::uint64_t low = metricBucketLowerBound(i);
+        ASSERT_EQ(metricBucket(low), i);
+        if (i > 0) {
+            ASSERT_EQ(metricBucket(low - 1), i - 1);
+        }
+    }
+    EXPECT_EQ(metricBucket(0), 0u);
+    EXPECT_EQ(metricBucket(15), 15u);
+    EXPECT_EQ(metricBucket(16), 16u);
+    EXPECT_EQ(metricBucket(17), 16u);
+    EXPECT_EQ(metricBucket(~std::uint64_t(0)), METRIC_BUCKET_COUNT - 1);
+}
+
+TEST(MetricBucketTest, Percentiles) {
+    OpMetrics m = MetricsSnapshot()[MetricOp::Add];
+    EXPECT_EQ(m.percentile(0.5), 0u);
+    m.calls = 100;
+    m.buckets[metricBucket(40)] = 90;
+    m.buckets[metricBucket(1000)] = 10;
+    EXPECT_EQ(m.percentile(0.5), metricBucketLowerBound(metricBucket(40) + 1) - 1);
+    EXPECT_GE(m.percentile(0.99), 1000u);
+    EXPECT_LT(m.percentile(0.99), 1000u * 9 / 8);
+}
+
+#ifdef CALCULATOR_METRICS
+
+TEST_F(MetricsTest, CountsCallsAndErrors) {
+    Calculator calc;
+    calc.add(1, 2);
+    calc.add(3, 4);
+    calc.divide(6, 3);
+    EXPECT_THROW(calc.divide(1, 0), std::domain_error);
+    EXPECT_FALSE(calc.trySqrt(-1).ok());
+
+    MetricsSnapshot snapshot = metricsSnapshot();
+    EXPECT_EQ(snapshot[MetricOp::Add].calls, 2u);
+    EXPECT_EQ(snapshot[MetricOp::Add].errors, 0u);
+    EXPECT_EQ(snapshot[MetricOp::Divide].calls, 2u);
+    EXPECT_EQ(snapshot[MetricOp::Divide].errors, 1u);
+    EXPECT_EQ(snapshot[MetricOp::Sqrt].errors, 1u);
+    EXPECT_EQ(snapshot[MetricOp::RecordHistory].calls, 3u);
+
+    std::uint64_t bucketTotal = 0;
+    for (std::uint64_t count : snapshot[MetricOp::Add].buckets) {
+        bucketTotal += count;
+    }
+    EXPECT_EQ(bucketTotal, 2u);
+}
+
+TEST_F(MetricsTest, CalculateErrorBranch) {
+    Calculator calc;
+    calc.appendNumber('8');
+    calc.setOperation('/');
+    calc.appendNumber('0');
+    calc.calculate();
+    ASSERT_EQ(calc.getDisplayText(), "Error: Division by zero");
+
+    MetricsSnapshot snapshot = metricsSnapshot();
+    EXPECT_EQ(snapshot[MetricOp::Calculate].errors, 1u);
+    EXPECT_EQ(snapshot[MetricOp::Divide].errors, 1u);
+    EXPECT_EQ(snapshot[MetricOp::AppendNumber].calls, 2u);
+    EXPECT_GE(snapshot[MetricOp::FormatNumber].calls, 2u);
+}
+
+TEST_F(MetricsTest, DisabledRecordsNothing) {
+    setMetricsEnabled(false);
+    Calculator calc;
+    calc.multiply(2, 3);
+    EXPECT_EQ(metricsSnapshot()[MetricOp::Multiply].calls, 0u);
+}
+
+TEST_F(MetricsTest, MergesThreads) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            Calculator calc;
+            for (int i = 0; i < 1000; ++i) {
+                calc.subtract(i, 1);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    // Finished threads are kept in the totals
+    EXPECT_EQ(metricsSnapshot()[MetricOp::Subtract].calls, 4000u);
+
+    resetMetrics();
+    EXPECT_EQ(metricsSnapshot()[MetricOp::Subtract].calls, 0u);
+}
+
+TEST_F(MetricsTest, Formats) {
+    Calculator calc;
+    calc.ln(2);
+    EXPECT_THROW(calc.ln(0), std::domain_error);
+    MetricsSnapshot snapshot = metricsSnapshot();
+
+    std::string json = snapshot.toJson();
+    EXPECT_NE(json.find("\"ln\": {\"calls\": 2, \"errors\": 1"), std::string::npos) << json;
+    EXPECT_EQ(json.find("\"tan\""), std::string::npos);
+
+    std::string text = snapshot.toPrometheus();
+    EXPECT_NE(text.find("# TYPE calculator_calls_total counter"), std::string::npos);
+    EXPECT_NE(text.find("calculator_calls_total{op=\"ln\"} 2\n"), std::string::npos);
+    EXPECT_NE(text.find("calculator_errors_total{op=\"ln\"} 1\n"), std::string::npos);
+    EXPECT_NE(text.find("calculator_latency_seconds{op=\"ln\",quantile=\"0.99\"}"), std::string::npos);
+    EXPECT_NE(text.find("calculator_latency_seconds_count{op=\"ln\"} 2\n"), std::string::npos);
+}
+
+#endif // CALCULATOR_METRICS
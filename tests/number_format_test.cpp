@@ -0,0 +1,128 @@
+#include <gtest/gtest.h>
+#include "number_format.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+
+class NumberFormatTest : public ::testing::Test {
+protected:
+    // Reference implementation the formatter must reproduce byte for byte
+    static std::string streamFormat(double num) {
+        std::ostringstream ss;
+        ss << std::fixed << std::setprecision(6);
+        ss << num;
+        std::string str = ss.str();
+        if (str.find('.') != std::string::npos) {
+            str = str.substr(0, str.find_last_not_of('0') + 1);
+            if (str.back() == '.') {
+                str = str.substr(0, str.size() - 1);
+            }
+        }
+        return str;
+    }
+
+    static std::string fixed(double num) {
+        char buffer[NUMBER_BUFFER_SIZE];
+        std::size_t length = formatFixed(num, buffer);
+        EXPECT_EQ(std::strlen(buffer), length);
+        return std::string(buffer, length);
+    }
+
+    static std::string shortest(double num) {
+        char buffer[NUMBER_BUFFER_SIZE];
+        std::size_t length = formatShortest(num, buffer);
+        EXPECT_EQ(std::strlen(buffer), length);
+        return std::string(buffer, length);
+    }
+
+    static double fromBits(std::uint64_t bits) {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+TEST_F(NumberFormatTest, FixedSpecialCases) {
+    const double values[] = {
+        0.0, -0.0, 1.0, -1.0, 2.5, 100.0, 1.23, 0.1, 1e-7, -1e-9,
+        0.0000005, 0.0000015, 0.0078125, 1234567.8901234, 9.9999995,
+        1e15, 1e22, 1e300, -1.7976931348623157e308,
+        std::numeric_limits<double>::denorm_min(),
+        std::numeric_limits<double>::infinity(),
+        -std::numeric_limits<double>::infinity(),
+        std::numeric_limits<double>::quiet_NaN()
+    };
+    for (double value : values) {
+        EXPECT_EQ(fixed(value), streamFormat(value)) << value;
+    }
+    EXPECT_EQ(fixed(2.5), "2.5");
+    EXPECT_EQ(fixed(-0.0), "-0");
+    EXPECT_EQ(fixed(20), "20");
+}
+
+TEST_F(NumberFormatTest, FixedMatchesStreamOnRandomValues) {
+    std::mt19937_64 rng(12345);
+    std::uniform_real_distribution<double> moderate(-1e6, 1e6);
+    for (int i = 0; i < 20000; ++i) {
+        double value = fromBits(rng());
+        if (!std::isnan(value)) {
+            ASSERT_EQ(fixed(value), streamFormat(value)) << value;
+        }
+        value = moderate(rng);
+        ASSERT_EQ(fixed(value), streamFormat(value)) << value;
+        // Halfway cases: k / 2^7 has an exact tie at the sixth decimal
+        value = static_cast<double>(rng() % 1000000) / 128.0;
+        ASSERT_EQ(fixed(value), streamFormat(value)) << value;
+    }
+}
+
+TEST_F(NumberFormatTest, ShortestKnownValues) {
+    EXPECT_EQ(shortest(0.0), "0");
+    EXPECT_EQ(shortest(-0.0), "-0");
+    EXPECT_EQ(shortest(0.1), "0.1");
+    EXPECT_EQ(shortest(0.1 + 0.2), "0.30000000000000004");
+    EXPECT_EQ(shortest(123.0), "123");
+    EXPECT_EQ(shortest(-2.5), "-2.5");
+    EXPECT_EQ(shortest(1e20), "100000000000000000000");
+    EXPECT_EQ(shortest(1e21), "1e+21");
+    EXPECT_EQ(shortest(1e-6), "0.000001");
+    EXPECT_EQ(shortest(1e-7), "1e-7");
+    EXPECT_EQ(shortest(1.5e-6), "0.0000015");
+    EXPECT_EQ(shortest(5e-324), "5e-324");
+    EXPECT_EQ(shortest(1.7976931348623157e308), "1.7976931348623157e+308");
+    EXPECT_EQ(shortest(std::numeric_limits<double>::infinity()), "inf");
+}
+
+TEST_F(NumberFormatTest, ShortestRoundTrips) {
+    std::mt19937_64 rng(67890);
+    for (int i = 0; i < 20000; ++i) {
+        double value = fromBits(rng());
+        if (std::isnan(value) || std::isinf(value)) {
+            continue;
+        }
+        std::string text = shortest(value);
+        ASSERT_EQ(std::strtod(text.c_str(), nullptr), value) << text;
+        // One significant digit fewer must not identify the same double
+        std::string mantissa = text.substr(0, text.find_first_of("eE"));
+        std::string digits;
+        for (char c : mantissa) {
+            if (c >= '0' && c <= '9') {
+                digits += c;
+            }
+        }
+        digits.erase(0, digits.find_first_not_of('0'));
+        digits.erase(digits.find_last_not_of('0') + 1);
+        if (digits.size() > 1) {
+            char buffer[40];
+            std::snprintf(buffer, sizeof(buffer), "%.*e", static_cast<int>(digits.size()) - 2, value);
+            ASSERT_NE(std::strtod(buffer, nullptr), value) << text << " vs " << buffer;
+        }
+    }
+}
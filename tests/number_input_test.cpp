@@ -0,0 +1,85 @@
+#include <gtest/gtest.h>
+#include "number_input.h"
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+class NumberInputTest : public ::testing::Test {
+protected:
+    NumberInput input;
+
+    double enter(const std::string& keys) {
+        input.reset();
+        for (char key : keys) {
+            input.append(key);
+        }
+        return input.value();
+    }
+};
+
+TEST_F(NumberInputTest, Digits) {
+    EXPECT_EQ(enter("0"), 0.0);
+    EXPECT_EQ(enter("12"), 12.0);
+    EXPECT_EQ(enter("12.5"), 12.5);
+    EXPECT_EQ(enter("007"), 7.0);
+    EXPECT_EQ(enter("0.001"), 0.001);
+    EXPECT_EQ(enter("-4"), -4.0);
+    EXPECT_EQ(enter("1.5e3"), 1500.0);
+    EXPECT_EQ(enter("25e-1"), 2.5);
+}
+
+TEST_F(NumberInputTest, EdgeCases) {
+    EXPECT_EQ(enter(""), 0.0);
+    EXPECT_EQ(enter("."), 0.0);
+    EXPECT_EQ(enter("-"), 0.0);
+    EXPECT_TRUE(std::signbit(enter("-")));
+    EXPECT_EQ(enter("-."), 0.0);
+    EXPECT_EQ(enter("1.2.3"), 1.23);
+    EXPECT_EQ(enter("5-3"), 53.0);
+    EXPECT_EQ(enter("1e"), 1.0);
+    EXPECT_TRUE(std::isinf(enter("1e999")));
+    EXPECT_EQ(enter("1e-999"), 0.0);
+
+    input.reset();
+    EXPECT_TRUE(input.empty());
+    EXPECT_TRUE(input.append('1'));
+    EXPECT_FALSE(input.append('-'));
+    EXPECT_FALSE(input.append('x'));
+    EXPECT_FALSE(input.empty());
+}
+
+TEST_F(NumberInputTest, MatchesStrtod) {
+    const char* cases[] = {
+        "0.1", "0.3", "123456789012345678", "9007199254740993",
+        "2.2250738585072011e-308", "4.9406564584124654e-324",
+        "2.4703282292062328e-324", "1.7976931348623157e308",
+        "1.7976931348623158e308", "3.14159265358979323", "1e23", "8.98846567431158e307"
+    };
+    for (const char* text : cases) {
+        EXPECT_EQ(enter(text), std::strtod(text, nullptr)) << text;
+    }
+
+    std::mt19937_64 rng(2024);
+    for (int i = 0; i < 20000; ++i) {
+        std::string text = std::to_string(rng() % 10000000000000000000ULL);
+        text.insert(1, ".");
+        text += "e" + std::to_string(static_cast<int>(rng() % 640) - 330);
+        ASSERT_EQ(enter(text), std::strtod(text.c_str(), nullptr)) << text;
+    }
+}
+
+TEST_F(NumberInputTest, LongInputIsIncremental) {
+    input.reset();
+    input.append('1');
+    for (int i = 0; i < 100000; ++i) {
+        input.append('0');
+    }
+    EXPECT_TRUE(std::isinf(input.value()));
+    input.reset();
+    input.append('.');
+    for (int i = 0; i < 100000; ++i) {
+        input.append('3');
+    }
+    EXPECT_EQ(input.value(), 1.0 / 3.0);
+}
@@ -0,0 +1,171 @@
+#include <gtest/gtest.h>
+#include "parallel_evaluator.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+std::string readAll(std::FILE* file) {
+    std::string text;
+    char buffer[4096];
+    std::size_t count;
+    std::rewind(file);
+    while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        text.append(buffer, count);
+    }
+    return text;
+}
+
+std::string makeInput(int lines) {
+    std::string input;
+    for (int i = 0; i < lines; ++i) {
+        switch (i % 5) {
+            case 0: input += std::to_string(i) + " + 0.5\n"; break;
+            case 1: input += "sqrt(" + std::to_string(i) + ") * 2\n"; break;
+            case 2: input += "1 / " + std::to_string(i % 3 - 2 + 1) + "\n"; break;
+            case 3: input += "\n"; break;
+            case 4: input += "ln(" + std::to_string(i) + ") ^ 2\n"; break;
+        }
+    }
+    return input;
+}
+
+} // namespace
+
+TEST(WorkStealingPoolTest, RunsAllTasks) {
+    WorkStealingPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    std::atomic<int> sum(0);
+    for (int i = 1; i <= 1000; ++i) {
+        pool.submit([&sum, &pool, i](std::size_t worker) {
+            EXPECT_LT(worker, pool.size());
+            sum += i;
+        });
+    }
+    pool.wait();
+    EXPECT_EQ(sum.load(), 500500);
+}
+
+TEST(WorkStealingPoolTest, NestedSubmit) {
+    WorkStealingPool pool(2);
+    std::atomic<int> count(0);
+    for (int i = 0; i < 10; ++i) {
+        pool.submit([&count, &pool](std::size_t) {
+            for (int j = 0; j < 10; ++j) {
+                pool.submit([&count](std::size_t) { ++count; });
+            }
+        });
+    }
+    pool.wait();
+    EXPECT_EQ(count.load(), 100);
+}
+
+TEST(ParallelEvaluatorTest, MatchesSequentialOutput) {
+    std::string input = makeInput(5000) + "2 ^ 3";
+
+    std::FILE* expected = std::tmpfile();
+    ASSERT_NE(expected, nullptr);
+    BatchStats sequentialStats;
+    {
+        Calculator calc;
+        BatchEvaluator evaluator(calc, fileno(expected));
+        evaluator.feed(input.data(), input.size());
+        evaluator.finish();
+        sequentialStats = evaluator.stats();
+    }
+
+    ParallelOptions options;
+    options.threads = 4;
+    options.chunkSize = 64;
+    options.chunksInFlight = 3;
+    ParallelEvaluator evaluator(options);
+    EXPECT_EQ(evaluator.threadCount(), 4);
+
+    std::FILE* actual = std::tmpfile();
+    ASSERT_NE(actual, nullptr);
+    evaluator.evaluate(input.data(), input.size(), fileno(actual));
+
+    EXPECT_EQ(readAll(actual), readAll(expected));
+    EXPECT_EQ(evaluator.stats().lines, sequentialStats.lines);
+    EXPECT_EQ(evaluator.stats().errors, sequentialStats.errors);
+    EXPECT_TRUE(evaluator.mergedHistory().empty());
+    std::fclose(actual);
+    std::fclose(expected);
+}
+
+TEST(ParallelEvaluatorTest, StreamInput) {
+    std::string input = makeInput(2000) + "7 * 6";
+    std::FILE* expected = std::tmpfile();
+    std::FILE* actual = std::tmpfile();
+    ASSERT_NE(expected, nullptr);
+    ASSERT_NE(actual, nullptr);
+    {
+        Calculator calc;
+        BatchEvaluator sequential(calc, fileno(expected));
+        sequential.feed(input.data(), input.size());
+        sequential.finish();
+    }
+
+    // A pipe cannot be mapped, so this exercises the streaming reader
+    int pipeFds[2];
+    ASSERT_EQ(::pipe(pipeFds), 0);
+    std::thread writer([&input, &pipeFds] {
+        std::size_t offset = 0;
+        while (offset < input.size()) {
+            std::size_t piece = std::min<std::size_t>(37, input.size() - offset);
+            ssize_t count = ::write(pipeFds[1], input.data() + offset, piece);
+            if (count <= 0) {
+                break;
+            }
+            offset += static_cast<std::size_t>(count);
+        }
+        ::close(pipeFds[1]);
+    });
+
+    ParallelOptions options;
+    options.threads = 3;
+    options.chunkSize = 100;
+    ParallelEvaluator evaluator(options);
+    evaluator.run("/dev/fd/" + std::to_string(pipeFds[0]), fileno(actual));
+    writer.join();
+    ::close(pipeFds[0]);
+
+    EXPECT_EQ(readAll(actual), readAll(expected));
+    EXPECT_EQ(evaluator.stats().lines, 2001);
+    std::fclose(actual);
+    std::fclose(expected);
+}
+
+TEST(ParallelEvaluatorTest, MergedHistoryInInputOrder) {
+    std::string input;
+    for (int i = 0; i < 150; ++i) {
+        input += std::to_string(i) + " + 1\n";
+    }
+    ParallelOptions options;
+    options.threads = 4;
+    options.chunkSize = 16;
+    options.recordHistory = true;
+    ParallelEvaluator evaluator(options);
+
+    std::FILE* sink = std::tmpfile();
+    ASSERT_NE(sink, nullptr);
+    evaluator.evaluate(input.data(), input.size(), fileno(sink));
+    std::fclose(sink);
+
+    auto history = evaluator.mergedHistory();
+    ASSERT_EQ(history.size(), HistoryBuffer::DEFAULT_CAPACITY);
+    EXPECT_EQ(history.front(), "50 + 1 = 51");
+    EXPECT_EQ(history.back(), "149 + 1 = 150");
+    for (std::size_t i = 0; i < history.size(); ++i) {
+        EXPECT_EQ(history[i], std::to_string(50 + i) + " + 1 = " + std::to_string(51 + i));
+    }
+}
+
+TEST(ParallelEvaluatorTest, MissingFile) {
+    ParallelEvaluator evaluator;
+    EXPECT_THROW(evaluator.run("/nonexistent/input.txt", 1), std::runtime_error);
+}
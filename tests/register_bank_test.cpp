@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "register_bank.h"
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int THREADS = 8;
+const int ADDS_PER_THREAD = 20000;
+
+void addConcurrently(SharedRegister& reg, double delta) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&reg, delta] {
+            for (int i = 0; i < ADDS_PER_THREAD; ++i) {
+                reg.add(delta);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace
+
+TEST(SharedRegisterTest, DirectOperations) {
+    SharedRegister reg;
+    EXPECT_EQ(reg.mode(), RegisterMode::Direct);
+    EXPECT_EQ(reg.load(), 0.0);
+    reg.store(5);
+    reg.add(3);
+    reg.subtract(1.5);
+    EXPECT_EQ(reg.load(), 6.5);
+    EXPECT_EQ(reg.fetchAdd(0.5), 6.5);
+    EXPECT_EQ(reg.load(), 7.0);
+    reg.clear();
+    EXPECT_EQ(reg.load(), 0.0);
+}
+
+TEST(SharedRegisterTest, ConcurrentAddsAreNotLost) {
+    SharedRegister direct;
+    addConcurrently(direct, 1.0);
+    EXPECT_EQ(direct.load(), static_cast<double>(THREADS * ADDS_PER_THREAD));
+
+    SharedRegister striped(RegisterMode::Striped, 4);
+    addConcurrently(striped, 1.0);
+    EXPECT_EQ(striped.load(), static_cast<double>(THREADS * ADDS_PER_THREAD));
+}
+
+TEST(SharedRegisterTest, StripedAddsAreCompensated) {
+    // 0.1 is inexact, so a plain running sum drifts; the compensated one
+    // matches the exact sum rounded once
+    SharedRegister striped(RegisterMode::Striped);
+    striped.store(1e10);
+    addConcurrently(striped, 0.1);
+    const double exact = 1e10 + 0.1 * THREADS * ADDS_PER_THREAD;
+    EXPECT_EQ(striped.load(), exact);
+
+    SharedRegister direct;
+    direct.store(1e10);
+    addConcurrently(direct, 0.1);
+    EXPECT_NE(direct.load(), exact);
+    EXPECT_NEAR(direct.load(), exact, 1.0);
+}
+
+TEST(SharedRegisterTest, StripedStoreResets) {
+    SharedRegister striped(RegisterMode::Striped, 3);
+    EXPECT_EQ(striped.mode(), RegisterMode::Striped);
+    striped.add(4);
+    striped.store(2);
+    striped.subtract(0.5);
+    EXPECT_EQ(striped.load(), 1.5);
+    EXPECT_THROW(striped.fetchAdd(1), std::logic_error);
+    striped.clear();
+    EXPECT_EQ(striped.load(), 0.0);
+}
+
+TEST(RegisterBankTest, NamedRegisters) {
+    RegisterBank bank;
+    EXPECT_EQ(bank.find("M"), nullptr);
+    SharedRegister& m = bank.at("M");
+    SharedRegister& total = bank.at("total", RegisterMode::Striped);
+    EXPECT_EQ(&bank.at("M"), &m);
+    EXPECT_EQ(bank.find("total"), &total);
+    EXPECT_THROW(bank.at("M", RegisterMode::Striped), std::invalid_argument);
+    EXPECT_EQ(bank.names(), (std::vector<std::string>{"M", "total"}));
+}
+
+TEST(RegisterBankTest, CalculatorMemoryOperations) {
+    RegisterBank bank;
+    SharedRegister& shared = bank.at("M", RegisterMode::Striped);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&shared] {
+            Calculator calc(0);
+            calc.attachMemory(&shared);
+            calc.appendNumber('2');
+            for (int i = 0; i < 1000; ++i) {
+                calc.memoryAdd();
+            }
+            calc.memorySubtract();
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    Calculator calc;
+    calc.attachMemory(&shared);
+    EXPECT_EQ(calc.getAttachedMemory(), &shared);
+    EXPECT_EQ(calc.memoryRecall(), 4 * 999 * 2.0);
+    EXPECT_EQ(calc.getDisplayText(), "7992");
+
+    calc.appendNumber('9');
+    calc.memoryStore();
+    EXPECT_EQ(shared.load(), 9.0);
+    calc.memoryClear();
+    EXPECT_EQ(shared.load(), 0.0);
+
+    // Detaching goes back to the calculator's own memory, which was untouched
+    calc.attachMemory(nullptr);
+    EXPECT_EQ(calc.memoryRecall(), 0.0);
+}
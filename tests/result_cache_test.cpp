@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "result_cache.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+#include <vector>
+
+namespace {
+
+bool sameBits(double a, double b) {
+    return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+} // namespace
+
+TEST(ResultCacheTest, KeysOnFunctionAndOperandBits) {
+    ResultCache cache(16);
+    double result = 0;
+    EXPECT_FALSE(cache.lookup(CachedFunction::Power, 2, 3, result));
+    cache.insert(CachedFunction::Power, 2, 3, 8);
+    ASSERT_TRUE(cache.lookup(CachedFunction::Power, 2, 3, result));
+    EXPECT_EQ(result, 8);
+    EXPECT_FALSE(cache.lookup(CachedFunction::Power, 3, 2, result));
+    EXPECT_FALSE(cache.lookup(CachedFunction::Ln, 2, 3, result));
+
+    cache.insert(CachedFunction::SinDegrees, 0.0, 0, 1);
+    EXPECT_FALSE(cache.lookup(CachedFunction::SinDegrees, -0.0, 0, result));
+    EXPECT_FALSE(cache.lookup(CachedFunction::SinRadians, 0.0, 0, result));
+
+    cache.clear();
+    EXPECT_FALSE(cache.lookup(CachedFunction::Power, 2, 3, result));
+}
+
+TEST(ResultCacheTest, StaysBounded) {
+    ResultCache cache(5);
+    EXPECT_EQ(cache.capacity(), 8u);
+    for (int i = 0; i < 1000; ++i) {
+        cache.insert(CachedFunction::Ln, i, 0, i * 0.5);
+    }
+    double result = 0;
+    int found = 0;
+    for (int i = 0; i < 1000; ++i) {
+        if (cache.lookup(CachedFunction::Ln, i, 0, result)) {
+            EXPECT_EQ(result, i * 0.5);
+            ++found;
+        }
+    }
+    EXPECT_LE(found, 8);
+    // The most recent insertion is always kept
+    EXPECT_TRUE(cache.lookup(CachedFunction::Ln, 999, 0, result));
+}
+
+TEST(ResultCacheTest, SharedCacheBasics) {
+    SharedResultCache cache(64);
+    double result = 0;
+    EXPECT_FALSE(cache.lookup(CachedFunction::CosRadians, 1, 0, result));
+    cache.insert(CachedFunction::CosRadians, 1, 0, std::cos(1.0));
+    ASSERT_TRUE(cache.lookup(CachedFunction::CosRadians, 1, 0, result));
+    EXPECT_TRUE(sameBits(result, std::cos(1.0)));
+    cache.clear();
+    EXPECT_FALSE(cache.lookup(CachedFunction::CosRadians, 1, 0, result));
+}
+
+TEST(ResultCacheTest, CalculatorResultsAreBitIdentical) {
+    Calculator plain(0);
+    Calculator cached(0);
+    cached.enableResultCache(256);
+    const double operands[] = {0.5, -0.0, 0.0, 2.0, 1e-300, 7.25, 1e10,
+                               std::numeric_limits<double>::infinity()};
+    for (int round = 0; round < 3; ++round) {
+        for (double x : operands) {
+            EXPECT_TRUE(sameBits(plain.sin(x), cached.sin(x)));
+            EXPECT_TRUE(sameBits(plain.cos(x), cached.cos(x)));
+            EXPECT_TRUE(sameBits(plain.tan(x), cached.tan(x)));
+            EXPECT_TRUE(sameBits(plain.power(x, 3.5), cached.power(x, 3.5)));
+            EXPECT_TRUE(sameBits(plain.power(-2, x), cached.power(-2, x)));
+            if (x > 0) {
+                EXPECT_TRUE(sameBits(plain.ln(x), cached.ln(x)));
+            }
+        }
+    }
+    CacheStats stats = cached.getResultCacheStats();
+    EXPECT_GT(stats.hits, 0u);
+    EXPECT_GT(stats.misses, 0u);
+    // At most the second and third rounds can hit
+    EXPECT_GT(stats.hitRate(), 0.5);
+    EXPECT_LE(stats.hitRate(), 2.0 / 3.0);
+
+    cached.resetResultCacheStats();
+    EXPECT_EQ(cached.getResultCacheStats().hits, 0u);
+    EXPECT_EQ(plain.getResultCacheStats().hits + plain.getResultCacheStats().misses, 0u);
+}
+
+TEST(ResultCacheTest, CalculatorStillRecordsHistoryAndErrors) {
+    Calculator calc;
+    calc.enableResultCache();
+    calc.power(2, 10);
+    calc.power(2, 10);
+    EXPECT_EQ(calc.getHistory().size(), 2u);
+    EXPECT_THROW(calc.ln(-1), std::domain_error);
+    EXPECT_THROW(calc.ln(-1), std::domain_error);
+    EXPECT_FALSE(calc.tryLn(0).ok());
+    EXPECT_EQ(calc.getResultCacheStats().hits, 1u);
+
+    calc.enableResultCache(0);
+    calc.power(2, 10);
+    EXPECT_EQ(calc.getResultCacheStats().hits, 1u);
+}
+
+TEST(ResultCacheTest, SharedCacheAcrossThreads) {
+    SharedResultCache cache(8192);
+    const int THREADS = 4;
+    std::vector<std::thread> threads;
+    std::vector<int> mismatches(THREADS, 0);
+    std::vector<CacheStats> stats(THREADS);
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&cache, &mismatches, &stats, t] {
+            Calculator calc(0);
+            calc.attachResultCache(&cache);
+            for (int round = 0; round < 50; ++round) {
+                for (int i = 0; i < 360; ++i) {
+                    double x = i * 0.25;
+                    if (!sameBits(calc.sin(x), std::sin(x)) ||
+                        !sameBits(calc.power(x, 1.5), std::pow(x, 1.5))) {
+                        ++mismatches[t];
+                    }
+                }
+            }
+            stats[t] = calc.getResultCacheStats();
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (int t = 0; t < THREADS; ++t) {
+        EXPECT_EQ(mismatches[t], 0);
+        EXPECT_GT(stats[t].hitRate(), 0.9);
+    }
+}
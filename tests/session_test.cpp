@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "session.h"
+#include "session_replay.h"
+#include "temp_dir.h"
+#include <cmath>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+// Records and replays one session file per test
+class SessionTest : public ::testing::Test {
+protected:
+    TempDir temp{"session_test"};
+    std::string path = temp.path("menu.session");
+};
+
+std::vector<SessionStep> additionSteps() {
+    std::vector<SessionStep> steps;
+    steps.push_back(SessionStep(SessionAction::EnterNumber, "12"));
+    steps.push_back(SessionStep(SessionAction::Add));
+    steps.push_back(SessionStep(SessionAction::EnterNumber, "3.5"));
+    steps.push_back(SessionStep(SessionAction::Calculate));
+    steps.push_back(SessionStep(SessionAction::MemoryStore));
+    steps.push_back(SessionStep(SessionAction::SquareRoot));
+    return steps;
+}
+
+} // namespace
+
+TEST(SessionStepTest, DrivesTheMenuStateMachine) {
+    Calculator calc;
+    std::vector<SessionStep> steps = additionSteps();
+    for (std::size_t i = 0; i + 1 < steps.size(); ++i) {
+        EXPECT_TRUE(std::isnan(performSessionStep(calc, steps[i])));
+    }
+    EXPECT_EQ(calc.getDisplayText(), "15.5");
+    double operand = 0;
+    EXPECT_DOUBLE_EQ(performSessionStep(calc, steps.back(), &operand), std::sqrt(15.5));
+    EXPECT_EQ(operand, 15.5);
+    ASSERT_EQ(calc.getHistory().size(), 3u);
+
+    calc.clear();
+    performSessionStep(calc, SessionStep(SessionAction::EnterNumber, "-4"));
+    EXPECT_THROW(performSessionStep(calc, SessionStep(SessionAction::SquareRoot)), std::domain_error);
+
+    performSessionStep(calc, SessionStep(SessionAction::ToggleAngleUnit));
+    EXPECT_FALSE(calc.isRadians());
+}
+
+TEST_F(SessionTest, RecordsAndReads) {
+    SessionSettings settings;
+    settings.precision = MathPrecision::High;
+    settings.radians = false;
+    Calculator calc;
+    settings.apply(calc);
+    {
+        SessionRecorder recorder(path, settings);
+        for (const SessionStep& step : additionSteps()) {
+            recorder.record(step);
+            performSessionStep(calc, step);
+        }
+        EXPECT_EQ(recorder.size(), additionSteps().size());
+        recorder.finish(calc);
+    }
+
+    Session session = readSession(path);
+    EXPECT_EQ(session.settings.precision, MathPrecision::High);
+    EXPECT_EQ(session.settings.decimalScale, -1);
+    EXPECT_FALSE(session.settings.radians);
+    ASSERT_EQ(session.steps.size(), additionSteps().size());
+    EXPECT_EQ(session.steps[0].action, SessionAction::EnterNumber);
+    EXPECT_EQ(session.steps[0].keys, "12");
+    EXPECT_EQ(session.steps[2].keys, "3.5");
+    EXPECT_EQ(session.steps[3].action, SessionAction::Calculate);
+    ASSERT_TRUE(session.hasOutcome);
+    EXPECT_EQ(session.display, "15.5");
+    EXPECT_EQ(session.history, calc.getHistory());
+
+    // 16-byte header, 9 bytes of steps, then the outcome
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    EXPECT_LT(static_cast<std::size_t>(file.tellg()), 16u + 9u + 128u);
+}
+
+TEST_F(SessionTest, UnfinishedRecordingHasNoOutcome) {
+    {
+        SessionSettings settings;
+        settings.decimalScale = 2;
+        SessionRecorder recorder(path, settings);
+        recorder.record(SessionStep(SessionAction::EnterNumber, "7"));
+        recorder.record(SessionStep(SessionAction::Clear));
+    }
+    Session session = readSession(path);
+    EXPECT_EQ(session.settings.decimalScale, 2);
+    EXPECT_EQ(session.steps.size(), 2u);
+    EXPECT_FALSE(session.hasOutcome);
+}
+
+TEST_F(SessionTest, RejectsDamagedRecordings) {
+    Session session;
+    session.steps.push_back(SessionStep(SessionAction::EnterNumber, "123456"));
+    writeSession(path, session);
+    EXPECT_EQ(readSession(path).steps[0].keys, "123456");
+
+    // Cut inside the keys of the step
+    truncate(path.c_str(), 16 + 4);
+    EXPECT_THROW(readSession(path), std::runtime_error);
+
+    {
+        std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+        file << "CALCHLOG and more than sixteen bytes";
+    }
+    EXPECT_THROW(readSession(path), std::runtime_error);
+    EXPECT_THROW(readSession(temp.path("missing")), std::runtime_error);
+}
+
+TEST_F(SessionTest, SyntheticSessionsAreReproducible) {
+    SessionProfile profile;
+    profile.steps = 300;
+    Session first = syntheticSession(profile, 42);
+    Session again = syntheticSession(profile, 42);
+    Session other = syntheticSession(profile, 43);
+    EXPECT_GE(first.steps.size(), 300u);
+    ASSERT_TRUE(first.hasOutcome);
+    EXPECT_EQ(first.history, again.history);
+    EXPECT_EQ(first.display, again.display);
+    EXPECT_NE(first.history, other.history);
+
+    writeSession(path, first);
+    Session read = readSession(path);
+    ASSERT_EQ(read.steps.size(), first.steps.size());
+    for (std::size_t i = 0; i < read.steps.size(); ++i) {
+        EXPECT_EQ(read.steps[i].action, first.steps[i].action);
+        EXPECT_EQ(read.steps[i].keys, first.steps[i].keys);
+    }
+    EXPECT_EQ(read.display, first.display);
+    EXPECT_EQ(read.history, first.history);
+}
+
+TEST(SessionReplayTest, ReplaysAndVerifiesConcurrently) {
+    SessionProfile profile;
+    profile.steps = 100;
+    std::vector<Session> sessions;
+    for (std::uint64_t seed = 1; seed <= 3; ++seed) {
+        sessions.push_back(syntheticSession(profile, seed));
+    }
+    profile.settings.decimalScale = 4;
+    sessions.push_back(syntheticSession(profile, 4));
+
+    SessionLoadOptions options;
+    options.instances = 200;
+    options.threads = 4;
+    SessionLoadReport report = runSessionLoad(sessions, options);
+    EXPECT_EQ(report.instances, 200u);
+    EXPECT_EQ(report.verified, 200u);
+    EXPECT_EQ(report.mismatches, 0u);
+    EXPECT_EQ(report.unverified, 0u);
+
+    std::uint64_t steps = 0;
+    for (std::size_t i = 0; i < options.instances; ++i) {
+        steps += sessions[i % sessions.size()].steps.size();
+    }
+    EXPECT_EQ(report.steps, steps);
+    std::uint64_t calculates = report.actions[static_cast<std::size_t>(SessionAction::Calculate)].calls;
+    EXPECT_GT(calculates, 0u);
+    EXPECT_GT(report.throughput, 0.0);
+    EXPECT_GE(report.latency.percentile(0.99), report.latency.percentile(0.50));
+}
+
+TEST(SessionReplayTest, ReportsMismatchesAndMissingOutcomes) {
+    SessionProfile profile;
+    profile.steps = 50;
+    std::vector<Session> sessions;
+    sessions.push_back(syntheticSession(profile, 7));
+    sessions.push_back(sessions[0]);
+    sessions[1].display = "0.1234";
+    sessions.push_back(sessions[0]);
+    sessions[2].hasOutcome = false;
+
+    SessionLoadOptions options;
+    options.instances = 9;
+    options.threads = 2;
+    options.maxMismatches = 2;
+    SessionLoadReport report = runSessionLoad(sessions, options);
+    EXPECT_EQ(report.verified, 3u);
+    EXPECT_EQ(report.mismatches, 3u);
+    EXPECT_EQ(report.unverified, 3u);
+    ASSERT_EQ(report.mismatchInstances.size(), 2u);
+    EXPECT_EQ(report.mismatchInstances[0], 1u);
+    EXPECT_EQ(report.mismatchInstances[1], 4u);
+
+    EXPECT_THROW(runSessionLoad(std::vector<Session>(), options), std::invalid_argument);
+}
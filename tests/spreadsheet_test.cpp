@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "spreadsheet.h"
+#include "work_stealing_pool.h"
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+TEST(SpreadsheetTest, FormulasOverNamedCells) {
+    Calculator calc;
+    Spreadsheet sheet(calc);
+    sheet.setValue("price", 20);
+    sheet.setValue("qty", 3);
+    sheet.setFormula("net", "price * qty");
+    sheet.setFormula("total", "net * (1 + tax)");
+    EXPECT_TRUE(sheet.contains("tax"));
+    EXPECT_TRUE(sheet.needsRecalculation());
+    EXPECT_EQ(sheet.recalculate(), 2u);
+    EXPECT_FALSE(sheet.needsRecalculation());
+    EXPECT_DOUBLE_EQ(sheet.value("net"), 60);
+    EXPECT_DOUBLE_EQ(sheet.value("total"), 60);
+
+    sheet.setValue("tax", 0.25);
+    EXPECT_EQ(sheet.recalculate(), 1u);
+    EXPECT_DOUBLE_EQ(sheet.value("total"), 75);
+    EXPECT_THROW(sheet.value("missing"), std::invalid_argument);
+}
+
+TEST(SpreadsheetTest, RecomputesOnlyWhatChanged) {
+    Calculator calc;
+    Spreadsheet sheet(calc);
+    sheet.setValue("a", 1);
+    sheet.setValue("b", 2);
+    sheet.setFormula("fromA", "a * 10");
+    sheet.setFormula("fromB", "b * 10");
+    sheet.setFormula("sign", "a / sqrt(a * a)");
+    sheet.setFormula("afterSign", "sign + 100");
+    sheet.recalculate();
+
+    sheet.setValue("b", 3);
+    EXPECT_EQ(sheet.recalculate(), 1u);
+    EXPECT_DOUBLE_EQ(sheet.value("fromB"), 30);
+
+    // sign stays 1, so afterSign is not recomputed
+    sheet.setValue("a", 5);
+    EXPECT_EQ(sheet.recalculate(), 2u);
+    EXPECT_DOUBLE_EQ(sheet.value("afterSign"), 101);
+
+    sheet.setValue("a", 5);
+    EXPECT_FALSE(sheet.needsRecalculation());
+    EXPECT_EQ(sheet.recalculate(), 0u);
+}
+
+TEST(SpreadsheetTest, RejectsCycles) {
+    Calculator calc;
+    Spreadsheet sheet(calc);
+    sheet.setFormula("b", "a + 1");
+    sheet.setFormula("c", "b * 2");
+    EXPECT_THROW(sheet.setFormula("a", "c - 1"), std::invalid_argument);
+    EXPECT_THROW(sheet.setFormula("a", "a + 1"), std::invalid_argument);
+    EXPECT_THROW(sheet.setFormula("a", "1 +"), std::invalid_argument);
+    sheet.setValue("a", 4);
+    sheet.recalculate();
+    EXPECT_DOUBLE_EQ(sheet.value("c"), 10);
+}
+
+TEST(SpreadsheetTest, ReplacingFormulasRewiresDependencies) {
+    Calculator calc;
+    Spreadsheet sheet(calc);
+    sheet.setValue("x", 1);
+    sheet.setValue("y", 2);
+    sheet.setFormula("f", "x + 1");
+    sheet.setFormula("g", "f * 2");
+    sheet.recalculate();
+    EXPECT_DOUBLE_EQ(sheet.value("g"), 4);
+
+    // f now reads a deeper chain; g must still come after it
+    sheet.setFormula("y2", "y * y");
+    sheet.setFormula("y3", "y2 + 1");
+    sheet.setFormula("f", "y3 + 1");
+    sheet.recalculate();
+    EXPECT_DOUBLE_EQ(sheet.value("g"), 12);
+
+    // x no longer feeds f
+    sheet.setValue("x", 100);
+    EXPECT_EQ(sheet.recalculate(), 0u);
+
+    sheet.setValue("f", 7);
+    sheet.recalculate();
+    EXPECT_DOUBLE_EQ(sheet.value("g"), 14);
+    sheet.setValue("y", 3);
+    sheet.recalculate();
+    EXPECT_DOUBLE_EQ(sheet.value("g"), 14);
+}
+
+TEST(SpreadsheetTest, ErrorsPropagateAndClear) {
+    Calculator calc;
+    Spreadsheet sheet(calc);
+    sheet.setValue("d", 0);
+    sheet.setFormula("q", "1 / d");
+    sheet.setFormula("r", "q + 1");
+    sheet.recalculate();
+    EXPECT_EQ(sheet.result("q").status, CalcStatus::DivisionByZero);
+    EXPECT_EQ(sheet.result("r").status, CalcStatus::DivisionByZero);
+    EXPECT_THROW(sheet.value("r"), std::domain_error);
+
+    sheet.setValue("d", 4);
+    sheet.recalculate();
+    EXPECT_DOUBLE_EQ(sheet.value("r"), 1.25);
+}
+
+TEST(SpreadsheetTest, UsesTheCalculatorAngleUnit) {
+    Calculator calc;
+    Spreadsheet sheet(calc);
+    sheet.setValue("t", 0.5);
+    sheet.setFormula("s", "sin(t)");
+    sheet.recalculate();
+    EXPECT_DOUBLE_EQ(sheet.value("s"), std::sin(0.5));
+
+    Calculator degrees;
+    degrees.setRadians(false);
+    Spreadsheet inDegrees(degrees);
+    inDegrees.setValue("A", 30);
+    inDegrees.setFormula("s", "sin(A)");
+    inDegrees.recalculate();
+    EXPECT_DOUBLE_EQ(inDegrees.value("s"), 0.5);
+}
+
+TEST(SpreadsheetTest, WideLevelsOnAPool) {
+    Calculator calc;
+    WorkStealingPool pool(4);
+    Spreadsheet parallel(calc, &pool);
+    Spreadsheet serial(calc);
+    const int CELLS = 3 * static_cast<int>(Spreadsheet::PARALLEL_LEVEL_SIZE);
+    for (Spreadsheet* sheet : {&parallel, &serial}) {
+        sheet->setValue("base", 2);
+        for (int i = 0; i < CELLS; ++i) {
+            const std::string name = "c" + std::to_string(i);
+            sheet->setFormula(name, "base * " + std::to_string(i) + " + sqrt(base)");
+            sheet->setFormula("d" + std::to_string(i), name + " * 2");
+        }
+        EXPECT_EQ(sheet->recalculate(), 2u * CELLS);
+        sheet->setValue("base", 3);
+        EXPECT_EQ(sheet->recalculate(), 2u * CELLS);
+    }
+    for (int i = 0; i < CELLS; i += 97) {
+        const std::string name = "d" + std::to_string(i);
+        EXPECT_EQ(parallel.value(name), serial.value(name));
+    }
+}
+
+TEST(SpreadsheetTest, RecalculatesInsideATaskOfItsPool) {
+    Calculator calc;
+    WorkStealingPool pool(1);
+    Spreadsheet sheet(calc, &pool);
+    const int CELLS = static_cast<int>(Spreadsheet::PARALLEL_LEVEL_SIZE);
+    sheet.setValue("base", 2);
+    for (int i = 0; i < CELLS; ++i) {
+        sheet.setFormula("c" + std::to_string(i), "base + " + std::to_string(i));
+    }
+    std::size_t recalculated = 0;
+    {
+        // The only worker runs the recalculation that fans out
+        TaskGroup group(pool);
+        group.submit([&](std::size_t) { recalculated = sheet.recalculate(); });
+    }
+    EXPECT_EQ(recalculated, static_cast<std::size_t>(CELLS));
+    EXPECT_EQ(sheet.value("c4000"), 4002);
+}
@@ -0,0 +1,73 @@
+/**
+ * @file temp_dir.h
+ * @brief Private temporary directory for tests that write files
+ */
+
+#ifndef TEMP_DIR_H
+#define TEMP_DIR_H
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+/**
+ * @class TempDir
+ * @brief Creates /tmp/<prefix>XXXXXX and removes it with its files
+ *
+ * Meant as a test fixture member: every test gets a fresh directory,
+ * and whatever the test left in it is deleted afterwards.
+ */
+class TempDir {
+public:
+    /**
+     * @param prefix Start of the directory name, e.g. "trace_test"
+     * @throw std::runtime_error if the directory cannot be created
+     */
+    explicit TempDir(const std::string& prefix) {
+        const std::string pattern = "/tmp/" + prefix + "XXXXXX";
+        std::vector<char> name(pattern.begin(), pattern.end());
+        name.push_back('\0');
+        if (mkdtemp(name.data()) == nullptr) {
+            throw std::runtime_error("Cannot create temporary directory " + pattern);
+        }
+        dir = name.data();
+    }
+
+    ~TempDir() {
+        if (DIR* listing = opendir(dir.c_str())) {
+            while (dirent* entry = readdir(listing)) {
+                const std::string entryName = entry->d_name;
+                if (entryName != "." && entryName != "..") {
+                    std::remove((dir + "/" + entryName).c_str());
+                }
+            }
+            closedir(listing);
+        }
+        rmdir(dir.c_str());
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    /// Path of the directory
+    const std::string& directory() const { return dir; }
+
+    /// Path of a file in the directory
+    std::string path(const std::string& name) const { return dir + "/" + name; }
+
+    /// Creates a file in the directory with the given contents; returns its path
+    std::string write(const std::string& name, const std::string& contents) const {
+        std::string file = path(name);
+        std::ofstream(file.c_str(), std::ios::binary) << contents;
+        return file;
+    }
+
+private:
+    std::string dir;
+};
+
+#endif // TEMP_DIR_H
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+#include "calculator.h"
+#include "trace.h"
+#include "temp_dir.h"
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef CALCULATOR_METRICS
+
+namespace {
+
+struct Span {
+    std::string name;
+    unsigned long tid;
+    double ts;
+    double dur;
+};
+
+// Traces into a file that is deleted after each test
+class TraceTest : public ::testing::Test {
+protected:
+    void TearDown() override {
+        stopTracing();
+    }
+
+    std::string contents() const {
+        std::ifstream file(path.c_str());
+        return std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    // The complete events, one per line as the tracer writes them
+    std::vector<Span> spans() const {
+        std::vector<Span> result;
+        std::ifstream file(path.c_str());
+        std::string line;
+        while (std::getline(file, line)) {
+            if (line.find("\"ph\":\"X\"") == std::string::npos) {
+                continue;
+            }
+            Span span;
+            char name[64];
+            int fields = std::sscanf(line.c_str(), "{\"name\":\"%63[^\"]\",\"ph\":\"X\",\"pid\":1,\"tid\":%lu,"
+                                     "\"ts\":%lf,\"dur\":%lf", name, &span.tid, &span.ts, &span.dur);
+            EXPECT_EQ(fields, 4) << line;
+            span.name = name;
+            result.push_back(span);
+        }
+        return result;
+    }
+
+    TempDir temp{"trace_test"};
+    std::string path = temp.path("calculator.json");
+};
+
+} // namespace
+
+TEST_F(TraceTest, WritesNestedSpans) {
+    EXPECT_FALSE(tracingEnabled());
+    startTracing(path);
+    EXPECT_TRUE(tracingEnabled());
+    EXPECT_THROW(startTracing(path), std::logic_error);
+
+    Calculator calc;
+    calc.appendNumber('8');
+    calc.setOperation('/');
+    calc.appendNumber('0');
+    calc.calculate();
+    {
+        TraceSpan span("custom_step");
+        calc.sqrt(2);
+    }
+    TraceStats stats = stopTracing();
+    EXPECT_FALSE(tracingEnabled());
+    EXPECT_EQ(stats.dropped, 0u);
+
+    std::string text = contents();
+    EXPECT_EQ(text.compare(0, 16, "{\"traceEvents\":["), 0);
+    EXPECT_NE(text.find("\"dropped_spans\":\"0\"}}\n"), std::string::npos);
+    EXPECT_NE(text.find("\"name\":\"divide\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(text.find("\"args\":{\"error\":true}"), std::string::npos);
+    EXPECT_NE(text.find("\"name\":\"thread_name\""), std::string::npos);
+
+    std::vector<Span> all = spans();
+    ASSERT_EQ(all.size(), stats.written);
+    const Span* calculate = nullptr;
+    const Span* divide = nullptr;
+    const Span* custom = nullptr;
+    const Span* sqrt = nullptr;
+    for (const Span& span : all) {
+        if (span.name == "calculate") calculate = &span;
+        if (span.name == "divide") divide = &span;
+        if (span.name == "custom_step") custom = &span;
+        if (span.name == "sqrt") sqrt = &span;
+    }
+    ASSERT_TRUE(calculate && divide && custom && sqrt);
+    // calculate() runs the division inside its own span
+    EXPECT_LE(calculate->ts, divide->ts);
+    EXPECT_GE(calculate->ts + calculate->dur, divide->ts + divide->dur);
+    EXPECT_LE(custom->ts, sqrt->ts);
+    EXPECT_GE(custom->ts + custom->dur, sqrt->ts + sqrt->dur);
+
+    EXPECT_EQ(stopTracing().written, 0u);
+}
+
+TEST_F(TraceTest, SeparatesThreads) {
+    startTracing(path);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.push_back(std::thread([] {
+            Calculator calc;
+            for (int i = 0; i < 100; ++i) {
+                calc.add(i, 1);
+            }
+        }));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    TraceStats stats = stopTracing();
+
+    std::set<unsigned long> tids;
+    std::size_t adds = 0;
+    for (const Span& span : spans()) {
+        if (span.name == "add") {
+            ++adds;
+            tids.insert(span.tid);
+        }
+    }
+    EXPECT_EQ(adds, 400u);
+    EXPECT_EQ(tids.size(), 4u);
+    EXPECT_EQ(stats.dropped, 0u);
+}
+
+TEST_F(TraceTest, DropsWhenTheBufferIsFull) {
+    TraceOptions options;
+    options.bufferEvents = 8;
+    options.flushMilliseconds = 1000;
+    startTracing(path, options);
+    // A new thread gets a buffer of the new size
+    std::thread worker([] {
+        Calculator calc;
+        calc.setHistoryCapacity(0);
+        for (int i = 0; i < 100; ++i) {
+            calc.multiply(i, 2);
+        }
+    });
+    worker.join();
+    TraceStats stats = stopTracing();
+    EXPECT_EQ(stats.written, 8u);
+    EXPECT_EQ(stats.written + stats.dropped, 200u);
+    EXPECT_NE(contents().find("\"dropped_spans\":\"192\""), std::string::npos);
+}
+
+TEST_F(TraceTest, FiltersAndSamples) {
+    TraceOptions options;
+    options.minNanoseconds = 1000000000;
+    startTracing(path, options);
+    Calculator calc;
+    calc.add(1, 2);
+    EXPECT_EQ(stopTracing().written, 0u);
+
+    options = TraceOptions();
+    options.sampleFraction = 0.5;
+    options.samplePeriodMicroseconds = 1000;
+    startTracing(path, options);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(tracingEnabled());
+    stopTracing();
+    EXPECT_EQ(instrumentationFlags.load() & INSTRUMENT_TRACING, 0u);
+
+    options.sampleFraction = 0;
+    EXPECT_THROW(startTracing(path, options), std::invalid_argument);
+    EXPECT_THROW(startTracing(temp.path("missing/trace.json")), std::runtime_error);
+    EXPECT_FALSE(tracingEnabled());
+}
+
+#endif // CALCULATOR_METRICS